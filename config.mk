@@ -45,3 +45,9 @@ THIRDPARTY += nlohmann
 
 ## 编译配置
 CCFLAGS += -DENABLE_TRACE_RECORDER=1
+
+## 编译需要 C++20 的测试，如 C++20 协程 coroutine/task.hpp 的测试，需编译器支持 C++20
+#ENABLE_CXX20_TEST = yes
+
+## 使用 libzstd 压缩日志与trace文件，需同时在链接应用时加上 -lzstd
+#CCFLAGS += -DTBOX_ENABLE_ZSTD=1
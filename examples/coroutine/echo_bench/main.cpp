@@ -0,0 +1,221 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+/**
+ * 回显服务的性能对比：协程 + FdIo 与 回调式的 network::TcpServer
+ *
+ * 服务端运行在主线程的 Loop 中，客户端为 conn_num 个线程，各自用阻塞的 socket
+ * 不停地发送 msg_size 字节并等待回显，最后统计每秒的往返次数。
+ */
+
+#include <unistd.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tbox/base/log.h>
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+#include <tbox/coroutine/scheduler.h>
+#include <tbox/coroutine/fd_io.h>
+#include <tbox/network/tcp_server.h>
+
+using namespace std;
+using namespace tbox;
+
+namespace {
+
+void PrintUsage(const char *prog)
+{
+    cout << "Usage: " << prog << " <co|cb> [conn_num] [seconds] [msg_size] [port]" << endl
+         << "  co: coroutine + FdIo echo server" << endl
+         << "  cb: callback-based network::TcpServer echo server" << endl
+         << "Exp  : " << prog << " co 50 5 64" << endl;
+}
+
+//! 协程版：一个协程 accept，每个连接一个协程回显
+bool StartCoroutineServer(coroutine::Scheduler &sch, uint16_t port)
+{
+    int listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int opt = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd, 1024) != 0) {
+        ::close(listen_fd);
+        return false;
+    }
+
+    sch.create(
+        [listen_fd] (coroutine::Scheduler &sch) {
+            coroutine::FdIo listen_io(sch, listen_fd);
+            for (;;) {
+                int conn_fd = listen_io.accept();
+                if (conn_fd < 0)
+                    break;
+
+                sch.create(
+                    [conn_fd] (coroutine::Scheduler &sch) {
+                        coroutine::FdIo io(sch, conn_fd);
+                        char buff[4096];
+                        for (;;) {
+                            auto rsize = io.read(buff, sizeof(buff));
+                            if (rsize <= 0 || io.write(buff, rsize) != rsize)
+                                break;
+                        }
+                        ::close(conn_fd);
+                    }, true, "echo", 16 << 10
+                );
+            }
+            ::close(listen_fd);
+        }, true, "accept"
+    );
+    return true;
+}
+
+//! 客户端线程：阻塞地发送与等待回显
+void ClientThread(int fd, uint16_t port, size_t msg_size, const atomic_bool &is_stop, atomic<uint64_t> &round_trips)
+{
+    int opt = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    std::string msg(msg_size, 'x');
+    std::vector<char> buff(msg_size);
+    uint64_t count = 0;
+    while (!is_stop) {
+        if (::write(fd, msg.data(), msg.size()) != static_cast<ssize_t>(msg.size()))
+            break;
+
+        size_t recv_size = 0;
+        while (recv_size < msg_size) {
+            auto rsize = ::read(fd, buff.data() + recv_size, msg_size - recv_size);
+            if (rsize <= 0)
+                goto quit;
+            recv_size += rsize;
+        }
+        ++count;
+    }
+
+quit:
+    round_trips += count;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    std::string mode = argv[1];
+    size_t conn_num = argc > 2 ? stoul(argv[2]) : 50;
+    int seconds = argc > 3 ? stoi(argv[3]) : 5;
+    size_t msg_size = argc > 4 ? stoul(argv[4]) : 64;
+    uint16_t port = argc > 5 ? stoi(argv[5]) : 23456;
+
+    if ((mode != "co" && mode != "cb") || conn_num == 0 || seconds <= 0 || msg_size == 0) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    //! 连接断开时写数据，不要因 SIGPIPE 退出
+    ::signal(SIGPIPE, SIG_IGN);
+
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    coroutine::Scheduler sch(sp_loop);
+    network::TcpServer server(sp_loop);
+
+    if (mode == "co") {
+        if (!StartCoroutineServer(sch, port)) {
+            cerr << "start coroutine server fail" << endl;
+            return 1;
+        }
+    } else {
+        auto bind_addr = network::SockAddr::FromString("127.0.0.1:" + to_string(port));
+        if (!server.initialize(bind_addr, 1024)) {
+            cerr << "start tcp server fail" << endl;
+            return 1;
+        }
+        server.setReceiveCallback(
+            [&server] (const network::TcpServer::ConnToken &client, network::Buffer &buff) {
+                server.send(client, buff.readableBegin(), buff.readableSize());
+                buff.hasReadAll();
+            }, 0
+        );
+        server.start();
+    }
+
+    atomic_bool is_stop(false);
+    atomic<uint64_t> round_trips(0);
+    vector<int> client_fds;
+    vector<thread> clients;
+    for (size_t i = 0; i < conn_num; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        client_fds.push_back(fd);
+        clients.emplace_back(ClientThread, fd, port, msg_size, std::cref(is_stop), std::ref(round_trips));
+    }
+
+    sp_loop->exitLoop(chrono::seconds(seconds));
+    auto start_ts = chrono::steady_clock::now();
+    sp_loop->runLoop();
+    auto cost_ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_ts).count();
+
+    //! 先停客户端，主动 shutdown 客户端的连接，使阻塞在 read() 的线程返回
+    is_stop = true;
+    for (int fd : client_fds)
+        ::shutdown(fd, SHUT_RDWR);
+    for (auto &t : clients)
+        t.join();
+    for (int fd : client_fds)
+        ::close(fd);
+
+    server.stop();
+    sch.cleanup();
+
+    cout << "mode: " << mode << ", conn_num: " << conn_num << ", msg_size: " << msg_size
+         << ", round trips: " << round_trips
+         << ", " << round_trips * 1000 / (cost_ms > 0 ? cost_ms : 1) << "/s" << endl;
+    return 0;
+}
@@ -122,6 +122,20 @@ endef
 
 $(foreach src,$(TEST_CPP_SRC_FILES),$(eval $(call CREATE_CPP_TEST_OBJECT,$(src))))
 
+# 需要 C++20 的测试，在 config.mk 中打开 ENABLE_CXX20_TEST 才编译
+ifeq ($(ENABLE_CXX20_TEST),yes)
+TEST_OBJECTS += $(foreach src,$(TEST_CXX20_CPP_SRC_FILES),$(call CPP_SOURCE_TO_TEST_OBJECT,$(src)))
+endif
+
+define CREATE_CPP20_TEST_OBJECT
+$(call CPP_SOURCE_TO_TEST_OBJECT,$(1)) : $(1)
+	@echo "\033[32mCXX $$^\033[0m"
+	@install -d $$(dir $$@)
+	@$(CXX) $(TEST_CXXFLAGS) -std=c++20 -o $$@ -c $$^
+endef
+
+$(foreach src,$(TEST_CXX20_CPP_SRC_FILES),$(eval $(call CREATE_CPP20_TEST_OBJECT,$(src))))
+
 print_test_vars :
 	@echo TEST_CXXFLAGS=$(TEST_CXXFLAGS)
 	@echo TEST_OBJECTS=$(TEST_OBJECTS)
@@ -22,10 +22,16 @@
 #include <sys/time.h>
 #include <sys/syscall.h>
 #include <unistd.h>
+#include <time.h>
+#include <cstdio>
 #include <cstring>
+#include <string>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 
 namespace {
@@ -70,6 +76,307 @@ void Dispatch(const LogContent &content)
     }
 }
 
+LogContent MakeContent(const char *module_id, const char *func_name, const char *file_name,
+                       int line, int level)
+{
+    if (level < 0) level = 0;
+    if (level >= LOG_LEVEL_MAX) level = (LOG_LEVEL_MAX - 1);
+
+    const char *module_id_be_print = (module_id != nullptr) ? module_id : "???";
+
+    struct timeval tv;
+    struct timezone tz;
+    gettimeofday(&tv, &tz);
+
+    LogContent content = {
+        .thread_id = syscall(SYS_gettid),
+        .timestamp = {
+            .sec  = static_cast<uint32_t>(tv.tv_sec),
+            .usec = static_cast<uint32_t>(tv.tv_usec),
+        },
+        .module_id = module_id_be_print,
+        .func_name = func_name,
+        .file_name = Basename(file_name),
+        .line = line,
+        .level = level,
+        .text_len = 0,
+        .text_ptr = nullptr,
+        .text_trunc = false,
+        .field_num = 0,
+        .fields = nullptr,
+    };
+    return content;
+}
+
+//! 字串值中含有这些字符时，文本形式要加引号
+bool IsNeedQuote(const char *ptr, uint32_t len)
+{
+    if (len == 0)
+        return true;
+    for (uint32_t i = 0; i < len; ++i) {
+        char c = ptr[i];
+        if (c == ' ' || c == '"' || c == '=' || c == '\\' || c == '\n' || c == '\t')
+            return true;
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// 限流
+/////////////////////////////////////////////////////////////////////////////
+
+//! 重复的日志最长合并多久就要输出一次汇总
+const uint64_t kRepeatSummaryIntervalUs = 30 * 1000000ull;
+
+struct ModuleLimit {
+    LogLimitConfig config;
+};
+
+struct CallSiteKey {
+    const char *file_name;
+    int line;
+
+    bool operator == (const CallSiteKey &other) const {
+        return file_name == other.file_name && line == other.line;
+    }
+};
+
+struct CallSiteKeyHash {
+    size_t operator () (const CallSiteKey &key) const {
+        return std::hash<const void*>()(key.file_name) ^ (static_cast<size_t>(key.line) * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+//! 调用点的限流状态
+struct CallSite {
+    const char *module_id = nullptr;
+    const char *func_name = nullptr;
+    const char *file_name = nullptr;
+    int line = 0;
+    int level = 0;
+
+    ModuleLimit *limit = nullptr;   //!< 所属模块的配置，为nullptr表示不限
+    LogLimitStats *stats = nullptr; //!< 所属模块的统计，即使使用的是默认配置，也按模块各自统计
+    uint32_t limit_gen = 0;         //!< 与 _limit_gen 不同时要重新查找 limit
+
+    double   tokens = 0;
+    uint64_t refill_us = 0;
+    uint64_t dropped = 0;           //!< 还没有输出汇总的丢弃条数
+
+    bool     has_last = false;
+    uint64_t last_hash = 0;
+    uint64_t repeated = 0;          //!< 还没有输出汇总的重复条数
+    uint64_t repeat_start_us = 0;
+};
+
+//! 需要输出的汇总信息
+struct Summary {
+    bool is_valid = false;
+    const char *module_id = nullptr;
+    const char *func_name = nullptr;
+    const char *file_name = nullptr;
+    int line = 0;
+    int level = 0;
+    uint64_t dropped = 0;
+    uint64_t repeated = 0;
+
+    //! 取走调用点中待汇总的计数
+    void take(CallSite &site) {
+        is_valid = true;
+        module_id = site.module_id;
+        func_name = site.func_name;
+        file_name = site.file_name;
+        line = site.line;
+        level = site.level;
+        dropped = site.dropped;
+        repeated = site.repeated;
+        site.dropped = 0;
+        site.repeated = 0;
+    }
+};
+
+std::mutex _limit_lock;
+std::atomic_bool _limit_enabled(false);
+uint32_t _limit_gen = 1;
+std::map<std::string, ModuleLimit> _module_limits;
+std::map<std::string, LogLimitStats> _module_stats;   //!< 各模块的统计，取消配置后仍保留
+std::unordered_map<CallSiteKey, CallSite, CallSiteKeyHash> _call_sites;
+
+uint64_t MonotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void HashBytes(uint64_t &hash, const void *data, size_t size)
+{
+    auto p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001B3ull;
+    }
+}
+
+uint64_t HashContent(const LogContent &content)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    HashBytes(hash, content.text_ptr, content.text_len);
+    for (uint32_t i = 0; i < content.field_num; ++i) {
+        auto &field = content.fields[i];
+        HashBytes(hash, &field.key, sizeof(field.key));
+        if (field.type == LOG_FIELD_STR)
+            HashBytes(hash, field.value.s.ptr, field.value.s.len);
+        else
+            HashBytes(hash, &field.value, sizeof(field.value));
+    }
+    return hash;
+}
+
+void DispatchSummary(const Summary &summary);
+
+/**
+ * 一条日志的限流过程
+ *
+ * 格式化之前调用 checkRate()，按调用点的令牌桶决定是否丢弃；
+ * 格式化之后调用 checkRepeat()，与该调用点的上一条比较，决定是否合并。
+ * 需要输出的汇总在释放 _limit_lock 之后才派发，先于本条日志输出。
+ */
+class Limiter {
+  public:
+    //! \return false 表示超出速率，应丢弃
+    bool checkRate(const LogContent &content, const char *file_name)
+    {
+        if (!_limit_enabled.load(std::memory_order_relaxed))
+            return true;
+
+        Summary summary;
+        {
+            std::lock_guard<std::mutex> lg(_limit_lock);
+            site_ = findSite(content, file_name);
+            if (site_ == nullptr)
+                return true;
+
+            auto &config = site_->limit->config;
+            if (config.rate > 0) {
+                uint64_t now_us = MonotonicUs();
+                double burst = config.burst > 0 ? config.burst : config.rate;
+                if (site_->refill_us == 0) {
+                    site_->tokens = burst;
+                } else {
+                    site_->tokens += (now_us - site_->refill_us) * config.rate / 1000000.0;
+                    if (site_->tokens > burst)
+                        site_->tokens = burst;
+                }
+                site_->refill_us = now_us;
+
+                if (site_->tokens < 1) {
+                    ++site_->dropped;
+                    ++site_->stats->dropped;
+                    site_ = nullptr;
+                    return false;
+                }
+                site_->tokens -= 1;
+            }
+
+            if (site_->dropped > 0)
+                summary.take(*site_);
+
+            if (!config.merge_repeat)
+                site_ = nullptr;
+        }
+
+        if (summary.is_valid)
+            DispatchSummary(summary);
+        return true;
+    }
+
+    //! \return false 表示与上一条重复，已合并
+    bool checkRepeat(const LogContent &content)
+    {
+        if (site_ == nullptr)
+            return true;
+
+        uint64_t hash = HashContent(content);
+        Summary summary;
+        bool is_pass = true;
+        {
+            std::lock_guard<std::mutex> lg(_limit_lock);
+            //! 期间配置被修改过，site_->limit 可能已失效；
+            //! 其它线程也可能已按新配置重新查找过，要再检查一次配置
+            if (site_->limit_gen != _limit_gen ||
+                site_->limit == nullptr || !site_->limit->config.merge_repeat)
+                return true;
+
+            if (site_->has_last && site_->last_hash == hash) {
+                uint64_t now_us = MonotonicUs();
+                if (site_->repeated == 0)
+                    site_->repeat_start_us = now_us;
+                ++site_->repeated;
+                ++site_->stats->merged;
+                is_pass = false;
+
+                //! 长时间重复，也要定期输出汇总
+                if (now_us - site_->repeat_start_us >= kRepeatSummaryIntervalUs)
+                    summary.take(*site_);
+
+            } else {
+                if (site_->repeated > 0)
+                    summary.take(*site_);
+                site_->has_last = true;
+                site_->last_hash = hash;
+            }
+        }
+
+        if (summary.is_valid)
+            DispatchSummary(summary);
+        return is_pass;
+    }
+
+  private:
+    CallSite* findSite(const LogContent &content, const char *file_name)
+    {
+        auto &site = _call_sites[CallSiteKey{file_name, content.line}];
+        if (site.limit_gen != _limit_gen) {
+            site.module_id = content.module_id;
+            site.func_name = content.func_name;
+            site.file_name = file_name;
+            site.line = content.line;
+            site.limit_gen = _limit_gen;
+
+            auto iter = _module_limits.find(content.module_id);
+            if (iter == _module_limits.end())
+                iter = _module_limits.find("");
+            site.limit = (iter != _module_limits.end()) ? &iter->second : nullptr;
+            site.stats = &_module_stats[content.module_id != nullptr ? content.module_id : ""];
+        }
+        site.level = content.level;
+        return site.limit != nullptr ? &site : nullptr;
+    }
+
+    CallSite *site_ = nullptr;  //!< 需要检查重复的调用点
+};
+
+void DispatchSummary(const Summary &summary)
+{
+    char text[128];
+    LogContent content = MakeContent(summary.module_id, summary.func_name, summary.file_name,
+                                     summary.line, summary.level);
+    content.text_ptr = text;
+
+    if (summary.dropped > 0) {
+        content.text_len = ::snprintf(text, sizeof(text), "%llu messages dropped by rate limit",
+                                      static_cast<unsigned long long>(summary.dropped));
+        Dispatch(content);
+    }
+
+    if (summary.repeated > 0) {
+        content.text_len = ::snprintf(text, sizeof(text), "last message repeated %llu times",
+                                      static_cast<unsigned long long>(summary.repeated));
+        Dispatch(content);
+    }
+}
+
 }
 
 const char  LOG_LEVEL_LEVEL_CODE[LOG_LEVEL_MAX] = {
@@ -115,30 +422,11 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
     if (CantDispatch())
         return;
 
-    if (level < 0) level = 0;
-    if (level >= LOG_LEVEL_MAX) level = (LOG_LEVEL_MAX - 1);
-
-    const char *module_id_be_print = (module_id != nullptr) ? module_id : "???";
-
-    struct timeval tv;
-    struct timezone tz;
-    gettimeofday(&tv, &tz);
+    LogContent content = MakeContent(module_id, func_name, file_name, line, level);
 
-    LogContent content = {
-        .thread_id = syscall(SYS_gettid),
-        .timestamp = {
-            .sec  = static_cast<uint32_t>(tv.tv_sec),
-            .usec = static_cast<uint32_t>(tv.tv_usec),
-        },
-        .module_id = module_id_be_print,
-        .func_name = func_name,
-        .file_name = Basename(file_name),
-        .line = line,
-        .level = level,
-        .text_len = 0,
-        .text_ptr = nullptr,
-        .text_trunc = false,
-    };
+    Limiter limiter;
+    if (!limiter.checkRate(content, file_name))
+        return;
 
     if (fmt != nullptr) {
         if (with_args) {
@@ -163,7 +451,8 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
                 if (len < buff_size) {
                     content.text_len = len;
                     content.text_ptr = buffer;
-                    Dispatch(content);
+                    if (limiter.checkRepeat(content))
+                        Dispatch(content);
                     break;
                 }
 
@@ -187,14 +476,217 @@ void LogPrintfFunc(const char *module_id, const char *func_name, const char *fil
             }
 
             content.text_ptr = fmt;
-            Dispatch(content);
+            if (limiter.checkRepeat(content))
+                Dispatch(content);
         }
 
-    } else {
+    } else if (limiter.checkRepeat(content)) {
         Dispatch(content);
     }
 }
 
+/**
+ * \brief   结构化日志打印接口的实现
+ *
+ * 消息与字段都不做格式化，打包成 LogContent 后直接派发
+ */
+void LogKvFunc(const char *module_id, const char *func_name, const char *file_name,
+               int line, int level, const char *msg, const LogField *fields, uint32_t field_num)
+{
+    if (CantDispatch())
+        return;
+
+    LogContent content = MakeContent(module_id, func_name, file_name, line, level);
+
+    Limiter limiter;
+    if (!limiter.checkRate(content, file_name))
+        return;
+
+    if (msg != nullptr) {
+        content.text_len = ::strlen(msg);
+        content.text_ptr = msg;
+    }
+
+    if (content.text_len > _LogTextMaxLength) {
+        content.text_len = _LogTextMaxLength;
+        content.text_trunc = true;
+    }
+
+    content.field_num = field_num;
+    content.fields = fields;
+
+    //! 过长的字串值也要截断
+    for (uint32_t i = 0; i < field_num; ++i) {
+        if (fields[i].type == LOG_FIELD_STR && fields[i].value.s.len > _LogTextMaxLength) {
+            std::vector<LogField> trunc_fields(fields, fields + field_num);
+            for (auto &field : trunc_fields) {
+                if (field.type == LOG_FIELD_STR && field.value.s.len > _LogTextMaxLength)
+                    field.value.s.len = _LogTextMaxLength;
+            }
+            content.fields = trunc_fields.data();
+            content.text_trunc = true;
+            if (limiter.checkRepeat(content))
+                Dispatch(content);
+            return;
+        }
+    }
+
+    if (limiter.checkRepeat(content))
+        Dispatch(content);
+}
+
+void LogSetLimit(const char *module_id, const LogLimitConfig *config)
+{
+    if (module_id == nullptr || config == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> lg(_limit_lock);
+    auto &limit = _module_limits[module_id];
+    limit.config = *config;
+    ++_limit_gen;
+    _limit_enabled = true;
+}
+
+bool LogUnsetLimit(const char *module_id)
+{
+    if (module_id == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lg(_limit_lock);
+    if (_module_limits.erase(module_id) == 0)
+        return false;
+
+    ++_limit_gen;
+    _limit_enabled = !_module_limits.empty();
+    return true;
+}
+
+bool LogGetLimitStats(const char *module_id, LogLimitStats *stats)
+{
+    if (stats == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lg(_limit_lock);
+    if (module_id != nullptr) {
+        auto iter = _module_stats.find(module_id);
+        if (iter != _module_stats.end()) {
+            *stats = iter->second;
+            return true;
+        }
+        //! 已配置但还没有日志经过限流
+        if (_module_limits.find(module_id) == _module_limits.end())
+            return false;
+        stats->dropped = stats->merged = 0;
+
+    } else {
+        stats->dropped = stats->merged = 0;
+        for (auto &item : _module_stats) {
+            stats->dropped += item.second.dropped;
+            stats->merged += item.second.merged;
+        }
+    }
+    return true;
+}
+
+void LogForeachLimitStats(LogLimitStatsFuncType func, void *ptr)
+{
+    if (func == nullptr)
+        return;
+
+    //! 先复制出来，回调中可以再调用日志接口
+    std::vector<std::pair<std::string, LogLimitStats>> all_stats;
+    {
+        std::lock_guard<std::mutex> lg(_limit_lock);
+        all_stats.assign(_module_stats.begin(), _module_stats.end());
+    }
+
+    for (auto &item : all_stats)
+        func(item.first.c_str(), &item.second, ptr);
+}
+
+void LogFlushLimit()
+{
+    if (!_limit_enabled)
+        return;
+
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> lg(_limit_lock);
+        for (auto &item : _call_sites) {
+            auto &site = item.second;
+            if (site.dropped > 0 || site.repeated > 0) {
+                Summary summary;
+                summary.take(site);
+                summaries.push_back(summary);
+            }
+            //! 汇总之后，下一条相同的日志要正常输出
+            site.has_last = false;
+        }
+    }
+
+    for (auto &summary : summaries)
+        DispatchSummary(summary);
+}
+
+}
+
+namespace tbox {
+
+void LogAppendFieldsAsText(const LogField *fields, uint32_t field_num, std::string &out)
+{
+    char buff[32];
+    for (uint32_t i = 0; i < field_num; ++i) {
+        auto &field = fields[i];
+        out += ' ';
+        out += field.key;
+        out += '=';
+
+        switch (field.type) {
+            case LOG_FIELD_INT:
+                ::snprintf(buff, sizeof(buff), "%lld", static_cast<long long>(field.value.i));
+                out += buff;
+                break;
+            case LOG_FIELD_UINT:
+                ::snprintf(buff, sizeof(buff), "%llu", static_cast<unsigned long long>(field.value.u));
+                out += buff;
+                break;
+            case LOG_FIELD_DOUBLE:
+                ::snprintf(buff, sizeof(buff), "%g", field.value.d);
+                out += buff;
+                break;
+            case LOG_FIELD_BOOL:
+                out += field.value.b ? "true" : "false";
+                break;
+            case LOG_FIELD_STR: {
+                auto ptr = field.value.s.ptr;
+                auto len = field.value.s.len;
+                if (!IsNeedQuote(ptr, len)) {
+                    out.append(ptr, len);
+                    break;
+                }
+                out += '"';
+                for (uint32_t j = 0; j < len; ++j) {
+                    char c = ptr[j];
+                    if (c == '"' || c == '\\') {
+                        out += '\\';
+                        out += c;
+                    } else if (c == '\n') {
+                        out += "\\n";
+                    } else if (c == '\t') {
+                        out += "\\t";
+                    } else {
+                        out += c;
+                    }
+                }
+                out += '"';
+                break;
+            }
+            default:
+                out += '?';
+        }
+    }
+}
+
 }
 
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr)
@@ -30,6 +30,7 @@
 #include <stddef.h>
 
 #include "log.h"
+#include "log_kv.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,8 @@ struct LogContent {
     uint32_t    text_len;   //!< 内容大小
     const char *text_ptr;   //!< 内容地址
     bool        text_trunc; //!< 是否截断
+    uint32_t    field_num;  //!< 结构化字段的个数
+    const struct LogField *fields;  //!< 结构化字段，由 LogKvFunc() 输出的日志才有
 };
 
 //! 日志等级颜色表
@@ -69,7 +72,45 @@ size_t   LogGetMaxLength();
 uint32_t LogAddPrintfFunc(LogPrintfFuncType func, void *ptr);
 bool     LogRemovePrintfFunc(uint32_t id);
 
+//! 日志限流配置，以调用点（文件+行号）为单位生效
+struct LogLimitConfig {
+    uint32_t rate;          //!< 每个调用点每秒最多输出的条数，0表示不限
+    uint32_t burst;         //!< 允许突发的条数，0表示与 rate 相同
+    bool     merge_repeat;  //!< 是否将同一调用点连续重复的日志合并成 "last message repeated N times"
+};
+
+//! 日志限流统计
+struct LogLimitStats {
+    uint64_t dropped;   //!< 因超出速率被丢弃的条数
+    uint64_t merged;    //!< 因重复被合并的条数
+};
+
+/**
+ * 设置模块的限流配置
+ * module_id 为 "" 表示默认配置，对没有单独配置的模块生效
+ *
+ * 限流在格式化之前进行，被丢弃的日志不会被格式化，也不会派发给任何输出通道
+ */
+void LogSetLimit(const char *module_id, const struct LogLimitConfig *config);
+bool LogUnsetLimit(const char *module_id);
+//! 获取模块的限流统计，module_id 为 NULL 表示所有模块的总和。使用默认配置的模块也各自统计
+bool LogGetLimitStats(const char *module_id, struct LogLimitStats *stats);
+//! 遍历有限流统计的各模块
+typedef void (*LogLimitStatsFuncType)(const char *module_id, const struct LogLimitStats *stats, void *ptr);
+void LogForeachLimitStats(LogLimitStatsFuncType func, void *ptr);
+//! 输出被丢弃与被合并日志的汇总，宜定时调用，否则不再打印的调用点的汇总要等到它下次打印时才输出
+void LogFlushLimit();
+
+#ifdef __cplusplus
+}
+#endif
+
 #ifdef __cplusplus
+#include <string>
+
+namespace tbox {
+//! 将结构化字段以 " key=value" 的文本形式追加到 out，供文本日志通道使用
+void LogAppendFieldsAsText(const LogField *fields, uint32_t field_num, std::string &out);
 }
 #endif
 
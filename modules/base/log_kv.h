@@ -0,0 +1,194 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+//! tbox/base/log_kv.h
+#ifndef TBOX_LOG_KV_H_20261019
+#define TBOX_LOG_KV_H_20261019
+
+/**
+ * 结构化日志
+ *
+ * 除了消息文本外，还携带带类型的 key/value 字段。字段的值在调用线程中只做打包，不做格式化，
+ * 由各日志通道在后台决定输出的形式：文本通道输出为 "key=value"，结构化通道输出为 JSON 或二进制。
+ *
+ * 使用示例：
+ *  LogKvInfo("order placed", LogKv("order_id", id), LogKv("price", 12.5), LogKv("user", name));
+ *
+ * \note    key 须为字串常量，日志通道可能在后台才使用它，且会缓存它的地址
+ */
+
+#include <stdint.h>
+
+#include "log.h"
+
+//! 字段值的类型
+enum LogFieldType {
+    LOG_FIELD_INT = 0,  //!< 有符号整数
+    LOG_FIELD_UINT,     //!< 无符号整数
+    LOG_FIELD_DOUBLE,   //!< 浮点数
+    LOG_FIELD_BOOL,     //!< 布尔
+    LOG_FIELD_STR,      //!< 字串
+};
+
+//! 结构化日志的字段
+struct LogField {
+    const char *key;    //!< 字段名，须为字串常量
+    int type;           //!< 值的类型，见 LogFieldType
+    union {
+        int64_t  i;
+        uint64_t u;
+        double   d;
+        int      b;
+        struct {
+            const char *ptr;
+            uint32_t    len;
+        } s;
+    } value;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//!
+//! \brief  Structured log print function
+//!
+//! \param  module_id   Module Id
+//! \param  func_name   Function name
+//! \param  file_name   File name
+//! \param  line        Code line
+//! \param  level       Log level
+//! \param  msg         Log message, not formatted
+//! \param  fields      Fields array
+//! \param  field_num   Fields number
+//!
+void LogKvFunc(const char *module_id, const char *func_name, const char *file_name,
+               int line, int level, const char *msg, const struct LogField *fields, uint32_t field_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <string>
+#include <initializer_list>
+#include <type_traits>
+
+namespace tbox {
+
+inline LogField LogMakeField(const char *key, bool value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_BOOL;
+    field.value.b = value;
+    return field;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, LogField>::type
+LogMakeField(const char *key, T value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_INT;
+    field.value.i = value;
+    return field;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, LogField>::type
+LogMakeField(const char *key, T value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_UINT;
+    field.value.u = value;
+    return field;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, LogField>::type
+LogMakeField(const char *key, T value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_DOUBLE;
+    field.value.d = value;
+    return field;
+}
+
+inline LogField LogMakeField(const char *key, const char *value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_STR;
+    field.value.s.ptr = value;
+    field.value.s.len = (value != nullptr) ? std::char_traits<char>::length(value) : 0;
+    return field;
+}
+
+inline LogField LogMakeField(const char *key, const std::string &value)
+{
+    LogField field;
+    field.key = key;
+    field.type = LOG_FIELD_STR;
+    field.value.s.ptr = value.data();
+    field.value.s.len = value.size();
+    return field;
+}
+
+//! 字段在整个表达式结束前都有效，所以字段的值可以是临时对象
+inline void LogKvPrint(const char *module_id, const char *func_name, const char *file_name,
+                       int line, int level, const char *msg, std::initializer_list<LogField> fields)
+{
+    LogKvFunc(module_id, func_name, file_name, line, level, msg, fields.begin(), fields.size());
+}
+
+}
+
+//! 定义一个字段
+#define LogKv(key, value)   ::tbox::LogMakeField(key, value)
+
+#define LogKvPrintf(level, msg, ...) \
+    ::tbox::LogKvPrint(LOG_MODULE_ID, __func__, __FILE__, __LINE__, level, msg, {__VA_ARGS__})
+
+#define LogKvFatal(msg, ...)     LogKvPrintf(LOG_LEVEL_FATAL,  msg, ## __VA_ARGS__)
+#define LogKvErr(msg, ...)       LogKvPrintf(LOG_LEVEL_ERROR,  msg, ## __VA_ARGS__)
+#define LogKvWarn(msg, ...)      LogKvPrintf(LOG_LEVEL_WARN,   msg, ## __VA_ARGS__)
+#define LogKvNotice(msg, ...)    LogKvPrintf(LOG_LEVEL_NOTICE, msg, ## __VA_ARGS__)
+#define LogKvImportant(msg, ...) LogKvPrintf(LOG_LEVEL_IMPORTANT, msg, ## __VA_ARGS__)
+#define LogKvInfo(msg, ...)      LogKvPrintf(LOG_LEVEL_INFO,   msg, ## __VA_ARGS__)
+
+#if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_DEBUG)
+    #define LogKvDbg(msg, ...)   LogKvPrintf(LOG_LEVEL_DEBUG, msg, ## __VA_ARGS__)
+#else
+    #define LogKvDbg(msg, ...)
+#endif
+
+#if !defined(STATIC_LOG_LEVEL) || (STATIC_LOG_LEVEL >= LOG_LEVEL_TRACE)
+    #define LogKvTrace(msg, ...) LogKvPrintf(LOG_LEVEL_TRACE, msg, ## __VA_ARGS__)
+#else
+    #define LogKvTrace(msg, ...)
+#endif
+
+#endif //__cplusplus
+
+#endif //TBOX_LOG_KV_H_20261019
@@ -28,6 +28,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <mutex>
+#include <string>
 #include <iostream>
 
 #include "log_impl.h"
@@ -66,6 +67,12 @@ namespace {
         if (content->text_len > 0)
             printf("%.*s ", content->text_len, content->text_ptr);
 
+        if (content->field_num > 0) {
+            std::string fields_text;
+            tbox::LogAppendFieldsAsText(content->fields, content->field_num, fields_text);
+            printf("%s ", fields_text.c_str() + 1);  //! 跳过开头的空格
+        }
+
         if (content->text_trunc == 1)
             printf("(TRUNCATED) ");
 
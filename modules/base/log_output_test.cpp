@@ -18,6 +18,10 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include "log.h"
 #include "log_impl.h"
 #include "log_output.h"
@@ -79,3 +83,145 @@ TEST(Log, Truncate)
     LogSetMaxLength(origin_len);
     LogOutput_Disable();
 }
+
+TEST(Log, KeyValue)
+{
+    LogOutput_Enable();
+
+    //! 另外挂一个输出函数，检查派发出来的字段
+    std::string fields_text;
+    auto id = LogAddPrintfFunc(
+        [] (const LogContent *content, void *ptr) {
+            auto p_text = static_cast<std::string*>(ptr);
+            p_text->assign(content->text_ptr, content->text_len);
+            tbox::LogAppendFieldsAsText(content->fields, content->field_num, *p_text);
+        }, &fields_text
+    );
+
+    LogKvInfo("kv", LogKv("i", -1), LogKv("u", 2u), LogKv("d", 0.5), LogKv("b", false),
+              LogKv("s", std::to_string(100)), LogKv("q", "a b"));
+    EXPECT_EQ(fields_text, "kv i=-1 u=2 d=0.5 b=false s=100 q=\"a b\"");
+
+    LogKvNotice("no field");
+    EXPECT_EQ(fields_text, "no field");
+
+    //! 过长的字串值要截断
+    auto origin_len = LogSetMaxLength(4);
+    LogKvWarn("long", LogKv("s", "123456"));
+    EXPECT_EQ(fields_text, "long s=1234");
+    LogSetMaxLength(origin_len);
+
+    LogRemovePrintfFunc(id);
+    LogOutput_Disable();
+}
+
+namespace {
+void CaptureText(const LogContent *content, void *ptr)
+{
+    auto p_texts = static_cast<std::vector<std::string>*>(ptr);
+    p_texts->emplace_back(content->text_ptr, content->text_len);
+}
+}
+
+TEST(Log, RateLimit)
+{
+    std::vector<std::string> texts;
+    auto id = LogAddPrintfFunc(CaptureText, &texts);
+
+    LogLimitConfig config = { 1, 3, false };
+    LogSetLimit(LOG_MODULE_ID, &config);
+
+    for (int i = 0; i < 10; ++i)
+        LogNotice("flood %d", i);
+
+    ASSERT_EQ(texts.size(), 3u);
+    EXPECT_EQ(texts[2], "flood 2");
+
+    LogLimitStats stats;
+    ASSERT_TRUE(LogGetLimitStats(LOG_MODULE_ID, &stats));
+    EXPECT_EQ(stats.dropped, 7u);
+    EXPECT_EQ(stats.merged, 0u);
+
+    LogFlushLimit();
+    ASSERT_EQ(texts.size(), 4u);
+    EXPECT_EQ(texts[3], "7 messages dropped by rate limit");
+
+    //! 其它模块不受影响
+    texts.clear();
+    for (int i = 0; i < 10; ++i)
+        LogPrintfFunc("other", __func__, __FILE__, __LINE__, LOG_LEVEL_NOTICE, 0, "other");
+    EXPECT_EQ(texts.size(), 10u);
+
+    EXPECT_TRUE(LogUnsetLimit(LOG_MODULE_ID));
+    EXPECT_FALSE(LogUnsetLimit(LOG_MODULE_ID));
+    LogRemovePrintfFunc(id);
+}
+
+TEST(Log, MergeRepeat)
+{
+    std::vector<std::string> texts;
+    auto id = LogAddPrintfFunc(CaptureText, &texts);
+
+    LogLimitConfig config = { 0, 0, true };
+    LogSetLimit("", &config);
+
+    const char *inputs[] = { "a", "a", "a", "a", "a", "b", "b" };
+    for (auto input : inputs)
+        LogNotice("%s", input);
+
+    ASSERT_EQ(texts.size(), 3u);
+    EXPECT_EQ(texts[0], "a");
+    EXPECT_EQ(texts[1], "last message repeated 4 times");
+    EXPECT_EQ(texts[2], "b");
+
+    LogFlushLimit();
+    ASSERT_EQ(texts.size(), 4u);
+    EXPECT_EQ(texts[3], "last message repeated 1 times");
+
+    LogLimitStats stats;
+    ASSERT_TRUE(LogGetLimitStats(nullptr, &stats));
+    EXPECT_EQ(stats.merged, 5u);
+
+    //! 使用默认配置的模块，统计仍记在各自名下
+    ASSERT_TRUE(LogGetLimitStats(LOG_MODULE_ID, &stats));
+    EXPECT_EQ(stats.merged, 5u);
+    ASSERT_TRUE(LogGetLimitStats("", &stats));
+    EXPECT_EQ(stats.merged, 0u);
+
+    LogUnsetLimit("");
+    LogRemovePrintfFunc(id);
+}
+
+//! 多线程打印重复日志的同时反复设置与取消限流配置
+TEST(Log, LimitSetUnsetConcurrently)
+{
+    auto id = LogAddPrintfFunc([] (const LogContent *, void *) { }, nullptr);
+    LogLimitConfig config = { 0, 0, true };
+    std::atomic_bool is_stop(false);
+
+    //! 保持限流开启，取消配置后，其它线程会按新配置重新查找调用点
+    LogSetLimit("limit_other", &config);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(
+            [&is_stop] {
+                while (!is_stop)
+                    LogPrintfFunc("limit_race", __func__, __FILE__, __LINE__, LOG_LEVEL_NOTICE, 1, "%s %f", "same", 1.5);
+            }
+        );
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        LogSetLimit("limit_race", &config);
+        LogUnsetLimit("limit_race");
+    }
+
+    is_stop = true;
+    for (auto &t : threads)
+        t.join();
+
+    LogUnsetLimit("limit_other");
+    LogFlushLimit();
+    LogRemovePrintfFunc(id);
+}
@@ -19,7 +19,15 @@
 */
 #include"recorder.h"
 
-#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace tbox {
 namespace trace {
@@ -29,15 +37,137 @@ void __attribute((weak)) CommitRecordFunc(
    const char *name, const char *module, uint32_t line,
    uint64_t end_timepoint_us, uint64_t duration_us
 );
+void __attribute((weak)) CommitEventFunc(
+   const char *name, const char *module, uint32_t line,
+   uint64_t timepoint_us
+);
+
+namespace {
+
+std::atomic<ClockSource> _clock_source(ClockSource::kRealtime);
+
+int64_t  _coarse_offset_us = 0; //! CLOCK_REALTIME 与 CLOCK_MONOTONIC_COARSE 的差值
+
+//! TSC换算参数: us = base_us + (ticks - base_ticks) * mult >> 32
+uint64_t _tsc_base_ticks = 0;
+uint64_t _tsc_base_us = 0;
+uint64_t _tsc_mult = 0;
+
+inline uint64_t GetClockMicroseconds(clockid_t clock_id)
+{
+   struct timespec ts;
+   clock_gettime(clock_id, &ts);
+   return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
 
-namespace{
-uint64_t GetCurrentUTCMicroseconds()
+inline uint64_t GetClockNanoseconds(clockid_t clock_id)
 {
-   struct timeval tv;
-   struct timezone tz;
-   gettimeofday(&tv, &tz);
-   return tv.tv_sec * 1000000 + tv.tv_usec;
+   struct timespec ts;
+   clock_gettime(clock_id, &ts);
+   return ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
+
+inline uint64_t ReadTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#elif defined(__aarch64__)
+   uint64_t ticks;
+   asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+   return ticks;
+#else
+   return 0;
+#endif
+}
+
+//! TSC 是否恒定频率，且在CPU休眠时不停止
+bool IsTscInvariant()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   std::ifstream ifs("/proc/cpuinfo");
+   std::string line;
+   while (std::getline(ifs, line)) {
+      if (line.compare(0, 5, "flags") == 0)
+         return line.find(" constant_tsc") != std::string::npos &&
+                line.find(" nonstop_tsc") != std::string::npos;
+   }
+   return false;
+#elif defined(__aarch64__)
+   return true;   //! 通用定时器的频率是固定的
+#else
+   return false;
+#endif
+}
+
+bool CalibrateTsc()
+{
+   if (!IsTscInvariant())
+      return false;
+
+   //! 以ns精度校准，减少误差
+   uint64_t start_ns = GetClockNanoseconds(CLOCK_MONOTONIC);
+   uint64_t start_ticks = ReadTicks();
+   ::usleep(10000);
+   uint64_t end_ns = GetClockNanoseconds(CLOCK_MONOTONIC);
+   uint64_t end_ticks = ReadTicks();
+
+   if (end_ticks <= start_ticks || end_ns <= start_ns)
+      return false;
+
+   _tsc_mult = (((end_ns - start_ns) << 32) / 1000) / (end_ticks - start_ticks);
+   _tsc_base_ticks = ReadTicks();
+   _tsc_base_us = GetClockMicroseconds(CLOCK_REALTIME);
+   return _tsc_mult > 0 && _tsc_mult <= 0xffffffffull;
+}
+
+}
+
+bool SetClockSource(ClockSource source)
+{
+   switch (source) {
+      case ClockSource::kRealtime:
+         break;
+
+      case ClockSource::kMonotonicCoarse:
+         _coarse_offset_us = GetClockMicroseconds(CLOCK_REALTIME) - GetClockMicroseconds(CLOCK_MONOTONIC_COARSE);
+         break;
+
+      case ClockSource::kTsc:
+         if (!CalibrateTsc())
+            return false;
+         break;
+
+      default:
+         return false;
+   }
+
+   _clock_source.store(source, std::memory_order_release);
+   return true;
+}
+
+ClockSource GetClockSource()
+{
+   return _clock_source.load(std::memory_order_acquire);
+}
+
+uint64_t GetTimestampUs()
+{
+   switch (_clock_source.load(std::memory_order_relaxed)) {
+      case ClockSource::kMonotonicCoarse:
+         return GetClockMicroseconds(CLOCK_MONOTONIC_COARSE) + _coarse_offset_us;
+
+      case ClockSource::kTsc: {
+         //! 分高低32位计算 ticks * mult >> 32，避免依赖 __int128，32位平台也可编译
+         //! 计数频率高于1MHz时 mult 小于 2^32，低位的乘积不会溢出
+         uint64_t ticks = ReadTicks() - _tsc_base_ticks;
+         uint64_t ticks_hi = ticks >> 32;
+         uint64_t ticks_lo = ticks & 0xffffffffull;
+         return _tsc_base_us + ticks_hi * _tsc_mult + ((ticks_lo * _tsc_mult) >> 32);
+      }
+
+      default:
+         return GetClockMicroseconds(CLOCK_REALTIME);
+   }
 }
 
 Recorder::Recorder(const char *name, const char *module, uint32_t line, bool start_now)
@@ -57,7 +187,7 @@ Recorder::~Recorder()
 void Recorder::start()
 {
    if (CommitRecordFunc)
-       start_ts_us_ = GetCurrentUTCMicroseconds();
+       start_ts_us_ = GetTimestampUs();
 }
 
 void Recorder::stop()
@@ -65,7 +195,7 @@ void Recorder::stop()
    if (start_ts_us_ == 0)
        return;
 
-   auto end_ts_us = GetCurrentUTCMicroseconds();
+   auto end_ts_us = GetTimestampUs();
    auto duration_us = end_ts_us - start_ts_us_;
 
    if (CommitRecordFunc)
@@ -76,8 +206,8 @@ void Recorder::stop()
 
 void RecordEvent(const char *name, const char *module, uint32_t line)
 {
-   if (CommitRecordFunc)
-       CommitRecordFunc(name, module, line, GetCurrentUTCMicroseconds(), 0);
+   if (CommitEventFunc)
+       CommitEventFunc(name, module, line, GetTimestampUs());
 }
 
 }
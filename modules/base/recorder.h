@@ -52,6 +52,28 @@ class Recorder {
 
 void RecordEvent(const char *name, const char *module, uint32_t line);
 
+//! 记录所用的时间源
+enum class ClockSource {
+    kRealtime,          //!< CLOCK_REALTIME，默认
+    kMonotonicCoarse,   //!< CLOCK_MONOTONIC_COARSE，开销最小，但精度只有一个时钟节拍(通常为1~4ms)
+    kTsc,               //!< CPU时间戳计数器，经校准后换算成微秒，仅支持 x86_64 与 aarch64
+};
+
+/**
+ * 设置时间源
+ *
+ * 非 kRealtime 的时间源在设置时与 CLOCK_REALTIME 对齐，得到的时间戳仍是UTC微秒数。
+ * 设置 kTsc 时需要约10ms进行校准，长时间运行后与系统时间会有少量偏差，可重新设置以再次校准。
+ * 须在开启记录之前设置，不要在记录过程中切换。
+ *
+ * \return  false   当前平台不支持，时间源保持不变
+ */
+bool SetClockSource(ClockSource source);
+ClockSource GetClockSource();
+
+//! 按当前时间源获取UTC时间戳，单位: us
+uint64_t GetTimestampUs();
+
 }
 }
 
@@ -18,6 +18,7 @@
  * of the source tree.
  */
 #include <gtest/gtest.h>
+#include <sys/time.h>
 #include "recorder.h"
 
 namespace tbox {
@@ -46,5 +47,34 @@ TEST(Recorder, Named) {
   RECORD_STOP(b);
 }
 
+TEST(Recorder, ClockSource) {
+  auto check_timestamp = [] {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint64_t now_us = tv.tv_sec * 1000000ull + tv.tv_usec;
+    uint64_t ts_us = GetTimestampUs();
+    //! 粗粒度时钟的误差在一个时钟节拍以内
+    EXPECT_NEAR(double(ts_us), double(now_us), 20000);
+  };
+
+  EXPECT_EQ(GetClockSource(), ClockSource::kRealtime);
+  check_timestamp();
+
+  EXPECT_TRUE(SetClockSource(ClockSource::kMonotonicCoarse));
+  EXPECT_EQ(GetClockSource(), ClockSource::kMonotonicCoarse);
+  check_timestamp();
+
+  if (SetClockSource(ClockSource::kTsc)) {
+    EXPECT_EQ(GetClockSource(), ClockSource::kTsc);
+    check_timestamp();
+    auto t1 = GetTimestampUs();
+    auto t2 = GetTimestampUs();
+    EXPECT_LE(t1, t2);
+  }
+
+  EXPECT_TRUE(SetClockSource(ClockSource::kRealtime));
+  EXPECT_EQ(GetClockSource(), ClockSource::kRealtime);
+}
+
 }
 }
@@ -0,0 +1,207 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_BASE_SMALL_FUNC_HPP_20261019
+#define TBOX_BASE_SMALL_FUNC_HPP_20261019
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+#include "defines.h"
+
+//! SmallFunc 内联存储的字节数，可在编译时指定
+#ifndef TBOX_SMALL_FUNC_INLINE_SIZE
+#define TBOX_SMALL_FUNC_INLINE_SIZE 48
+#endif
+
+namespace tbox {
+
+template <typename Signature, size_t InlineSize = TBOX_SMALL_FUNC_INLINE_SIZE>
+class SmallFunc;
+
+/**
+ * 带小对象优化的只移动函数对象
+ *
+ * 与 std::function 相比：
+ * - 内联存储 InlineSize 字节，捕获内容不超过该大小的lambda不会分配内存；
+ *   libstdc++ 的 std::function 只有16字节，捕获两个指针以上的lambda就要分配；
+ * - 只能移动，不能复制，因而可以存放 std::unique_ptr 等只移动的对象；
+ * - 可由 std::function 构造，空的 std::function 构造出来的 SmallFunc 也为空。
+ *
+ * 主要用于 Loop::runInLoop()、ThreadPool::execute() 等每次投递都要保存一次函数对象的场景。
+ */
+template <typename R, typename... Args, size_t InlineSize>
+class SmallFunc<R(Args...), InlineSize> {
+  public:
+    //! D 是否可以 Args... 为参数调用，且返回值可转换成 R
+    template <typename D, typename = void>
+    struct IsCallable : std::false_type { };
+
+    template <typename D>
+    struct IsCallable<D, typename std::enable_if<
+        std::is_void<R>::value ||
+        std::is_convertible<decltype(std::declval<D&>()(std::declval<Args>()...)), R>::value>::type>
+        : std::true_type { };
+
+    //! F 是否可以直接存入 SmallFunc，且不是 std::function 与 SmallFunc 本身，用于重载决议
+    template <typename F, typename D = typename std::decay<F>::type>
+    struct IsBindable : std::integral_constant<bool,
+        !std::is_same<D, SmallFunc>::value &&
+        !std::is_same<D, std::function<R(Args...)>>::value &&
+        (std::is_same<D, std::nullptr_t>::value || IsCallable<D>::value)> { };
+
+    SmallFunc() = default;
+    SmallFunc(std::nullptr_t) { }
+
+    template <typename F,
+              typename D = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<D, SmallFunc>::value &&
+                                                 IsCallable<D>::value>::type>
+    SmallFunc(F &&f) { assign<D>(std::forward<F>(f)); }
+
+    SmallFunc(SmallFunc &&other) noexcept { moveFrom(other); }
+
+    SmallFunc& operator = (SmallFunc &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    SmallFunc& operator = (std::nullptr_t) { reset(); return *this; }
+
+    ~SmallFunc() { reset(); }
+
+    NONCOPYABLE(SmallFunc);
+
+  public:
+    explicit operator bool () const { return ops_ != nullptr; }
+
+    R operator () (Args... args) const {
+        if (ops_ == nullptr)
+            throw std::bad_function_call();
+        return ops_->invoke(storage(), std::forward<Args>(args)...);
+    }
+
+    //! 是否存放在内联存储中，即构造时没有分配内存
+    bool isInline() const { return ops_ != nullptr && ops_->is_inline; }
+
+    void reset() {
+        if (ops_ != nullptr) {
+            ops_->destroy(storage());
+            ops_ = nullptr;
+        }
+    }
+
+    void swap(SmallFunc &other) noexcept {
+        SmallFunc tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+  protected:
+    struct Ops {
+        R (*invoke)(void *obj, Args&&... args);
+        void (*move)(void *dst, void *src);     //!< 移动到dst，并析构src
+        void (*destroy)(void *obj);
+        bool is_inline;
+    };
+
+    template <typename F>
+    struct InlineOps {
+        static R Invoke(void *obj, Args&&... args) {
+            return (*static_cast<F*>(obj))(std::forward<Args>(args)...);
+        }
+        static void Move(void *dst, void *src) {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void *obj) { static_cast<F*>(obj)->~F(); }
+        static const Ops kOps;
+    };
+
+    //! 放不下的，在内联存储中只存放指针
+    template <typename F>
+    struct HeapOps {
+        static R Invoke(void *obj, Args&&... args) {
+            return (**static_cast<F**>(obj))(std::forward<Args>(args)...);
+        }
+        static void Move(void *dst, void *src) { *static_cast<F**>(dst) = *static_cast<F**>(src); }
+        static void Destroy(void *obj) { delete *static_cast<F**>(obj); }
+        static const Ops kOps;
+    };
+
+    template <typename F>
+    using IsInlineable = std::integral_constant<bool,
+          sizeof(F) <= InlineSize &&
+          alignof(F) <= alignof(std::max_align_t) &&
+          std::is_nothrow_move_constructible<F>::value>;
+
+    template <typename F> static bool IsNull(const F &) { return false; }
+    template <typename T> static bool IsNull(T *p) { return p == nullptr; }
+    template <typename S> static bool IsNull(const std::function<S> &f) { return !f; }
+
+    template <typename D, typename F>
+    typename std::enable_if<IsInlineable<D>::value>::type assign(F &&f) {
+        if (IsNull(f))
+            return;
+        new (storage()) D(std::forward<F>(f));
+        ops_ = &InlineOps<D>::kOps;
+    }
+
+    template <typename D, typename F>
+    typename std::enable_if<!IsInlineable<D>::value>::type assign(F &&f) {
+        if (IsNull(f))
+            return;
+        *static_cast<D**>(storage()) = new D(std::forward<F>(f));
+        ops_ = &HeapOps<D>::kOps;
+    }
+
+    void moveFrom(SmallFunc &other) {
+        if (other.ops_ != nullptr) {
+            other.ops_->move(storage(), other.storage());
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void* storage() const { return const_cast<void*>(static_cast<const void*>(&storage_)); }
+
+  private:
+    typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type storage_;
+    const Ops *ops_ = nullptr;
+};
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename F>
+const typename SmallFunc<R(Args...), InlineSize>::Ops
+SmallFunc<R(Args...), InlineSize>::InlineOps<F>::kOps = { &Invoke, &Move, &Destroy, true };
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename F>
+const typename SmallFunc<R(Args...), InlineSize>::Ops
+SmallFunc<R(Args...), InlineSize>::HeapOps<F>::kOps = { &Invoke, &Move, &Destroy, false };
+
+}
+
+#endif //TBOX_BASE_SMALL_FUNC_HPP_20261019
@@ -0,0 +1,153 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+#include "small_func.hpp"
+
+namespace tbox {
+namespace {
+
+using Func = SmallFunc<void()>;
+
+TEST(SmallFunc, Empty) {
+    Func f1;
+    EXPECT_FALSE(f1);
+    EXPECT_FALSE(f1.isInline());
+    EXPECT_THROW(f1(), std::bad_function_call);
+
+    Func f2(nullptr);
+    EXPECT_FALSE(f2);
+
+    std::function<void()> std_func;
+    Func f3(std::move(std_func));
+    EXPECT_FALSE(f3);
+
+    void (*func_ptr)() = nullptr;
+    Func f4(func_ptr);
+    EXPECT_FALSE(f4);
+}
+
+TEST(SmallFunc, Inline) {
+    int count = 0;
+    uint64_t a = 1, b = 2, c = 3, d = 4;
+    Func f([&count, a, b, c, d] { count += a + b + c + d; });
+    EXPECT_TRUE(f);
+    EXPECT_TRUE(f.isInline());
+    f();
+    EXPECT_EQ(count, 10);
+
+    Func f2(std::move(f));
+    EXPECT_FALSE(f);
+    EXPECT_TRUE(f2.isInline());
+    f2();
+    EXPECT_EQ(count, 20);
+}
+
+TEST(SmallFunc, Heap) {
+    char buff[128] = {1};
+    int count = 0;
+    Func f([&count, buff] { count += buff[0]; });
+    EXPECT_TRUE(f);
+    EXPECT_FALSE(f.isInline());
+
+    Func f2;
+    f2 = std::move(f);
+    EXPECT_FALSE(f);
+    f2();
+    EXPECT_EQ(count, 1);
+}
+
+TEST(SmallFunc, MoveOnly) {
+    struct Setter {
+        int *p_value;
+        std::unique_ptr<int> up;
+        void operator () () const { *p_value = *up; }
+    };
+
+    int value = 0;
+    Func f(Setter{&value, std::unique_ptr<int>(new int(12))});
+    EXPECT_TRUE(f.isInline());
+    f();
+    EXPECT_EQ(value, 12);
+}
+
+TEST(SmallFunc, FromStdFunction) {
+    int count = 0;
+    std::function<void()> std_func = [&count] { ++count; };
+    Func f(std_func);
+    EXPECT_TRUE(f.isInline());
+    f();
+    EXPECT_EQ(count, 1);
+    std_func();
+    EXPECT_EQ(count, 2);
+}
+
+TEST(SmallFunc, ArgsAndReturn) {
+    SmallFunc<std::string(const std::string &, int)> f(
+        [] (const std::string &s, int n) {
+            std::string r;
+            for (int i = 0; i < n; ++i)
+                r += s;
+            return r;
+        }
+    );
+    EXPECT_EQ(f("ab", 3), "ababab");
+
+    SmallFunc<int(std::unique_ptr<int>)> f2([] (std::unique_ptr<int> p) { return *p; });
+    EXPECT_EQ(f2(std::unique_ptr<int>(new int(5))), 5);
+}
+
+TEST(SmallFunc, Destruct) {
+    auto sp = std::make_shared<int>(0);
+    {
+        Func f([sp] { });
+        EXPECT_EQ(sp.use_count(), 2);
+        Func f2(std::move(f));
+        EXPECT_EQ(sp.use_count(), 2);
+        f2 = nullptr;
+        EXPECT_EQ(sp.use_count(), 1);
+        Func f3([sp] { });
+        EXPECT_EQ(sp.use_count(), 2);
+    }
+    EXPECT_EQ(sp.use_count(), 1);
+}
+
+TEST(SmallFunc, Swap) {
+    int v1 = 0, v2 = 0;
+    Func f1([&v1] { ++v1; });
+    Func f2([&v2] { ++v2; });
+    f1.swap(f2);
+    f1();
+    EXPECT_EQ(v1, 0);
+    EXPECT_EQ(v2, 1);
+}
+
+TEST(SmallFunc, IsBindable) {
+    auto lambda = [] { };
+    EXPECT_TRUE(Func::IsBindable<decltype(lambda)>::value);
+    EXPECT_TRUE(Func::IsBindable<std::nullptr_t>::value);
+    EXPECT_FALSE(Func::IsBindable<std::function<void()>>::value);
+    EXPECT_FALSE(Func::IsBindable<Func>::value);
+    EXPECT_FALSE(Func::IsBindable<int>::value);
+}
+
+}
+}
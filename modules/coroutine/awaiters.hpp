@@ -0,0 +1,226 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_AWAITERS_HPP_20261019
+#define TBOX_COROUTINE_AWAITERS_HPP_20261019
+
+/**
+ * 供 Task 在 Loop 中等待的对象，需要 C++20
+ *
+ *   co_await RunInLoop(loop);                      //! 切换到 loop 的线程中继续执行
+ *   co_await Delay(loop, milliseconds(100));       //! 延时
+ *   short events = co_await WaitFd(loop, fd, event::FdEvent::kReadEvent, milliseconds(500));
+ *   int result = co_await Offload(thread_pool, [] { return HeavyWork(); });
+ *
+ * 由事件回调恢复的协程，都通过 Loop::runNext() 在回调返回之后再恢复，
+ * 以便协程在恢复后可以放心地销毁等待对象及其中的事件。
+ *
+ * \warning 协程挂起期间，不可销毁该协程
+ */
+
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <tbox/event/loop.h>
+#include <tbox/event/fd_event.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/eventx/thread_pool.h>
+
+#include "task.hpp"
+#include "fd_io.h"
+
+namespace tbox {
+namespace coroutine {
+
+//! 切换到 loop 的线程中继续执行，即使已在该线程中，也会让出一次
+class RunInLoop {
+  public:
+    explicit RunInLoop(event::Loop *loop) : loop_(loop) { }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        loop_->runInLoop([handle] { handle.resume(); }, "co_await");
+    }
+    void await_resume() const noexcept { }
+
+  private:
+    event::Loop *loop_;
+};
+
+//! 延时，duration 不大于0时不挂起
+class Delay {
+  public:
+    Delay(event::Loop *loop, std::chrono::milliseconds duration) :
+        loop_(loop), duration_(duration)
+    { }
+
+    ~Delay() { CHECK_DELETE_OBJ(timer_event_); }
+
+    NONCOPYABLE(Delay);
+    IMMOVABLE(Delay);
+
+    bool await_ready() const noexcept { return duration_ <= std::chrono::milliseconds::zero(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        timer_event_ = loop_->newTimerEvent("co_await Delay");
+        timer_event_->initialize(duration_, event::Event::Mode::kOneshot);
+        timer_event_->setCallback(
+            [this, handle] {
+                loop_->runNext([handle] { handle.resume(); }, "co_await");
+            }
+        );
+        timer_event_->enable();
+    }
+    void await_resume() const noexcept { }
+
+  private:
+    event::Loop *loop_;
+    std::chrono::milliseconds duration_;
+    event::TimerEvent *timer_event_ = nullptr;
+};
+
+/**
+ * 等待 fd 就绪
+ *
+ * co_await 的结果为就绪的事件，超时返回0
+ */
+class WaitFd {
+  public:
+    WaitFd(event::Loop *loop, int fd, short events, std::chrono::milliseconds timeout = kForever) :
+        loop_(loop), fd_(fd), events_(events), timeout_(timeout)
+    { }
+
+    ~WaitFd() {
+        CHECK_DELETE_OBJ(fd_event_);
+        CHECK_DELETE_OBJ(timer_event_);
+    }
+
+    NONCOPYABLE(WaitFd);
+    IMMOVABLE(WaitFd);
+
+    bool await_ready() const noexcept { return timeout_ == std::chrono::milliseconds::zero(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+        fd_event_ = loop_->newFdEvent("co_await WaitFd");
+        fd_event_->initialize(fd_, events_, event::Event::Mode::kOneshot);
+        fd_event_->setCallback(
+            [this, handle] (short events) {
+                ready_events_ = events;
+                if (timer_event_ != nullptr)
+                    timer_event_->disable();
+                loop_->runNext([handle] { handle.resume(); }, "co_await");
+            }
+        );
+        fd_event_->enable();
+
+        if (timeout_ > std::chrono::milliseconds::zero()) {
+            timer_event_ = loop_->newTimerEvent("co_await WaitFd");
+            timer_event_->initialize(timeout_, event::Event::Mode::kOneshot);
+            timer_event_->setCallback(
+                [this, handle] {
+                    fd_event_->disable();
+                    loop_->runNext([handle] { handle.resume(); }, "co_await");
+                }
+            );
+            timer_event_->enable();
+        }
+    }
+    short await_resume() const noexcept { return ready_events_; }
+
+  private:
+    event::Loop *loop_;
+    int fd_;
+    short events_;
+    std::chrono::milliseconds timeout_;
+    short ready_events_ = 0;
+
+    event::FdEvent *fd_event_ = nullptr;
+    event::TimerEvent *timer_event_ = nullptr;
+};
+
+/**
+ * 将 func 放到线程池中执行，完成后回到线程池的主 Loop 中继续执行
+ *
+ * co_await 的结果为 func 的返回值，func 中抛出的异常会在 co_await 处重新抛出；
+ * 线程池未初始化等原因，任务放不进线程池时，不挂起，在 co_await 处抛出 std::runtime_error
+ */
+template <typename Func>
+class Offload {
+  public:
+    using Result = std::invoke_result_t<Func&>;
+
+    Offload(eventx::ThreadPool &thread_pool, Func func, int prio = 0) :
+        thread_pool_(thread_pool), func_(std::move(func)), prio_(prio)
+    { }
+
+    NONCOPYABLE(Offload);
+    IMMOVABLE(Offload);
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        auto token = thread_pool_.execute(
+            [this] { run(); },
+            [handle] { handle.resume(); },
+            prio_
+        );
+
+        //! 任务没有放进去，不会有回调，不能挂起
+        if (token.isNull()) {
+            exception_ = std::make_exception_ptr(std::runtime_error("offload to thread pool fail"));
+            return false;
+        }
+        return true;
+    }
+
+    Result await_resume() {
+        if (exception_)
+            std::rethrow_exception(exception_);
+        if constexpr (!std::is_void_v<Result>)
+            return std::move(*result_);
+    }
+
+  private:
+    void run() {
+        try {
+            if constexpr (std::is_void_v<Result>)
+                func_();
+            else
+                result_.emplace(func_());
+        } catch (...) {
+            exception_ = std::current_exception();
+        }
+    }
+
+    using Storage = std::conditional_t<std::is_void_v<Result>, bool, Result>;
+
+    eventx::ThreadPool &thread_pool_;
+    Func func_;
+    int prio_;
+    std::optional<Storage> result_;
+    std::exception_ptr exception_;
+};
+
+template <typename Func>
+Offload(eventx::ThreadPool &, Func, int = 0) -> Offload<Func>;
+
+}
+}
+
+#endif //TBOX_COROUTINE_AWAITERS_HPP_20261019
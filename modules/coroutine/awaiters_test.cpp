@@ -0,0 +1,184 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <stdexcept>
+#include <thread>
+
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/event/loop.h>
+
+#include "awaiters.hpp"
+
+namespace tbox {
+namespace coroutine {
+
+using namespace std::chrono;
+
+TEST(Awaiters, RunInLoop)
+{
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    std::thread::id loop_thread_id;
+    std::thread::id task_thread_id;
+
+    auto func = [&] () -> Task<> {
+        co_await RunInLoop(sp_loop);
+        task_thread_id = std::this_thread::get_id();
+        sp_loop->exitLoop();
+    };
+
+    //! 在另一个线程中启动，切换到 Loop 的线程继续
+    std::thread t([&] { func().detach(); });
+    t.join();
+
+    loop_thread_id = std::this_thread::get_id();
+    sp_loop->runLoop();
+    EXPECT_EQ(task_thread_id, loop_thread_id);
+}
+
+TEST(Awaiters, Delay)
+{
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    milliseconds cost(0);
+    auto func = [&] () -> Task<> {
+        auto start = steady_clock::now();
+        co_await Delay(sp_loop, milliseconds(50));
+        co_await Delay(sp_loop, milliseconds(0));
+        cost = duration_cast<milliseconds>(steady_clock::now() - start);
+        sp_loop->exitLoop();
+    };
+
+    sp_loop->runInLoop([&] { func().detach(); });
+    sp_loop->runLoop();
+    EXPECT_GE(cost.count(), 45);
+    EXPECT_LT(cost.count(), 100);
+}
+
+TEST(Awaiters, WaitFd)
+{
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    SetScopeExitAction([fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    short timeout_events = -1;
+    short ready_events = 0;
+    char value = 0;
+
+    auto reader = [&] () -> Task<> {
+        timeout_events = co_await WaitFd(sp_loop, fds[0], event::FdEvent::kReadEvent, milliseconds(20));
+        ready_events = co_await WaitFd(sp_loop, fds[0], event::FdEvent::kReadEvent, milliseconds(1000));
+        if (ready_events & event::FdEvent::kReadEvent)
+            (void)::read(fds[0], &value, 1);
+        sp_loop->exitLoop();
+    };
+
+    auto writer = [&] () -> Task<> {
+        co_await Delay(sp_loop, milliseconds(50));
+        (void)::write(fds[1], "x", 1);
+    };
+
+    sp_loop->runInLoop([&] { reader().detach(); writer().detach(); });
+    sp_loop->runLoop();
+
+    EXPECT_EQ(timeout_events, 0);
+    EXPECT_TRUE(ready_events & event::FdEvent::kReadEvent);
+    EXPECT_EQ(value, 'x');
+}
+
+TEST(Awaiters, Offload)
+{
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    eventx::ThreadPool thread_pool(sp_loop);
+    ASSERT_TRUE(thread_pool.initialize(1, 2));
+    SetScopeExitAction([&thread_pool] { thread_pool.cleanup(); });
+
+    auto main_thread_id = std::this_thread::get_id();
+    std::thread::id worker_thread_id;
+    std::thread::id resume_thread_id;
+    int result = 0;
+    bool is_void_done = false;
+    bool is_caught = false;
+
+    auto func = [&] () -> Task<> {
+        result = co_await Offload(thread_pool,
+            [&] {
+                worker_thread_id = std::this_thread::get_id();
+                return 6 * 7;
+            }
+        );
+        resume_thread_id = std::this_thread::get_id();
+
+        co_await Offload(thread_pool, [&] { is_void_done = true; });
+
+        try {
+            co_await Offload(thread_pool, [] { throw std::runtime_error("fail"); });
+        } catch (const std::runtime_error &) {
+            is_caught = true;
+        }
+        sp_loop->exitLoop();
+    };
+
+    sp_loop->runInLoop([&] { func().detach(); });
+    sp_loop->runLoop();
+
+    EXPECT_EQ(result, 42);
+    EXPECT_NE(worker_thread_id, main_thread_id);
+    EXPECT_EQ(resume_thread_id, main_thread_id);
+    EXPECT_TRUE(is_void_done);
+    EXPECT_TRUE(is_caught);
+}
+
+//! 线程池未初始化，任务放不进去，不挂起，直接抛出异常
+TEST(Awaiters, OffloadNotReady)
+{
+    auto sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop] { delete sp_loop; });
+
+    eventx::ThreadPool thread_pool(sp_loop);
+
+    bool is_func_invoked = false;
+    bool is_caught = false;
+
+    auto func = [&] () -> Task<> {
+        try {
+            co_await Offload(thread_pool, [&] { is_func_invoked = true; return 1; });
+        } catch (const std::runtime_error &) {
+            is_caught = true;
+        }
+    };
+
+    func().detach();
+
+    EXPECT_TRUE(is_caught);
+    EXPECT_FALSE(is_func_invoked);
+}
+
+}
+}
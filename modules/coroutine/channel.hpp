@@ -21,52 +21,302 @@
 #define TBOX_COROUTINE_CHANNEL_HPP_20180527
 
 #include "scheduler.h"
-#include <queue>
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
 namespace tbox {
 namespace coroutine {
 
-//! 参考 Golang 的 chan，实现一个通道
+/**
+ * 参考 Golang 的 chan，实现一个通道
+ *
+ * 数据存放在环形缓冲中，可指定容量。容量为0表示不限，此时发送永不等待，与旧的行为一致。
+ * 容量有限时，通道满了发送者要等待，避免快的生产者让内存无限增长。
+ *
+ * 等待的接收者与发送者分别按先后排队：
+ * - 有接收者在等待时，发送的数据直接交给最早等待的接收者，不经过缓冲；
+ * - 接收者取走数据腾出空间后，立即将最早等待的发送者的数据放入缓冲。
+ * 所以先等待的总是先被满足，不会被后来者抢走；每次唤醒都是 O(1) 的。
+ *
+ * 元素只需可移动构造与移动赋值，支持 std::unique_ptr 等只能移动的类型。
+ *
+ * close() 之后，发送均失败，接收者可继续取完缓冲中剩余的数据，取完后接收失败。
+ *
+ * \note    recv() 与容量有限时的 send() 可能需要等待，只能在协程中调用；
+ *          不在协程中时，请用 trySend() 与 tryRecv()
+ */
 template <class T>
 class Channel {
   public:
-    Channel (Scheduler &sch) : sch_(sch) { }
-
-    bool operator >> (T &out) {
-        if (queue_.empty()) {   //! 如果队列里没有，则等待
-            token_.push(sch_.getToken());
-            do {
-                sch_.wait();
-                if (sch_.isCanceled())
-                    return false;
-            } while (queue_.empty());
+    explicit Channel(Scheduler &sch, size_t capacity = 0) : sch_(sch), capacity_(capacity) { }
+    ~Channel() {
+        while (size_ > 0)
+            popFront();
+        if (buff_ != nullptr)
+            alloc_.deallocate(buff_, buff_size_);
+    }
+
+    NONCOPYABLE(Channel);
+    IMMOVABLE(Channel);
+
+  public:
+    //! 发送，满时等待。已关闭或协程被取消时返回 false
+    bool send(const T &value) {
+        T tmp(value);
+        return send(std::move(tmp));
+    }
+
+    bool send(T &&value) {
+        if (tryPush(value))
+            return true;
+
+        if (is_closed_)
+            return false;
+
+        Waiter waiter(sch_.getToken(), &value);
+        send_waiters_.pushBack(&waiter);
+        return wait(waiter, send_waiters_);
+    }
+
+    //! 发送，不等待。已满或已关闭时返回 false，value 不被移走
+    bool trySend(const T &value) {
+        if (is_closed_ || (recv_waiters_.empty() && isFull()))
+            return false;
+        T tmp(value);
+        return tryPush(tmp);
+    }
+
+    bool trySend(T &&value) { return tryPush(value); }
+
+    //! 接收，空时等待。已关闭且取完，或协程被取消时返回 false
+    bool recv(T &out) {
+        if (tryPop(out))
+            return true;
+
+        if (is_closed_)
+            return false;
+
+        Waiter waiter(sch_.getToken(), &out);
+        recv_waiters_.pushBack(&waiter);
+        return wait(waiter, recv_waiters_);
+    }
+
+    //! 接收，不等待。空时返回 false
+    bool tryRecv(T &out) { return tryPop(out); }
+
+    //! 取出最多 max_num 个数据，追加到 out 中，不等待，返回取出的个数
+    size_t tryRecvMany(std::vector<T> &out, size_t max_num) {
+        size_t num = 0;
+        while (num < max_num && size_ > 0) {
+            out.push_back(std::move(front()));
+            popFrontAndRefill();
+            ++num;
+        }
+        return num;
+    }
+
+    //! 同上，但至少等到1个数据，失败的条件同 recv()
+    size_t recvMany(std::vector<T> &out, size_t max_num) {
+        if (max_num == 0)
+            return 0;
+
+        //! 不指定接收位置，被唤醒时数据放在缓冲中，由自己来取
+        while (size_ == 0) {
+            if (is_closed_)
+                return 0;
+
+            Waiter waiter(sch_.getToken(), nullptr);
+            recv_waiters_.pushBack(&waiter);
+            if (!wait(waiter, recv_waiters_))
+                return 0;
+        }
+        return tryRecvMany(out, max_num);
+    }
+
+    //! 关闭通道，唤醒所有等待的接收者与发送者
+    void close() {
+        if (is_closed_)
+            return;
+
+        is_closed_ = true;
+        while (!recv_waiters_.empty())
+            sch_.resume(recv_waiters_.popFront()->token);
+        while (!send_waiters_.empty())
+            sch_.resume(send_waiters_.popFront()->token);
+    }
+
+    bool operator >> (T &out) { return recv(out); }
+
+    Channel& operator << (const T &value) { send(value); return *this; }
+    Channel& operator << (T &&value) { send(std::move(value)); return *this; }
+
+    inline bool empty() const { return size_ == 0; }
+    inline size_t size() const { return size_; }
+    inline size_t capacity() const { return capacity_; }
+    inline bool isFull() const { return capacity_ != 0 && size_ >= capacity_; }
+    inline bool isClosed() const { return is_closed_; }
+
+  protected:
+    //! 等待者，存放在等待的协程的栈上
+    struct Waiter {
+        Waiter(RoutineToken t, T *i) : token(t), item(i) { }
+
+        RoutineToken token;
+        T *item;                //!< 发送者：要发送的数据；接收者：接收数据的位置，为 nullptr 表示由自己从缓冲中取
+        bool is_done = false;   //!< 是否已完成交接
+        bool is_linked = false;
+        Waiter *prev = nullptr;
+        Waiter *next = nullptr;
+    };
+
+    //! 侵入式的双向链表，被取消的等待者能 O(1) 地移除
+    class WaiterList {
+      public:
+        bool empty() const { return head_ == nullptr; }
+
+        void pushBack(Waiter *w) {
+            w->prev = tail_;
+            w->next = nullptr;
+            if (tail_ != nullptr)
+                tail_->next = w;
+            else
+                head_ = w;
+            tail_ = w;
+            w->is_linked = true;
+        }
+
+        Waiter* popFront() {
+            Waiter *w = head_;
+            remove(w);
+            return w;
+        }
+
+        void remove(Waiter *w) {
+            if (!w->is_linked)
+                return;
+            if (w->prev != nullptr)
+                w->prev->next = w->next;
+            else
+                head_ = w->next;
+            if (w->next != nullptr)
+                w->next->prev = w->prev;
+            else
+                tail_ = w->prev;
+            w->prev = w->next = nullptr;
+            w->is_linked = false;
+        }
+
+      private:
+        Waiter *head_ = nullptr;
+        Waiter *tail_ = nullptr;
+    };
+
+    bool wait(Waiter &waiter, WaiterList &list) {
+        while (!waiter.is_done && !is_closed_ && !sch_.isCanceled())
+            sch_.wait();
+
+        list.remove(&waiter);
+        return waiter.is_done;
+    }
+
+    //! 尝试发送，仅在成功时移走 value
+    bool tryPush(T &value) {
+        if (is_closed_)
+            return false;
+
+        //! 有等待的接收者时缓冲一定是空的，直接交给最早等待的
+        if (!recv_waiters_.empty()) {
+            Waiter *w = recv_waiters_.popFront();
+            w->is_done = true;
+            sch_.resume(w->token);
+            if (w->item != nullptr) {
+                *w->item = std::move(value);
+                return true;
+            }
         }
 
-        out = queue_.front();
-        queue_.pop();
+        if (isFull())
+            return false;
+
+        pushBack(std::move(value));
+        return true;
+    }
+
+    bool tryPop(T &out) {
+        if (size_ == 0)
+            return false;
+
+        out = std::move(front());
+        popFrontAndRefill();
         return true;
     }
 
-    Channel& operator << (const T &value) {
-        if (queue_.empty() && !token_.empty()) {
-            auto t = token_.front();
-            token_.pop();
-            sch_.resume(t);
+    //! 取走一个后，将最早等待的发送者的数据放入缓冲
+    void popFrontAndRefill() {
+        popFront();
+        if (!send_waiters_.empty()) {
+            Waiter *w = send_waiters_.popFront();
+            pushBack(std::move(*w->item));
+            w->is_done = true;
+            sch_.resume(w->token);
         }
-        queue_.push(value);
-        return *this;
     }
 
-    inline bool empty() const { return queue_.empty(); }
-    inline bool size() const { return queue_.size(); }
+    T& front() { return buff_[head_]; }
+
+    void popFront() {
+        buff_[head_].~T();
+        head_ = (head_ + 1) & (buff_size_ - 1);
+        --size_;
+    }
+
+    void pushBack(T &&value) {
+        if (size_ == buff_size_)
+            grow();
+        new (buff_ + ((head_ + size_) & (buff_size_ - 1))) T(std::move(value));
+        ++size_;
+    }
+
+    //! 缓冲的大小总是2的幂，满了就翻倍
+    void grow() {
+        size_t new_size = buff_size_ == 0 ? kInitBuffSize : buff_size_ * 2;
+        T *new_buff = alloc_.allocate(new_size);
+        for (size_t i = 0; i < size_; ++i) {
+            T *p = buff_ + ((head_ + i) & (buff_size_ - 1));
+            new (new_buff + i) T(std::move(*p));
+            p->~T();
+        }
+        if (buff_ != nullptr)
+            alloc_.deallocate(buff_, buff_size_);
+
+        buff_ = new_buff;
+        buff_size_ = new_size;
+        head_ = 0;
+    }
 
   private:
+    static constexpr size_t kInitBuffSize = 16;
+
     Scheduler &sch_;
+    size_t capacity_;
+    bool is_closed_ = false;
+
+    std::allocator<T> alloc_;
+    T *buff_ = nullptr;
+    size_t buff_size_ = 0;
+    size_t head_ = 0;
+    size_t size_ = 0;
 
-    std::queue<T> queue_;
-    std::queue<RoutineToken> token_;
+    WaiterList recv_waiters_;
+    WaiterList send_waiters_;
 };
 
+template <class T>
+constexpr size_t Channel<T>::kInitBuffSize;
+
 }
 }
 
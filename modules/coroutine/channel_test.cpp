@@ -22,6 +22,9 @@
 #include <tbox/base/scope_exit.hpp>
 #include <tbox/event/timer_event.h>
 #include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
 
 using namespace std;
 using namespace tbox;
@@ -192,3 +195,249 @@ TEST(Channel, TimerProduceAndConsumer)
     sp_loop->cleanup();
 }
 
+
+/**
+ * 容量有限时，满了发送者要等待，直到接收者取走数据
+ */
+TEST(Channel, BoundedSendWait)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<int> ch(sch, 2);
+
+    int send_count = 0;
+    size_t max_size = 0;
+    vector<int> recv_vec;
+
+    auto producer_entry = [&] (Scheduler &) {
+        for (int i = 0; i < 10; ++i) {
+            if (!ch.send(i))
+                break;
+            ++send_count;
+            max_size = std::max(max_size, ch.size());
+        }
+    };
+
+    sch.create(producer_entry);
+    sp_loop->exitLoop(chrono::milliseconds(1));
+    sp_loop->runLoop();
+
+    //! 没有消费者，生产者只能先放入2个
+    EXPECT_EQ(send_count, 2);
+    EXPECT_FALSE(ch.trySend(100));
+
+    auto consumer_entry = [&] (Scheduler &sch) {
+        for (int i = 0; i < 10; ++i) {
+            sch.yield();
+            int value = 0;
+            if (ch.recv(value))
+                recv_vec.push_back(value);
+        }
+        sp_loop->exitLoop();
+    };
+    sch.create(consumer_entry);
+
+    sp_loop->exitLoop(chrono::seconds(1));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(send_count, 10);
+    EXPECT_LE(max_size, 2u);
+    EXPECT_EQ(recv_vec, vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+/**
+ * 只能移动的元素
+ */
+TEST(Channel, MoveOnly)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<unique_ptr<int>> ch(sch, 4);
+
+    vector<int> recv_vec;
+    sch.create(
+        [&] (Scheduler &) {
+            unique_ptr<int> p;
+            while (ch >> p)
+                recv_vec.push_back(*p);
+        }
+    );
+
+    for (int i = 0; i < 20; ++i) {
+        //! 协程外不能等待，满了就让 Loop 跑一轮，让消费者取走
+        unique_ptr<int> p(new int(i));
+        while (!ch.trySend(std::move(p))) {
+            EXPECT_NE(p, nullptr);  //! 失败时不会被移走
+            sp_loop->exitLoop(chrono::milliseconds(1));
+            sp_loop->runLoop();
+        }
+    }
+    ch.close();
+
+    sp_loop->exitLoop(chrono::milliseconds(10));
+    sp_loop->runLoop();
+
+    ASSERT_EQ(recv_vec.size(), 20u);
+    for (int i = 0; i < 20; ++i)
+        EXPECT_EQ(recv_vec[i], i);
+}
+
+/**
+ * 批量接收
+ */
+TEST(Channel, RecvMany)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<int> ch(sch);
+
+    vector<int> recv_vec;
+    vector<size_t> batch_sizes;
+    sch.create(
+        [&] (Scheduler &) {
+            for (;;) {
+                auto num = ch.recvMany(recv_vec, 4);
+                if (num == 0)
+                    break;
+                batch_sizes.push_back(num);
+            }
+        }
+    );
+
+    vector<int> out;
+    EXPECT_EQ(ch.tryRecvMany(out, 10), 0u);
+
+    for (int i = 0; i < 10; ++i)
+        ch << i;
+    ch.close();
+
+    sp_loop->exitLoop(chrono::milliseconds(10));
+    sp_loop->runLoop();
+
+    EXPECT_EQ(recv_vec, vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    EXPECT_EQ(batch_sizes, vector<size_t>({4, 4, 2}));
+}
+
+/**
+ * 关闭后，发送失败，剩余的数据仍可接收，等待的协程都被唤醒
+ */
+TEST(Channel, Close)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<int> ch(sch, 1);
+
+    ch << 1;
+    bool is_send_fail = false;
+    sch.create([&] (Scheduler &) { is_send_fail = !ch.send(2); });
+
+    ch.close();
+    EXPECT_FALSE(ch.trySend(3));
+
+    int recv_num = 0;
+    bool is_recv_end = false;
+    sch.create(
+        [&] (Scheduler &) {
+            int value = 0;
+            while (ch.recv(value))
+                ++recv_num;
+            is_recv_end = true;
+        }
+    );
+
+    sp_loop->exitLoop(chrono::milliseconds(10));
+    sp_loop->runLoop();
+
+    EXPECT_TRUE(is_send_fail);
+    EXPECT_EQ(recv_num, 1);
+    EXPECT_TRUE(is_recv_end);
+}
+
+/**
+ * 多个接收者时，按等待的先后轮流得到数据；被取消的等待者不影响其它
+ */
+TEST(Channel, FairnessAndCancel)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<int> ch(sch);
+
+    vector<string> recv_vec;
+    auto consumer_entry = [&] (Scheduler &sch) {
+        int value = 0;
+        while (ch >> value)
+            recv_vec.push_back(sch.getName() + ":" + to_string(value));
+    };
+
+    sch.create(consumer_entry, true, "a");
+    auto token_b = sch.create(consumer_entry, true, "b");
+    sch.create(consumer_entry, true, "c");
+
+    sch.cancel(token_b);
+    sp_loop->exitLoop(chrono::milliseconds(1));
+    sp_loop->runLoop();
+
+    //! 每发一个让 Loop 跑一轮，接收者处理完后重新排到队尾
+    for (int i = 0; i < 4; ++i) {
+        ch << i;
+        sp_loop->exitLoop(chrono::milliseconds(1));
+        sp_loop->runLoop();
+    }
+
+    EXPECT_EQ(recv_vec, vector<string>({"a:0", "c:1", "a:2", "c:3"}));
+    sch.cleanup();
+}
+
+/**
+ * 两个协程通过两个通道来回传递数据的吞吐量
+ */
+TEST(Channel, PingPongBenchmark)
+{
+    Loop *sp_loop = event::Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    Scheduler sch(sp_loop);
+    Channel<int> ping(sch, 1), pong(sch, 1);
+
+    const int kRounds = 200000;
+    int count = 0;
+
+    sch.create(
+        [&] (Scheduler &) {
+            int value = 0;
+            while ((ping >> value) && pong.send(value + 1))
+                ++count;
+        }
+    );
+
+    auto start_ts = chrono::steady_clock::now();
+    sch.create(
+        [&] (Scheduler &) {
+            int value = 0;
+            for (int i = 0; i < kRounds; ++i) {
+                ping.send(value);
+                pong >> value;
+            }
+            ping.close();
+            sp_loop->exitLoop();
+        }
+    );
+
+    sp_loop->exitLoop(chrono::seconds(30));
+    sp_loop->runLoop();
+    auto cost_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_ts).count();
+
+    EXPECT_EQ(count, kRounds);
+    cout << kRounds << " round trips cost " << cost_us << " us, "
+         << kRounds * 1000000ull / (cost_us > 0 ? cost_us : 1) << " round trips/s" << endl;
+}
@@ -0,0 +1,210 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "context.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <tbox/base/assert.h>
+
+#ifdef TBOX_COROUTINE_ASM_CONTEXT
+
+extern "C" {
+//! 保存当前的寄存器到当前栈上，将栈顶存入 *from_sp，然后切到 to_sp 所指的栈恢复寄存器
+void tbox_coroutine_switch(void **from_sp, void *to_sp);
+//! 新上下文第一次被切换进来时的入口，从寄存器中取出 entry 与 arg 并调用
+void tbox_coroutine_trampoline();
+}
+
+#if defined(__x86_64__)
+/**
+ * 栈上的布局，由低到高：
+ *   mxcsr(4B) x87控制字(2B) 保留(2B) | r12 | r13 | r14 | r15 | rbx | rbp | 返回地址
+ */
+asm(R"(
+    .text
+    .globl  tbox_coroutine_switch
+    .hidden tbox_coroutine_switch
+    .type   tbox_coroutine_switch, @function
+    .align  16
+tbox_coroutine_switch:
+    pushq   %rbp
+    pushq   %rbx
+    pushq   %r15
+    pushq   %r14
+    pushq   %r13
+    pushq   %r12
+    subq    $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw  4(%rsp)
+    movq    %rsp, (%rdi)
+    movq    %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw   4(%rsp)
+    addq    $8, %rsp
+    popq    %r12
+    popq    %r13
+    popq    %r14
+    popq    %r15
+    popq    %rbx
+    popq    %rbp
+    ret
+    .size   tbox_coroutine_switch, .-tbox_coroutine_switch
+
+    .globl  tbox_coroutine_trampoline
+    .hidden tbox_coroutine_trampoline
+    .type   tbox_coroutine_trampoline, @function
+    .align  16
+tbox_coroutine_trampoline:
+    movq    %r12, %rdi
+    callq   *%r13
+    ud2
+    .size   tbox_coroutine_trampoline, .-tbox_coroutine_trampoline
+)");
+
+namespace {
+enum {
+    kFrameFpu = 0, kFrameR12, kFrameR13, kFrameR14, kFrameR15, kFrameRbx, kFrameRbp, kFrameRet,
+    kFrameSlotNum
+};
+}
+
+#elif defined(__aarch64__)
+/**
+ * 栈上的布局，由低到高：
+ *   d8 ~ d15 | x19 ~ x28 | x29(fp) | x30(lr)
+ */
+asm(R"(
+    .text
+    .globl  tbox_coroutine_switch
+    .hidden tbox_coroutine_switch
+    .type   tbox_coroutine_switch, %function
+    .align  4
+tbox_coroutine_switch:
+    sub     sp, sp, #0xa0
+    stp     d8,  d9,  [sp, #0x00]
+    stp     d10, d11, [sp, #0x10]
+    stp     d12, d13, [sp, #0x20]
+    stp     d14, d15, [sp, #0x30]
+    stp     x19, x20, [sp, #0x40]
+    stp     x21, x22, [sp, #0x50]
+    stp     x23, x24, [sp, #0x60]
+    stp     x25, x26, [sp, #0x70]
+    stp     x27, x28, [sp, #0x80]
+    stp     x29, x30, [sp, #0x90]
+    mov     x9, sp
+    str     x9, [x0]
+    mov     sp, x1
+    ldp     d8,  d9,  [sp, #0x00]
+    ldp     d10, d11, [sp, #0x10]
+    ldp     d12, d13, [sp, #0x20]
+    ldp     d14, d15, [sp, #0x30]
+    ldp     x19, x20, [sp, #0x40]
+    ldp     x21, x22, [sp, #0x50]
+    ldp     x23, x24, [sp, #0x60]
+    ldp     x25, x26, [sp, #0x70]
+    ldp     x27, x28, [sp, #0x80]
+    ldp     x29, x30, [sp, #0x90]
+    add     sp, sp, #0xa0
+    ret
+    .size   tbox_coroutine_switch, .-tbox_coroutine_switch
+
+    .globl  tbox_coroutine_trampoline
+    .hidden tbox_coroutine_trampoline
+    .type   tbox_coroutine_trampoline, %function
+    .align  4
+tbox_coroutine_trampoline:
+    mov     x0, x19
+    blr     x20
+    brk     #0
+    .size   tbox_coroutine_trampoline, .-tbox_coroutine_trampoline
+)");
+
+namespace {
+enum {
+    kFrameX19 = 8, kFrameX20 = 9, kFrameX29 = 18, kFrameX30 = 19,
+    kFrameSlotNum = 20
+};
+}
+
+#endif
+
+namespace tbox {
+namespace coroutine {
+
+void Context::init(void *stack_base, size_t stack_size, Entry entry, void *arg)
+{
+    TBOX_ASSERT(stack_size > kFrameSlotNum * sizeof(void*) * 2);
+
+    //! 栈从高地址向低地址增长，先将栈顶按16字节对齐
+    auto top = (reinterpret_cast<uintptr_t>(stack_base) + stack_size) & ~static_cast<uintptr_t>(15);
+
+#if defined(__x86_64__)
+    //! 经 ret 进入 tbox_coroutine_trampoline 后，rsp 要16字节对齐，这样 call 之后才符合调用约定
+    auto frame = reinterpret_cast<uint64_t*>(top - 16 - kFrameSlotNum * sizeof(uint64_t));
+    ::memset(frame, 0, kFrameSlotNum * sizeof(uint64_t));
+    frame[kFrameFpu] = 0x037F00001F80ull;  //! mxcsr 与 x87 控制字的默认值
+    frame[kFrameR12] = reinterpret_cast<uint64_t>(arg);
+    frame[kFrameR13] = reinterpret_cast<uint64_t>(entry);
+    frame[kFrameRet] = reinterpret_cast<uint64_t>(&tbox_coroutine_trampoline);
+
+#elif defined(__aarch64__)
+    auto frame = reinterpret_cast<uint64_t*>(top - kFrameSlotNum * sizeof(uint64_t));
+    ::memset(frame, 0, kFrameSlotNum * sizeof(uint64_t));
+    frame[kFrameX19] = reinterpret_cast<uint64_t>(arg);
+    frame[kFrameX20] = reinterpret_cast<uint64_t>(entry);
+    frame[kFrameX29] = 0;
+    frame[kFrameX30] = reinterpret_cast<uint64_t>(&tbox_coroutine_trampoline);
+#endif
+
+    sp_ = frame;
+}
+
+void Context::Switch(Context &from, Context &to)
+{
+    tbox_coroutine_switch(&from.sp_, to.sp_);
+}
+
+}
+}
+
+#else   //! ucontext
+
+namespace tbox {
+namespace coroutine {
+
+void Context::init(void *stack_base, size_t stack_size, Entry entry, void *arg)
+{
+    getcontext(&ctx_);
+    ctx_.uc_stack.ss_size = stack_size;
+    ctx_.uc_stack.ss_sp = stack_base;
+    ctx_.uc_link = nullptr;
+    makecontext(&ctx_, (void(*)(void))entry, 1, arg);
+}
+
+void Context::Switch(Context &from, Context &to)
+{
+    swapcontext(&from.ctx_, &to.ctx_);
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_CONTEXT_H_20261019
+#define TBOX_COROUTINE_CONTEXT_H_20261019
+
+#include <cstddef>
+
+/**
+ * 在 x86-64 与 aarch64 上使用手写的汇编切换上下文，只保存与恢复被调用者保存的寄存器，
+ * 不像 swapcontext() 那样每次都通过系统调用保存与恢复信号掩码。
+ * 其它平台，或定义了 TBOX_COROUTINE_USE_UCONTEXT 时，退化为 ucontext。
+ */
+#if !defined(TBOX_COROUTINE_USE_UCONTEXT) && (defined(__x86_64__) || defined(__aarch64__))
+    #define TBOX_COROUTINE_ASM_CONTEXT 1
+#else
+    #include <ucontext.h>
+#endif
+
+namespace tbox {
+namespace coroutine {
+
+//! 协程上下文，仅供 Scheduler 内部使用
+class Context {
+  public:
+    using Entry = void (*)(void *arg);
+
+    /**
+     * 在指定的栈上构建一个新的上下文，第一次切换进去时执行 entry(arg)
+     *
+     * \warning entry 不能返回，结束时必须切换到其它上下文
+     */
+    void init(void *stack_base, size_t stack_size, Entry entry, void *arg);
+
+    //! 保存当前的执行现场到 from，然后切换到 to
+    static void Switch(Context &from, Context &to);
+
+  private:
+#ifdef TBOX_COROUTINE_ASM_CONTEXT
+    void *sp_ = nullptr;    //!< 切出时的栈顶，寄存器都保存在栈上
+#else
+    ucontext_t ctx_;
+#endif
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_CONTEXT_H_20261019
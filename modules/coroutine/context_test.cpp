@@ -0,0 +1,86 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#include "context.h"
+#include "stack_pool.h"
+
+namespace tbox {
+namespace coroutine {
+namespace {
+
+struct PingPong {
+    Context main_ctx;
+    Context sub_ctx;
+    int counter = 0;
+    double sum = 0;
+    std::string text;
+};
+
+void PingPongEntry(void *arg)
+{
+    auto p = static_cast<PingPong*>(arg);
+    for (int i = 0; i < 100; ++i) {
+        ++p->counter;
+        p->sum += 0.5;
+        Context::Switch(p->sub_ctx, p->main_ctx);
+    }
+
+    //! 检查栈是否对齐：格式化浮点数、抛出并捕获异常
+    char buff[32];
+    snprintf(buff, sizeof(buff), "%.3f", p->sum);
+    try {
+        throw std::runtime_error(buff);
+    } catch (const std::exception &e) {
+        p->text = e.what();
+    }
+    Context::Switch(p->sub_ctx, p->main_ctx);
+}
+
+}
+
+TEST(Context, Switch)
+{
+    StackPool pool;
+    auto stack = pool.alloc(16 << 10);
+    ASSERT_NE(stack.base, nullptr);
+
+    PingPong data;
+    data.sub_ctx.init(stack.base, stack.size, PingPongEntry, &data);
+
+    //! 主协程中的局部变量在切换前后要保持不变
+    double local = 1.25;
+    for (int i = 0; i < 100; ++i) {
+        Context::Switch(data.main_ctx, data.sub_ctx);
+        EXPECT_EQ(data.counter, i + 1);
+        local *= 2;
+    }
+    EXPECT_DOUBLE_EQ(local, 1.25 * (1ull << 50) * (1ull << 50));
+
+    Context::Switch(data.main_ctx, data.sub_ctx);
+    EXPECT_EQ(data.text, "50.000");
+
+    pool.free(stack);
+}
+
+}
+}
@@ -0,0 +1,240 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "fd_io.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <tbox/base/assert.h>
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace coroutine {
+
+using namespace std::chrono;
+
+FdIo::FdIo(Scheduler &sch, int fd) :
+    sch_(sch), fd_(fd)
+{ }
+
+FdIo::~FdIo()
+{
+    TBOX_ASSERT(!read_waiter_.is_waiting && !write_waiter_.is_waiting);
+
+    CHECK_DELETE_RESET_OBJ(read_waiter_.fd_event);
+    CHECK_DELETE_RESET_OBJ(read_waiter_.timer_event);
+    CHECK_DELETE_RESET_OBJ(write_waiter_.fd_event);
+    CHECK_DELETE_RESET_OBJ(write_waiter_.timer_event);
+}
+
+bool FdIo::waitReadable(milliseconds timeout)
+{
+    return wait(read_waiter_, event::FdEvent::kReadEvent, timeout);
+}
+
+bool FdIo::waitWritable(milliseconds timeout)
+{
+    return wait(write_waiter_, event::FdEvent::kWriteEvent, timeout);
+}
+
+ssize_t FdIo::read(void *buff, size_t size, milliseconds timeout)
+{
+    auto deadline = steady_clock::now() + timeout;
+    for (;;) {
+        auto rsize = ::read(fd_, buff, size);
+        if (rsize >= 0)
+            return rsize;
+
+        if (errno == EINTR)
+            continue;
+
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+            !waitReadable(Remain(deadline, timeout)))
+            return -1;
+    }
+}
+
+ssize_t FdIo::write(const void *data, size_t size, milliseconds timeout)
+{
+    auto deadline = steady_clock::now() + timeout;
+    auto ptr = static_cast<const uint8_t*>(data);
+    size_t remain_size = size;
+
+    while (remain_size > 0) {
+        auto wsize = ::write(fd_, ptr, remain_size);
+        if (wsize >= 0) {
+            ptr += wsize;
+            remain_size -= wsize;
+            continue;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+            !waitWritable(Remain(deadline, timeout)))
+            return -1;
+    }
+    return size;
+}
+
+int FdIo::accept(struct sockaddr *addr, socklen_t *addr_len, milliseconds timeout)
+{
+    auto deadline = steady_clock::now() + timeout;
+    for (;;) {
+        int new_fd = ::accept4(fd_, addr, addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (new_fd >= 0)
+            return new_fd;
+
+        if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+            !waitReadable(Remain(deadline, timeout)))
+            return -1;
+    }
+}
+
+bool FdIo::connect(const struct sockaddr *addr, socklen_t addr_len, milliseconds timeout)
+{
+    if (::connect(fd_, addr, addr_len) == 0)
+        return true;
+
+    if (errno != EINPROGRESS && errno != EINTR)
+        return false;
+
+    //! 连接的结果要等可写之后，从 SO_ERROR 中取
+    if (!waitWritable(timeout))
+        return false;
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+        return false;
+
+    if (err != 0) {
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+bool FdIo::wait(Waiter &waiter, short events, milliseconds timeout)
+{
+    TBOX_ASSERT(!waiter.is_waiting);    //! 不允许多个协程同时等待同一种事件
+
+    if (sch_.isCanceled()) {
+        errno = ECANCELED;
+        return false;
+    }
+
+    if (timeout == milliseconds::zero()) {
+        errno = ETIMEDOUT;
+        return false;
+    }
+
+    auto loop = sch_.getLoop();
+    if (waiter.fd_event == nullptr) {
+        waiter.fd_event = loop->newFdEvent("coroutine::FdIo");
+        waiter.fd_event->initialize(fd_, events, event::Event::Mode::kOneshot);
+    }
+
+    bool is_ready = false;
+    bool is_timeout = false;
+    auto token = sch_.getToken();
+
+    waiter.fd_event->setCallback(
+        [this, token, &is_ready] (short) {
+            is_ready = true;
+            sch_.resume(token);
+        }
+    );
+    waiter.fd_event->enable();
+
+    if (timeout > milliseconds::zero()) {
+        if (waiter.timer_event == nullptr)
+            waiter.timer_event = loop->newTimerEvent("coroutine::FdIo");
+        waiter.timer_event->initialize(timeout, event::Event::Mode::kOneshot);
+        waiter.timer_event->setCallback(
+            [this, token, &is_timeout] {
+                is_timeout = true;
+                sch_.resume(token);
+            }
+        );
+        waiter.timer_event->enable();
+    }
+
+    waiter.is_waiting = true;
+    while (!is_ready && !is_timeout && !sch_.isCanceled())
+        sch_.wait();
+    waiter.is_waiting = false;
+
+    waiter.fd_event->disable();
+    if (waiter.timer_event != nullptr)
+        waiter.timer_event->disable();
+
+    if (is_ready)
+        return true;
+
+    errno = is_timeout ? ETIMEDOUT : ECANCELED;
+    return false;
+}
+
+milliseconds FdIo::Remain(steady_clock::time_point deadline, milliseconds timeout)
+{
+    if (timeout < milliseconds::zero())
+        return kForever;
+
+    auto remain = duration_cast<milliseconds>(deadline - steady_clock::now());
+    return remain > milliseconds::zero() ? remain : milliseconds::zero();
+}
+
+bool Sleep(Scheduler &sch, milliseconds duration)
+{
+    if (sch.isCanceled())
+        return false;
+
+    if (duration <= milliseconds::zero()) {
+        sch.yield();
+        return !sch.isCanceled();
+    }
+
+    bool is_timeup = false;
+    auto token = sch.getToken();
+
+    auto timer_event = sch.getLoop()->newTimerEvent("coroutine::Sleep");
+    timer_event->initialize(duration, event::Event::Mode::kOneshot);
+    timer_event->setCallback(
+        [&sch, token, &is_timeup] {
+            is_timeup = true;
+            sch.resume(token);
+        }
+    );
+    timer_event->enable();
+
+    while (!is_timeup && !sch.isCanceled())
+        sch.wait();
+
+    delete timer_event;
+    return is_timeup;
+}
+
+}
+}
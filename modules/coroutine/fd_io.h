@@ -0,0 +1,113 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_FD_IO_H_20261019
+#define TBOX_COROUTINE_FD_IO_H_20261019
+
+#include <chrono>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <tbox/event/fd_event.h>
+#include <tbox/event/timer_event.h>
+
+#include "scheduler.h"
+
+namespace tbox {
+namespace coroutine {
+
+//! 表示不超时
+constexpr std::chrono::milliseconds kForever(-1);
+
+/**
+ * 协程中的非阻塞IO
+ *
+ * 在协程中像写阻塞代码一样读写 fd。当 fd 暂时不可读写时，在调度器的 Loop 上注册 FdEvent，
+ * 挂起当前协程，待 fd 就绪后再恢复执行，不会阻塞 Loop。
+ *
+ * 使用示例：
+ *   sch.create([fd] (Scheduler &sch) {
+ *       FdIo io(sch, fd);
+ *       char buff[1024];
+ *       for (;;) {
+ *           auto rsize = io.read(buff, sizeof(buff));
+ *           if (rsize <= 0 || io.write(buff, rsize) != rsize)
+ *               break;
+ *       }
+ *   });
+ *
+ * 失败时返回 -1 或 false，并设置 errno，其中：超时为 ETIMEDOUT，协程被取消为 ECANCELED。
+ * timeout 均为整个操作的超时，kForever 表示不超时。
+ *
+ * \note    fd 须为非阻塞的，且 FdIo 不负责关闭 fd
+ * \warning 只能在协程中调用；同一时刻，一个 FdIo 最多只能有一个协程读、一个协程写
+ */
+class FdIo {
+  public:
+    FdIo(Scheduler &sch, int fd);
+    ~FdIo();
+
+    NONCOPYABLE(FdIo);
+    IMMOVABLE(FdIo);
+
+  public:
+    int fd() const { return fd_; }
+
+    //! 等待可读或可写
+    bool waitReadable(std::chrono::milliseconds timeout = kForever);
+    bool waitWritable(std::chrono::milliseconds timeout = kForever);
+
+    //! 读取数据，读到数据即返回。对端关闭时返回0
+    ssize_t read(void *buff, size_t size, std::chrono::milliseconds timeout = kForever);
+    //! 写数据，直到全部写完才返回
+    ssize_t write(const void *data, size_t size, std::chrono::milliseconds timeout = kForever);
+
+    //! 接受连接，返回的 fd 为非阻塞的，且设置了 close-on-exec
+    int accept(struct sockaddr *addr = nullptr, socklen_t *addr_len = nullptr,
+               std::chrono::milliseconds timeout = kForever);
+    //! 发起连接，直到连接成功或失败
+    bool connect(const struct sockaddr *addr, socklen_t addr_len,
+                 std::chrono::milliseconds timeout = kForever);
+
+  protected:
+    struct Waiter {
+        event::FdEvent *fd_event = nullptr;
+        event::TimerEvent *timer_event = nullptr;
+        bool is_waiting = false;
+    };
+
+    bool wait(Waiter &waiter, short events, std::chrono::milliseconds timeout);
+    //! 由截止时间计算剩余的超时
+    static std::chrono::milliseconds Remain(std::chrono::steady_clock::time_point deadline, std::chrono::milliseconds timeout);
+
+  private:
+    Scheduler &sch_;
+    int fd_;
+
+    Waiter read_waiter_;
+    Waiter write_waiter_;
+};
+
+//! 在协程中休眠，被取消时返回 false
+bool Sleep(Scheduler &sch, std::chrono::milliseconds duration);
+
+}
+}
+
+#endif //TBOX_COROUTINE_FD_IO_H_20261019
@@ -0,0 +1,239 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "fd_io.h"
+
+using namespace std;
+using namespace tbox;
+using namespace tbox::event;
+using namespace tbox::coroutine;
+
+TEST(FdIo, ReadWrite)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    SetScopeExitAction([fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    std::string recv_data;
+    {
+        Scheduler sch(sp_loop);
+        //! 读协程：把读到的数据存起来，直到对端关闭
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[0]);
+                char buff[4];
+                for (;;) {
+                    auto rsize = io.read(buff, sizeof(buff));
+                    if (rsize <= 0)
+                        break;
+                    recv_data.append(buff, rsize);
+                }
+                sp_loop->exitLoop();
+            }
+        );
+        //! 写协程：分两次写，中间休眠
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[1]);
+                EXPECT_EQ(io.write("hello ", 6), 6);
+                EXPECT_TRUE(Sleep(sch, chrono::milliseconds(10)));
+                EXPECT_EQ(io.write("world", 5), 5);
+                ::shutdown(fds[1], SHUT_WR);
+            }
+        );
+
+        sp_loop->exitLoop(chrono::seconds(1));
+        sp_loop->runLoop();
+    }
+    EXPECT_EQ(recv_data, "hello world");
+}
+
+TEST(FdIo, WriteLargeData)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    SetScopeExitAction([fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    //! 远超过 socket 缓冲大小，写的协程要多次等待可写
+    std::string send_data(4 << 20, 'x');
+    size_t recv_size = 0;
+    {
+        Scheduler sch(sp_loop);
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[1]);
+                EXPECT_EQ(io.write(send_data.data(), send_data.size()), static_cast<ssize_t>(send_data.size()));
+                ::shutdown(fds[1], SHUT_WR);
+            }
+        );
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[0]);
+                char buff[4096];
+                ssize_t rsize = 0;
+                while ((rsize = io.read(buff, sizeof(buff))) > 0)
+                    recv_size += rsize;
+                sp_loop->exitLoop();
+            }, true, "", 32 << 10
+        );
+
+        sp_loop->exitLoop(chrono::seconds(5));
+        sp_loop->runLoop();
+    }
+    EXPECT_EQ(recv_size, send_data.size());
+}
+
+TEST(FdIo, ReadTimeout)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    SetScopeExitAction([fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    bool is_done = false;
+    {
+        Scheduler sch(sp_loop);
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[0]);
+                char buff[4];
+                auto start = chrono::steady_clock::now();
+                EXPECT_EQ(io.read(buff, sizeof(buff), chrono::milliseconds(20)), -1);
+                EXPECT_EQ(errno, ETIMEDOUT);
+                EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(15));
+                is_done = true;
+            }
+        );
+
+        sp_loop->exitLoop(chrono::milliseconds(100));
+        sp_loop->runLoop();
+    }
+    EXPECT_TRUE(is_done);
+}
+
+TEST(FdIo, Cancel)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int fds[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    SetScopeExitAction([fds] { ::close(fds[0]); ::close(fds[1]); });
+
+    bool is_read_canceled = false;
+    bool is_sleep_canceled = false;
+    {
+        Scheduler sch(sp_loop);
+        auto read_token = sch.create(
+            [&] (Scheduler &sch) {
+                FdIo io(sch, fds[0]);
+                char buff[4];
+                if (io.read(buff, sizeof(buff)) == -1 && errno == ECANCELED)
+                    is_read_canceled = true;
+            }
+        );
+        auto sleep_token = sch.create(
+            [&] (Scheduler &sch) {
+                is_sleep_canceled = !Sleep(sch, chrono::seconds(10));
+            }
+        );
+
+        sp_loop->runInLoop([&] { sch.cancel(read_token); sch.cancel(sleep_token); });
+        sp_loop->exitLoop(chrono::milliseconds(20));
+        sp_loop->runLoop();
+    }
+    EXPECT_TRUE(is_read_canceled);
+    EXPECT_TRUE(is_sleep_canceled);
+}
+
+TEST(FdIo, AcceptConnect)
+{
+    Loop *sp_loop = Loop::New();
+    SetScopeExitAction([sp_loop]{ delete sp_loop;});
+
+    int listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(listen_fd, 0);
+    SetScopeExitAction([listen_fd] { ::close(listen_fd); });
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_EQ(::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(listen_fd, 5), 0);
+    socklen_t addr_len = sizeof(addr);
+    ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+
+    std::string echo_data;
+    {
+        Scheduler sch(sp_loop);
+        //! 服务端：接受一个连接，回显
+        sch.create(
+            [&] (Scheduler &sch) {
+                FdIo listen_io(sch, listen_fd);
+                int conn_fd = listen_io.accept();
+                ASSERT_GE(conn_fd, 0);
+                FdIo io(sch, conn_fd);
+                char buff[64];
+                auto rsize = io.read(buff, sizeof(buff));
+                if (rsize > 0)
+                    io.write(buff, rsize);
+                ::close(conn_fd);
+            }
+        );
+        //! 客户端
+        sch.create(
+            [&] (Scheduler &sch) {
+                int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+                FdIo io(sch, fd);
+                EXPECT_TRUE(io.connect(reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+                EXPECT_EQ(io.write("ping", 4), 4);
+                char buff[64];
+                auto rsize = io.read(buff, sizeof(buff), chrono::milliseconds(500));
+                if (rsize > 0)
+                    echo_data.assign(buff, rsize);
+                ::close(fd);
+                sp_loop->exitLoop();
+            }
+        );
+
+        sp_loop->exitLoop(chrono::seconds(1));
+        sp_loop->runLoop();
+    }
+    EXPECT_EQ(echo_data, "ping");
+}
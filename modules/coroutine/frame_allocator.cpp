@@ -0,0 +1,115 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "frame_allocator.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace tbox {
+namespace coroutine {
+
+namespace {
+//! 返回 size 所在的级，不缓存时返回 -1
+int SizeToIndex(size_t size)
+{
+    if (size == 0 || size > FrameAllocator::kMaxCachedSize)
+        return -1;
+    return static_cast<int>((size - 1) / FrameAllocator::kAlignSize);
+}
+}
+
+constexpr size_t FrameAllocator::kAlignSize;
+constexpr size_t FrameAllocator::kMaxCachedSize;
+
+FrameAllocator::FrameAllocator() :
+    cached_frames_(kMaxCachedSize / kAlignSize)
+{ }
+
+FrameAllocator::~FrameAllocator()
+{
+    clear();
+}
+
+FrameAllocator& FrameAllocator::ThreadLocal()
+{
+    static thread_local FrameAllocator _allocator;
+    return _allocator;
+}
+
+void FrameAllocator::setConfig(const Config &cfg)
+{
+    cfg_ = cfg;
+    clear();
+}
+
+void* FrameAllocator::alloc(size_t size)
+{
+    int index = SizeToIndex(size);
+    if (index >= 0) {
+        auto &frames = cached_frames_[index];
+        if (!frames.empty()) {
+            void *ptr = frames.back();
+            frames.pop_back();
+            --cached_num_;
+            ++stats_.reuse_num;
+            return ptr;
+        }
+        //! 按级的大小申请，以便释放后给同级的帧复用
+        size = (index + 1) * kAlignSize;
+    }
+
+    void *ptr = ::malloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+
+    ++stats_.alloc_num;
+    return ptr;
+}
+
+void FrameAllocator::free(void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    int index = SizeToIndex(size);
+    if (index >= 0) {
+        auto &frames = cached_frames_[index];
+        if (frames.size() < cfg_.max_cached_num) {
+            frames.push_back(ptr);
+            ++cached_num_;
+            return;
+        }
+    }
+
+    ::free(ptr);
+}
+
+void FrameAllocator::clear()
+{
+    for (auto &frames : cached_frames_) {
+        for (void *ptr : frames)
+            ::free(ptr);
+        frames.clear();
+    }
+    cached_num_ = 0;
+}
+
+}
+}
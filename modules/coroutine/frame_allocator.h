@@ -0,0 +1,92 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_FRAME_ALLOCATOR_H_20261019
+#define TBOX_COROUTINE_FRAME_ALLOCATOR_H_20261019
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 协程帧分配器
+ *
+ * 供 task.hpp 中的 C++20 无栈协程分配协程帧使用。协程帧按 kAlignSize 向上取整分级，
+ * 释放后不归还系统，而是缓存起来给后面同级大小的帧复用，免去频繁的 malloc() 与 free()。
+ *
+ * 每个线程一个，通过 ThreadLocal() 获取。由于 Loop 与其线程一一对应，也就是每个 Loop 一个。
+ * 在 A 线程申请、B 线程释放的帧，会被缓存到 B 线程的分配器中，不会产生竞争。
+ *
+ * \warning 不可多线程同时使用同一个对象
+ */
+class FrameAllocator {
+  public:
+    static constexpr size_t kAlignSize = 64;            //!< 分级的粒度
+    static constexpr size_t kMaxCachedSize = 4096;      //!< 超过该大小的帧不缓存
+
+    struct Config {
+        size_t max_cached_num = 256;    //!< 每一级最多缓存的空闲帧个数，0表示不缓存
+    };
+
+    struct Stats {
+        uint64_t alloc_num = 0; //!< 调用 malloc() 新申请的次数
+        uint64_t reuse_num = 0; //!< 从缓存中复用的次数
+    };
+
+  public:
+    FrameAllocator();
+    ~FrameAllocator();
+
+    NONCOPYABLE(FrameAllocator);
+    IMMOVABLE(FrameAllocator);
+
+  public:
+    //! 获取当前线程的分配器
+    static FrameAllocator& ThreadLocal();
+
+    void setConfig(const Config &cfg);
+    const Config& getConfig() const { return cfg_; }
+
+    //! 申请 size 字节，失败时抛出 std::bad_alloc
+    void* alloc(size_t size);
+    //! 释放，size 须与申请时的相同
+    void free(void *ptr, size_t size);
+
+    //! 释放所有缓存的帧
+    void clear();
+
+    size_t cachedNum() const { return cached_num_; }
+    const Stats& getStats() const { return stats_; }
+
+  private:
+    Config cfg_;
+    size_t cached_num_ = 0;
+    std::vector<std::vector<void*>> cached_frames_; //!< 第 i 级缓存 (i+1)*kAlignSize 大小的空闲帧
+    Stats stats_;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_FRAME_ALLOCATOR_H_20261019
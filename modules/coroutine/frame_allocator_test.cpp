@@ -0,0 +1,105 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "frame_allocator.h"
+
+namespace tbox {
+namespace coroutine {
+
+TEST(FrameAllocator, Reuse)
+{
+    FrameAllocator allocator;
+
+    void *p1 = allocator.alloc(100);
+    ASSERT_NE(p1, nullptr);
+    allocator.free(p1, 100);
+    EXPECT_EQ(allocator.cachedNum(), 1u);
+
+    //! 同一级的大小复用同一块内存
+    void *p2 = allocator.alloc(128);
+    EXPECT_EQ(p2, p1);
+    EXPECT_EQ(allocator.cachedNum(), 0u);
+
+    //! 不同级的不复用
+    void *p3 = allocator.alloc(129);
+    EXPECT_NE(p3, p1);
+
+    allocator.free(p2, 128);
+    allocator.free(p3, 129);
+
+    EXPECT_EQ(allocator.getStats().alloc_num, 2u);
+    EXPECT_EQ(allocator.getStats().reuse_num, 1u);
+}
+
+TEST(FrameAllocator, LargeNotCached)
+{
+    FrameAllocator allocator;
+
+    void *p = allocator.alloc(FrameAllocator::kMaxCachedSize + 1);
+    ASSERT_NE(p, nullptr);
+    allocator.free(p, FrameAllocator::kMaxCachedSize + 1);
+    EXPECT_EQ(allocator.cachedNum(), 0u);
+}
+
+TEST(FrameAllocator, MaxCachedNum)
+{
+    FrameAllocator allocator;
+    FrameAllocator::Config cfg;
+    cfg.max_cached_num = 2;
+    allocator.setConfig(cfg);
+
+    void *ptrs[3];
+    for (auto &p : ptrs)
+        p = allocator.alloc(64);
+    for (auto p : ptrs)
+        allocator.free(p, 64);
+
+    EXPECT_EQ(allocator.cachedNum(), 2u);
+    allocator.clear();
+    EXPECT_EQ(allocator.cachedNum(), 0u);
+}
+
+TEST(FrameAllocator, ThreadLocal)
+{
+    FrameAllocator *main_allocator = &FrameAllocator::ThreadLocal();
+    EXPECT_EQ(main_allocator, &FrameAllocator::ThreadLocal());
+
+    //! 在另一线程释放的帧，缓存到该线程的分配器中
+    void *p = main_allocator->alloc(200);
+    FrameAllocator *other_allocator = nullptr;
+    size_t other_cached_num = 0;
+    std::thread t(
+        [&] {
+            other_allocator = &FrameAllocator::ThreadLocal();
+            other_allocator->free(p, 200);
+            other_cached_num = other_allocator->cachedNum();
+        }
+    );
+    t.join();
+
+    EXPECT_NE(other_allocator, main_allocator);
+    EXPECT_EQ(other_cached_num, 1u);
+}
+
+}
+}
@@ -22,12 +22,13 @@
 #include <cstring>
 
 #include <queue>
-#include <ucontext.h>
 
 #include <tbox/base/log.h>
 #include <tbox/base/assert.h>
 #include <tbox/base/cabinet.hpp>
 
+#include "context.h"
+
 namespace tbox {
 namespace coroutine {
 
@@ -40,7 +41,8 @@ using RoutineCabinet = cabinet::Cabinet<Routine>;
 struct Scheduler::Data {
     event::Loop *wp_loop = nullptr;
 
-    ucontext_t main_ctx;   //! 主协程上下文
+    Context main_ctx;   //! 主协程上下文
+    StackPool stack_pool;
     RoutineCabinet routine_cabinet;
     Routine *curr_routine = nullptr;    //! 当前协程的 Routine 对象指针，为 nullptr 表示主协程
 
@@ -55,7 +57,8 @@ struct Routine {
     string       name;  //! 协程名
     Scheduler   &scheduler; //! 协度器引用
 
-    ucontext_t   ctx;   //! 协程上下文
+    Context      ctx;   //! 协程上下文
+    StackPool::Stack stack; //! 协程栈
 
     //! 协程状态
     enum class State {
@@ -78,9 +81,12 @@ struct Routine {
         LogDbg("Routine %u:%s end", token.id(), name.c_str());
     }
 
-    static void RoutineMainEntry(Routine *p_routine)
+    static void RoutineMainEntry(void *p_routine)
     {
-        p_routine->mainEntry();
+        auto routine = static_cast<Routine*>(p_routine);
+        routine->mainEntry();
+        //! 协程结束，回到主协程，不会再切换回来
+        Context::Switch(routine->ctx, routine->scheduler.d_->main_ctx);
     }
 
     Routine(const RoutineEntry &e, const string &n, size_t ss, Scheduler &sch) :
@@ -88,16 +94,11 @@ struct Routine {
     {
         LogDbg("Routine(%u)", token.id());
 
-        void *p_stack_mem = malloc(ss);
-        TBOX_ASSERT(p_stack_mem != nullptr);
-
-        //!TODO: 是否可以加哨兵标记，检查栈溢出
+        //! 栈从栈池中取，栈底有保护页，栈溢出时会触发 SIGSEGV
+        stack = scheduler.d_->stack_pool.alloc(ss);
+        TBOX_ASSERT(stack.base != nullptr);
 
-        getcontext(&ctx);
-        ctx.uc_stack.ss_size = ss;
-        ctx.uc_stack.ss_sp = p_stack_mem;
-        ctx.uc_link = &(scheduler.d_->main_ctx);
-        makecontext(&ctx, (void(*)(void))RoutineMainEntry, 1, this);
+        ctx.init(stack.base, stack.size, RoutineMainEntry, this);
     }
 
     ~Routine()
@@ -105,7 +106,7 @@ struct Routine {
         //! 只有没有启动或是已结束的协程才能被释放
         TBOX_ASSERT(!is_started || state == State::kDead);
 
-        free(ctx.uc_stack.ss_sp);
+        scheduler.d_->stack_pool.free(stack);
         LogDbg("~Routine(%u)", token.id());
     }
 };
@@ -117,8 +118,6 @@ Scheduler::Scheduler(Loop *wp_loop) :
 {
     TBOX_ASSERT(d_ != nullptr);
     d_->wp_loop = wp_loop;
-
-    ::memset(&d_->main_ctx, 0, sizeof(ucontext_t));
 }
 
 Scheduler::~Scheduler()
@@ -195,7 +194,7 @@ void Scheduler::wait()
         return;
 
     d_->curr_routine->state = Routine::State::kSuspend;
-    swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+    Context::Switch(d_->curr_routine->ctx, d_->main_ctx);
 }
 
 void Scheduler::yield()
@@ -205,7 +204,7 @@ void Scheduler::yield()
         return;
 
     makeRoutineReady(d_->curr_routine);
-    swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+    Context::Switch(d_->curr_routine->ctx, d_->main_ctx);
 }
 
 bool Scheduler::join(const RoutineToken &other_routine)
@@ -226,7 +225,7 @@ bool Scheduler::join(const RoutineToken &other_routine)
         routine->join_token = d_->curr_routine->token;
 
         d_->curr_routine->state = Routine::State::kSuspend;
-        swapcontext(&(d_->curr_routine->ctx), &d_->main_ctx);
+        Context::Switch(d_->curr_routine->ctx, d_->main_ctx);
 
         //! 如果不是被cancel唤醒的，那返回成功；否则返回失败
         return !d_->curr_routine->is_canceled;
@@ -257,6 +256,11 @@ event::Loop* Scheduler::getLoop() const
     return d_->wp_loop;
 }
 
+StackPool& Scheduler::getStackPool()
+{
+    return d_->stack_pool;
+}
+
 /**
  * 将 routine 状态置为 kReady，然后将其丢到就绪列表中
  */
@@ -280,7 +284,7 @@ void Scheduler::switchToRoutine(Routine *routine)
     d_->curr_routine->state = Routine::State::kRunning;
 
     //! 切换到 curr_routine 指定协程去执行
-    swapcontext(&d_->main_ctx, &(d_->curr_routine->ctx));
+    Context::Switch(d_->main_ctx, d_->curr_routine->ctx);
     //! 从 curr_routine 指定协程返回来
 
     //! 检查协程状态，如果已经结束了的协程，要释放资源
@@ -24,6 +24,8 @@
 #include <tbox/base/cabinet_token.h>
 #include <tbox/event/loop.h>
 
+#include "stack_pool.h"
+
 namespace tbox {
 namespace coroutine {
 
@@ -67,6 +69,9 @@ class Scheduler {
     std::string getName() const;    //! 当前协程的名称
     event::Loop* getLoop() const;
 
+    //! 协程栈池，可用于调整栈的缓存个数、保护页等，应在创建协程之前设置
+    StackPool& getStackPool();
+
   public:
     //! 以下仅限主协程调用
     void cleanup(); //! 强行停止并清理所有的协程，通常在程序退出前使用
@@ -0,0 +1,131 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "stack_pool.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <tbox/base/log.h>
+
+namespace tbox {
+namespace coroutine {
+
+StackPool::StackPool()
+{
+    auto page_size = ::sysconf(_SC_PAGESIZE);
+    page_size_ = page_size > 0 ? static_cast<size_t>(page_size) : 4096;
+}
+
+StackPool::~StackPool()
+{
+    clear();
+}
+
+void StackPool::setConfig(const Config &cfg)
+{
+    cfg_ = cfg;
+    //! 保护页的设置可能变了，之前缓存的不再复用
+    clear();
+}
+
+StackPool::Stack StackPool::alloc(size_t size)
+{
+    //! 可用大小按页对齐
+    size = (size + page_size_ - 1) & ~(page_size_ - 1);
+    if (size == 0)
+        size = page_size_;
+
+    auto iter = cached_stacks_.find(size);
+    if (iter != cached_stacks_.end() && !iter->second.empty()) {
+        Stack stack = iter->second.back();
+        iter->second.pop_back();
+        --cached_num_;
+        ++stats_.reuse_num;
+        return stack;
+    }
+
+    Stack stack;
+    size_t guard_size = cfg_.enable_guard_page ? page_size_ : 0;
+    size_t mem_size = size + guard_size;
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_STACK
+    flags |= MAP_STACK;
+#endif
+    if (size >= cfg_.lazy_threshold)
+        flags |= MAP_NORESERVE;
+
+    void *mem = ::mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mem == MAP_FAILED) {
+        LogErr("mmap stack fail, size:%zu, errno:%d", mem_size, errno);
+        return stack;
+    }
+
+    //! 栈由高地址向低地址增长，所以保护页放在最低处
+    if (guard_size != 0 && ::mprotect(mem, guard_size, PROT_NONE) != 0)
+        LogWarn("mprotect guard page fail, errno:%d", errno);
+
+    stack.mem = mem;
+    stack.mem_size = mem_size;
+    stack.base = static_cast<uint8_t*>(mem) + guard_size;
+    stack.size = size;
+    ++stats_.map_num;
+    return stack;
+}
+
+void StackPool::free(const Stack &stack)
+{
+    if (stack.base == nullptr)
+        return;
+
+    //! 与当前配置不符的，如设置配置之前申请的，不再缓存
+    size_t guard_size = cfg_.enable_guard_page ? page_size_ : 0;
+    if (cached_num_ >= cfg_.max_cached_num || stack.mem_size != stack.size + guard_size) {
+        unmap(stack);
+        return;
+    }
+
+    //! 大栈的物理内存归还给系统，栈顶那一页几乎总会被用到，保留
+    if (stack.size >= cfg_.lazy_threshold)
+        ::madvise(stack.base, stack.size - page_size_, MADV_DONTNEED);
+
+    cached_stacks_[stack.size].push_back(stack);
+    ++cached_num_;
+}
+
+void StackPool::clear()
+{
+    for (auto &item : cached_stacks_) {
+        for (auto &stack : item.second)
+            unmap(stack);
+    }
+    cached_stacks_.clear();
+    cached_num_ = 0;
+}
+
+void StackPool::unmap(const Stack &stack)
+{
+    if (::munmap(stack.mem, stack.mem_size) != 0)
+        LogWarn("munmap stack fail, errno:%d", errno);
+}
+
+}
+}
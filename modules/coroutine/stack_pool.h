@@ -0,0 +1,102 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_STACK_POOL_H_20261019
+#define TBOX_COROUTINE_STACK_POOL_H_20261019
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace coroutine {
+
+/**
+ * 协程栈池
+ *
+ * 栈用 mmap() 申请，在栈底（低地址）设置一个不可访问的保护页，栈溢出时立即触发 SIGSEGV，
+ * 而不是悄悄地改写其它内存。协程结束后，栈不释放，而是缓存起来给后面创建的协程使用，
+ * 免去频繁创建与销毁协程时 mmap() 与 munmap() 的开销。
+ *
+ * 较大的栈使用 MAP_NORESERVE 申请，物理内存在使用时才按页分配；回收时用 madvise() 将物理内存归还，
+ * 所以可以放心地给协程分配较大的栈。
+ *
+ * \warning 不可多线程同时使用
+ */
+class StackPool {
+  public:
+    struct Config {
+        size_t max_cached_num = 1024;       //!< 最多缓存的空闲栈个数，0表示不缓存
+        bool   enable_guard_page = true;    //!< 是否设置保护页
+        size_t lazy_threshold = 64 << 10;   //!< 不小于该大小的栈，其物理内存按需分配，回收时归还
+    };
+
+    struct Stack {
+        void  *base = nullptr;  //!< 可用栈空间的起始地址（低地址），为nullptr表示无效
+        size_t size = 0;        //!< 可用栈空间的大小
+
+        void  *mem = nullptr;   //!< 整块映射的起始地址，含保护页
+        size_t mem_size = 0;    //!< 整块映射的大小
+    };
+
+    struct Stats {
+        uint64_t map_num = 0;   //!< 调用 mmap() 新申请的次数
+        uint64_t reuse_num = 0; //!< 从缓存中复用的次数
+    };
+
+  public:
+    StackPool();
+    ~StackPool();
+
+    NONCOPYABLE(StackPool);
+    IMMOVABLE(StackPool);
+
+  public:
+    void setConfig(const Config &cfg);
+    const Config& getConfig() const { return cfg_; }
+
+    //! 申请一个可用空间不小于 size 的栈，失败时返回的 Stack::base 为 nullptr
+    Stack alloc(size_t size);
+    //! 归还栈，优先放入缓存
+    void free(const Stack &stack);
+
+    //! 释放所有缓存的栈
+    void clear();
+
+    size_t cachedNum() const { return cached_num_; }
+    const Stats& getStats() const { return stats_; }
+
+  protected:
+    void unmap(const Stack &stack);
+
+  private:
+    Config cfg_;
+    size_t page_size_;
+    size_t cached_num_ = 0;
+    std::unordered_map<size_t, std::vector<Stack>> cached_stacks_;  //!< 可用大小 -> 空闲的栈
+    Stats stats_;
+};
+
+}
+}
+
+#endif //TBOX_COROUTINE_STACK_POOL_H_20261019
@@ -0,0 +1,103 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstring>
+#include "stack_pool.h"
+
+namespace tbox {
+namespace coroutine {
+
+TEST(StackPool, Reuse)
+{
+    StackPool pool;
+    auto s1 = pool.alloc(8192);
+    ASSERT_NE(s1.base, nullptr);
+    EXPECT_GE(s1.size, 8192u);
+    ::memset(s1.base, 0xcc, s1.size);   //! 整个栈都可写
+
+    pool.free(s1);
+    EXPECT_EQ(pool.cachedNum(), 1u);
+
+    auto s2 = pool.alloc(8192);
+    EXPECT_EQ(s2.base, s1.base);
+    EXPECT_EQ(pool.cachedNum(), 0u);
+
+    //! 大小不同的不复用
+    auto s3 = pool.alloc(16384);
+    EXPECT_NE(s3.base, s1.base);
+
+    pool.free(s2);
+    pool.free(s3);
+    EXPECT_EQ(pool.getStats().map_num, 2u);
+    EXPECT_EQ(pool.getStats().reuse_num, 1u);
+}
+
+TEST(StackPool, MaxCachedNum)
+{
+    StackPool pool;
+    StackPool::Config cfg;
+    cfg.max_cached_num = 2;
+    pool.setConfig(cfg);
+
+    StackPool::Stack stacks[4];
+    for (auto &stack : stacks)
+        stack = pool.alloc(8192);
+    for (auto &stack : stacks)
+        pool.free(stack);
+
+    EXPECT_EQ(pool.cachedNum(), 2u);
+    pool.clear();
+    EXPECT_EQ(pool.cachedNum(), 0u);
+}
+
+TEST(StackPool, LazyRelease)
+{
+    StackPool pool;
+    StackPool::Config cfg;
+    cfg.lazy_threshold = 64 << 10;
+    pool.setConfig(cfg);
+
+    auto s1 = pool.alloc(1 << 20);
+    ASSERT_NE(s1.base, nullptr);
+    ::memset(s1.base, 0xcc, s1.size);
+    pool.free(s1);
+
+    //! 回收时物理内存已归还，再次使用时是全新的零页
+    auto s2 = pool.alloc(1 << 20);
+    ASSERT_EQ(s2.base, s1.base);
+    EXPECT_EQ(static_cast<uint8_t*>(s2.base)[0], 0);
+    pool.free(s2);
+}
+
+TEST(StackPool, GuardPage)
+{
+    testing::FLAGS_gtest_death_test_style = "threadsafe";
+    StackPool pool;
+    auto stack = pool.alloc(8192);
+    ASSERT_NE(stack.base, nullptr);
+
+    //! 写到栈底之下，即保护页中
+    volatile uint8_t *p = static_cast<uint8_t*>(stack.base) - 1;
+    EXPECT_DEATH(*p = 1, "");
+    pool.free(stack);
+}
+
+}
+}
@@ -0,0 +1,231 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_COROUTINE_TASK_HPP_20261019
+#define TBOX_COROUTINE_TASK_HPP_20261019
+
+/**
+ * C++20 无栈协程
+ *
+ * 与 Scheduler 的有栈协程不同，Task 不需要独立的栈，每个进行中的操作只占用一个协程帧
+ * （通常只有几百字节），协程帧由 FrameAllocator 分配并缓存复用。
+ *
+ * 使用示例：
+ *   Task<int> Add(event::Loop *loop, int a, int b) {
+ *       co_await Delay(loop, std::chrono::milliseconds(10));
+ *       co_return a + b;
+ *   }
+ *
+ *   Task<> Main(event::Loop *loop) {
+ *       int sum = co_await Add(loop, 1, 2);
+ *       ...
+ *   }
+ *
+ *   Main(loop).detach();
+ *
+ * Task 是惰性的，创建后不会执行，直到被 co_await 或者 detach()。
+ * 可在 Loop 中等待的对象见 awaiters.hpp
+ *
+ * \note    本文件需要 C++20，而 tbox 的其它部分仍按 C++11 编译，所以只在需要的编译单元中引用
+ * \warning 协程挂起期间，不可销毁等待它的 Task；detach() 的 Task 中未捕获的异常会导致 std::terminate()
+ */
+
+#if !defined(__cpp_impl_coroutine)
+#error "tbox/coroutine/task.hpp requires C++20 coroutines, please compile with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include <tbox/base/assert.h>
+#include <tbox/base/defines.h>
+
+#include "frame_allocator.h"
+
+namespace tbox {
+namespace coroutine {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+class TaskPromiseBase {
+  public:
+    //! 协程帧由当前线程的 FrameAllocator 分配
+    static void* operator new(size_t size) { return FrameAllocator::ThreadLocal().alloc(size); }
+    static void operator delete(void *ptr, size_t size) { FrameAllocator::ThreadLocal().free(ptr, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    //! 结束时，有等待者就直接切换到等待者，没有就停在这里，被 detach() 的则自行销毁
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+            if (promise.continuation_)
+                return promise.continuation_;
+
+            if (promise.is_detached_) {
+                if (promise.exception_)
+                    std::terminate();
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept { }
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+  protected:
+    void rethrowIfFailed() {
+        if (exception_)
+            std::rethrow_exception(exception_);
+    }
+
+  private:
+    template <typename> friend class tbox::coroutine::Task;
+
+    std::coroutine_handle<> continuation_;  //!< 等待本协程结束的协程
+    std::exception_ptr exception_;
+    bool is_detached_ = false;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+  public:
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U &&value) { value_.emplace(std::forward<U>(value)); }
+
+    T result() {
+        rethrowIfFailed();
+        return std::move(*value_);
+    }
+
+  private:
+    std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+  public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept { }
+    void result() { rethrowIfFailed(); }
+};
+
+}
+
+template <typename T>
+class Task {
+  public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle_(handle) { }
+    ~Task() { reset(); }
+
+    NONCOPYABLE(Task);
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) { }
+    Task& operator = (Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+  public:
+    bool valid() const { return static_cast<bool>(handle_); }
+    bool done() const { return handle_ && handle_.done(); }
+
+    //! 等待协程结束，并获取其返回值。协程中抛出的异常会在这里重新抛出
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            //! 对称转移：直接切换到被等待的协程，不经过 Loop
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation_ = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+
+        TBOX_ASSERT(handle_);
+        return Awaiter{handle_};
+    }
+
+    /**
+     * 开始执行，不等待其结束
+     *
+     * 之后协程的生命期由其自行管理，结束后自动释放，Task 对象变为无效
+     */
+    void detach() {
+        TBOX_ASSERT(handle_);
+        auto handle = std::exchange(handle_, nullptr);
+        handle.promise().is_detached_ = true;
+        handle.resume();
+    }
+
+  private:
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+    Handle handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+}
+
+}
+}
+
+#endif //TBOX_COROUTINE_TASK_HPP_20261019
@@ -0,0 +1,165 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "task.hpp"
+
+namespace tbox {
+namespace coroutine {
+
+namespace {
+
+Task<int> Add(int a, int b)
+{
+    co_return a + b;
+}
+
+Task<std::string> Concat(std::string a, std::string b)
+{
+    int len = co_await Add(a.size(), b.size());
+    co_return a + b + std::to_string(len);
+}
+
+Task<int> Fail()
+{
+    throw std::runtime_error("fail");
+    co_return 0;
+}
+
+//! 手动恢复的等待对象，用于模拟异步事件
+struct ManualEvent {
+    std::coroutine_handle<> waiting;
+
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            ManualEvent *event;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) noexcept { event->waiting = handle; }
+            void await_resume() const noexcept { }
+        };
+        return Awaiter{this};
+    }
+
+    void fire() { std::exchange(waiting, nullptr).resume(); }
+};
+
+}
+
+TEST(Task, Lazy)
+{
+    bool is_run = false;
+    auto func = [&] () -> Task<> {
+        is_run = true;
+        co_return;
+    };
+
+    auto task = func();
+    EXPECT_TRUE(task.valid());
+    EXPECT_FALSE(is_run);
+
+    task.detach();
+    EXPECT_TRUE(is_run);
+    EXPECT_FALSE(task.valid());
+}
+
+TEST(Task, AwaitResult)
+{
+    std::string result;
+    auto func = [&] () -> Task<> {
+        result = co_await Concat("ab", "cd");
+    };
+    func().detach();
+    EXPECT_EQ(result, "abcd4");
+}
+
+TEST(Task, Exception)
+{
+    bool is_caught = false;
+    auto func = [&] () -> Task<> {
+        try {
+            co_await Fail();
+        } catch (const std::runtime_error &e) {
+            is_caught = true;
+        }
+    };
+    func().detach();
+    EXPECT_TRUE(is_caught);
+}
+
+TEST(Task, SuspendAndResume)
+{
+    ManualEvent event;
+    std::vector<int> steps;
+
+    auto child = [&] () -> Task<int> {
+        steps.push_back(1);
+        co_await event;
+        steps.push_back(2);
+        co_return 10;
+    };
+
+    auto parent = [&] () -> Task<> {
+        int value = co_await child();
+        steps.push_back(value);
+    };
+
+    parent().detach();
+    EXPECT_EQ(steps, std::vector<int>({1}));
+
+    event.fire();
+    EXPECT_EQ(steps, std::vector<int>({1, 2, 10}));
+}
+
+TEST(Task, DestroyUnstarted)
+{
+    //! 未开始执行的 Task 析构时释放协程帧，不执行
+    bool is_run = false;
+    {
+        auto func = [&] () -> Task<> {
+            is_run = true;
+            co_return;
+        };
+        auto task = func();
+    }
+    EXPECT_FALSE(is_run);
+}
+
+TEST(Task, FrameReuse)
+{
+    auto &allocator = FrameAllocator::ThreadLocal();
+    //! 先跑一次，让协程帧进入缓存
+    Add(1, 2).detach();
+
+    auto stats = allocator.getStats();
+    for (int i = 0; i < 100; ++i)
+        Add(i, i).detach();
+
+    //! 之后的协程帧都是复用的
+    EXPECT_EQ(allocator.getStats().alloc_num, stats.alloc_num);
+    EXPECT_EQ(allocator.getStats().reuse_num, stats.reuse_num + 100);
+}
+
+}
+}
@@ -51,6 +51,13 @@ class CommonLoop : public Loop {
     virtual RunId runNext(const Func &func, const std::string &what) override;
     virtual RunId run(Func &&func, const std::string &what) override;
     virtual RunId run(const Func &func, const std::string &what) override;
+    virtual RunId runInLoop(RunFunc &&func, const std::string &what) override;
+    virtual RunId runNext(RunFunc &&func, const std::string &what) override;
+    virtual RunId run(RunFunc &&func, const std::string &what) override;
+
+    using Loop::runInLoop;
+    using Loop::runNext;
+    using Loop::run;
     virtual bool  cancel(RunId run_id) override;
 
     virtual Stat getStat() const override;
@@ -119,11 +126,11 @@ class CommonLoop : public Loop {
     };
 
     struct RunFuncItem {
-        RunFuncItem(RunId id, Func &&func, const std::string &what);
+        RunFuncItem(RunId id, RunFunc &&func, const std::string &what);
 
         RunId id;
         std::chrono::steady_clock::time_point commit_time_point;
-        Func func;
+        RunFunc func;
         std::string what;
     };
 
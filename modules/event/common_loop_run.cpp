@@ -31,7 +31,7 @@ namespace event {
 
 using namespace std::chrono;
 
-CommonLoop::RunFuncItem::RunFuncItem(RunId i, Func &&f, const std::string &w)
+CommonLoop::RunFuncItem::RunFuncItem(RunId i, RunFunc &&f, const std::string &w)
     : id(i)
     , commit_time_point(steady_clock::now())
     , func(std::move(f))
@@ -54,6 +54,16 @@ Loop::RunId CommonLoop::allocRunNextId()
 }
 
 Loop::RunId CommonLoop::runInLoop(Func &&func, const std::string &what)
+{
+    return runInLoop(RunFunc(std::move(func)), what);
+}
+
+Loop::RunId CommonLoop::runInLoop(const Func &func, const std::string &what)
+{
+    return runInLoop(RunFunc(func), what);
+}
+
+Loop::RunId CommonLoop::runInLoop(RunFunc &&func, const std::string &what)
 {
     RECORD_SCOPE();
     std::lock_guard<std::recursive_mutex> g(lock_);
@@ -74,13 +84,17 @@ Loop::RunId CommonLoop::runInLoop(Func &&func, const std::string &what)
     return run_id;
 }
 
-Loop::RunId CommonLoop::runInLoop(const Func &func, const std::string &what)
+Loop::RunId CommonLoop::runNext(Func &&func, const std::string &what)
 {
-    Func func_copy(func);
-    return runInLoop(std::move(func_copy), what);
+    return runNext(RunFunc(std::move(func)), what);
 }
 
-Loop::RunId CommonLoop::runNext(Func &&func, const std::string &what)
+Loop::RunId CommonLoop::runNext(const Func &func, const std::string &what)
+{
+    return runNext(RunFunc(func), what);
+}
+
+Loop::RunId CommonLoop::runNext(RunFunc &&func, const std::string &what)
 {
     RECORD_SCOPE();
     RunId run_id = allocRunNextId();
@@ -96,13 +110,17 @@ Loop::RunId CommonLoop::runNext(Func &&func, const std::string &what)
     return run_id;
 }
 
-Loop::RunId CommonLoop::runNext(const Func &func, const std::string &what)
+Loop::RunId CommonLoop::run(Func &&func, const std::string &what)
 {
-    Func func_copy(func);
-    return runNext(std::move(func_copy), what);
+    return run(RunFunc(std::move(func)), what);
 }
 
-Loop::RunId CommonLoop::run(Func &&func, const std::string &what)
+Loop::RunId CommonLoop::run(const Func &func, const std::string &what)
+{
+    return run(RunFunc(func), what);
+}
+
+Loop::RunId CommonLoop::run(RunFunc &&func, const std::string &what)
 {
     RECORD_SCOPE();
     bool can_run_next = true;
@@ -118,12 +136,6 @@ Loop::RunId CommonLoop::run(Func &&func, const std::string &what)
         return runInLoop(std::move(func), what);
 }
 
-Loop::RunId CommonLoop::run(const Func &func, const std::string &what)
-{
-    Func func_copy(func);
-    return run(std::move(func_copy), what);
-}
-
 //! 从队列中删除指定run_id的项
 bool CommonLoop::RemoveRunFuncItemById(RunFuncQueue &run_deqeue, RunId run_id)
 {
@@ -172,7 +184,7 @@ void CommonLoop::handleNextFunc()
     run_next_func_queue_.swap(tmp_func_queue_);
 
     while (!tmp_func_queue_.empty()) {
-        auto item = tmp_func_queue_.front();
+        auto item = std::move(tmp_func_queue_.front());
         tmp_func_queue_.pop_front();
 
         auto now = steady_clock::now();
@@ -211,7 +223,7 @@ void CommonLoop::handleRunInLoopFunc()
     }
 
     while (!tmp_func_queue_.empty()) {
-        auto item = tmp_func_queue_.front();
+        auto item = std::move(tmp_func_queue_.front());
         tmp_func_queue_.pop_front();
 
         auto now = steady_clock::now();
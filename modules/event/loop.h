@@ -25,6 +25,8 @@
 #include <string>
 #include <vector>
 
+#include <tbox/base/small_func.hpp>
+
 #include "forward.h"
 #include "stat.h"
 
@@ -59,6 +61,7 @@ class Loop {
     //! 委托与取消委托延后执行动作
     using RunId = uint64_t;
     using Func = std::function<void()>;
+    using RunFunc = SmallFunc<void()>;  //!< 内部存放委托函数的类型，小对象内联存储，不分配内存
     /**
      * runInLoop(), runNext(), run() 区别
      *
@@ -88,6 +91,24 @@ class Loop {
     virtual RunId runNext(const Func &func, const std::string &what = "") = 0;
     virtual RunId run(Func &&func, const std::string &what = "") = 0;
     virtual RunId run(const Func &func, const std::string &what = "") = 0;
+
+    virtual RunId runInLoop(RunFunc &&func, const std::string &what = "") = 0;
+    virtual RunId runNext(RunFunc &&func, const std::string &what = "") = 0;
+    virtual RunId run(RunFunc &&func, const std::string &what = "") = 0;
+
+    /**
+     * 直接传入lambda等可调用对象时，就地构造成 RunFunc，避免先转换成 std::function
+     * 而导致的内存分配。捕获内容超过两个指针的lambda，std::function 都要分配内存。
+     */
+    template <typename F, typename = typename std::enable_if<RunFunc::IsBindable<F>::value>::type>
+    RunId runInLoop(F &&func, const std::string &what = "") { return runInLoop(RunFunc(std::forward<F>(func)), what); }
+
+    template <typename F, typename = typename std::enable_if<RunFunc::IsBindable<F>::value>::type>
+    RunId runNext(F &&func, const std::string &what = "") { return runNext(RunFunc(std::forward<F>(func)), what); }
+
+    template <typename F, typename = typename std::enable_if<RunFunc::IsBindable<F>::value>::type>
+    RunId run(F &&func, const std::string &what = "") { return run(RunFunc(std::forward<F>(func)), what); }
+
     virtual bool  cancel(RunId run_id) = 0;
 
     //! 创建事件
@@ -0,0 +1,132 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <atomic>
+#include <memory>
+#include <new>
+#include <gtest/gtest.h>
+
+#include "loop.h"
+
+namespace tbox {
+namespace event {
+
+using namespace std;
+
+namespace {
+const int kPostTimes = 10000;
+
+/**
+ * 被投递的函数对象，占40字节，超出了 std::function 的内联存储空间
+ *
+ * std::function 与 RunFunc 都用 new 在堆上构造放不下的函数对象，
+ * 所以用类自己的 operator new 就能统计分配次数，不必替换全局的 operator new
+ */
+struct CountedTask {
+    int *p_counter;
+    uint64_t a = 1, b = 2, c = 3, d = 4;
+
+    explicit CountedTask(int &counter) : p_counter(&counter) { }
+    void operator () () const { *p_counter += (a + b + c + d) / 10; }
+
+    static void* operator new(size_t size) {
+        ++alloc_times;
+        return ::operator new(size);
+    }
+    static void operator delete(void *p) noexcept { ::operator delete(p); }
+    //! 内联存储时的就地构造，不计数
+    static void* operator new(size_t, void *p) noexcept { return p; }
+    static void operator delete(void *, void *) noexcept { }
+
+    static std::atomic<size_t> alloc_times;
+};
+
+std::atomic<size_t> CountedTask::alloc_times(0);
+
+template <typename PostFunc>
+size_t CountPostAllocTimes(int &counter, PostFunc &&post)
+{
+    auto before = CountedTask::alloc_times.load();
+    for (int i = 0; i < kPostTimes; ++i)
+        post(CountedTask(counter));
+    return CountedTask::alloc_times.load() - before;
+}
+}
+
+//! 对比以 std::function 投递与直接投递函数对象时，函数对象的内存分配次数
+TEST(RunFuncAlloc, Benchmark)
+{
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        cout << "engine: " << e << endl;
+        Loop *sp_loop = Loop::New(e);
+
+        int counter = 0;
+        auto std_func_alloc_times = CountPostAllocTimes(counter,
+            [sp_loop] (Loop::Func &&func) { sp_loop->runNext(func); }
+        );
+        auto lambda_alloc_times = CountPostAllocTimes(counter,
+            [sp_loop] (Loop::RunFunc &&func) { sp_loop->runNext(std::move(func)); }
+        );
+        auto direct_alloc_times = CountPostAllocTimes(counter,
+            [sp_loop] (CountedTask &&task) { sp_loop->runInLoop(std::move(task)); }
+        );
+
+        cout << "post " << kPostTimes << " times, alloc times:" << endl
+             << "  std::function : " << std_func_alloc_times << endl
+             << "  RunFunc       : " << lambda_alloc_times << endl
+             << "  lambda        : " << direct_alloc_times << endl;
+
+        //! 以 std::function 投递，每次构造与拷贝各分配一次
+        EXPECT_GE(std_func_alloc_times, size_t(kPostTimes * 2));
+        EXPECT_EQ(lambda_alloc_times, 0u);
+        EXPECT_EQ(direct_alloc_times, 0u);
+
+        sp_loop->runInLoop([sp_loop] { sp_loop->exitLoop(); });
+        sp_loop->runLoop();
+        EXPECT_EQ(counter, kPostTimes * 3);
+
+        delete sp_loop;
+    }
+}
+
+TEST(RunFuncAlloc, MoveOnlyCapture)
+{
+    struct Task {
+        std::unique_ptr<int> value;
+        int *p_result;
+        void operator () () { *p_result = *value; }
+    };
+
+    auto engines = Loop::Engines();
+    for (auto e : engines) {
+        Loop *sp_loop = Loop::New(e);
+
+        int result = 0;
+        sp_loop->runNext(Task{std::unique_ptr<int>(new int(100)), &result});
+        sp_loop->runInLoop([sp_loop] { sp_loop->exitLoop(); });
+        sp_loop->runLoop();
+        EXPECT_EQ(result, 100);
+
+        delete sp_loop;
+    }
+}
+
+}
+}
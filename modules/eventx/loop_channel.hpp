@@ -0,0 +1,353 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_EVENTX_LOOP_CHANNEL_HPP_20261019
+#define TBOX_EVENTX_LOOP_CHANNEL_HPP_20261019
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+#include <type_traits>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <tbox/base/log.h>
+#include <tbox/base/defines.h>
+#include <tbox/event/loop.h>
+#include <tbox/event/fd_event.h>
+
+namespace tbox {
+namespace eventx {
+
+/**
+ * Loop 间的有界消息通道
+ *
+ * 连接一个生产者Loop与一个消费者Loop，单生产者单消费者：
+ * - 数据存放在无锁环形缓冲中，send() 不分配内存，也不加锁；
+ * - 每一批数据只通过 eventfd 唤醒消费者Loop一次，消费者Loop以批的形式回调；
+ * - 缓冲中的数据量达到高水位时，在生产者Loop中回调 high_water_line_cb，
+ *   回落到低水位时，在生产者Loop中回调 low_water_line_cb，用于反压控制。
+ *
+ * 使用示例：
+ *  LoopChannel<Packet> ch(net_loop, proc_loop);
+ *  ch.initialize(1024);
+ *  ch.setBatchCallback([] (std::vector<Packet> &packets) { ... });    //! 在 proc_loop 中执行
+ *  ch.setWaterLine(768, 256);
+ *  ch.setHighWaterLineCallback([&] { conn->disable(); });   //! 在 net_loop 中执行
+ *  ch.setLowWaterLineCallback([&] { conn->enable(); });     //! 在 net_loop 中执行
+ *  ...
+ *  ch.send(std::move(packet)); //! 在 net_loop 中执行
+ *
+ * \warnning    send() 只能在生产者Loop线程中调用；
+ *              initialize() 与 cleanup() 须在两个Loop都未运行时调用，如：LoopThread(false)
+ */
+template <typename T>
+class LoopChannel {
+  public:
+    using BatchCallback = std::function<void (std::vector<T> &items)>;
+    using WaterLineCallback = std::function<void ()>;
+
+  public:
+    LoopChannel(event::Loop *producer_loop, event::Loop *consumer_loop) :
+        producer_loop_(producer_loop), consumer_loop_(consumer_loop)
+    { }
+
+    ~LoopChannel() { cleanup(); }
+
+    NONCOPYABLE(LoopChannel);
+    IMMOVABLE(LoopChannel);
+
+  public:
+    /**
+     * 初始化
+     *
+     * \param capacity      最多缓存的数据个数，会向上取整到2的幂
+     * \param batch_size    每次回调最多取出的数据个数
+     */
+    bool initialize(size_t capacity, size_t batch_size = 64);
+
+    //! 设置消费者Loop中的批处理回调
+    void setBatchCallback(BatchCallback &&cb) { batch_cb_ = std::move(cb); }
+
+    /**
+     * 设置高低水位
+     *
+     * \param high  高水位，缓存数量 >= high 时触发 high_water_line_cb，0表示不启用
+     * \param low   低水位，超过高水位后回落到 <= low 时触发 low_water_line_cb
+     */
+    void setWaterLine(size_t high, size_t low) { high_water_line_ = high; low_water_line_ = low; }
+    void setHighWaterLineCallback(WaterLineCallback &&cb) { high_water_line_cb_ = std::move(cb); }
+    void setLowWaterLineCallback(WaterLineCallback &&cb) { low_water_line_cb_ = std::move(cb); }
+
+    /**
+     * 发送数据，仅限在生产者Loop中调用
+     *
+     * \return  bool    成功与否，缓冲已满时返回false
+     */
+    bool send(T &&item) { return emplace(std::move(item)); }
+    bool send(const T &item) { return emplace(item); }
+
+    template <typename... Args>
+    bool emplace(Args&&... args);
+
+    size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size() == 0; }
+    bool isFull() const { return size() >= capacity_; }
+
+    //! 是否处于高水位状态，即触发了high_water_line_cb，还未触发low_water_line_cb
+    bool isAboveHighWaterLine() const { return is_above_high_.load(std::memory_order_acquire); }
+
+    void cleanup();
+
+  protected:
+    using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    T* itemAt(size_t index) { return reinterpret_cast<T*>(&slots_[index & mask_]); }
+
+    static void Notify(int fd);
+    static void Drain(int fd);
+
+    void onConsumerEvent();
+    void onProducerEvent();
+    //! 在生产者Loop中回调 low_water_line_cb，只有在回调过 high_water_line_cb 之后才回调
+    void notifyLowWaterLine();
+
+  private:
+    event::Loop *producer_loop_;
+    event::Loop *consumer_loop_;
+
+    Slot *slots_ = nullptr;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    size_t batch_size_ = 0;
+
+    //! 生产者与消费者各自写的变量放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> tail_{0};   //!< 由生产者写
+    alignas(64) std::atomic<size_t> head_{0};   //!< 由消费者写
+
+    alignas(64) std::atomic_bool is_consumer_notified_{false};  //!< 消费者是否已被唤醒且未开始消费
+    std::atomic_bool is_above_high_{false};
+    bool is_high_notified_ = false;     //!< 是否已回调了 high_water_line_cb 而未回调 low_water_line_cb，仅生产者访问
+
+    size_t high_water_line_ = 0;
+    size_t low_water_line_ = 0;
+
+    int consumer_fd_ = -1;
+    int producer_fd_ = -1;
+    event::FdEvent *consumer_event_ = nullptr;
+    event::FdEvent *producer_event_ = nullptr;
+
+    std::vector<T> batch_;
+    BatchCallback batch_cb_;
+    WaterLineCallback high_water_line_cb_;
+    WaterLineCallback low_water_line_cb_;
+};
+
+///////////////////////////////////////////////////////////////////////
+
+template <typename T>
+bool LoopChannel<T>::initialize(size_t capacity, size_t batch_size)
+{
+    if (slots_ != nullptr) {
+        LogWarn("it has initialized, cleanup() first");
+        return false;
+    }
+
+    if (capacity == 0 || batch_size == 0) {
+        LogWarn("capacity or batch_size is zero");
+        return false;
+    }
+
+    capacity_ = 1;
+    while (capacity_ < capacity)
+        capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    batch_size_ = batch_size;
+
+    consumer_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    producer_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (consumer_fd_ < 0 || producer_fd_ < 0) {
+        LogErr("eventfd fail, errno:%d", errno);
+        cleanup();
+        return false;
+    }
+
+    slots_ = new Slot[capacity_];
+    batch_.reserve(batch_size_);
+
+    consumer_event_ = consumer_loop_->newFdEvent("LoopChannel::consumer_event_");
+    consumer_event_->initialize(consumer_fd_, event::FdEvent::kReadEvent, event::Event::Mode::kPersist);
+    consumer_event_->setCallback([this] (short) { onConsumerEvent(); });
+    consumer_event_->enable();
+
+    producer_event_ = producer_loop_->newFdEvent("LoopChannel::producer_event_");
+    producer_event_->initialize(producer_fd_, event::FdEvent::kReadEvent, event::Event::Mode::kPersist);
+    producer_event_->setCallback([this] (short) { onProducerEvent(); });
+    producer_event_->enable();
+
+    return true;
+}
+
+template <typename T>
+template <typename... Args>
+bool LoopChannel<T>::emplace(Args&&... args)
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (slots_ == nullptr || tail - head >= capacity_)
+        return false;
+
+    new (itemAt(tail)) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1);
+
+    //! 同一批数据只唤醒一次消费者
+    if (!is_consumer_notified_.exchange(true))
+        Notify(consumer_fd_);
+
+    if (high_water_line_ > 0 && (tail + 1 - head_.load()) >= high_water_line_ &&
+        !is_above_high_.exchange(true)) {
+        //! 上一次的低水位通知还未处理时再次越过高水位，不重复回调
+        if (!is_high_notified_) {
+            is_high_notified_ = true;
+            if (high_water_line_cb_)
+                high_water_line_cb_();
+        }
+
+        //! 消费者可能在置标记之前就已消费完，不会再发低水位通知了，需要自行检查
+        if ((tail + 1 - head_.load()) <= low_water_line_ && is_above_high_.exchange(false))
+            notifyLowWaterLine();
+    }
+
+    return true;
+}
+
+template <typename T>
+void LoopChannel<T>::onConsumerEvent()
+{
+    Drain(consumer_fd_);
+    //! 须先清标记再读tail_，否则可能漏掉清标记之前发送的数据
+    is_consumer_notified_.store(false);
+
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load();
+    size_t num = std::min(tail - head, batch_size_);
+
+    batch_.clear();
+    for (size_t i = 0; i < num; ++i) {
+        T *item = itemAt(head + i);
+        batch_.push_back(std::move(*item));
+        item->~T();
+    }
+    head_.store(head + num);
+
+    //! 一次没有取完，让出Loop给其它事件，下次再取
+    if (num < tail - head) {
+        if (!is_consumer_notified_.exchange(true))
+            Notify(consumer_fd_);
+    }
+
+    if (is_above_high_.load() && (tail - head - num) <= low_water_line_) {
+        if (is_above_high_.exchange(false))
+            Notify(producer_fd_);
+    }
+
+    if (num > 0 && batch_cb_)
+        batch_cb_(batch_);
+}
+
+template <typename T>
+void LoopChannel<T>::onProducerEvent()
+{
+    Drain(producer_fd_);
+
+    //! 通知可能滞后，其间又越过了高水位，等消费者再次回落到低水位时的通知
+    if (is_above_high_.load())
+        return;
+
+    //! 其间又发送了数据，已高于低水位，重新置为高水位状态，等消费者回落到低水位时再通知
+    if (size() > low_water_line_) {
+        is_above_high_.store(true);
+        //! 消费者可能在置标记之前就已消费完，需要自行检查
+        if (size() > low_water_line_ || !is_above_high_.exchange(false))
+            return;
+    }
+
+    notifyLowWaterLine();
+}
+
+template <typename T>
+void LoopChannel<T>::notifyLowWaterLine()
+{
+    if (!is_high_notified_)
+        return;
+
+    is_high_notified_ = false;
+    if (low_water_line_cb_)
+        low_water_line_cb_();
+}
+
+template <typename T>
+void LoopChannel<T>::cleanup()
+{
+    CHECK_DELETE_RESET_OBJ(consumer_event_);
+    CHECK_DELETE_RESET_OBJ(producer_event_);
+    CHECK_CLOSE_RESET_FD(consumer_fd_);
+    CHECK_CLOSE_RESET_FD(producer_fd_);
+
+    if (slots_ != nullptr) {
+        size_t head = head_.load();
+        size_t tail = tail_.load();
+        for (size_t i = head; i != tail; ++i)
+            itemAt(i)->~T();
+
+        delete [] slots_;
+        slots_ = nullptr;
+    }
+
+    head_ = 0;
+    tail_ = 0;
+    is_consumer_notified_ = false;
+    is_above_high_ = false;
+    is_high_notified_ = false;
+    batch_.clear();
+}
+
+template <typename T>
+void LoopChannel<T>::Notify(int fd)
+{
+    uint64_t one = 1;
+    auto wsize = ::write(fd, &one, sizeof(one));
+    (void)wsize;
+}
+
+template <typename T>
+void LoopChannel<T>::Drain(int fd)
+{
+    uint64_t value = 0;
+    auto rsize = ::read(fd, &value, sizeof(value));
+    (void)rsize;
+}
+
+}
+}
+
+#endif //TBOX_EVENTX_LOOP_CHANNEL_HPP_20261019
@@ -0,0 +1,188 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "loop_channel.hpp"
+#include "loop_thread.h"
+
+namespace tbox {
+namespace eventx {
+namespace {
+
+TEST(LoopChannel, SendInOrder) {
+    LoopThread producer(false), consumer(false);
+    LoopChannel<int> ch(producer.loop(), consumer.loop());
+    ASSERT_TRUE(ch.initialize(1000, 16));
+    EXPECT_EQ(ch.capacity(), 1024u);
+
+    const int kNum = 10000;
+    std::vector<int> recv_vec;
+    std::atomic_int recv_num(0);
+    int batch_times = 0;
+    ch.setBatchCallback(
+        [&] (std::vector<int> &items) {
+            EXPECT_LE(items.size(), 16u);
+            recv_vec.insert(recv_vec.end(), items.begin(), items.end());
+            recv_num += items.size();
+            ++batch_times;
+        }
+    );
+
+    producer.start();
+    consumer.start();
+
+    int sent_num = 0;
+    std::function<void()> send_func = [&] {
+        while (sent_num < kNum && ch.send(sent_num))
+            ++sent_num;
+        if (sent_num < kNum)
+            producer.loop()->runNext(send_func);
+    };
+    producer.loop()->runInLoop(send_func);
+
+    for (int i = 0; i < 100 && recv_num < kNum; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    producer.stop();
+    consumer.stop();
+
+    ASSERT_EQ(recv_vec.size(), size_t(kNum));
+    for (int i = 0; i < kNum; ++i)
+        ASSERT_EQ(recv_vec[i], i);
+    EXPECT_GE(batch_times, kNum / 16);
+
+    ch.cleanup();
+}
+
+TEST(LoopChannel, Full) {
+    LoopThread producer(false), consumer(false);
+    LoopChannel<std::unique_ptr<int>> ch(producer.loop(), consumer.loop());
+    ASSERT_TRUE(ch.initialize(4));
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ch.send(std::unique_ptr<int>(new int(i))));
+    EXPECT_TRUE(ch.isFull());
+    EXPECT_FALSE(ch.send(std::unique_ptr<int>(new int(4))));
+    //! 未被消费的数据在 cleanup() 中释放
+}
+
+TEST(LoopChannel, WaterLine) {
+    LoopThread producer(false), consumer(false);
+    LoopChannel<int> ch(producer.loop(), consumer.loop());
+    ASSERT_TRUE(ch.initialize(64, 4));
+    ch.setWaterLine(32, 8);
+
+    int high_times = 0, low_times = 0;
+    bool paused = false;
+    std::thread::id producer_tid;
+    ch.setHighWaterLineCallback([&] { ++high_times; paused = true; EXPECT_EQ(std::this_thread::get_id(), producer_tid); });
+    ch.setLowWaterLineCallback([&] { ++low_times; paused = false; EXPECT_EQ(std::this_thread::get_id(), producer_tid); });
+
+    int recv_num = 0;
+    ch.setBatchCallback(
+        [&] (std::vector<int> &items) {
+            recv_num += items.size();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    );
+
+    producer.start();
+    consumer.start();
+
+    const int kNum = 200;
+    int sent_num = 0;
+    std::function<void()> send_func = [&] {
+        producer_tid = std::this_thread::get_id();
+        while (!paused && sent_num < kNum && ch.send(sent_num))
+            ++sent_num;
+        if (sent_num < kNum)
+            producer.loop()->runNext(send_func);
+    };
+    producer.loop()->runInLoop(send_func);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    producer.stop();
+    consumer.stop();
+
+    EXPECT_EQ(sent_num, kNum);
+    EXPECT_EQ(recv_num, kNum);
+    EXPECT_GE(high_times, 1);
+    EXPECT_EQ(high_times, low_times);
+    EXPECT_FALSE(ch.isAboveHighWaterLine());
+}
+
+/**
+ * 低水位通知在生产者Loop中处理之前，又越过了高水位，或回升到低水位之上，
+ * 滞后的通知不能让生产者恢复发送
+ */
+TEST(LoopChannel, StaleLowWaterLineNotify) {
+    auto producer_loop = event::Loop::New();
+    auto consumer_loop = event::Loop::New();
+    SetScopeExitAction([=] { delete producer_loop; delete consumer_loop; });
+
+    auto run_once = [] (event::Loop *loop) {
+        loop->exitLoop(std::chrono::milliseconds(10));
+        loop->runLoop();
+    };
+
+    LoopChannel<int> ch(producer_loop, consumer_loop);
+    ASSERT_TRUE(ch.initialize(16, 16));
+    ch.setWaterLine(4, 1);
+
+    int high_times = 0, low_times = 0;
+    ch.setHighWaterLineCallback([&] { ++high_times; });
+    ch.setLowWaterLineCallback([&] { ++low_times; });
+
+    //! 越过高水位，消费完后回落，在生产者处理低水位通知之前，又越过高水位
+    for (int i = 0; i < 4; ++i)
+        ch.send(i);
+    EXPECT_EQ(high_times, 1);
+    run_once(consumer_loop);
+    for (int i = 0; i < 4; ++i)
+        ch.send(i);
+    EXPECT_EQ(high_times, 1);   //! 生产者仍处于暂停状态，不重复回调
+
+    run_once(producer_loop);
+    EXPECT_EQ(low_times, 0);
+    EXPECT_TRUE(ch.isAboveHighWaterLine());
+
+    //! 回落到低水位，在生产者处理通知之前，回升到低水位与高水位之间
+    run_once(consumer_loop);
+    ch.send(0);
+    ch.send(1);
+    run_once(producer_loop);
+    EXPECT_EQ(low_times, 0);
+
+    //! 真正回落到低水位后才通知
+    run_once(consumer_loop);
+    run_once(producer_loop);
+    EXPECT_EQ(high_times, 1);
+    EXPECT_EQ(low_times, 1);
+    EXPECT_FALSE(ch.isAboveHighWaterLine());
+}
+
+}
+}
+}
@@ -29,20 +29,63 @@
 #include <algorithm>
 #include <condition_variable>
 #include <chrono>
+#include <iomanip>
+#include <ctime>
 
 #include <tbox/base/log.h>
+#include <tbox/base/json.hpp>
 #include <tbox/base/cabinet.hpp>
 #include <tbox/base/assert.h>
 #include <tbox/base/catch_throw.h>
 #include <tbox/base/object_pool.hpp>
 #include <tbox/base/wrapped_recorder.h>
 #include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
 
 namespace tbox {
 namespace eventx {
 
 using Clock = std::chrono::steady_clock;
 
+namespace {
+
+//! 调度类别：[0, THREAD_POOL_PRIO_SIZE) 为各优先级，THREAD_POOL_PRIO_SIZE 为有期限的任务
+constexpr int kDeadlineLevel = THREAD_POOL_PRIO_SIZE;
+constexpr int kClassNum = THREAD_POOL_PRIO_SIZE + 1;
+
+//! 加权公平调度中，权重为1的优先级每执行一个任务所前进的步长
+constexpr uint64_t kStrideBase = 1 << 20;
+
+uint64_t ToUs(Clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+ThreadPool::Stat::PrioStat& ClassStat(ThreadPool::Stat &stat, int level)
+{
+    return level < kDeadlineLevel ? stat.prio[level] : stat.deadline;
+}
+
+//! 工作线程的统计数据，仅由工作线程自己写入，读取时再合并
+struct WorkerStat {
+    std::mutex lock;
+    std::array<ThreadPool::Stat::PrioStat, kClassNum> classes; //!< 各调度类别的统计
+    Clock::time_point alive_begin_time_point;   //!< 存活计时起点
+    Clock::duration busy_time = Clock::duration::zero();
+    util::Histogram window_wait_time_us;        //!< 自适应调节评估周期内的排队时长
+};
+
+//! 获取进程累计消耗的CPU时长
+Clock::duration GetProcessCpuTime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+        return Clock::duration::zero();
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+}
+
 //! ThreadPool 的私有数据
 struct ThreadPool::Data {
     event::Loop *wp_loop = nullptr; //!< 主线程
@@ -51,21 +94,73 @@ struct ThreadPool::Data {
 
     size_t min_thread_num = 0; //!< 最少的线程个数
     size_t max_thread_num = 0; //!< 最多的线程个数
+    size_t keep_thread_num = 0; //!< 常驻线程个数，在 [min_thread_num, max_thread_num] 之间
 
     std::mutex lock;                //!< 互斥锁
     std::condition_variable cond_var;   //!< 条件变量
 
     cabinet::Cabinet<Task> undo_tasks_cabinet;
     std::array<std::deque<TaskToken>, THREAD_POOL_PRIO_SIZE> undo_tasks_token; //!< 优先级任务列表，THREAD_POOL_PRIO_SIZE级
+    std::multimap<Clock::time_point, TaskToken> undo_deadline_tasks_token; //!< 有期限的任务列表，按期限先后排序
     std::set<TaskToken> doing_tasks_token;    //!< 记录正在从事的任务
 
+    SchedPolicy sched_policy = SchedPolicy::kStrictPriority;
+    std::array<uint32_t, THREAD_POOL_PRIO_SIZE> prio_weight;    //!< 各优先级的权重
+    std::array<uint64_t, THREAD_POOL_PRIO_SIZE> prio_pass = {}; //!< 各优先级的虚拟时间，小的先执行
+    uint64_t global_pass = 0;                                   //!< 最近一次被调度的虚拟时间
+    std::array<size_t, kClassNum> class_max_doing_num = {};     //!< 各调度类别的最大并发数，0表示不限
+    std::array<size_t, kClassNum> class_doing_num = {};         //!< 各调度类别正在执行的任务数
+    size_t deadline_miss_num = 0;
+
     size_t idle_thread_num = 0;         //!< 空间线程个数
+    size_t exiting_thread_num = 0;      //!< 已决定退出，但还未从 threads_cabinet 中移除的线程个数
     cabinet::Cabinet<std::thread> threads_cabinet;
     bool all_threads_stop_flag = false; //!< 是否所有工作线程立即停止标记
 
     size_t undo_task_peak_num_ = 0;
 
     ObjectPool<Task> task_pool{64};
+
+    std::set<WorkerStat*> worker_stats; //!< 存活的工作线程的统计数据
+    Stat retired_stat;                  //!< 已退出的工作线程的统计数据
+    Clock::time_point stat_begin_time_point = Clock::now();
+
+    //! 自适应调节相关
+    AdaptiveConfig adaptive_cfg;
+    event::TimerEvent *adaptive_timer = nullptr;
+    util::Histogram retired_window_wait_time_us;    //!< 评估周期内已退出线程的排队时长
+    Snapshot::Adaptive adaptive_state;
+    int adaptive_low_periods = 0;                   //!< 连续满足缩容条件的周期数
+    Clock::time_point adaptive_last_time_point;
+    Clock::duration adaptive_last_cpu_time = Clock::duration::zero();
+
+    //! 不计正在退出的线程，当前存活的线程个数
+    size_t aliveThreadNum() const {
+        auto thread_num = threads_cabinet.size();
+        return thread_num > exiting_thread_num ? thread_num - exiting_thread_num : 0;
+    }
+
+    //! 该调度类别是否还允许再多执行一个任务
+    bool isClassUnderLimit(int level) const {
+        return class_max_doing_num[level] == 0 || class_doing_num[level] < class_max_doing_num[level];
+    }
+
+    bool isClassEmpty(int level) const {
+        return level == kDeadlineLevel ? undo_deadline_tasks_token.empty() : undo_tasks_token[level].empty();
+    }
+
+    //! 现在就可以被领取的任务数，受并发数限制而暂时不能执行的任务不计在内
+    size_t runnableTaskNum() const {
+        size_t num = 0;
+        for (int i = 0; i < kClassNum; ++i) {
+            size_t undo_num = (i == kDeadlineLevel) ? undo_deadline_tasks_token.size() : undo_tasks_token[i].size();
+            if (class_max_doing_num[i] == 0)
+                num += undo_num;
+            else if (class_doing_num[i] < class_max_doing_num[i])
+                num += std::min(undo_num, class_max_doing_num[i] - class_doing_num[i]);
+        }
+        return num;
+    }
 };
 
 /**
@@ -73,9 +168,11 @@ struct ThreadPool::Data {
  */
 struct ThreadPool::Task {
     TaskToken token;
-    NonReturnFunc backend_task;   //! 任务在工作线程中执行函数
-    NonReturnFunc main_cb;        //! 任务执行完成后由main_loop执行的回调函数
+    TaskFunc backend_task;        //! 任务在工作线程中执行函数
+    TaskFunc main_cb;             //! 任务执行完成后由main_loop执行的回调函数
     Clock::time_point create_time_point;
+    Clock::time_point deadline;   //! 期限，仅有期限的任务有效
+    int level = 0;                //! 调度类别，见 kDeadlineLevel
 
     Task *next = nullptr;
 };
@@ -86,6 +183,9 @@ ThreadPool::ThreadPool(event::Loop *main_loop) :
     d_(new Data)
 {
     d_->wp_loop = main_loop;
+
+    for (int i = 0; i < THREAD_POOL_PRIO_SIZE; ++i)
+        d_->prio_weight[i] = 1u << (THREAD_POOL_PRIO_SIZE - 1 - i);
 }
 
 ThreadPool::~ThreadPool()
@@ -93,6 +193,7 @@ ThreadPool::~ThreadPool()
     if (d_->is_ready)
         cleanup();
 
+    delete d_->adaptive_timer;
     delete d_;
 }
 
@@ -114,6 +215,7 @@ bool ThreadPool::initialize(ssize_t min_thread_num, ssize_t max_thread_num)
         std::lock_guard<std::mutex> lg(d_->lock);
         d_->min_thread_num = min_thread_num;
         d_->max_thread_num = max_thread_num;
+        d_->keep_thread_num = min_thread_num;
 
         for (ssize_t i = 0; i < min_thread_num; ++i)
             if (!createWorker())
@@ -123,35 +225,67 @@ bool ThreadPool::initialize(ssize_t min_thread_num, ssize_t max_thread_num)
     d_->all_threads_stop_flag = false;
     d_->is_ready = true;
 
+    if (d_->adaptive_cfg.target_wait_p99.count() > 0)
+        startAdaptiveTimer();
+
     return true;
 }
 
 ThreadPool::TaskToken ThreadPool::execute(NonReturnFunc &&backend_task, int prio)
 {
-    return execute(std::move(backend_task), nullptr, prio);
+    return executeFunc(TaskFunc(std::move(backend_task)), nullptr, prio);
 }
 
 ThreadPool::TaskToken ThreadPool::execute(const NonReturnFunc &backend_task, int prio)
 {
-    return execute(backend_task, nullptr, prio);
+    return executeFunc(TaskFunc(backend_task), nullptr, prio);
 }
 
 ThreadPool::TaskToken ThreadPool::execute(NonReturnFunc &&backend_task, NonReturnFunc &&main_cb, int prio)
 {
-    RECORD_SCOPE();
-    TaskToken token;
+    return executeFunc(TaskFunc(std::move(backend_task)), TaskFunc(std::move(main_cb)), prio);
+}
 
-    if (!d_->is_ready) {
-        LogWarn("need initialize() first");
-        return token;
-    }
+ThreadPool::TaskToken ThreadPool::execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, int prio)
+{
+    return executeFunc(TaskFunc(backend_task), TaskFunc(main_cb), prio);
+}
 
+ThreadPool::TaskToken ThreadPool::executeBefore(const TimePoint &deadline, NonReturnFunc &&backend_task, NonReturnFunc &&main_cb)
+{
+    return executeFuncBefore(deadline, TaskFunc(std::move(backend_task)), TaskFunc(std::move(main_cb)));
+}
+
+ThreadPool::TaskToken ThreadPool::executeBefore(const TimePoint &deadline, const NonReturnFunc &backend_task, const NonReturnFunc &main_cb)
+{
+    return executeFuncBefore(deadline, TaskFunc(backend_task), TaskFunc(main_cb));
+}
+
+ThreadPool::TaskToken ThreadPool::executeFunc(TaskFunc &&backend_task, TaskFunc &&main_cb, int prio)
+{
     if (prio < THREAD_POOL_PRIO_MIN)
         prio = THREAD_POOL_PRIO_MIN;
     else if (prio > THREAD_POOL_PRIO_MAX)
         prio = THREAD_POOL_PRIO_MAX;
 
-    int level = prio + THREAD_POOL_PRIO_MAX;
+    int level = prio - THREAD_POOL_PRIO_MIN;
+    return pushTask(std::move(backend_task), std::move(main_cb), level, TimePoint());
+}
+
+ThreadPool::TaskToken ThreadPool::executeFuncBefore(const TimePoint &deadline, TaskFunc &&backend_task, TaskFunc &&main_cb)
+{
+    return pushTask(std::move(backend_task), std::move(main_cb), kDeadlineLevel, deadline);
+}
+
+ThreadPool::TaskToken ThreadPool::pushTask(TaskFunc &&backend_task, TaskFunc &&main_cb, int level, const TimePoint &deadline)
+{
+    RECORD_SCOPE();
+    TaskToken token;
+
+    if (!d_->is_ready) {
+        LogWarn("need initialize() first");
+        return token;
+    }
 
     {
         std::lock_guard<std::mutex> lg(d_->lock);
@@ -160,11 +294,24 @@ ThreadPool::TaskToken ThreadPool::execute(NonReturnFunc &&backend_task, NonRetur
         item->backend_task = std::move(backend_task);
         item->main_cb = std::move(main_cb);
         item->create_time_point = Clock::now();
+        item->deadline = deadline;
+        item->level = level;
         item->token = token = d_->undo_tasks_cabinet.alloc(item);
 
-        d_->undo_tasks_token.at(level).push_back(token);
-        //! 如果空闲线程不够分配未认领的任务，且还可以再创建新的线程
-        if (d_->undo_tasks_cabinet.size() > d_->idle_thread_num) {
+        if (level == kDeadlineLevel) {
+            d_->undo_deadline_tasks_token.emplace(deadline, token);
+
+        } else {
+            auto &tasks_token = d_->undo_tasks_token.at(level);
+            //! 刚从空闲中恢复的优先级不能带着过去积攒的虚拟时间优势，否则会独占一段时间
+            if (tasks_token.empty() && d_->prio_pass[level] < d_->global_pass)
+                d_->prio_pass[level] = d_->global_pass;
+            tasks_token.push_back(token);
+        }
+
+        //! 如果空闲线程不够分配可执行的任务，且还可以再创建新的线程
+        //! 受并发数限制而暂时不能执行的任务不计在内，否则创建出来的线程无事可做
+        if (d_->runnableTaskNum() > d_->idle_thread_num) {
             if (d_->threads_cabinet.size() < d_->max_thread_num) {
                 createWorker();
             } else {
@@ -180,11 +327,46 @@ ThreadPool::TaskToken ThreadPool::execute(NonReturnFunc &&backend_task, NonRetur
     return token;
 }
 
-ThreadPool::TaskToken ThreadPool::execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, int prio)
+void ThreadPool::setSchedPolicy(SchedPolicy policy)
+{
+    std::lock_guard<std::mutex> lg(d_->lock);
+    d_->sched_policy = policy;
+}
+
+bool ThreadPool::setPrioWeight(int prio, uint32_t weight)
+{
+    if (prio < THREAD_POOL_PRIO_MIN || prio > THREAD_POOL_PRIO_MAX || weight == 0) {
+        LogWarn("prio:%d or weight:%u invalid", prio, weight);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(d_->lock);
+    d_->prio_weight[prio - THREAD_POOL_PRIO_MIN] = weight;
+    return true;
+}
+
+bool ThreadPool::setPrioConcurrency(int prio, size_t max_num)
+{
+    if (prio < THREAD_POOL_PRIO_MIN || prio > THREAD_POOL_PRIO_MAX) {
+        LogWarn("prio:%d invalid", prio);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(d_->lock);
+        d_->class_max_doing_num[prio - THREAD_POOL_PRIO_MIN] = max_num;
+    }
+    d_->cond_var.notify_all();  //! 限制放宽后，让等待的线程重新检查
+    return true;
+}
+
+void ThreadPool::setDeadlineConcurrency(size_t max_num)
 {
-    NonReturnFunc backend_task_copy(backend_task);
-    NonReturnFunc main_cb_copy(main_cb);
-    return execute(std::move(backend_task_copy), std::move(main_cb_copy), prio);
+    {
+        std::lock_guard<std::mutex> lg(d_->lock);
+        d_->class_max_doing_num[kDeadlineLevel] = max_num;
+    }
+    d_->cond_var.notify_all();
 }
 
 ThreadPool::TaskStatus ThreadPool::getTaskStatus(TaskToken task_token) const
@@ -228,15 +410,34 @@ int ThreadPool::cancel(TaskToken token)
         }
     }
 
+    auto &deadline_tasks_token = d_->undo_deadline_tasks_token;
+    for (auto iter = deadline_tasks_token.begin(); iter != deadline_tasks_token.end(); ++iter) {
+        if (iter->second == token) {
+            deadline_tasks_token.erase(iter);
+            d_->task_pool.free(d_->undo_tasks_cabinet.free(token));
+            return 0;
+        }
+    }
+
     return 1;   //! 返回没有找到
 }
 
+event::Loop* ThreadPool::getLoop() const
+{
+    return d_->wp_loop;
+}
+
 void ThreadPool::cleanup()
 {
     RECORD_SCOPE();
     if (!d_->is_ready)
         return;
 
+    //! 自适应调节随之关闭，再次 initialize() 之前需重新 setAdaptive()
+    CHECK_DELETE_RESET_OBJ(d_->adaptive_timer);
+    d_->adaptive_cfg = AdaptiveConfig();
+    d_->adaptive_low_periods = 0;
+
     std::vector<std::thread*> thread_vec;
     {
         std::lock_guard<std::mutex> lg(d_->lock);
@@ -250,6 +451,12 @@ void ThreadPool::cleanup()
             }
         }
 
+        for (auto &item : d_->undo_deadline_tasks_token)
+            d_->task_pool.free(d_->undo_tasks_cabinet.free(item.second));
+        d_->undo_deadline_tasks_token.clear();
+
+        d_->adaptive_state = Snapshot::Adaptive();
+
         //! 将threads_cabinet中的线程搬到thread_vec
         thread_vec.reserve(d_->threads_cabinet.size());
         d_->threads_cabinet.foreach(
@@ -283,27 +490,84 @@ ThreadPool::Snapshot ThreadPool::snapshot() const
     for (size_t i = 0; i < THREAD_POOL_PRIO_SIZE; ++i)
         ss.undo_task_num[i] = d_->undo_tasks_token[i].size();
     ss.undo_task_peak_num = d_->undo_task_peak_num_;
+    ss.keep_thread_num = d_->keep_thread_num;
+    ss.deadline_task_num = d_->undo_deadline_tasks_token.size();
+    ss.deadline_miss_num = d_->deadline_miss_num;
+    ss.adaptive = d_->adaptive_state;
 
     return ss;
 }
 
+ThreadPool::Stat ThreadPool::getStat() const
+{
+    Stat stat;
+    auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lg(d_->lock);
+    stat = d_->retired_stat;
+
+    for (auto worker_stat : d_->worker_stats) {
+        std::lock_guard<std::mutex> worker_lg(worker_stat->lock);
+        for (int i = 0; i < kClassNum; ++i) {
+            auto &class_stat = ClassStat(stat, i);
+            class_stat.wait_time_us.merge(worker_stat->classes[i].wait_time_us);
+            class_stat.exec_time_us.merge(worker_stat->classes[i].exec_time_us);
+        }
+        stat.worker_alive_us += ToUs(now - worker_stat->alive_begin_time_point);
+        stat.worker_busy_us += ToUs(worker_stat->busy_time);
+    }
+
+    stat.stat_time_us = ToUs(now - d_->stat_begin_time_point);
+    return stat;
+}
+
+void ThreadPool::resetStat()
+{
+    auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lg(d_->lock);
+    d_->retired_stat = Stat();
+
+    for (auto worker_stat : d_->worker_stats) {
+        std::lock_guard<std::mutex> worker_lg(worker_stat->lock);
+        for (auto &prio_stat : worker_stat->classes) {
+            prio_stat.wait_time_us.reset();
+            prio_stat.exec_time_us.reset();
+        }
+        worker_stat->alive_begin_time_point = now;
+        worker_stat->busy_time = Clock::duration::zero();
+    }
+
+    d_->stat_begin_time_point = now;
+}
+
 void ThreadPool::threadProc(ThreadToken thread_token)
 {
     bool let_main_loop_join_me = false;
 
     LogDbg("thread %u start", thread_token.id());
 
+    WorkerStat worker_stat;
+    {
+        std::lock_guard<std::mutex> lg(d_->lock);
+        worker_stat.alive_begin_time_point = Clock::now();
+        d_->worker_stats.insert(&worker_stat);
+    }
+
     while (true) {
         Task* item = nullptr;
         {
             std::unique_lock<std::mutex> lk(d_->lock);
 
             /**
-             * 如果当前空闲的线程数量大于等于未被领取的任务数，且当前的线程个数已超过长驻线程数，说明线程数据已满足现有要求则退出当前线程
+             * 如果当前空闲的线程数量大于等于可执行的任务数，且当前的线程个数已超过长驻线程数，说明线程数据已满足现有要求则退出当前线程
+             * 受并发数限制的任务不计在内，否则多出来的线程会因等不到可执行的任务而空转
              */
-            if ((d_->idle_thread_num >= d_->undo_tasks_cabinet.size()) && (d_->threads_cabinet.size() > d_->min_thread_num)) {
+            if ((d_->idle_thread_num >= d_->runnableTaskNum()) &&
+                (d_->aliveThreadNum() > d_->keep_thread_num)) {
                 LogDbg("thread %u will exit, no more work.", thread_token.id());
                 let_main_loop_join_me = true;
+                ++d_->exiting_thread_num;
                 break;
             }
 
@@ -342,11 +606,20 @@ void ThreadPool::threadProc(ThreadToken thread_token)
 
             {
                 RECORD_SCOPE();
-                CatchThrow(item->backend_task, true);
+                CatchThrow([item] { item->backend_task(); }, true);
             }
 
             auto exec_time_cost = Clock::now() - exec_time_point;
 
+            {
+                std::lock_guard<std::mutex> lg(worker_stat.lock);
+                auto &prio_stat = worker_stat.classes[item->level];
+                prio_stat.wait_time_us.record(ToUs(wait_time_cost));
+                prio_stat.exec_time_us.record(ToUs(exec_time_cost));
+                worker_stat.busy_time += exec_time_cost;
+                worker_stat.window_wait_time_us.record(ToUs(wait_time_cost));
+            }
+
             LogDbg("thread %u finish task %u, cost %" PRIu64 " + %" PRIu64 " us",
                    thread_token.id(), item->token.id(),
                    wait_time_cost.count() / 1000,
@@ -354,25 +627,52 @@ void ThreadPool::threadProc(ThreadToken thread_token)
 
             if (item->main_cb) {
                 RECORD_SCOPE();
-                d_->wp_loop->runInLoop(item->main_cb, "ThreadPool::threadProc, invoke main_cb");
+                d_->wp_loop->runInLoop(std::move(item->main_cb), "ThreadPool::threadProc, invoke main_cb");
             }
 
+            bool need_notify = false;
             {
                 std::lock_guard<std::mutex> lg(d_->lock);
                 d_->doing_tasks_token.erase(item->token);
+
+                //! 如果该类别受并发数限制，空出的名额需要通知其它线程来领取
+                int level = item->level;
+                --d_->class_doing_num[level];
+                need_notify = d_->class_max_doing_num[level] != 0 && !d_->isClassEmpty(level);
+
                 d_->task_pool.free(item);
             }
+
+            if (need_notify)
+                d_->cond_var.notify_one();
         }
     }
 
     LogDbg("thread %u exit", thread_token.id());
 
+    {
+        //! 将本线程的统计数据合并到 retired_stat 中，避免线程退出后数据丢失
+        std::lock_guard<std::mutex> lg(d_->lock);
+        d_->worker_stats.erase(&worker_stat);
+
+        auto &retired_stat = d_->retired_stat;
+        for (int i = 0; i < kClassNum; ++i) {
+            auto &class_stat = ClassStat(retired_stat, i);
+            class_stat.wait_time_us.merge(worker_stat.classes[i].wait_time_us);
+            class_stat.exec_time_us.merge(worker_stat.classes[i].exec_time_us);
+        }
+        retired_stat.worker_alive_us += ToUs(Clock::now() - worker_stat.alive_begin_time_point);
+        retired_stat.worker_busy_us += ToUs(worker_stat.busy_time);
+        d_->retired_window_wait_time_us.merge(worker_stat.window_wait_time_us);
+    }
+
     if (let_main_loop_join_me) {
         //! 则将线程取出来，交给main_loop去join()，然后delete
         std::unique_lock<std::mutex> lk(d_->lock);
 
         auto t = d_->threads_cabinet.free(thread_token);
         TBOX_ASSERT(t != nullptr);
+        --d_->exiting_thread_num;
         d_->wp_loop->runInLoop(
             [t]{ t->join(); delete t; },
             "ThreadPool::threadProc, join and delete it"
@@ -402,29 +702,309 @@ bool ThreadPool::shouldThreadExitWaiting() const
     if (d_->all_threads_stop_flag)
         return true;
 
-    for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-        const auto &tasks_token = d_->undo_tasks_token.at(i);
-        if (!tasks_token.empty()) {
+    //! 自适应调节缩容后，多出来的空闲线程需要退出
+    if (d_->aliveThreadNum() > d_->keep_thread_num)
+        return true;
+
+    return hasRunnableTask();
+}
+
+bool ThreadPool::hasRunnableTask() const
+{
+    for (int i = 0; i < kClassNum; ++i) {
+        if (!d_->isClassEmpty(i) && d_->isClassUnderLimit(i))
             return true;
-        }
     }
-
     return false;
 }
 
+/**
+ * 调度顺序：
+ * 1. 有期限的任务，按期限先后（EDF）；
+ * 2. 各优先级的任务，按 SchedPolicy 选出优先级，同一优先级内先进先出。
+ * 已达到并发数限制的类别会被跳过。
+ */
 ThreadPool::Task* ThreadPool::popOneTask()
 {
-    //! 从高优先级向低优先级遍历，找出优先级最高的任务
-    for (size_t i = 0; i < d_->undo_tasks_token.size(); ++i) {
-        auto &tasks_token = d_->undo_tasks_token.at(i);
-        if (!tasks_token.empty()) {
-            TaskToken token = tasks_token.front();
-            tasks_token.pop_front();
-            return d_->undo_tasks_cabinet.free(token);
+    int level = -1;
+    TaskToken token;
+
+    auto &deadline_tasks_token = d_->undo_deadline_tasks_token;
+    if (!deadline_tasks_token.empty() && d_->isClassUnderLimit(kDeadlineLevel)) {
+        auto iter = deadline_tasks_token.begin();
+        if (iter->first < Clock::now())
+            ++d_->deadline_miss_num;
+        token = iter->second;
+        deadline_tasks_token.erase(iter);
+        level = kDeadlineLevel;
+
+    } else if (d_->sched_policy == SchedPolicy::kStrictPriority) {
+        //! 从高优先级向低优先级遍历，找出优先级最高的任务
+        for (int i = 0; i < THREAD_POOL_PRIO_SIZE; ++i) {
+            if (!d_->isClassEmpty(i) && d_->isClassUnderLimit(i)) {
+                level = i;
+                break;
+            }
+        }
+
+    } else {
+        //! 找出虚拟时间最小的优先级，执行后其虚拟时间按 1/weight 前进
+        for (int i = 0; i < THREAD_POOL_PRIO_SIZE; ++i) {
+            if (!d_->isClassEmpty(i) && d_->isClassUnderLimit(i)) {
+                if (level < 0 || d_->prio_pass[i] < d_->prio_pass[level])
+                    level = i;
+            }
+        }
+
+        if (level >= 0) {
+            d_->global_pass = d_->prio_pass[level];
+            d_->prio_pass[level] += kStrideBase / d_->prio_weight[level];
+        }
+    }
+
+    if (level < 0)
+        return nullptr;
+
+    if (level != kDeadlineLevel) {
+        auto &tasks_token = d_->undo_tasks_token.at(level);
+        token = tasks_token.front();
+        tasks_token.pop_front();
+    }
+
+    ++d_->class_doing_num[level];
+    return d_->undo_tasks_cabinet.free(token);
+}
+
+bool ThreadPool::setAdaptive(const AdaptiveConfig &cfg)
+{
+    if (cfg.target_wait_p99.count() < 0 || cfg.interval.count() <= 0 ||
+        cfg.hysteresis < 0 || cfg.hysteresis >= 1 || cfg.shrink_periods <= 0 ||
+        cfg.max_cpu_usage <= 0 || cfg.step == 0) {
+        LogWarn("adaptive config invalid");
+        return false;
+    }
+
+    d_->adaptive_cfg = cfg;
+
+    if (cfg.target_wait_p99.count() == 0) {
+        if (d_->adaptive_timer != nullptr)
+            d_->adaptive_timer->disable();
+
+        {
+            std::lock_guard<std::mutex> lg(d_->lock);
+            d_->keep_thread_num = d_->min_thread_num;
+            d_->adaptive_state = Snapshot::Adaptive();
+            d_->adaptive_low_periods = 0;
+        }
+        //! 常驻线程数已恢复，唤醒多余的空闲线程退出
+        d_->cond_var.notify_all();
+        return true;
+    }
+
+    if (d_->is_ready)
+        startAdaptiveTimer();
+
+    return true;
+}
+
+void ThreadPool::startAdaptiveTimer()
+{
+    if (d_->adaptive_timer == nullptr) {
+        d_->adaptive_timer = d_->wp_loop->newTimerEvent("ThreadPool::adaptive_timer");
+        d_->adaptive_timer->setCallback(std::bind(&ThreadPool::onAdaptiveTimerTick, this));
+    }
+
+    d_->adaptive_timer->disable();
+    d_->adaptive_timer->initialize(d_->adaptive_cfg.interval, event::Event::Mode::kPersist);
+    d_->adaptive_timer->enable();
+
+    std::lock_guard<std::mutex> lg(d_->lock);
+    d_->adaptive_state.enabled = true;
+    d_->adaptive_low_periods = 0;
+    d_->adaptive_last_time_point = Clock::now();
+    d_->adaptive_last_cpu_time = GetProcessCpuTime();
+}
+
+/**
+ * 自适应调节
+ *
+ * 1. 统计评估周期内所有任务的排队时长p99，以及进程的CPU使用率；
+ * 2. p99 高于目标上沿时，如果CPU未饱和则增加常驻线程数，并立即补足线程；
+ * 3. p99 连续 shrink_periods 个周期低于目标下沿时，减少常驻线程数，唤醒多余的空闲线程退出；
+ * 4. 介于上下沿之间保持不变，以此形成迟滞，避免反复调节。
+ */
+void ThreadPool::onAdaptiveTimerTick()
+{
+    RECORD_SCOPE();
+    const auto &cfg = d_->adaptive_cfg;
+
+    auto now = Clock::now();
+    auto cpu_time = GetProcessCpuTime();
+
+    bool need_notify = false;
+    {
+        std::lock_guard<std::mutex> lg(d_->lock);
+
+        util::Histogram window;
+        window.merge(d_->retired_window_wait_time_us);
+        d_->retired_window_wait_time_us.reset();
+        for (auto worker_stat : d_->worker_stats) {
+            std::lock_guard<std::mutex> worker_lg(worker_stat->lock);
+            window.merge(worker_stat->window_wait_time_us);
+            worker_stat->window_wait_time_us.reset();
         }
+
+        auto wall_time = now - d_->adaptive_last_time_point;
+        auto cpu_num = std::max(std::thread::hardware_concurrency(), 1u);
+        double cpu_usage = wall_time.count() > 0 ?
+            (cpu_time - d_->adaptive_last_cpu_time).count() * 1.0 / wall_time.count() / cpu_num : 0;
+        d_->adaptive_last_time_point = now;
+        d_->adaptive_last_cpu_time = cpu_time;
+
+        auto &state = d_->adaptive_state;
+        state.wait_p99_us = window.percentile(99);
+        state.cpu_usage = cpu_usage;
+
+        uint64_t target_us = cfg.target_wait_p99.count();
+        uint64_t high_us = target_us * (1 + cfg.hysteresis);
+        uint64_t low_us = target_us * (1 - cfg.hysteresis);
+
+        if (window.count() > 0 && state.wait_p99_us > high_us) {
+            d_->adaptive_low_periods = 0;
+            if (cpu_usage >= cfg.max_cpu_usage) {
+                state.decision = AdaptiveDecision::kCpuBound;
+
+            } else if (d_->keep_thread_num < d_->max_thread_num) {
+                d_->keep_thread_num = std::min(d_->keep_thread_num + cfg.step, d_->max_thread_num);
+                while (d_->aliveThreadNum() < d_->keep_thread_num) {
+                    if (!createWorker())
+                        break;
+                }
+                state.decision = AdaptiveDecision::kGrow;
+                ++state.grow_times;
+
+            } else {
+                state.decision = AdaptiveDecision::kHold;
+            }
+
+        } else if (window.count() == 0 || state.wait_p99_us < low_us) {
+            state.decision = AdaptiveDecision::kHold;
+            if (++d_->adaptive_low_periods >= cfg.shrink_periods) {
+                d_->adaptive_low_periods = 0;
+                if (d_->keep_thread_num > d_->min_thread_num) {
+                    d_->keep_thread_num = std::max(d_->keep_thread_num - std::min(cfg.step, d_->keep_thread_num), d_->min_thread_num);
+                    state.decision = AdaptiveDecision::kShrink;
+                    ++state.shrink_times;
+                    need_notify = true;
+                }
+            }
+
+        } else {
+            d_->adaptive_low_periods = 0;
+            state.decision = AdaptiveDecision::kHold;
+        }
+
+        if (state.decision == AdaptiveDecision::kGrow || state.decision == AdaptiveDecision::kShrink)
+            LogInfo("adaptive %s, p99:%" PRIu64 "us, cpu:%.2f, keep_thread_num:%zu",
+                    ToString(state.decision).c_str(), state.wait_p99_us, cpu_usage, d_->keep_thread_num);
+    }
+
+    if (need_notify)
+        d_->cond_var.notify_all();
+}
+
+std::string ToString(ThreadPool::AdaptiveDecision decision)
+{
+    switch (decision) {
+        case ThreadPool::AdaptiveDecision::kNone:     return "none";
+        case ThreadPool::AdaptiveDecision::kHold:     return "hold";
+        case ThreadPool::AdaptiveDecision::kGrow:     return "grow";
+        case ThreadPool::AdaptiveDecision::kShrink:   return "shrink";
+        case ThreadPool::AdaptiveDecision::kCpuBound: return "cpu_bound";
+        default: return "unknown";
     }
-    return nullptr;
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+
+uint64_t ThreadPool::Stat::doneTaskNum() const
+{
+    uint64_t num = deadline.exec_time_us.count();
+    for (auto &prio_stat : prio)
+        num += prio_stat.exec_time_us.count();
+    return num;
+}
+
+double ThreadPool::Stat::throughput() const
+{
+    return stat_time_us > 0 ? (doneTaskNum() * 1000000.0 / stat_time_us) : 0;
+}
+
+double ThreadPool::Stat::utilization() const
+{
+    return worker_alive_us > 0 ? (worker_busy_us * 1.0 / worker_alive_us) : 0;
+}
+
+void ThreadPool::Stat::toJson(Json &js) const
+{
+    js["stat_time_us"] = stat_time_us;
+    js["done_task_num"] = doneTaskNum();
+    js["throughput"] = throughput();
+    js["worker_alive_us"] = worker_alive_us;
+    js["worker_busy_us"] = worker_busy_us;
+    js["utilization"] = utilization();
+
+    auto &js_prio = js["prio"];
+    for (size_t i = 0; i < THREAD_POOL_PRIO_SIZE; ++i) {
+        Json js_item;
+        js_item["prio"] = static_cast<int>(i) + THREAD_POOL_PRIO_MIN;
+        prio[i].wait_time_us.toJson(js_item["wait_time_us"]);
+        prio[i].exec_time_us.toJson(js_item["exec_time_us"]);
+        js_prio.push_back(std::move(js_item));
+    }
+
+    deadline.wait_time_us.toJson(js["deadline"]["wait_time_us"]);
+    deadline.exec_time_us.toJson(js["deadline"]["exec_time_us"]);
+}
+
+}
+}
+
+namespace {
+void PrintHistogram(std::ostream &os, const char *name, const tbox::util::Histogram &h)
+{
+    os << "  " << name << ": count=" << h.count()
+       << " min=" << h.min() << " avg=" << h.mean()
+       << " p50=" << h.percentile(50) << " p90=" << h.percentile(90)
+       << " p99=" << h.percentile(99) << " p999=" << h.percentile(99.9)
+       << " max=" << h.max() << " us" << std::endl;
+}
 }
+
+std::ostream& operator<< (std::ostream &os, const tbox::eventx::ThreadPool::Stat &stat)
+{
+    os << std::setprecision(3);
+
+    os << "stat_time: " << stat.stat_time_us << " us" << std::endl;
+    os << "done_task_num: " << stat.doneTaskNum() << std::endl;
+    os << "throughput: " << stat.throughput() << " /s" << std::endl;
+    os << "utilization: " << stat.utilization() * 100 << " %" << std::endl;
+
+    for (size_t i = 0; i < THREAD_POOL_PRIO_SIZE; ++i) {
+        const auto &prio_stat = stat.prio[i];
+        if (prio_stat.wait_time_us.count() == 0)
+            continue;
+
+        os << "prio " << static_cast<int>(i) + THREAD_POOL_PRIO_MIN << ':' << std::endl;
+        PrintHistogram(os, "wait", prio_stat.wait_time_us);
+        PrintHistogram(os, "exec", prio_stat.exec_time_us);
+    }
+
+    if (stat.deadline.wait_time_us.count() != 0) {
+        os << "deadline:" << std::endl;
+        PrintHistogram(os, "wait", stat.deadline.wait_time_us);
+        PrintHistogram(os, "exec", stat.deadline.exec_time_us);
+    }
+
+    return os;
 }
@@ -23,8 +23,14 @@
 #include <limits>
 #include <functional>
 #include <array>
+#include <chrono>
+#include <string>
+#include <ostream>
 #include <tbox/event/forward.h>
 #include <tbox/base/cabinet_token.h>
+#include <tbox/base/json_fwd.h>
+#include <tbox/base/small_func.hpp>
+#include <tbox/util/histogram.h>
 
 namespace tbox {
 namespace eventx {
@@ -65,6 +71,7 @@ class ThreadPool {
     bool initialize(ssize_t min_thread_num = 0, ssize_t max_thread_num = std::numeric_limits<ssize_t>::max());
 
     using NonReturnFunc = std::function<void ()>;
+    using TaskFunc = SmallFunc<void ()>;    //!< 内部存放任务函数的类型，小对象内联存储，不分配内存
 
     /**
      * 使用worker线程执行某个函数
@@ -89,6 +96,78 @@ class ThreadPool {
     TaskToken execute(NonReturnFunc &&backend_task, NonReturnFunc &&main_cb, int prio = 0);
     TaskToken execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, int prio = 0);
 
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * 使用worker线程执行某个有期限的函数
+     *
+     * 有期限的任务优先于按优先级排队的任务，且按期限先后执行（EDF）。
+     * 超过期限的任务仍会被执行，但会被计入 Snapshot::deadline_miss_num
+     *
+     * \param deadline          期限，期望在该时间点前开始执行
+     * \param backend_task      让worker线程执行的函数对象
+     * \param main_cb           任务完成后，由主线程执行的回调函数对象
+     *
+     * \return TaskToken        任务Token
+     */
+    TaskToken executeBefore(const TimePoint &deadline, NonReturnFunc &&backend_task, NonReturnFunc &&main_cb = nullptr);
+    TaskToken executeBefore(const TimePoint &deadline, const NonReturnFunc &backend_task, const NonReturnFunc &main_cb = nullptr);
+
+    /**
+     * 同上，直接传入lambda等可调用对象时，就地构造成 TaskFunc，避免先转换成 std::function 而分配内存
+     */
+    template <typename F, typename = typename std::enable_if<TaskFunc::IsBindable<F>::value>::type>
+    TaskToken execute(F &&backend_task, int prio = 0) {
+        return executeFunc(TaskFunc(std::forward<F>(backend_task)), nullptr, prio);
+    }
+
+    template <typename F, typename G, typename = typename std::enable_if<
+        TaskFunc::IsBindable<F>::value && TaskFunc::IsBindable<G>::value>::type>
+    TaskToken execute(F &&backend_task, G &&main_cb, int prio = 0) {
+        return executeFunc(TaskFunc(std::forward<F>(backend_task)), TaskFunc(std::forward<G>(main_cb)), prio);
+    }
+
+    template <typename F, typename = typename std::enable_if<TaskFunc::IsBindable<F>::value>::type>
+    TaskToken executeBefore(const TimePoint &deadline, F &&backend_task) {
+        return executeFuncBefore(deadline, TaskFunc(std::forward<F>(backend_task)), nullptr);
+    }
+
+    template <typename F, typename G, typename = typename std::enable_if<
+        TaskFunc::IsBindable<F>::value && TaskFunc::IsBindable<G>::value>::type>
+    TaskToken executeBefore(const TimePoint &deadline, F &&backend_task, G &&main_cb) {
+        return executeFuncBefore(deadline, TaskFunc(std::forward<F>(backend_task)), TaskFunc(std::forward<G>(main_cb)));
+    }
+
+    //! 各优先级之间的调度策略
+    enum class SchedPolicy {
+        kStrictPriority,    //!< 严格优先级，总是先执行优先级高的任务（默认）
+        kWeightedFair,      //!< 加权公平，按权重比例在各优先级之间分配执行机会，低优先级不会饿死
+    };
+
+    //! 设置各优先级之间的调度策略
+    void setSchedPolicy(SchedPolicy policy);
+
+    /**
+     * 设置优先级的权重，仅在 SchedPolicy::kWeightedFair 下有效
+     * 默认优先级越高权重越大，依次为 16,8,4,2,1
+     *
+     * \param prio      优先级
+     * \param weight    权重，必须 > 0
+     */
+    bool setPrioWeight(int prio, uint32_t weight);
+
+    /**
+     * 设置某优先级的任务最多同时被多少个线程执行
+     * 用于限制后台类任务占满所有的线程
+     *
+     * \param prio      优先级
+     * \param max_num   最大并发数，0表示不限制
+     */
+    bool setPrioConcurrency(int prio, size_t max_num);
+
+    //! 设置有期限的任务最多同时被多少个线程执行，0表示不限制
+    void setDeadlineConcurrency(size_t max_num);
+
     enum class TaskStatus {
         kWaiting,   //! 等待中
         kExecuting, //! 执行中
@@ -114,6 +193,43 @@ class ThreadPool {
      */
     void cleanup();
 
+    //! 获取 main_cb 所在的 Loop
+    event::Loop* getLoop() const;
+
+    //! 自适应线程数调节参数
+    struct AdaptiveConfig {
+        std::chrono::microseconds target_wait_p99{0};   //!< 目标排队时长p99，为0表示不启用
+        std::chrono::milliseconds interval{1000};       //!< 评估周期
+        double hysteresis = 0.2;    //!< 迟滞比例，p99高于 target*(1+h) 才扩容，低于 target*(1-h) 才缩容
+        int shrink_periods = 3;     //!< 需要连续多少个周期满足缩容条件才缩容
+        double max_cpu_usage = 0.9; //!< 进程CPU使用率超过该值时不再扩容，[0, 1]
+        size_t step = 1;            //!< 每次调节的线程数
+    };
+
+    /**
+     * 设置自适应线程数调节
+     *
+     * 启用后，线程池会周期性地在main_loop中评估任务的排队时长p99与CPU使用率，
+     * 在 [min_thread_num, max_thread_num] 之间调节常驻线程数 keep_thread_num。
+     * 多出常驻线程数的空闲线程才会退出，避免突发任务导致线程反复创建与销毁。
+     *
+     * \param cfg     调节参数，cfg.target_wait_p99 为 0 表示关闭
+     *
+     * \note  cleanup() 会关闭自适应调节，再次 initialize() 后需重新设置
+     *
+     * \return bool   是否成功
+     */
+    bool setAdaptive(const AdaptiveConfig &cfg);
+
+    //! 自适应调节的决策
+    enum class AdaptiveDecision {
+        kNone,      //!< 未启用或尚未评估
+        kHold,      //!< 保持
+        kGrow,      //!< 扩容
+        kShrink,    //!< 缩容
+        kCpuBound,  //!< 需要扩容，但CPU已饱和
+    };
+
     //! 快照结构
     struct Snapshot {
         size_t thread_num = 0;          //!< 当前存活线程数
@@ -121,11 +237,53 @@ class ThreadPool {
         std::array<size_t, THREAD_POOL_PRIO_SIZE> undo_task_num;  //! 各优先级等待任务数
         size_t doing_task_num = 0;      //!< 正在执行的任务数
         size_t undo_task_peak_num = 0;  //!< 等待任务数峰值
+        size_t keep_thread_num = 0;     //!< 常驻线程数，启用自适应调节后会变化
+        size_t deadline_task_num = 0;   //!< 等待中的有期限任务数
+        size_t deadline_miss_num = 0;   //!< 累计超期才开始执行的任务数
+
+        struct Adaptive {
+            bool enabled = false;           //!< 是否启用自适应调节
+            uint64_t wait_p99_us = 0;       //!< 上个评估周期排队时长p99
+            double cpu_usage = 0;           //!< 上个评估周期进程CPU使用率
+            AdaptiveDecision decision = AdaptiveDecision::kNone;   //!< 上个评估周期的决策
+            size_t grow_times = 0;          //!< 累计扩容次数
+            size_t shrink_times = 0;        //!< 累计缩容次数
+        } adaptive;
     };
 
     //! 获取当前快照
     Snapshot snapshot() const;
 
+    //! 统计数据
+    struct Stat {
+        uint64_t stat_time_us = 0;      //!< 统计时长
+
+        struct PrioStat {
+            util::Histogram wait_time_us;   //!< 任务排队等待时长分布
+            util::Histogram exec_time_us;   //!< 任务执行时长分布
+        };
+        std::array<PrioStat, THREAD_POOL_PRIO_SIZE> prio;   //!< 各优先级的统计
+        PrioStat deadline;                                  //!< 有期限任务的统计
+
+        uint64_t worker_alive_us = 0;   //!< 所有工作线程的存活时长之和
+        uint64_t worker_busy_us = 0;    //!< 所有工作线程的执行任务时长之和
+
+        uint64_t doneTaskNum() const;   //!< 已完成的任务数
+        double throughput() const;      //!< 每秒完成的任务数
+        double utilization() const;     //!< 工作线程利用率，[0, 1]
+
+        void toJson(Json &js) const;
+    };
+
+    /**
+     * 获取统计数据
+     *
+     * 各工作线程独自记录自己的统计数据，在此处才进行合并，对任务执行的影响可忽略
+     */
+    Stat getStat() const;
+    //! 重置统计数据
+    void resetStat();
+
   protected:
     using ThreadToken = cabinet::Token;
 
@@ -134,15 +292,26 @@ class ThreadPool {
 
     bool shouldThreadExitWaiting() const;   //! 判定子线程是否需要退出条件变量的wait()函数
 
+    void startAdaptiveTimer();
+    void onAdaptiveTimerTick();    //! 自适应调节评估
+
     struct Task;
-    Task* popOneTask(); //! 取出一个优先级最高的任务
+    TaskToken executeFunc(TaskFunc &&backend_task, TaskFunc &&main_cb, int prio);
+    TaskToken executeFuncBefore(const TimePoint &deadline, TaskFunc &&backend_task, TaskFunc &&main_cb);
+    TaskToken pushTask(TaskFunc &&backend_task, TaskFunc &&main_cb, int level, const TimePoint &deadline);
+    Task* popOneTask(); //! 按调度策略取出一个任务
+    bool hasRunnableTask() const;   //! 是否有可被执行的任务（不受并发数限制）
 
   private:
     struct Data;
     Data *d_ = nullptr;
 };
 
+std::string ToString(ThreadPool::AdaptiveDecision decision);
+
 }
 }
 
+std::ostream& operator<< (std::ostream &os, const tbox::eventx::ThreadPool::Stat &stat);
+
 #endif //TBOX_THREAD_POOL_H
@@ -17,10 +17,16 @@
  * project authors may be found in the CONTRIBUTORS.md file in the root
  * of the source tree.
  */
+#include <ctime>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <gtest/gtest.h>
 
 #include <tbox/base/log.h>
+#include <tbox/base/json.hpp>
 #include <tbox/event/loop.h>
 #include <tbox/event/timer_event.h>
 
@@ -41,6 +47,39 @@ auto backend_func = \
 
 ThreadPool::TaskToken null_task_token;
 
+/**
+ * 闸门，用于代替 sleep 控制任务的执行时机
+ *
+ * 占住工作线程的任务调用 pass()，先通知已开始执行，再等待放行
+ */
+class Gate {
+  public:
+    void pass() {
+        std::unique_lock<std::mutex> lk(lock_);
+        is_entered_ = true;
+        cond_.notify_all();
+        cond_.wait(lk, [this] { return is_open_; });
+    }
+
+    //! 等待有任务执行到 pass()
+    void waitEntered() {
+        std::unique_lock<std::mutex> lk(lock_);
+        cond_.wait(lk, [this] { return is_entered_; });
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lg(lock_);
+        is_open_ = true;
+        cond_.notify_all();
+    }
+
+  private:
+    std::mutex lock_;
+    std::condition_variable cond_;
+    bool is_entered_ = false;
+    bool is_open_ = false;
+};
+
 /**
  * 最小线程数为2，最大线程数为5
  */
@@ -268,4 +307,373 @@ TEST(ThreadPool, cleanup_before_finish) {
     delete loop;
 }
 
+/**
+ * 统计数据
+ *
+ * 检查各优先级的等待与执行时长是否被记录，且线程退出后数据仍然保留
+ */
+TEST(ThreadPool, stat) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(0, 1));
+
+    //! 全部完成即退出，不依赖固定的时长
+    int done_num = 0;
+    auto main_cb = [&] {
+        if (++done_num == 4)
+            loop->exitLoop();
+    };
+
+    for (int i = 0; i < 3; ++i)
+        tp->execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }, main_cb, -2);
+    tp->execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }, main_cb, 2);
+
+    loop->exitLoop(std::chrono::seconds(5));
+    loop->runLoop();
+    ASSERT_EQ(done_num, 4);
+
+    auto stat = tp->getStat();
+    EXPECT_EQ(stat.doneTaskNum(), 4u);
+    EXPECT_EQ(stat.prio[0].exec_time_us.count(), 3u);
+    EXPECT_EQ(stat.prio[4].exec_time_us.count(), 1u);
+    EXPECT_GE(stat.prio[0].exec_time_us.min(), 10000u);
+    EXPECT_GE(stat.prio[4].wait_time_us.min(), 30000u);  //! 最低优先级的任务要等前三个执行完
+    EXPECT_GE(stat.worker_busy_us, 40000u);
+    EXPECT_GT(stat.utilization(), 0);
+    EXPECT_LE(stat.utilization(), 1);
+
+    tbox::Json js;
+    stat.toJson(js);
+    EXPECT_EQ(js["done_task_num"], 4);
+    EXPECT_EQ(js["prio"].size(), THREAD_POOL_PRIO_SIZE);
+
+    tp->resetStat();
+    stat = tp->getStat();
+    EXPECT_EQ(stat.doneTaskNum(), 0u);
+    EXPECT_EQ(stat.worker_busy_us, 0u);
+
+    tp->cleanup();
+
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 自适应调节
+ *
+ * 突发任务排队时长超过目标，常驻线程数增长至最大；任务结束后连续多个周期空闲，常驻线程数回落
+ */
+TEST(ThreadPool, adaptive) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+
+    ThreadPool::AdaptiveConfig cfg;
+    cfg.target_wait_p99 = std::chrono::milliseconds(1);
+    cfg.interval = std::chrono::milliseconds(50);
+    cfg.shrink_periods = 4;
+    cfg.max_cpu_usage = 1.1;    //! 任务是sleep，避免受机器负载影响
+    ASSERT_TRUE(tp->setAdaptive(cfg));
+    ASSERT_TRUE(tp->initialize(0, 2));
+
+    for (int i = 0; i < 10; ++i)
+        tp->execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+
+    auto t1 = loop->newTimerEvent();
+    t1->initialize(chrono::milliseconds(130), Event::Mode::kOneshot);
+    t1->enable();
+    t1->setCallback(
+        [&] {
+            auto ss = tp->snapshot();
+            EXPECT_TRUE(ss.adaptive.enabled);
+            EXPECT_EQ(ss.keep_thread_num, 2u);
+            EXPECT_EQ(ss.thread_num, 2u);
+            EXPECT_GE(ss.adaptive.grow_times, 1u);
+        }
+    );
+
+    loop->exitLoop(std::chrono::milliseconds(700));
+    loop->runLoop();
+
+    auto ss = tp->snapshot();
+    EXPECT_LT(ss.keep_thread_num, 2u);
+    EXPECT_GE(ss.adaptive.shrink_times, 1u);
+    EXPECT_EQ(ss.thread_num, ss.keep_thread_num);
+
+    tp->cleanup();
+
+    delete t1;
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 关闭自适应调节后，多余的空闲线程立即退出；cleanup() 之后自适应调节不再生效
+ */
+TEST(ThreadPool, adaptiveDisableAndCleanup) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+
+    ThreadPool::AdaptiveConfig cfg;
+    cfg.target_wait_p99 = std::chrono::milliseconds(1);
+    cfg.interval = std::chrono::milliseconds(20);
+    cfg.shrink_periods = 1000;  //! 不让它自行缩容
+    cfg.max_cpu_usage = 1.1;
+    ASSERT_TRUE(tp->setAdaptive(cfg));
+    ASSERT_TRUE(tp->initialize(0, 2));
+
+    for (int i = 0; i < 10; ++i)
+        tp->execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(10)); });
+
+    //! 等常驻线程数增长到2后关闭自适应调节，再等多余的线程退出
+    bool is_disabled = false;
+    auto t1 = loop->newTimerEvent();
+    t1->initialize(chrono::milliseconds(10), Event::Mode::kPersist);
+    t1->setCallback(
+        [&] {
+            auto ss = tp->snapshot();
+            if (!is_disabled) {
+                if (ss.keep_thread_num == 2 && ss.thread_num == 2 && ss.idle_thread_num == 2) {
+                    ASSERT_TRUE(tp->setAdaptive(ThreadPool::AdaptiveConfig()));
+                    is_disabled = true;
+                }
+            } else if (ss.thread_num == 0) {
+                loop->exitLoop();
+            }
+        }
+    );
+    t1->enable();
+
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    auto ss = tp->snapshot();
+    EXPECT_TRUE(is_disabled);
+    EXPECT_FALSE(ss.adaptive.enabled);
+    EXPECT_EQ(ss.keep_thread_num, 0u);
+    EXPECT_EQ(ss.thread_num, 0u);
+
+    //! cleanup() 关闭自适应调节，重新 initialize() 后不再启用
+    ASSERT_TRUE(tp->setAdaptive(cfg));
+    EXPECT_TRUE(tp->snapshot().adaptive.enabled);
+    tp->cleanup();
+    EXPECT_FALSE(tp->snapshot().adaptive.enabled);
+
+    ASSERT_TRUE(tp->initialize(0, 2));
+    EXPECT_FALSE(tp->snapshot().adaptive.enabled);
+    tp->cleanup();
+
+    delete t1;
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 有期限的任务
+ *
+ * 期望有期限的任务先于普通任务执行，且按期限先后执行
+ */
+TEST(ThreadPool, executeBefore) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    std::mutex task_ids_lock;
+    vector<int> task_ids;
+    auto backend_func = [&] (int id) {
+        std::lock_guard<std::mutex> lg(task_ids_lock);
+        task_ids.push_back(id);
+    };
+    int done_num = 0;
+    auto main_cb = [&] {
+        if (++done_num == 4)
+            loop->exitLoop();
+    };
+    auto now = std::chrono::steady_clock::now();
+
+    //! 先占住唯一的线程，使后面的任务都排队
+    Gate gate;
+    tp->execute([&gate] { gate.pass(); });
+    gate.waitEntered();
+
+    tp->execute(std::bind(backend_func, 0), main_cb, THREAD_POOL_PRIO_MIN);
+    tp->executeBefore(now + std::chrono::seconds(3), std::bind(backend_func, 3), main_cb);
+    tp->executeBefore(now + std::chrono::milliseconds(10), std::bind(backend_func, 1), main_cb);
+    tp->executeBefore(now + std::chrono::seconds(2), std::bind(backend_func, 2), main_cb);
+    EXPECT_EQ(tp->snapshot().deadline_task_num, 3u);
+
+    //! 过了第一个任务的期限才放行
+    std::this_thread::sleep_until(now + std::chrono::milliseconds(20));
+    gate.open();
+
+    loop->exitLoop(std::chrono::seconds(5));
+    loop->runLoop();
+
+    std::lock_guard<std::mutex> lg(task_ids_lock);
+    ASSERT_EQ(task_ids.size(), 4u);
+    EXPECT_EQ(task_ids[0], 1);
+    EXPECT_EQ(task_ids[1], 2);
+    EXPECT_EQ(task_ids[2], 3);
+    EXPECT_EQ(task_ids[3], 0);
+
+    auto ss = tp->snapshot();
+    EXPECT_EQ(ss.deadline_task_num, 0u);
+    EXPECT_EQ(ss.deadline_miss_num, 1u);    //! 期限为10ms的任务在20ms后才执行
+    EXPECT_EQ(tp->getStat().deadline.exec_time_us.count(), 3u);
+
+    tp->cleanup();
+
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 加权公平调度
+ *
+ * 期望低优先级的任务按权重比例得到执行，而不是等高优先级的全部执行完
+ */
+TEST(ThreadPool, weightedFair) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 1));
+
+    tp->setSchedPolicy(ThreadPool::SchedPolicy::kWeightedFair);
+    EXPECT_TRUE(tp->setPrioWeight(THREAD_POOL_PRIO_MIN, 2));
+    EXPECT_TRUE(tp->setPrioWeight(THREAD_POOL_PRIO_MAX, 1));
+    EXPECT_FALSE(tp->setPrioWeight(THREAD_POOL_PRIO_MAX, 0));
+
+    std::mutex task_prios_lock;
+    vector<int> task_prios;
+    auto backend_func = [&] (int prio) {
+        std::lock_guard<std::mutex> lg(task_prios_lock);
+        task_prios.push_back(prio);
+    };
+    int done_num = 0;
+    auto main_cb = [&] {
+        if (++done_num == 20)
+            loop->exitLoop();
+    };
+
+    //! 先占住唯一的线程，待任务全部入队后再放行
+    Gate gate;
+    tp->execute([&gate] { gate.pass(); });
+    gate.waitEntered();
+
+    for (int i = 0; i < 10; ++i) {
+        tp->execute(std::bind(backend_func, THREAD_POOL_PRIO_MIN), main_cb, THREAD_POOL_PRIO_MIN);
+        tp->execute(std::bind(backend_func, THREAD_POOL_PRIO_MAX), main_cb, THREAD_POOL_PRIO_MAX);
+    }
+    gate.open();
+
+    loop->exitLoop(std::chrono::seconds(5));
+    loop->runLoop();
+
+    std::lock_guard<std::mutex> lg(task_prios_lock);
+    ASSERT_EQ(task_prios.size(), 20u);
+    //! 按 2:1 的比例交替执行
+    int low_prio_num = std::count(task_prios.begin(), task_prios.begin() + 6, THREAD_POOL_PRIO_MAX);
+    EXPECT_EQ(low_prio_num, 2);
+
+    tp->cleanup();
+
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 并发数限制
+ *
+ * 期望低优先级的任务最多只占用一个线程，且不影响高优先级任务的执行
+ */
+TEST(ThreadPool, concurrencyLimit) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(3, 3));
+    EXPECT_TRUE(tp->setPrioConcurrency(THREAD_POOL_PRIO_MAX, 1));
+
+    std::atomic_int curr_num(0), peak_num(0);
+    auto backend_func = [&] {
+        int num = ++curr_num;
+        int peak = peak_num;
+        while (num > peak && !peak_num.compare_exchange_weak(peak, num));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        --curr_num;
+    };
+
+    int done_num = 0;
+    auto main_cb = [&] {
+        if (++done_num == 5)
+            loop->exitLoop();
+    };
+
+    for (int i = 0; i < 4; ++i)
+        tp->execute(backend_func, main_cb, THREAD_POOL_PRIO_MAX);
+
+    //! 高优先级任务不必等低优先级的任务都执行完
+    std::atomic_bool high_prio_done(false);
+    std::atomic_int low_prio_done_num_before_high(-1);
+    tp->execute(
+        [&] {
+            low_prio_done_num_before_high = tp->getStat().prio[THREAD_POOL_PRIO_SIZE - 1].exec_time_us.count();
+            high_prio_done = true;
+        },
+        main_cb, THREAD_POOL_PRIO_MIN
+    );
+
+    loop->exitLoop(std::chrono::seconds(5));
+    loop->runLoop();
+    ASSERT_EQ(done_num, 5);
+
+    EXPECT_EQ(peak_num, 1);
+    EXPECT_TRUE(high_prio_done);
+    EXPECT_LT(low_prio_done_num_before_high, 4);
+    EXPECT_EQ(tp->getStat().prio[THREAD_POOL_PRIO_SIZE - 1].exec_time_us.count(), 4u);
+
+    tp->cleanup();
+
+    delete tp;
+    delete loop;
+}
+
+/**
+ * 受并发数限制的任务排队时，不应为其创建新线程，多余的线程也不应空转
+ */
+TEST(ThreadPool, concurrencyLimitNoBusyWait) {
+    Loop *loop = Loop::New();
+    ThreadPool *tp = new ThreadPool(loop);
+    ASSERT_TRUE(tp->initialize(1, 8));
+    EXPECT_TRUE(tp->setPrioConcurrency(THREAD_POOL_PRIO_MAX, 1));
+
+    int done_num = 0;
+    for (int i = 0; i < 6; ++i)
+        tp->execute([] { std::this_thread::sleep_for(std::chrono::milliseconds(30)); },
+                    [&] {
+                        if (++done_num == 6)
+                            loop->exitLoop();
+                    },
+                    THREAD_POOL_PRIO_MAX);
+
+    size_t max_thread_num = 0;
+    auto timer = loop->newTimerEvent();
+    timer->initialize(std::chrono::milliseconds(5), Event::Mode::kPersist);
+    timer->setCallback([&] { max_thread_num = std::max(max_thread_num, tp->snapshot().thread_num); });
+    timer->enable();
+
+    auto cpu_begin = std::clock();
+    auto wall_begin = std::chrono::steady_clock::now();
+    loop->exitLoop(std::chrono::seconds(5));
+    loop->runLoop();
+    double cpu_sec = double(std::clock() - cpu_begin) / CLOCKS_PER_SEC;
+    double wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_begin).count();
+
+    EXPECT_EQ(done_num, 6);
+    EXPECT_LE(max_thread_num, 2u);
+    EXPECT_LT(cpu_sec, wall_sec * 0.5);   //! 任务都在sleep，空转会占满CPU
+
+    delete timer;
+    tp->cleanup();
+
+    delete tp;
+    delete loop;
+}
+
 }
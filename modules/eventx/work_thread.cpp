@@ -66,8 +66,8 @@ struct WorkThread::Data {
  */
 struct WorkThread::Task {
     TaskToken token;
-    NonReturnFunc backend_task;   //! 任务在工作线程中执行函数
-    NonReturnFunc main_cb;        //! 任务执行完成后由main_loop执行的回调函数
+    TaskFunc backend_task;        //! 任务在工作线程中执行函数
+    TaskFunc main_cb;             //! 任务执行完成后由main_loop执行的回调函数
     event::Loop  *main_loop = nullptr;
     Clock::time_point create_time_point;
 
@@ -91,16 +91,25 @@ WorkThread::~WorkThread()
 
 WorkThread::TaskToken WorkThread::execute(NonReturnFunc &&backend_task)
 {
-    return execute(std::move(backend_task), nullptr, nullptr);
+    return executeFunc(TaskFunc(std::move(backend_task)), nullptr, nullptr);
 }
 
 WorkThread::TaskToken WorkThread::execute(const NonReturnFunc &backend_task)
 {
-    NonReturnFunc backend_task_copy(backend_task);
-    return execute(std::move(backend_task_copy), nullptr, nullptr);
+    return executeFunc(TaskFunc(backend_task), nullptr, nullptr);
 }
 
 WorkThread::TaskToken WorkThread::execute(NonReturnFunc &&backend_task, NonReturnFunc &&main_cb, event::Loop *main_loop)
+{
+    return executeFunc(TaskFunc(std::move(backend_task)), TaskFunc(std::move(main_cb)), main_loop);
+}
+
+WorkThread::TaskToken WorkThread::execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, event::Loop *main_loop)
+{
+    return executeFunc(TaskFunc(backend_task), TaskFunc(main_cb), main_loop);
+}
+
+WorkThread::TaskToken WorkThread::executeFunc(TaskFunc &&backend_task, TaskFunc &&main_cb, event::Loop *main_loop)
 {
     RECORD_SCOPE();
     TaskToken token;
@@ -129,13 +138,6 @@ WorkThread::TaskToken WorkThread::execute(NonReturnFunc &&backend_task, NonRetur
     return token;
 }
 
-WorkThread::TaskToken WorkThread::execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, event::Loop *main_loop)
-{
-    NonReturnFunc backend_task_copy(backend_task);
-    NonReturnFunc main_cb_copy(main_cb);
-    return execute(std::move(backend_task_copy), std::move(main_cb_copy), main_loop);
-}
-
 WorkThread::TaskStatus WorkThread::getTaskStatus(TaskToken task_token) const
 {
     if (d_ == nullptr) {
@@ -229,7 +231,7 @@ void WorkThread::threadProc()
 
             {
                 RECORD_SCOPE();
-                CatchThrow(item->backend_task, true);
+                CatchThrow([item] { item->backend_task(); }, true);
             }
 
             auto exec_time_cost = Clock::now() - exec_time_point;
@@ -241,7 +243,7 @@ void WorkThread::threadProc()
 
             if (item->main_cb && item->main_loop != nullptr) {
                 RECORD_SCOPE();
-                item->main_loop->runInLoop(item->main_cb, "WorkThread::threadProc, invoke main_cb");
+                item->main_loop->runInLoop(std::move(item->main_cb), "WorkThread::threadProc, invoke main_cb");
             }
 
             {
@@ -25,6 +25,7 @@
 #include <array>
 #include <tbox/event/forward.h>
 #include <tbox/base/cabinet_token.h>
+#include <tbox/base/small_func.hpp>
 
 namespace tbox {
 namespace eventx {
@@ -47,6 +48,7 @@ class WorkThread {
     virtual ~WorkThread();
 
     using NonReturnFunc = std::function<void ()>;
+    using TaskFunc = SmallFunc<void ()>;    //!< 内部存放任务函数的类型，小对象内联存储，不分配内存
 
     /**
      * 使用worker线程执行某个函数
@@ -69,6 +71,20 @@ class WorkThread {
     TaskToken execute(NonReturnFunc &&backend_task, NonReturnFunc &&main_cb, event::Loop *main_loop = nullptr);
     TaskToken execute(const NonReturnFunc &backend_task, const NonReturnFunc &main_cb, event::Loop *main_loop = nullptr);
 
+    /**
+     * 同上，直接传入lambda等可调用对象时，就地构造成 TaskFunc，避免先转换成 std::function 而分配内存
+     */
+    template <typename F, typename = typename std::enable_if<TaskFunc::IsBindable<F>::value>::type>
+    TaskToken execute(F &&backend_task) {
+        return executeFunc(TaskFunc(std::forward<F>(backend_task)), nullptr, nullptr);
+    }
+
+    template <typename F, typename G, typename = typename std::enable_if<
+        TaskFunc::IsBindable<F>::value && TaskFunc::IsBindable<G>::value>::type>
+    TaskToken execute(F &&backend_task, G &&main_cb, event::Loop *main_loop = nullptr) {
+        return executeFunc(TaskFunc(std::forward<F>(backend_task)), TaskFunc(std::forward<G>(main_cb)), main_loop);
+    }
+
     enum class TaskStatus {
         kWaiting,   //! 等待中
         kExecuting, //! 执行中
@@ -99,6 +115,8 @@ class WorkThread {
 
     bool shouldThreadExitWaiting() const;   //! 判定子线程是否需要退出条件变量的wait()函数
 
+    TaskToken executeFunc(TaskFunc &&backend_task, TaskFunc &&main_cb, event::Loop *main_loop);
+
     struct Task;
     Task* popOneTask(); //! 取出一个优先级最高的任务
 
@@ -26,6 +26,8 @@
 #include <tbox/event/loop.h>
 #include <tbox/event/timer_event.h>
 
+#include "action_arena.h"
+
 namespace tbox {
 namespace flow {
 
@@ -37,6 +39,14 @@ Action::Action(event::Loop &loop, const std::string &type)
   , type_(type)
 {}
 
+void* Action::operator new(size_t size) {
+  return ActionArena::Alloc(size);
+}
+
+void Action::operator delete(void *ptr) {
+  ActionArena::Free(ptr);
+}
+
 Action::~Action() {
   if (isUnderway()) {
     LogWarn("action %d:%s[%s] is still underway, state:%s",
@@ -291,8 +301,7 @@ void Action::onBlock(const Reason &why, const Trace &trace) {
   if (block_cb_) {
     Trace new_trace(trace);
     new_trace.emplace_back(id_, type_, label_);
-    block_cb_run_id_ = loop_.runNext(std::bind(block_cb_, why, new_trace),
-                                     std::string("Action::block") + ToString(new_trace));
+    block_cb_run_id_ = loop_.runNext(std::bind(block_cb_, why, std::move(new_trace)), "Action::block");
   }
 
   is_base_func_invoked_ = true;
@@ -304,8 +313,7 @@ void Action::onFinished(bool is_succ, const Reason &why, const Trace &trace) {
   if (finish_cb_) {
     Trace new_trace(trace);
     new_trace.emplace_back(id_, type_, label_);
-    finish_cb_run_id_ = loop_.runNext(std::bind(finish_cb_, is_succ, why, new_trace),
-                                      std::string("Action::finish") + ToString(new_trace));
+    finish_cb_run_id_ = loop_.runNext(std::bind(finish_cb_, is_succ, why, std::move(new_trace)), "Action::finish");
   }
 
   is_base_func_invoked_ = true;
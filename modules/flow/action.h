@@ -44,6 +44,10 @@ class Action {
     NONCOPYABLE(Action);
     IMMOVABLE(Action);
 
+    //! 内存经由 ActionArena 申请，见 ActionBlueprint
+    static void* operator new(size_t size);
+    static void operator delete(void *ptr);
+
   public:
     //! 状态
     enum class State {
@@ -0,0 +1,188 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "action_arena.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace flow {
+
+namespace {
+
+constexpr size_t kAlign = 16;
+
+inline size_t AlignUp(size_t size) { return (size + kAlign - 1) & ~(kAlign - 1); }
+
+//! 每个对象前面的头部，记录它所在的内存块，为 nullptr 表示从堆中申请
+struct alignas(kAlign) ObjectHeader {
+    ActionArena::Block *block;
+};
+
+thread_local ActionArena::Scope *_current_scope_ = nullptr;
+
+}
+
+struct ActionArena::Block {
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t live_num = 0;    //!< 还未析构的对象数
+    bool is_sealed = false; //!< 是否已不再往里划分内存
+    std::shared_ptr<Pool> pool;
+
+    uint8_t* data() { return reinterpret_cast<uint8_t*>(this) + AlignUp(sizeof(Block)); }
+
+    static Block* New(size_t capacity) {
+        void *mem = ::malloc(AlignUp(sizeof(Block)) + capacity);
+        if (mem == nullptr)
+            throw std::bad_alloc();
+        auto block = new (mem) Block;
+        block->capacity = capacity;
+        return block;
+    }
+
+    static void Delete(Block *block) {
+        block->~Block();
+        ::free(block);
+    }
+
+    //! 所有对象都已析构，且不再划分，归还到池中或释放
+    void tryRecycle() {
+        if (!is_sealed || live_num != 0)
+            return;
+
+        auto owner = std::move(pool);
+        if (owner)
+            owner->give(this);
+        else
+            Delete(this);
+    }
+};
+
+ActionArena::Pool::~Pool() {
+    clear();
+}
+
+ActionArena::Block* ActionArena::Pool::take(size_t capacity, const std::shared_ptr<Pool> &self) {
+    TBOX_ASSERT(self.get() == this);
+
+    Block *block = nullptr;
+    while (!cached_blocks_.empty()) {
+        block = cached_blocks_.back();
+        cached_blocks_.pop_back();
+        if (block->capacity >= capacity)
+            break;
+        Block::Delete(block);
+        block = nullptr;
+    }
+
+    if (block == nullptr)
+        block = Block::New(capacity);
+
+    block->used = 0;
+    block->live_num = 0;
+    block->is_sealed = false;
+    block->pool = self;
+    return block;
+}
+
+void ActionArena::Pool::give(Block *block) {
+    if (block->capacity < min_capacity_ || cached_blocks_.size() >= max_cached_num_) {
+        Block::Delete(block);
+        return;
+    }
+    cached_blocks_.push_back(block);
+}
+
+void ActionArena::Pool::clear() {
+    for (auto block : cached_blocks_)
+        Block::Delete(block);
+    cached_blocks_.clear();
+}
+
+ActionArena::Scope::Scope(Block *block) :
+    block_(block), prev_(_current_scope_)
+{
+    _current_scope_ = this;
+}
+
+ActionArena::Scope::~Scope() {
+    TBOX_ASSERT(_current_scope_ == this);
+    _current_scope_ = prev_;
+
+    if (block_ != nullptr) {
+        block_->is_sealed = true;
+        block_->tryRecycle();
+    }
+}
+
+void* ActionArena::Alloc(size_t size) {
+    size_t total_size = sizeof(ObjectHeader) + AlignUp(size);
+    ObjectHeader *header = nullptr;
+
+    auto scope = _current_scope_;
+    if (scope != nullptr) {
+        scope->requested_size_ += total_size;
+
+        auto block = scope->block_;
+        if (block != nullptr && block->used + total_size <= block->capacity) {
+            header = reinterpret_cast<ObjectHeader*>(block->data() + block->used);
+            header->block = block;
+            block->used += total_size;
+            ++block->live_num;
+            return header + 1;
+        }
+
+        if (block != nullptr)
+            ++scope->overflow_num_;
+    }
+
+    header = static_cast<ObjectHeader*>(::malloc(total_size));
+    if (header == nullptr)
+        throw std::bad_alloc();
+
+    header->block = nullptr;
+    return header + 1;
+}
+
+void ActionArena::Free(void *ptr) {
+    if (ptr == nullptr)
+        return;
+
+    auto header = static_cast<ObjectHeader*>(ptr) - 1;
+    auto block = header->block;
+    if (block == nullptr) {
+        ::free(header);
+        return;
+    }
+
+    TBOX_ASSERT(block->live_num > 0);
+    --block->live_num;
+    block->tryRecycle();
+}
+
+size_t ActionArena::Overhead() {
+    return sizeof(ObjectHeader);
+}
+
+}
+}
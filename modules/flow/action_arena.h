@@ -0,0 +1,107 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_FLOW_ACTION_ARENA_H_20261019
+#define TBOX_FLOW_ACTION_ARENA_H_20261019
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace flow {
+
+/**
+ * Action 的内存竞技场
+ *
+ * 所有 Action 对象都经由 Action::operator new 申请内存。当线程上有活动的 Scope 时，
+ * 申请从 Scope 的内存块中顺序划出，一棵动作树只需一次申请；否则直接从堆中申请。
+ *
+ * 内存块中的对象全部析构后，内存块被归还到其所属的 Pool 中缓存，供下一次使用。
+ *
+ * \warning 同一个内存块中的对象须在同一个线程中析构
+ */
+class ActionArena {
+  public:
+    struct Block;
+
+    //! 内存块的缓存池
+    class Pool {
+      public:
+        explicit Pool(size_t max_cached_num) : max_cached_num_(max_cached_num) { }
+        ~Pool();
+
+        NONCOPYABLE(Pool);
+        IMMOVABLE(Pool);
+
+      public:
+        //! 取一个容量不小于 capacity 的内存块
+        Block* take(size_t capacity, const std::shared_ptr<Pool> &self);
+        //! 回收内存块，容量小于 min_capacity 的直接释放
+        void give(Block *block);
+        void clear();
+
+        void setMinCapacity(size_t min_capacity) { min_capacity_ = min_capacity; }
+        void setMaxCachedNum(size_t max_cached_num) { max_cached_num_ = max_cached_num; }
+        size_t cachedNum() const { return cached_blocks_.size(); }
+
+      private:
+        size_t max_cached_num_;
+        size_t min_capacity_ = 0;
+        std::vector<Block*> cached_blocks_;
+    };
+
+    //! 在其生命期内，本线程申请的 Action 内存从 block 中划出
+    class Scope {
+      public:
+        explicit Scope(Block *block);
+        ~Scope();
+
+        NONCOPYABLE(Scope);
+        IMMOVABLE(Scope);
+
+        //! 在 Scope 内一共申请了多少字节，含超出内存块而从堆中申请的
+        size_t requestedSize() const { return requested_size_; }
+        //! 超出内存块而从堆中申请的次数
+        size_t overflowNum() const { return overflow_num_; }
+
+      private:
+        friend class ActionArena;
+
+        Block *block_;
+        Scope *prev_;
+        size_t requested_size_ = 0;
+        size_t overflow_num_ = 0;
+    };
+
+  public:
+    static void* Alloc(size_t size);
+    static void Free(void *ptr);
+
+    //! 每个对象额外占用的空间
+    static size_t Overhead();
+};
+
+}
+}
+
+#endif //TBOX_FLOW_ACTION_ARENA_H_20261019
@@ -0,0 +1,66 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "action_blueprint.h"
+
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace flow {
+
+ActionBlueprint::ActionBlueprint(const Builder &builder, size_t max_cached_num) :
+    builder_(builder),
+    pool_(std::make_shared<ActionArena::Pool>(max_cached_num))
+{
+    TBOX_ASSERT(builder_ != nullptr);
+}
+
+ActionBlueprint::~ActionBlueprint() { }
+
+Action* ActionBlueprint::create(event::Loop &loop) {
+    ++stats_.create_num;
+
+    if (arena_size_ == 0) {
+        //! 第一次，只统计大小
+        ActionArena::Scope scope(nullptr);
+        auto action = builder_(loop);
+        arena_size_ = scope.requestedSize();
+        pool_->setMinCapacity(arena_size_);
+        return action;
+    }
+
+    Action *action = nullptr;
+    size_t requested_size = 0;
+    {
+        ActionArena::Scope scope(pool_->take(arena_size_, pool_));
+        action = builder_(loop);
+        requested_size = scope.requestedSize();
+        stats_.overflow_num += scope.overflowNum();
+    }
+    ++stats_.arena_num;
+
+    if (requested_size > arena_size_) {
+        arena_size_ = requested_size;
+        pool_->setMinCapacity(arena_size_);
+    }
+    return action;
+}
+
+}
+}
@@ -0,0 +1,101 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_FLOW_ACTION_BLUEPRINT_H_20261019
+#define TBOX_FLOW_ACTION_BLUEPRINT_H_20261019
+
+#include <functional>
+#include <memory>
+
+#include <tbox/base/defines.h>
+#include <tbox/event/loop.h>
+
+#include "action.h"
+#include "action_arena.h"
+
+namespace tbox {
+namespace flow {
+
+/**
+ * 动作树蓝图
+ *
+ * 对于需要反复创建同一种结构的动作树的场景，用蓝图来创建，能省去逐个节点申请内存的开销。
+ *
+ * 蓝图记录构建函数。第一次 create() 时正常构建，同时统计整棵树的 Action 占用了多少内存；
+ * 之后每次 create() 只申请一块足够大的内存，整棵树的 Action 都从这块内存中划出。
+ * 树被 delete 之后，这块内存被缓存起来，留给下一次 create() 使用。
+ *
+ * 使用示例：
+ *   ActionBlueprint bp(
+ *     [] (event::Loop &loop) {
+ *       auto seq = new SequenceAction(loop);
+ *       seq->addChild(new FunctionAction(loop, [] { return true; }));
+ *       seq->addChild(new SleepAction(loop, std::chrono::milliseconds(100)));
+ *       return seq;
+ *     }
+ *   );
+ *
+ *   auto action = bp.create(*loop);
+ *   ...
+ *   delete action;
+ *
+ * \note    构建函数应每次都构建出相同结构的树。若某次构建的树更大，超出的部分从堆中申请，
+ *          并按新的大小调整之后申请的内存块
+ * \warning 蓝图与其创建出的动作树须在同一个线程中使用；蓝图可先于其创建出的动作树析构
+ */
+class ActionBlueprint {
+  public:
+    using Builder = std::function<Action*(event::Loop &loop)>;
+
+    struct Stats {
+        uint64_t create_num = 0;    //!< 创建的次数
+        uint64_t arena_num = 0;     //!< 从内存块中创建的次数
+        uint64_t overflow_num = 0;  //!< 内存块不够用，从堆中申请的次数
+    };
+
+  public:
+    explicit ActionBlueprint(const Builder &builder, size_t max_cached_num = 16);
+    ~ActionBlueprint();
+
+    NONCOPYABLE(ActionBlueprint);
+    IMMOVABLE(ActionBlueprint);
+
+  public:
+    //! 按蓝图创建一棵动作树，用 delete 释放
+    Action* create(event::Loop &loop);
+
+    //! 每棵树所需的内存块大小，为0表示还没有构建过
+    size_t arenaSize() const { return arena_size_; }
+    size_t cachedNum() const { return pool_->cachedNum(); }
+    const Stats& getStats() const { return stats_; }
+
+    //! 释放所有缓存的内存块
+    void clear() { pool_->clear(); }
+
+  private:
+    Builder builder_;
+    std::shared_ptr<ActionArena::Pool> pool_;
+    size_t arena_size_ = 0;
+    Stats stats_;
+};
+
+}
+}
+
+#endif //TBOX_FLOW_ACTION_BLUEPRINT_H_20261019
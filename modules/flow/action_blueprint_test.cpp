@@ -0,0 +1,215 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "action_blueprint.h"
+#include "actions/function_action.h"
+#include "actions/sequence_action.h"
+#include "actions/parallel_action.h"
+#include "actions/repeat_action.h"
+
+namespace tbox {
+namespace flow {
+
+namespace {
+
+//! 构建一棵有12个节点的树，其中9个 FunctionAction
+Action* BuildTree(event::Loop &loop, int &count) {
+  auto seq = new SequenceAction(loop);
+  seq->set_label("device_job_sequence");
+  seq->setTimeout(std::chrono::seconds(10));
+
+  seq->addChild(new FunctionAction(loop, [&count] { ++count; return true; }));
+
+  auto para = new ParallelAction(loop);
+  para->set_label("device_job_parallel");
+  for (int i = 0; i < 4; ++i)
+    para->addChild(new FunctionAction(loop, [&count] { ++count; return true; }));
+  seq->addChild(para);
+
+  seq->addChild(new RepeatAction(loop, new FunctionAction(loop, [&count] { ++count; return true; }), 3));
+  seq->addChild(new FunctionAction(loop, [&count] { ++count; return true; }));
+  return seq;
+}
+
+//! 循环执行 创建->运行->销毁，返回耗时
+std::chrono::nanoseconds RunCycles(event::Loop &loop, int cycle_num,
+                                   const std::function<Action*()> &create, int &succ_num) {
+  int remain_num = cycle_num;
+  std::function<void()> next;
+  next = [&] {
+    if (remain_num-- == 0) {
+      loop.exitLoop();
+      return;
+    }
+
+    auto action = create();
+    action->setFinishCallback(
+      [&, action] (bool is_succ, const Action::Reason &, const Action::Trace &) {
+        if (is_succ)
+          ++succ_num;
+        delete action;
+        next();
+      }
+    );
+    action->start();
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  loop.runNext(next);
+  loop.runLoop();
+  return std::chrono::steady_clock::now() - start;
+}
+
+}
+
+TEST(ActionBlueprint, Basic) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  int count = 0;
+  ActionBlueprint bp([&count] (event::Loop &loop) { return BuildTree(loop, count); });
+  EXPECT_EQ(bp.arenaSize(), 0u);
+
+  for (int i = 0; i < 3; ++i) {
+    auto action = bp.create(*loop);
+    EXPECT_EQ(action->type(), "Sequence");
+    EXPECT_EQ(action->label(), "device_job_sequence");
+
+    bool is_finished = false;
+    action->setFinishCallback(
+      [&] (bool is_succ, const Action::Reason &, const Action::Trace &) {
+        EXPECT_TRUE(is_succ);
+        is_finished = true;
+        loop->exitLoop();
+      }
+    );
+    action->start();
+    loop->runLoop();
+    EXPECT_TRUE(is_finished);
+    delete action;
+
+    EXPECT_GT(bp.arenaSize(), 0u);
+    //! 除第一次外，删除后内存块回到缓存中
+    EXPECT_EQ(bp.cachedNum(), i == 0 ? 0u : 1u);
+  }
+
+  EXPECT_EQ(count, 9 * 3);
+  EXPECT_EQ(bp.getStats().create_num, 3u);
+  EXPECT_EQ(bp.getStats().arena_num, 2u);
+  EXPECT_EQ(bp.getStats().overflow_num, 0u);
+}
+
+//! 同时存在多棵树，以及蓝图先于树析构
+TEST(ActionBlueprint, OutliveBlueprint) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  int count = 0;
+  std::vector<Action*> actions;
+  {
+    ActionBlueprint bp([&count] (event::Loop &loop) { return BuildTree(loop, count); }, 2);
+    for (int i = 0; i < 5; ++i)
+      actions.push_back(bp.create(*loop));
+
+    delete actions.back();
+    actions.pop_back();
+    EXPECT_EQ(bp.cachedNum(), 1u);
+  }
+
+  for (auto action : actions)
+    delete action;
+}
+
+//! 构建出的树变大时，超出部分从堆中申请，之后调整内存块大小
+TEST(ActionBlueprint, Grow) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  int child_num = 1;
+  ActionBlueprint bp(
+    [&child_num] (event::Loop &loop) {
+      auto seq = new SequenceAction(loop);
+      for (int i = 0; i < child_num; ++i)
+        seq->addChild(new FunctionAction(loop, [] { return true; }));
+      return seq;
+    }
+  );
+
+  delete bp.create(*loop);
+  auto small_size = bp.arenaSize();
+
+  child_num = 3;
+  delete bp.create(*loop);
+  EXPECT_EQ(bp.getStats().overflow_num, 2u);
+  EXPECT_GT(bp.arenaSize(), small_size);
+  //! 小的内存块不再缓存
+  EXPECT_EQ(bp.cachedNum(), 0u);
+
+  delete bp.create(*loop);
+  EXPECT_EQ(bp.getStats().overflow_num, 2u);
+  EXPECT_EQ(bp.cachedNum(), 1u);
+}
+
+TEST(ActionBlueprint, Benchmark) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  const int kCycleNum = 20000;
+  int count = 0;
+
+  int heap_succ_num = 0;
+  auto heap_cost = RunCycles(*loop, kCycleNum,
+    [&] { return BuildTree(*loop, count); },
+    heap_succ_num);
+
+  ActionBlueprint bp([&count] (event::Loop &loop) { return BuildTree(loop, count); });
+  int bp_succ_num = 0;
+  auto bp_cost = RunCycles(*loop, kCycleNum,
+    [&] { return bp.create(*loop); },
+    bp_succ_num);
+
+  EXPECT_EQ(heap_succ_num, kCycleNum);
+  EXPECT_EQ(bp_succ_num, kCycleNum);
+  EXPECT_EQ(count, 9 * kCycleNum * 2);
+
+  auto measure_create = [&] (const std::function<Action*()> &create) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCycleNum; ++i)
+      delete create();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  };
+  auto heap_create_us = measure_create([&] { return BuildTree(*loop, count); });
+  auto bp_create_us = measure_create([&] { return bp.create(*loop); });
+  std::cout << kCycleNum << " create-destroy cycles, heap: " << heap_create_us << " us"
+            << ", blueprint: " << bp_create_us << " us" << std::endl;
+
+  auto heap_us = std::chrono::duration_cast<std::chrono::microseconds>(heap_cost).count();
+  auto bp_us = std::chrono::duration_cast<std::chrono::microseconds>(bp_cost).count();
+  std::cout << kCycleNum << " create-run-destroy cycles, heap: " << heap_us << " us"
+            << ", blueprint: " << bp_us << " us" << std::endl;
+}
+
+}
+}
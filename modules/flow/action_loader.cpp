@@ -0,0 +1,543 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "action_loader.h"
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include <tbox/base/log.h>
+#include <tbox/base/json.hpp>
+#include <tbox/util/fs.h>
+
+#include "actions/sequence_action.h"
+#include "actions/parallel_action.h"
+#include "actions/if_else_action.h"
+#include "actions/switch_action.h"
+#include "actions/loop_action.h"
+#include "actions/repeat_action.h"
+#include "actions/sleep_action.h"
+#include "actions/event_action.h"
+#include "actions/succ_fail_action.h"
+
+namespace tbox {
+namespace flow {
+
+namespace {
+
+//! 防止描述嵌套过深导致栈溢出
+constexpr int kMaxDepth = 64;
+
+enum class NodeType {
+    kSequence, kParallel, kIfElse, kSwitch, kLoop, kRepeat,
+    kSleep, kEvent, kFunction, kSucc, kFail,
+};
+
+const std::map<std::string, NodeType> kNodeTypeMap = {
+    { "Sequence", NodeType::kSequence },
+    { "Parallel", NodeType::kParallel },
+    { "IfElse",   NodeType::kIfElse },
+    { "Switch",   NodeType::kSwitch },
+    { "Loop",     NodeType::kLoop },
+    { "Repeat",   NodeType::kRepeat },
+    { "Sleep",    NodeType::kSleep },
+    { "Event",    NodeType::kEvent },
+    { "Function", NodeType::kFunction },
+    { "Succ",     NodeType::kSucc },
+    { "Fail",     NodeType::kFail },
+};
+
+//! 收到指定的事件时结束的动作
+class MatchEventAction : public EventAction {
+  public:
+    using EventSet = std::set<Event::ID>;
+
+    //! holder 持有 events 的所有者，保证动作存在期间 events 有效
+    MatchEventAction(event::Loop &loop, EventPublisher &pub,
+                     const std::shared_ptr<const void> &holder,
+                     const EventSet &succ_events, const EventSet &fail_events) :
+        EventAction(loop, "Event", pub),
+        holder_(holder),
+        succ_events_(succ_events),
+        fail_events_(fail_events)
+    {
+        for (auto id : succ_events_)
+            addInterestedEvent(id);
+        for (auto id : fail_events_)
+            addInterestedEvent(id);
+    }
+
+    virtual bool isReady() const override { return true; }
+
+    virtual bool onEvent(Event event) override {
+        if (succ_events_.count(event.id) != 0) {
+            finish(true);
+            return true;
+        }
+
+        if (fail_events_.count(event.id) != 0) {
+            finish(false);
+            return true;
+        }
+
+        return false;
+    }
+
+  private:
+    std::shared_ptr<const void> holder_;
+    const EventSet &succ_events_;
+    const EventSet &fail_events_;
+};
+
+//! 解析字串型的模式，字段不存在时取 tbl[0]
+template <typename Mode, size_t N>
+bool GetMode(const Json &js, const std::string &path, const char *(&tbl)[N], Mode &mode) {
+    auto iter = js.find("mode");
+    if (iter == js.end()) {
+        mode = static_cast<Mode>(0);
+        return true;
+    }
+
+    if (iter->is_string()) {
+        auto &str = iter->template get_ref<const std::string&>();
+        for (size_t i = 0; i < N; ++i) {
+            if (str == tbl[i]) {
+                mode = static_cast<Mode>(i);
+                return true;
+            }
+        }
+    }
+
+    LogWarn("%s.mode is invalid", path.c_str());
+    return false;
+}
+
+bool GetEvents(const Json &js, const std::string &path, const char *field, std::set<Event::ID> &events) {
+    auto iter = js.find(field);
+    if (iter == js.end())
+        return true;
+
+    if (!iter->is_array()) {
+        LogWarn("%s.%s should be array", path.c_str(), field);
+        return false;
+    }
+
+    for (auto &js_id : *iter) {
+        if (!js_id.is_number_integer()) {
+            LogWarn("%s.%s should be integer array", path.c_str(), field);
+            return false;
+        }
+        events.insert(js_id.get<Event::ID>());
+    }
+    return true;
+}
+
+}
+
+//! 解析、校验后的节点，创建动作树时只读
+struct ActionLoader::Node {
+    NodeType type = NodeType::kSucc;
+    std::string label;
+    std::chrono::milliseconds timeout{0};
+
+    int mode = 0;
+    size_t times = 0;
+    size_t succ_num = 0;
+    size_t max_concurrency = 0;
+    std::chrono::milliseconds time{0};
+    std::set<Event::ID> succ_events;
+    std::set<Event::ID> fail_events;
+    FunctionAction::FuncWithReasonVars func;
+
+    //! 角色 -> 子节点，Sequence 与 Parallel 的角色为空
+    std::vector<std::pair<std::string, NodeSptr>> children;
+
+    //! 创建出的动作树可能比蓝图活得久，所以其中引用节点数据的动作要持有节点
+    static Action* Build(const NodeSptr &node, event::Loop &loop, EventPublisher *wp_pub);
+};
+
+Action* ActionLoader::Node::Build(const NodeSptr &node, event::Loop &loop, EventPublisher *wp_pub) {
+    auto &children = node->children;
+    auto mode = node->mode;
+    Action *action = nullptr;
+    AssembleAction *assemble = nullptr;
+
+    switch (node->type) {
+        case NodeType::kSequence: {
+            auto seq = new SequenceAction(loop, static_cast<SequenceAction::Mode>(mode));
+            for (auto &item : children)
+                seq->addChild(Build(item.second, loop, wp_pub));
+            action = seq;
+            break;
+        }
+        case NodeType::kParallel: {
+            auto para = new ParallelAction(loop, static_cast<ParallelAction::Mode>(mode));
+            para->setRequiredSuccNum(node->succ_num);
+            para->setMaxConcurrency(node->max_concurrency);
+            for (auto &item : children)
+                para->addChild(Build(item.second, loop, wp_pub));
+            action = para;
+            break;
+        }
+        case NodeType::kIfElse:
+            action = assemble = new IfElseAction(loop);
+            break;
+        case NodeType::kSwitch:
+            action = assemble = new SwitchAction(loop);
+            break;
+        case NodeType::kLoop:
+            action = assemble = new LoopAction(loop, static_cast<LoopAction::Mode>(mode));
+            break;
+        case NodeType::kRepeat:
+            action = assemble = new RepeatAction(loop, node->times, static_cast<RepeatAction::Mode>(mode));
+            break;
+        case NodeType::kSleep:
+            action = new SleepAction(loop, node->time);
+            break;
+        case NodeType::kEvent:
+            action = new MatchEventAction(loop, *wp_pub, node, node->succ_events, node->fail_events);
+            break;
+        case NodeType::kFunction:
+            action = new FunctionAction(loop,
+                [node] (Action::Reason &why, util::Variables &vars) { return node->func(why, vars); }
+            );
+            break;
+        case NodeType::kSucc:
+            action = new SuccAction(loop);
+            break;
+        case NodeType::kFail:
+            action = new FailAction(loop);
+            break;
+    }
+
+    if (node->type == NodeType::kLoop || node->type == NodeType::kRepeat) {
+        assemble->setChild(Build(children.front().second, loop, wp_pub));
+
+    } else if (node->type == NodeType::kIfElse || node->type == NodeType::kSwitch) {
+        for (auto &item : children)
+            assemble->setChildAs(Build(item.second, loop, wp_pub), item.first);
+    }
+
+    if (!node->label.empty())
+        action->set_label(node->label);
+
+    if (node->timeout.count() > 0)
+        action->setTimeout(node->timeout);
+
+    return action;
+}
+
+ActionLoader::ActionLoader(EventPublisher *wp_pub) :
+    wp_pub_(wp_pub)
+{ }
+
+ActionLoader::~ActionLoader() { }
+
+bool ActionLoader::registerFunction(const std::string &name, const FunctionAction::Func &func) {
+    if (!func)
+        return false;
+
+    return registerFunction(name,
+        [func] (Action::Reason &, util::Variables &) { return func(); }
+    );
+}
+
+bool ActionLoader::registerFunction(const std::string &name, const FunctionAction::FuncWithReasonVars &func) {
+    if (name.empty() || !func)
+        return false;
+
+    func_map_[name] = func;
+    clearCache();
+    return true;
+}
+
+bool ActionLoader::unregisterFunction(const std::string &name) {
+    if (func_map_.erase(name) == 0)
+        return false;
+
+    clearCache();
+    return true;
+}
+
+ActionLoader::BlueprintSptr ActionLoader::load(const Json &js) {
+    auto text = js.dump();
+    auto iter = json_cache_.find(text);
+    if (iter != json_cache_.end())
+        return iter->second;
+
+    auto bp = compile(js);
+    if (bp)
+        json_cache_.emplace(std::move(text), bp);
+    return bp;
+}
+
+ActionLoader::BlueprintSptr ActionLoader::loadText(const std::string &json_text) {
+    //! 先按原文本查找，命中时免去 JSON 解析
+    auto iter = text_cache_.find(json_text);
+    if (iter != text_cache_.end())
+        return iter->second;
+
+    Json js;
+    try {
+        js = Json::parse(json_text);
+    } catch (const std::exception &e) {
+        LogWarn("parse json fail: %s", e.what());
+        return nullptr;
+    }
+
+    auto bp = load(js);
+    if (bp)
+        text_cache_.emplace(json_text, bp);
+    return bp;
+}
+
+ActionLoader::BlueprintSptr ActionLoader::loadFile(const std::string &filename) {
+    std::string json_text;
+    if (!util::fs::ReadStringFromTextFile(filename, json_text)) {
+        LogWarn("read file %s fail", filename.c_str());
+        return nullptr;
+    }
+    return loadText(json_text);
+}
+
+void ActionLoader::clearCache() {
+    text_cache_.clear();
+    json_cache_.clear();
+}
+
+ActionLoader::BlueprintSptr ActionLoader::compile(const Json &js) {
+    auto root = parse(js, "root", 0);
+    if (!root)
+        return nullptr;
+
+    auto wp_pub = wp_pub_;
+    return std::make_shared<ActionBlueprint>(
+        [root, wp_pub] (event::Loop &loop) { return Node::Build(root, loop, wp_pub); }
+    );
+}
+
+ActionLoader::NodeSptr ActionLoader::parse(const Json &js, const std::string &path, int depth) const {
+    if (depth > kMaxDepth) {
+        LogWarn("%s is too deep", path.c_str());
+        return nullptr;
+    }
+
+    if (!js.is_object()) {
+        LogWarn("%s should be object", path.c_str());
+        return nullptr;
+    }
+
+    std::string type_str;
+    if (!util::json::GetField(js, "type", type_str)) {
+        LogWarn("%s.type is required", path.c_str());
+        return nullptr;
+    }
+
+    auto type_iter = kNodeTypeMap.find(type_str);
+    if (type_iter == kNodeTypeMap.end()) {
+        LogWarn("%s.type '%s' is unknown", path.c_str(), type_str.c_str());
+        return nullptr;
+    }
+
+    auto node = std::make_shared<Node>();
+    node->type = type_iter->second;
+
+    if (js.contains("label") && !util::json::GetField(js, "label", node->label)) {
+        LogWarn("%s.label should be string", path.c_str());
+        return nullptr;
+    }
+
+    if (js.contains("timeout")) {
+        unsigned int timeout_ms = 0;
+        if (!util::json::GetField(js, "timeout", timeout_ms)) {
+            LogWarn("%s.timeout should be unsigned integer", path.c_str());
+            return nullptr;
+        }
+        node->timeout = std::chrono::milliseconds(timeout_ms);
+    }
+
+    //! 解析必填或选填的子节点
+    auto parse_child = [&] (const char *field, const std::string &role, bool is_required) {
+        auto iter = js.find(field);
+        if (iter == js.end()) {
+            if (is_required)
+                LogWarn("%s.%s is required", path.c_str(), field);
+            return !is_required;
+        }
+
+        auto child = parse(*iter, path + '.' + field, depth + 1);
+        if (!child)
+            return false;
+
+        node->children.emplace_back(role, child);
+        return true;
+    };
+
+    switch (node->type) {
+        case NodeType::kSequence:
+        case NodeType::kParallel: {
+            if (node->type == NodeType::kSequence) {
+                const char *mode_tbl[] = { "AllFinish", "AnyFail", "AnySucc" };
+                if (!GetMode<int>(js, path, mode_tbl, node->mode))
+                    return nullptr;
+
+            } else {
+                const char *mode_tbl[] = { "AllFinish", "AnyFail", "AnySucc", "NOfM" };
+                if (!GetMode<int>(js, path, mode_tbl, node->mode))
+                    return nullptr;
+
+                unsigned int succ_num = 0, max_concurrency = 0;
+                if ((js.contains("succ_num") && !util::json::GetField(js, "succ_num", succ_num)) ||
+                    (js.contains("max_concurrency") && !util::json::GetField(js, "max_concurrency", max_concurrency))) {
+                    LogWarn("%s.succ_num and max_concurrency should be unsigned integer", path.c_str());
+                    return nullptr;
+                }
+                node->succ_num = succ_num;
+                node->max_concurrency = max_concurrency;
+            }
+
+            auto iter = js.find("children");
+            if (iter == js.end() || !iter->is_array() || iter->empty()) {
+                LogWarn("%s.children should be non-empty array", path.c_str());
+                return nullptr;
+            }
+
+            for (size_t i = 0; i < iter->size(); ++i) {
+                auto child = parse(iter->at(i), path + ".children[" + std::to_string(i) + ']', depth + 1);
+                if (!child)
+                    return nullptr;
+                node->children.emplace_back(std::string(), child);
+            }
+            break;
+        }
+
+        case NodeType::kIfElse:
+            if (!parse_child("if", "if", true) ||
+                !parse_child("then", "then", false) ||
+                !parse_child("else", "else", false))
+                return nullptr;
+
+            if (node->children.size() < 2) {
+                LogWarn("%s requires then or else", path.c_str());
+                return nullptr;
+            }
+            break;
+
+        case NodeType::kSwitch: {
+            if (!parse_child("switch", "switch", true) ||
+                !parse_child("default", "default", false))
+                return nullptr;
+
+            auto iter = js.find("cases");
+            if (iter != js.end()) {
+                if (!iter->is_object()) {
+                    LogWarn("%s.cases should be object", path.c_str());
+                    return nullptr;
+                }
+                for (auto case_iter = iter->begin(); case_iter != iter->end(); ++case_iter) {
+                    auto child = parse(case_iter.value(), path + ".cases." + case_iter.key(), depth + 1);
+                    if (!child)
+                        return nullptr;
+                    node->children.emplace_back("case:" + case_iter.key(), child);
+                }
+            }
+
+            if (node->children.size() < 2) {
+                LogWarn("%s requires cases or default", path.c_str());
+                return nullptr;
+            }
+            break;
+        }
+
+        case NodeType::kLoop: {
+            const char *mode_tbl[] = { "Forever", "UntilFail", "UntilSucc" };
+            if (!GetMode<int>(js, path, mode_tbl, node->mode) ||
+                !parse_child("child", "", true))
+                return nullptr;
+            break;
+        }
+
+        case NodeType::kRepeat: {
+            const char *mode_tbl[] = { "NoBreak", "BreakFail", "BreakSucc" };
+            unsigned int times = 0;
+            if (!util::json::GetField(js, "times", times)) {
+                LogWarn("%s.times should be unsigned integer", path.c_str());
+                return nullptr;
+            }
+            node->times = times;
+
+            if (!GetMode<int>(js, path, mode_tbl, node->mode) ||
+                !parse_child("child", "", true))
+                return nullptr;
+            break;
+        }
+
+        case NodeType::kSleep: {
+            unsigned int time_ms = 0;
+            if (!util::json::GetField(js, "time", time_ms)) {
+                LogWarn("%s.time should be unsigned integer", path.c_str());
+                return nullptr;
+            }
+            node->time = std::chrono::milliseconds(time_ms);
+            break;
+        }
+
+        case NodeType::kEvent:
+            if (wp_pub_ == nullptr) {
+                LogWarn("%s is Event, but no publisher", path.c_str());
+                return nullptr;
+            }
+
+            if (!GetEvents(js, path, "succ_events", node->succ_events) ||
+                !GetEvents(js, path, "fail_events", node->fail_events))
+                return nullptr;
+
+            if (node->succ_events.empty() && node->fail_events.empty()) {
+                LogWarn("%s requires succ_events or fail_events", path.c_str());
+                return nullptr;
+            }
+            break;
+
+        case NodeType::kFunction: {
+            std::string name;
+            if (!util::json::GetField(js, "name", name)) {
+                LogWarn("%s.name should be string", path.c_str());
+                return nullptr;
+            }
+
+            auto iter = func_map_.find(name);
+            if (iter == func_map_.end()) {
+                LogWarn("%s.name '%s' is not registered", path.c_str(), name.c_str());
+                return nullptr;
+            }
+            node->func = iter->second;
+            break;
+        }
+
+        case NodeType::kSucc:
+        case NodeType::kFail:
+            break;
+    }
+
+    return node;
+}
+
+}
+}
@@ -0,0 +1,122 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_FLOW_ACTION_LOADER_H_20261019
+#define TBOX_FLOW_ACTION_LOADER_H_20261019
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <tbox/base/defines.h>
+#include <tbox/base/json_fwd.h>
+
+#include "action_blueprint.h"
+#include "event_publisher.h"
+#include "actions/function_action.h"
+
+namespace tbox {
+namespace flow {
+
+/**
+ * 从 JSON 描述加载动作树
+ *
+ * 描述被解析、校验一次后生成 ActionBlueprint，并按内容缓存，相同的描述再次加载时直接返回缓存的蓝图。
+ * 之后用蓝图的 create() 创建动作树，创建时不再解析 JSON。
+ *
+ * 每个节点都是一个 JSON 对象，公共字段有：
+ *   "type"    : 必填，节点类型，见下
+ *   "label"   : 选填，标签
+ *   "timeout" : 选填，超时时长，单位毫秒
+ *
+ * 各类型的字段：
+ *   {"type":"Sequence", "mode":"AllFinish|AnyFail|AnySucc", "children":[...]}
+ *   {"type":"Parallel", "mode":"AllFinish|AnyFail|AnySucc|NOfM", "succ_num":2, "max_concurrency":4, "children":[...]}
+ *   {"type":"IfElse", "if":{...}, "then":{...}, "else":{...}}         then 与 else 至少有一个
+ *   {"type":"Switch", "switch":{...}, "cases":{"xxx":{...}}, "default":{...}}   switch 以 Reason 的 message 为 "case:xxx" 结束时执行 xxx
+ *   {"type":"Loop", "mode":"Forever|UntilFail|UntilSucc", "child":{...}}
+ *   {"type":"Repeat", "times":3, "mode":"NoBreak|BreakFail|BreakSucc", "child":{...}}
+ *   {"type":"Sleep", "time":100}                                      单位毫秒
+ *   {"type":"Event", "succ_events":[1,2], "fail_events":[3]}          收到指定的事件时结束
+ *   {"type":"Function", "name":"xxx"}                                 执行 registerFunction() 注册的函数
+ *   {"type":"Succ"} 与 {"type":"Fail"}
+ * 其中 "mode" 均为选填，默认为第一个；Parallel 的 "succ_num" 与 "max_concurrency" 选填，默认为0，
+ * 含义见 ParallelAction::setRequiredSuccNum() 与 setMaxConcurrency()。
+ *
+ * 使用示例：
+ *   ActionLoader loader(&publisher);
+ *   loader.registerFunction("check", [] { return true; });
+ *
+ *   auto bp = loader.loadText(R"({"type":"Sequence","children":[{"type":"Function","name":"check"},{"type":"Sleep","time":100}]})");
+ *   if (bp) {
+ *     auto action = bp->create(*loop);
+ *     ...
+ *   }
+ *
+ * \warning 与 ActionBlueprint 一样，加载器及其加载出的蓝图须在同一个线程中使用
+ */
+class ActionLoader {
+  public:
+    using BlueprintSptr = std::shared_ptr<ActionBlueprint>;
+
+    //! wp_pub 供 Event 节点订阅事件，为 nullptr 表示不支持 Event 节点
+    explicit ActionLoader(EventPublisher *wp_pub = nullptr);
+    ~ActionLoader();
+
+    NONCOPYABLE(ActionLoader);
+    IMMOVABLE(ActionLoader);
+
+  public:
+    //! 注册供 Function 节点使用的函数。注册会清空已缓存的蓝图
+    bool registerFunction(const std::string &name, const FunctionAction::Func &func);
+    bool registerFunction(const std::string &name, const FunctionAction::FuncWithReasonVars &func);
+    bool unregisterFunction(const std::string &name);
+
+    /**
+     * 加载
+     *
+     * \return 蓝图，失败时返回 nullptr，并打印失败原因
+     */
+    BlueprintSptr load(const Json &js);
+    BlueprintSptr loadText(const std::string &json_text);
+    BlueprintSptr loadFile(const std::string &filename);
+
+    size_t cacheSize() const { return text_cache_.size() + json_cache_.size(); }
+    void clearCache();
+
+  protected:
+    struct Node;
+    using NodeSptr = std::shared_ptr<const Node>;
+
+    BlueprintSptr compile(const Json &js);
+    NodeSptr parse(const Json &js, const std::string &path, int depth) const;
+
+  private:
+    EventPublisher *wp_pub_;
+    std::map<std::string, FunctionAction::FuncWithReasonVars> func_map_;
+
+    std::unordered_map<std::string, BlueprintSptr> text_cache_; //!< JSON 文本 -> 蓝图
+    std::unordered_map<std::string, BlueprintSptr> json_cache_; //!< 规范化后的 JSON 文本 -> 蓝图
+};
+
+}
+}
+
+#endif //TBOX_FLOW_ACTION_LOADER_H_20261019
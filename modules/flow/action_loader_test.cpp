@@ -0,0 +1,329 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <chrono>
+#include <iostream>
+#include <gtest/gtest.h>
+#include <tbox/event/loop.h>
+#include <tbox/event/timer_event.h>
+#include <tbox/base/json.hpp>
+#include <tbox/base/scope_exit.hpp>
+
+#include "action_loader.h"
+#include "event_publisher_impl.h"
+
+namespace tbox {
+namespace flow {
+
+namespace {
+
+//! 启动动作，运行 Loop 直到动作结束，返回是否成功
+bool RunToFinish(event::Loop &loop, Action *action) {
+  bool is_succ = false;
+  action->setFinishCallback(
+    [&] (bool succ, const Action::Reason &, const Action::Trace &) {
+      is_succ = succ;
+      loop.exitLoop();
+    }
+  );
+  action->start();
+  loop.exitLoop(std::chrono::seconds(1));
+  loop.runLoop();
+  return is_succ;
+}
+
+}
+
+TEST(ActionLoader, Sequence) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  std::vector<std::string> steps;
+  ActionLoader loader;
+  loader.registerFunction("a", [&] { steps.push_back("a"); return true; });
+  loader.registerFunction("b", [&] { steps.push_back("b"); return true; });
+
+  const char *text = R"({
+    "type": "Sequence", "label": "job",
+    "children": [
+      {"type": "Function", "name": "a"},
+      {"type": "Sleep", "time": 10},
+      {"type": "Repeat", "times": 2, "child": {"type": "Function", "name": "b"}}
+    ]
+  })";
+
+  auto bp = loader.loadText(text);
+  ASSERT_NE(bp, nullptr);
+
+  auto action = bp->create(*loop);
+  EXPECT_EQ(action->type(), "Sequence");
+  EXPECT_EQ(action->label(), "job");
+  EXPECT_TRUE(RunToFinish(*loop, action));
+  EXPECT_EQ(steps, std::vector<std::string>({"a", "b", "b"}));
+  delete action;
+}
+
+//! 相同的描述只解析一次
+TEST(ActionLoader, Cache) {
+  ActionLoader loader;
+
+  auto bp1 = loader.loadText(R"({"type":"Succ"})");
+  auto bp2 = loader.loadText(R"({"type":"Succ"})");
+  auto bp3 = loader.loadText(R"( { "type" : "Succ" } )");
+  auto bp4 = loader.load(Json::parse(R"({"type":"Succ"})"));
+  ASSERT_NE(bp1, nullptr);
+  EXPECT_EQ(bp1, bp2);
+  EXPECT_EQ(bp1, bp3);
+  EXPECT_EQ(bp1, bp4);
+
+  auto bp5 = loader.loadText(R"({"type":"Fail"})");
+  ASSERT_NE(bp5, nullptr);
+  EXPECT_NE(bp1, bp5);
+
+  //! 注册函数后，缓存失效
+  loader.registerFunction("f", [] { return true; });
+  EXPECT_EQ(loader.cacheSize(), 0u);
+  EXPECT_NE(loader.loadText(R"({"type":"Succ"})"), bp1);
+}
+
+TEST(ActionLoader, Invalid) {
+  ActionLoader loader;
+  loader.registerFunction("f", [] { return true; });
+
+  const char *texts[] = {
+    "{",
+    "[]",
+    R"({"label":"no type"})",
+    R"({"type":"Unknown"})",
+    R"({"type":"Function"})",
+    R"({"type":"Function","name":"g"})",
+    R"({"type":"Sequence","children":[]})",
+    R"({"type":"Sequence","mode":"Bad","children":[{"type":"Succ"}]})",
+    R"({"type":"Parallel","children":[{"type":"Succ"},{"type":"Bad"}]})",
+    R"({"type":"Sequence","mode":"NOfM","children":[{"type":"Succ"}]})",
+    R"({"type":"Parallel","mode":"NOfM","succ_num":-1,"children":[{"type":"Succ"}]})",
+    R"({"type":"IfElse","if":{"type":"Succ"}})",
+    R"({"type":"Switch","switch":{"type":"Succ"}})",
+    R"({"type":"Switch","switch":{"type":"Succ"},"cases":[]})",
+    R"({"type":"Loop"})",
+    R"({"type":"Repeat","child":{"type":"Succ"}})",
+    R"({"type":"Sleep","time":-1})",
+    R"({"type":"Succ","timeout":"1s"})",
+    R"({"type":"Event","succ_events":[1]})",   //! 没有 publisher
+  };
+
+  for (auto text : texts)
+    EXPECT_EQ(loader.loadText(text), nullptr) << text;
+  EXPECT_EQ(loader.cacheSize(), 0u);
+
+  //! 嵌套过深
+  Json js = {{"type", "Succ"}};
+  for (int i = 0; i < 100; ++i)
+    js = Json{{"type", "Loop"}, {"child", js}};
+  EXPECT_EQ(loader.load(js), nullptr);
+}
+
+TEST(ActionLoader, ParallelNOfM) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  ActionLoader loader;
+  const char *text = R"({
+    "type": "Parallel", "mode": "NOfM", "succ_num": 2, "max_concurrency": 2,
+    "children": [{"type": "Fail"}, {"type": "Succ"}, {"type": "Fail"}, {"type": "Succ"}]
+  })";
+
+  auto bp = loader.loadText(text);
+  ASSERT_NE(bp, nullptr);
+
+  auto action = bp->create(*loop);
+  EXPECT_TRUE(RunToFinish(*loop, action));
+  Json js;
+  action->toJson(js);
+  EXPECT_EQ(js["required_succ_num"], 2);
+  EXPECT_EQ(js["max_concurrency"], 2);
+  delete action;
+}
+
+TEST(ActionLoader, IfElseAndSwitch) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  std::string branch;
+  std::string color = "red";
+
+  ActionLoader loader;
+  loader.registerFunction("is_red", [&] { return color == "red"; });
+  loader.registerFunction("get_color",
+    [&] (Action::Reason &why, util::Variables &) { why.message = "case:" + color; return true; });
+  loader.registerFunction("then", [&] { branch = "then"; return true; });
+  loader.registerFunction("else", [&] { branch = "else"; return true; });
+  loader.registerFunction("red", [&] { branch = "red"; return true; });
+  loader.registerFunction("other", [&] { branch = "other"; return true; });
+
+  auto if_bp = loader.loadText(R"({
+    "type": "IfElse",
+    "if": {"type": "Function", "name": "is_red"},
+    "then": {"type": "Function", "name": "then"},
+    "else": {"type": "Function", "name": "else"}
+  })");
+  auto switch_bp = loader.loadText(R"({
+    "type": "Switch",
+    "switch": {"type": "Function", "name": "get_color"},
+    "cases": {"red": {"type": "Function", "name": "red"}},
+    "default": {"type": "Function", "name": "other"}
+  })");
+  ASSERT_NE(if_bp, nullptr);
+  ASSERT_NE(switch_bp, nullptr);
+
+  for (auto c : {"red", "blue"}) {
+    color = c;
+    bool is_red = color == "red";
+
+    auto action = if_bp->create(*loop);
+    EXPECT_TRUE(RunToFinish(*loop, action));
+    EXPECT_EQ(branch, is_red ? "then" : "else");
+    delete action;
+
+    action = switch_bp->create(*loop);
+    EXPECT_TRUE(RunToFinish(*loop, action));
+    EXPECT_EQ(branch, is_red ? "red" : "other");
+    delete action;
+  }
+}
+
+TEST(ActionLoader, EventAndTimeout) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  EventPublisherImpl pub(loop);
+  ActionLoader loader(&pub);
+
+  auto bp = loader.loadText(R"({
+    "type": "Sequence", "mode": "AnyFail",
+    "children": [
+      {"type": "Event", "succ_events": [1], "fail_events": [2]},
+      {"type": "Event", "succ_events": [3], "timeout": 20}
+    ]
+  })");
+  ASSERT_NE(bp, nullptr);
+
+  //! 第二个 Event 在第一个结束后才订阅，所以事件3要晚一点发
+  auto timer = loop->newTimerEvent();
+  SetScopeExitAction([timer] { delete timer; });
+  timer->initialize(std::chrono::milliseconds(5), event::Event::Mode::kOneshot);
+  timer->setCallback([&] { pub.post(3); });
+
+  auto action = bp->create(*loop);
+  loop->runNext([&] { pub.post(1); });
+  timer->enable();
+  EXPECT_TRUE(RunToFinish(*loop, action));
+  delete action;
+
+  //! 收到失败事件
+  action = bp->create(*loop);
+  loop->runNext([&] { pub.post(2); });
+  EXPECT_FALSE(RunToFinish(*loop, action));
+  delete action;
+
+  //! 第二个等待超时
+  action = bp->create(*loop);
+  loop->runNext([&] { pub.post(1); });
+  EXPECT_FALSE(RunToFinish(*loop, action));
+  delete action;
+  EXPECT_EQ(pub.subscriberNumber(), 0u);
+}
+
+//! 蓝图及加载器先于动作树析构
+TEST(ActionLoader, OutliveLoader) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  EventPublisherImpl pub(loop);
+  int count = 0;
+  Action *action = nullptr;
+  {
+    ActionLoader loader(&pub);
+    loader.registerFunction("count", [&] { ++count; return true; });
+    action = loader.loadText(R"({
+      "type": "Sequence",
+      "children": [{"type": "Event", "succ_events": [1]}, {"type": "Function", "name": "count"}]
+    })")->create(*loop);
+  }
+
+  loop->runNext([&] { pub.post(1); });
+  EXPECT_TRUE(RunToFinish(*loop, action));
+  EXPECT_EQ(count, 1);
+  delete action;
+}
+
+//! 大量并发的作业，每个都在等待自己的事件
+TEST(ActionLoader, ManyJobs) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  const int kJobNum = 2000;
+
+  EventPublisherImpl pub(loop);
+  ActionLoader loader(&pub);
+  int done_num = 0;
+  loader.registerFunction("done", [&] { ++done_num; return true; });
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Action*> jobs;
+  for (int i = 0; i < kJobNum; ++i) {
+    Json js = {
+      {"type", "Sequence"},
+      {"children", {
+        {{"type", "Event"}, {"succ_events", {i}}},
+        {{"type", "Function"}, {"name", "done"}}
+      }}
+    };
+    auto job = loader.load(js)->create(*loop);
+    job->start();
+    jobs.push_back(job);
+  }
+
+  for (int i = 0; i < kJobNum; ++i)
+    pub.post(i);
+
+  int finished_num = 0;
+  for (auto job : jobs) {
+    job->setFinishCallback(
+      [&] (bool, const Action::Reason &, const Action::Trace &) {
+        if (++finished_num == kJobNum)
+          loop->exitLoop();
+      }
+    );
+  }
+  loop->exitLoop(std::chrono::seconds(5));
+  loop->runLoop();
+
+  EXPECT_EQ(done_num, kJobNum);
+  EXPECT_EQ(finished_num, kJobNum);
+  for (auto job : jobs)
+    delete job;
+
+  auto cost = std::chrono::steady_clock::now() - start;
+  std::cout << kJobNum << " jobs cost "
+            << std::chrono::duration_cast<std::chrono::microseconds>(cost).count() << " us" << std::endl;
+}
+
+}
+}
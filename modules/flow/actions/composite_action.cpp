@@ -25,8 +25,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 CompositeAction::~CompositeAction() {
     CHECK_DELETE_RESET_OBJ(child_);
 }
@@ -41,8 +39,8 @@ bool CompositeAction::setChild(Action *child) {
     if (!child->setParent(this))
         return false;
 
-    child->setFinishCallback(std::bind(&CompositeAction::onLastChildFinished, this, _1, _2, _3));
-    child->setBlockCallback(std::bind(&CompositeAction::block, this, _1, _2));
+    child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+    child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
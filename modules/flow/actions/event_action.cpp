@@ -32,9 +32,22 @@ EventAction::~EventAction() {
         pub_.unsubscribe(this);
 }
 
+void EventAction::addInterestedEvent(Event::ID event_id) {
+    interested_events_.push_back(event_id);
+}
+
+void EventAction::subscribe() {
+    if (interested_events_.empty()) {
+        pub_.subscribe(this);
+    } else {
+        for (auto event_id : interested_events_)
+            pub_.subscribe(this, event_id);
+    }
+}
+
 void EventAction::onStart() {
     Action::onStart();
-    pub_.subscribe(this);
+    subscribe();
 }
 
 void EventAction::onStop() {
@@ -54,7 +67,7 @@ void EventAction::onBlock(const Reason &why, const Trace &trace) {
 
 void EventAction::onResume() {
     Action::onResume();
-    pub_.subscribe(this);
+    subscribe();
 }
 
 void EventAction::onReset() {
@@ -20,6 +20,8 @@
 #ifndef TBOX_FLOW_EVENT_ACTION_H_20221105
 #define TBOX_FLOW_EVENT_ACTION_H_20221105
 
+#include <vector>
+
 #include "../action.h"
 #include "../event_subscriber.h"
 #include "../event_publisher.h"
@@ -34,6 +36,16 @@ class EventAction : public Action,
     virtual ~EventAction();
 
   protected:
+    /**
+     * 指定关心的事件
+     *
+     * 指定之后只向发布者订阅这些事件，发布者不会再将其它事件交给 onEvent()，
+     * 等待的 EventAction 很多时能明显减少发布事件的开销。未指定则订阅所有事件
+     *
+     * \note 须在 start() 之前指定
+     */
+    void addInterestedEvent(Event::ID event_id);
+
     virtual void onStart() override;
     virtual void onStop() override;
     virtual void onPause() override;
@@ -42,8 +54,12 @@ class EventAction : public Action,
     virtual void onReset() override;
     virtual void onFinished(bool succ, const Reason &why, const Trace &trace) override;
 
+  private:
+    void subscribe();
+
   private:
     EventPublisher &pub_;
+    std::vector<Event::ID> interested_events_;
 };
 
 }
@@ -20,6 +20,7 @@
 #include "function_action.h"
 #include <tbox/base/assert.h>
 #include <tbox/event/loop.h>
+#include <tbox/eventx/thread_pool.h>
 
 namespace tbox {
 namespace flow {
@@ -56,11 +57,56 @@ FunctionAction::FunctionAction(event::Loop &loop, FuncWithReasonVars &&func)
     TBOX_ASSERT(func_with_reason_vars_ != nullptr);
 }
 
+//! 在线程池中执行的任务，Loop 线程与工作线程共享
+struct FunctionAction::OffloadTask {
+    Func func;
+    FuncWithReason func_with_reason;
+
+    Reason reason;
+    bool is_succ = false;
+
+    bool is_done = false;       //!< 是否已执行完成，只在 Loop 线程中访问
+    bool is_canceled = false;   //!< 动作是否已不再关心结果，只在 Loop 线程中访问
+};
+
+FunctionAction::~FunctionAction() {
+    cancelOffloadTask();
+}
+
 void FunctionAction::onStart() {
     Action::onStart();
 
     Reason reason(ACTION_REASON_FUNCTION_ACTION, "FunctionAction");
 
+    if (thread_pool_ != nullptr && (func_ || func_with_reason_)) {
+        //! 完成回调在线程池的 Loop 中执行，必须与本动作是同一个 Loop
+        TBOX_ASSERT(thread_pool_->getLoop() == &loop_);
+
+        auto task = std::make_shared<OffloadTask>();
+        task->func = func_;
+        task->func_with_reason = func_with_reason_;
+        task->reason = reason;
+        offload_task_ = task;
+
+        auto token = thread_pool_->execute(
+            [task] {
+                task->is_succ = task->func ? task->func() : task->func_with_reason(task->reason);
+            },
+            [this, task] {
+                task->is_done = true;
+                if (!task->is_canceled)
+                    onOffloadTaskDone();
+            }
+        );
+
+        //! 线程池未初始化等原因，任务没有放进去，不会有回调
+        if (token.isNull()) {
+            offload_task_.reset();
+            finish(false, Reason(ACTION_REASON_OFFLOAD_FAIL, "OffloadFail"));
+        }
+        return;
+    }
+
     if (func_) {
       finish(func_(), reason);
 
@@ -78,5 +124,40 @@ void FunctionAction::onStart() {
     }
 }
 
+void FunctionAction::onStop() {
+    cancelOffloadTask();
+    Action::onStop();
+}
+
+void FunctionAction::onResume() {
+    Action::onResume();
+
+    //! 暂停期间线程池中的任务已完成，现在结束
+    if (offload_task_ && offload_task_->is_done) {
+        auto task = std::move(offload_task_);
+        finish(task->is_succ, task->reason);
+    }
+}
+
+void FunctionAction::onReset() {
+    cancelOffloadTask();
+    Action::onReset();
+}
+
+void FunctionAction::onOffloadTaskDone() {
+    if (state() != State::kRunning)
+        return;
+
+    auto task = std::move(offload_task_);
+    finish(task->is_succ, task->reason);
+}
+
+void FunctionAction::cancelOffloadTask() {
+    if (offload_task_) {
+        offload_task_->is_canceled = true;
+        offload_task_.reset();
+    }
+}
+
 }
 }
@@ -20,9 +20,15 @@
 #ifndef TBOX_FLOW_FUNCTION_ACTION_H_20221003
 #define TBOX_FLOW_FUNCTION_ACTION_H_20221003
 
+#include <memory>
 #include "../action.h"
 
 namespace tbox {
+
+namespace eventx {
+class ThreadPool;
+}
+
 namespace flow {
 
 class FunctionAction : public Action {
@@ -37,6 +43,7 @@ class FunctionAction : public Action {
     explicit FunctionAction(event::Loop &loop, FuncWithReason &&func);
     explicit FunctionAction(event::Loop &loop, FuncWithVars &&func);
     explicit FunctionAction(event::Loop &loop, FuncWithReasonVars &&func);
+    virtual ~FunctionAction();
 
     virtual bool isReady() const {
         return bool(func_) ||
@@ -50,14 +57,36 @@ class FunctionAction : public Action {
     inline void setFunc(FuncWithVars &&func) { func_with_vars_ = std::move(func); }
     inline void setFunc(FuncWithReasonVars &&func) { func_with_reason_vars_ = std::move(func); }
 
+    /**
+     * 指定线程池，用于执行耗CPU的函数
+     *
+     * 指定后，Func 与 FuncWithReason 类型的函数放到线程池中执行，执行完成后回到 Loop 线程中结束动作，
+     * 不阻塞 Loop。执行期间动作可以被暂停、停止，但函数本身不会被打断，其结果在恢复后才生效。
+     * FuncWithVars 与 FuncWithReasonVars 要访问 vars()，仍在 Loop 线程中执行。
+     *
+     * \warning 函数须是线程安全的；线程池须由本动作所在的 Loop 创建，因为 main_cb 在线程池的 Loop 中执行
+     */
+    inline void setThreadPool(eventx::ThreadPool *thread_pool) { thread_pool_ = thread_pool; }
+
   protected:
     virtual void onStart() override;
+    virtual void onStop() override;
+    virtual void onResume() override;
+    virtual void onReset() override;
+
+  private:
+    struct OffloadTask;
+    void onOffloadTaskDone();
+    void cancelOffloadTask();
 
   private:
     Func func_;
     FuncWithVars   func_with_vars_;
     FuncWithReason func_with_reason_;
     FuncWithReasonVars   func_with_reason_vars_;
+
+    eventx::ThreadPool *thread_pool_ = nullptr;
+    std::shared_ptr<OffloadTask> offload_task_;  //!< 正在线程池中执行的任务
 };
 
 }
@@ -17,13 +17,19 @@
  * project authors may be found in the CONTRIBUTORS.md file in the root
  * of the source tree.
  */
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <gtest/gtest.h>
 #include <tbox/base/json.hpp>
 #include <tbox/event/loop.h>
 #include <tbox/base/scope_exit.hpp>
+#include <tbox/eventx/thread_pool.h>
 
 #include "function_action.h"
 #include "sequence_action.h"
+#include "parallel_action.h"
 
 namespace tbox {
 namespace flow {
@@ -165,5 +171,150 @@ TEST(FunctionAction, WithVars) {
     }
 }
 
+
+//! 在线程池中并行执行耗时的函数，结果回到 Loop 线程
+TEST(FunctionAction, ThreadPool) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([loop] { delete loop; });
+
+    eventx::ThreadPool thread_pool(loop);
+    ASSERT_TRUE(thread_pool.initialize(4, 4));
+    SetScopeExitAction([&thread_pool] { thread_pool.cleanup(); });
+
+    auto loop_thread_id = std::this_thread::get_id();
+    std::atomic_int run_in_worker_num(0);
+
+    //! 每个函数都要等到4个函数同时在执行才返回，串行执行则会超时
+    std::mutex lock;
+    std::condition_variable cond;
+    int running_num = 0;
+    int all_running_num = 0;
+
+    ParallelAction para_action(*loop, ParallelAction::Mode::kNOfM);
+    for (int i = 0; i < 4; ++i) {
+        auto child = new FunctionAction(*loop,
+            [&, i] (Action::Reason &why) {
+                if (std::this_thread::get_id() != loop_thread_id)
+                    ++run_in_worker_num;
+
+                std::unique_lock<std::mutex> lk(lock);
+                ++running_num;
+                cond.notify_all();
+                if (cond.wait_for(lk, std::chrono::seconds(1), [&] { return running_num == 4; }))
+                    ++all_running_num;
+
+                why.code = 1000 + i;
+                return true;
+            }
+        );
+        child->setThreadPool(&thread_pool);
+        para_action.addChild(child);
+    }
+
+    bool is_succ = false;
+    para_action.setFinishCallback(
+        [&] (bool succ, const Action::Reason&, const Action::Trace&) {
+            //! 回到了 Loop 线程
+            EXPECT_EQ(std::this_thread::get_id(), loop_thread_id);
+            is_succ = succ;
+            loop->exitLoop();
+        }
+    );
+
+    para_action.start();
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    EXPECT_TRUE(is_succ);
+    EXPECT_EQ(run_in_worker_num, 4);
+    //! 4个函数是并行执行的
+    EXPECT_EQ(all_running_num, 4);
+}
+
+//! 线程池未初始化，任务放不进去，动作直接失败
+TEST(FunctionAction, ThreadPoolNotReady) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([loop] { delete loop; });
+
+    eventx::ThreadPool thread_pool(loop);
+
+    bool is_func_invoked = false;
+    FunctionAction action(*loop, [&] { is_func_invoked = true; return true; });
+    action.setThreadPool(&thread_pool);
+
+    bool is_finished = false;
+    action.setFinishCallback(
+        [&] (bool is_succ, const Action::Reason &why, const Action::Trace&) {
+            EXPECT_FALSE(is_succ);
+            EXPECT_EQ(why.code, ACTION_REASON_OFFLOAD_FAIL);
+            is_finished = true;
+        }
+    );
+
+    action.start();
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+
+    EXPECT_TRUE(is_finished);
+    EXPECT_FALSE(is_func_invoked);
+    EXPECT_EQ(action.state(), Action::State::kFinished);
+}
+
+//! 在线程池中执行期间被暂停、停止或析构
+TEST(FunctionAction, ThreadPoolPauseStop) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([loop] { delete loop; });
+
+    eventx::ThreadPool thread_pool(loop);
+    ASSERT_TRUE(thread_pool.initialize(2, 2));
+    SetScopeExitAction([&thread_pool] { thread_pool.cleanup(); });
+
+    auto slow_func = [] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return true;
+    };
+
+    //! 暂停期间完成，恢复后才结束
+    FunctionAction action(*loop, slow_func);
+    action.setThreadPool(&thread_pool);
+    int finish_count = 0;
+    action.setFinishCallback(
+        [&] (bool is_succ, const Action::Reason&, const Action::Trace&) {
+            EXPECT_TRUE(is_succ);
+            ++finish_count;
+        }
+    );
+
+    action.start();
+    action.pause();
+    loop->exitLoop(std::chrono::milliseconds(50));
+    loop->runLoop();
+    EXPECT_EQ(action.state(), Action::State::kPause);
+    EXPECT_EQ(finish_count, 0);
+
+    action.resume();
+    loop->exitLoop(std::chrono::milliseconds(10));
+    loop->runLoop();
+    EXPECT_EQ(action.state(), Action::State::kFinished);
+    EXPECT_EQ(finish_count, 1);
+
+    //! 停止后，结果被丢弃
+    action.reset();
+    action.start();
+    action.stop();
+    loop->exitLoop(std::chrono::milliseconds(50));
+    loop->runLoop();
+    EXPECT_EQ(action.state(), Action::State::kStoped);
+    EXPECT_EQ(finish_count, 1);
+
+    //! 执行期间析构
+    auto tmp_action = new FunctionAction(*loop, slow_func);
+    tmp_action->setThreadPool(&thread_pool);
+    tmp_action->start();
+    delete tmp_action;
+    loop->exitLoop(std::chrono::milliseconds(50));
+    loop->runLoop();
+}
+
 }
 }
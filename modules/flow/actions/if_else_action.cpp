@@ -26,8 +26,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 IfElseAction::IfElseAction(event::Loop &loop)
     : SerialAssembleAction(loop, "IfElse")
 { }
@@ -59,22 +57,22 @@ bool IfElseAction::setChildAs(Action *child, const std::string &role) {
         return false;
 
     if (role == "if") {
-        child->setFinishCallback(std::bind(&IfElseAction::onCondActionFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&IfElseAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onCondActionFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(if_action_);
         if_action_ = child;
         return true;
 
     } else if (role == "succ" || role == "then") {
-        child->setFinishCallback(std::bind(&IfElseAction::onLastChildFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&IfElseAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(then_action_);
         then_action_ = child;
         return true;
 
     } else if (role == "fail" || role == "else") {
-        child->setFinishCallback(std::bind(&IfElseAction::onLastChildFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&IfElseAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(else_action_);
         else_action_ = child;
         return true;
@@ -29,8 +29,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 IfThenAction::IfThenAction(event::Loop &loop)
     : SerialAssembleAction(loop, "IfThen")
 { }
@@ -84,8 +82,8 @@ int IfThenAction::addChildAs(Action *child, const std::string &role) {
         if (!child->setParent(this))
             return -1;
 
-        child->setFinishCallback(std::bind(&IfThenAction::onIfActionFinished, this, _1));
-        child->setBlockCallback(std::bind(&IfThenAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &, const Trace &) { onIfActionFinished(is_succ); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         tmp_.first = child;
 
         //! 先不处理，等到了then之后再加到if_then_actions_
@@ -103,8 +101,8 @@ int IfThenAction::addChildAs(Action *child, const std::string &role) {
         if (!child->setParent(this))
             return -1;
 
-        child->setFinishCallback(std::bind(&IfThenAction::onLastChildFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&IfThenAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         tmp_.second = child;
 
         auto index = if_then_actions_.size();
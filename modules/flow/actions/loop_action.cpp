@@ -24,8 +24,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 LoopAction::LoopAction(event::Loop &loop, Mode mode)
   : SerialAssembleAction(loop, "Loop")
   , mode_(mode)
@@ -41,8 +39,8 @@ LoopAction::LoopAction(event::Loop &loop, Action *child, Mode mode)
     TBOX_ASSERT(is_set_parent_ok);
     UNUSED_VAR(is_set_parent_ok);
 
-    child_->setFinishCallback(std::bind(&LoopAction::onChildFinished, this, _1, _2, _3));
-    child_->setBlockCallback(std::bind(&LoopAction::block, this, _1, _2));
+    child_->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child_->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 }
 
 LoopAction::~LoopAction() {
@@ -64,8 +62,8 @@ bool LoopAction::setChild(Action *child) {
     if (!child->setParent(this))
         return false;
 
-    child->setFinishCallback(std::bind(&LoopAction::onChildFinished, this, _1, _2, _3));
-    child->setBlockCallback(std::bind(&LoopAction::block, this, _1, _2));
+    child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
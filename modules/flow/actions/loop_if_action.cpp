@@ -25,8 +25,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 LoopIfAction::LoopIfAction(event::Loop &loop)
   : SerialAssembleAction(loop, "LoopIf")
 { }
@@ -54,15 +52,15 @@ bool LoopIfAction::setChildAs(Action *child, const std::string &role) {
         return false;
 
     if (role == "if") {
-        child->setFinishCallback(std::bind(&LoopIfAction::onIfFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&LoopIfAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onIfFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(if_action_);
         if_action_ = child;
         return true;
 
     } else if (role == "exec") {
-        child->setFinishCallback(std::bind(&LoopIfAction::onExecFinished, this, _2, _3));
-        child->setBlockCallback(std::bind(&LoopIfAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool, const Reason &why, const Trace &trace) { onExecFinished(why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(exec_action_);
         exec_action_ = child;
         return true;
@@ -27,8 +27,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 ParallelAction::ParallelAction(event::Loop &loop, Mode mode)
   : AssembleAction(loop, "Parallel")
   , mode_(mode)
@@ -48,6 +46,12 @@ void ParallelAction::toJson(Json &js) const {
         js_children.push_back(std::move(js_child));
     }
     js["mode"] = ToString(mode_);
+    if (mode_ == Mode::kNOfM)
+        js["required_succ_num"] = required_succ_num_;
+    if (max_concurrency_ != 0) {
+        js["max_concurrency"] = max_concurrency_;
+        js["running_num"] = running_num_;
+    }
 }
 
 int ParallelAction::addChild(Action *action) {
@@ -59,8 +63,8 @@ int ParallelAction::addChild(Action *action) {
 
     if (action->setParent(this)) {
         int index = children_.size();
-        action->setFinishCallback(std::bind(&ParallelAction::onChildFinished, this, index, _1));
-        action->setBlockCallback(std::bind(&ParallelAction::onChildBlocked, this, index, _1, _2));
+        action->setFinishCallback([this, index] (bool is_succ, const Reason &, const Trace &) { onChildFinished(index, is_succ); });
+        action->setBlockCallback([this, index] (const Reason &why, const Trace &trace) { onChildBlocked(index, why, trace); });
         children_.push_back(action);
         return index;
 
@@ -81,22 +85,17 @@ bool ParallelAction::isReady() const {
 void ParallelAction::onStart() {
     AssembleAction::onStart();
 
-    for (size_t index = 0; index < children_.size(); ++index) {
-        Action *action = children_.at(index);
-        if (!action->start()) {
-            finished_children_[index] = false;
-            //! 如果是任一失败都退出，那么要直接结束
-            if (mode_ == Mode::kAnyFail) {
-                finish(true);
-                stopAllActions();
-                return;
-            }
-        }
+    next_index_ = 0;
+    running_num_ = 0;
+    succ_num_ = 0;
+
+    //! 没有子动作，直接结束
+    if (children_.empty()) {
+        finish(mode_ != Mode::kNOfM || required_succ_num_ == 0);
+        return;
     }
 
-    //! 如果全部都启动失败了，那么就直接结束
-    if (finished_children_.size() == children_.size())
-        finish(true);
+    startPendingActions();
 }
 
 void ParallelAction::onStop() {
@@ -122,6 +121,9 @@ void ParallelAction::onReset() {
     for (auto child : children_)
         child->reset();
 
+    next_index_ = 0;
+    running_num_ = 0;
+    succ_num_ = 0;
     finished_children_.clear();
     AssembleAction::onReset();
 }
@@ -134,22 +136,64 @@ void ParallelAction::stopAllActions() {
 
 void ParallelAction::pauseAllActions() {
     for (Action *action : children_) {
-        action->pause();
+        if (action->state() == State::kRunning)
+            action->pause();
     }
 }
 
-void ParallelAction::onChildFinished(int index, bool is_succ) {
-    if (state() == State::kRunning) {
-        finished_children_[index] = is_succ;
+void ParallelAction::startPendingActions() {
+    while (next_index_ < children_.size() &&
+           (max_concurrency_ == 0 || running_num_ < max_concurrency_)) {
+        int index = next_index_++;
+        if (children_.at(index)->start()) {
+            ++running_num_;
+
+        } else if (handleChildResult(index, false)) {
+            return;
+        }
+    }
+}
+
+bool ParallelAction::handleChildResult(int index, bool is_succ) {
+    finished_children_[index] = is_succ;
+    if (is_succ)
+        ++succ_num_;
 
-        if ((mode_ == Mode::kAnySucc && is_succ) ||
-            (mode_ == Mode::kAnyFail && !is_succ)) {
-            stopAllActions();
-            finish(true);
+    bool is_finished = false;
+    bool is_finish_succ = true;
 
-        } else if (finished_children_.size() == children_.size()) {
-            finish(true);
+    if (mode_ == Mode::kNOfM) {
+        size_t total_num = children_.size();
+        size_t required_num = required_succ_num_ == 0 ? total_num : required_succ_num_;
+        size_t fail_num = finished_children_.size() - succ_num_;
+
+        if (succ_num_ >= required_num) {
+            is_finished = true;
+
+        } else if (total_num - fail_num < required_num) {
+            //! 剩下的全部成功也不够了
+            is_finished = true;
+            is_finish_succ = false;
         }
+
+    } else if ((mode_ == Mode::kAnySucc && is_succ) ||
+               (mode_ == Mode::kAnyFail && !is_succ) ||
+               finished_children_.size() == children_.size()) {
+        is_finished = true;
+    }
+
+    if (is_finished) {
+        stopAllActions();
+        finish(is_finish_succ);
+    }
+    return is_finished;
+}
+
+void ParallelAction::onChildFinished(int index, bool is_succ) {
+    if (state() == State::kRunning) {
+        --running_num_;
+        if (!handleChildResult(index, is_succ))
+            startPendingActions();
     }
 }
 
@@ -161,7 +205,7 @@ void ParallelAction::onChildBlocked(int, const Reason &why, const Trace &trace)
 }
 
 std::string ParallelAction::ToString(Mode mode) {
-    const char *tbl[] = { "AllFinish", "AnyFail", "AnySucc" };
+    const char *tbl[] = { "AllFinish", "AnyFail", "AnySucc", "NOfM" };
 
     auto index = static_cast<size_t>(mode);
     if (index < NUMBER_OF_ARRAY(tbl))
@@ -30,6 +30,14 @@ namespace flow {
 
 /**
  * 并行动作
+ *
+ * 默认同时启动所有子动作。子动作很多时，可用 setMaxConcurrency() 限制同时运行的个数，
+ * 其余的子动作排队，有子动作结束时再依次启动。
+ *
+ * 结束条件由 Mode 决定，其中 kNOfM 在 M 个子动作中有 N 个成功时成功，已不可能有 N 个成功时失败，
+ * N 由 setRequiredSuccNum() 指定：N 为 1 即任一成功，N 为 0 或 M 即全部成功。
+ *
+ * 如果子动作是耗CPU的 FunctionAction，可以用 FunctionAction::setThreadPool() 让它们在线程池中并行执行。
  */
 class ParallelAction : public AssembleAction {
   public:
@@ -38,6 +46,7 @@ class ParallelAction : public AssembleAction {
       kAllFinish, //!< 全部结束
       kAnyFail,   //!< 任一失败
       kAnySucc,   //!< 任一成功
+      kNOfM,      //!< N个成功
     };
 
     explicit ParallelAction(event::Loop &loop, Mode mode = Mode::kAllFinish);
@@ -49,6 +58,10 @@ class ParallelAction : public AssembleAction {
     virtual bool isReady() const override;
 
     inline void setMode(Mode mode) { mode_ = mode; }
+    //! 设置最多同时运行的子动作个数，0表示不限制。须在 start() 之前设置
+    inline void setMaxConcurrency(size_t max_concurrency) { max_concurrency_ = max_concurrency; }
+    //! 设置 kNOfM 模式下需要成功的个数，0表示全部
+    inline void setRequiredSuccNum(size_t succ_num) { required_succ_num_ = succ_num; }
 
     using FinishedChildren = std::map<int, bool>;
 
@@ -67,13 +80,23 @@ class ParallelAction : public AssembleAction {
     void stopAllActions();
     void pauseAllActions();
 
+    //! 在并发数的限制内启动排队的子动作
+    void startPendingActions();
+    //! 记录子动作的结果，并检查是否达到结束条件，返回是否已结束
+    bool handleChildResult(int index, bool is_succ);
+
     void onChildFinished(int index, bool is_succ);
     void onChildBlocked(int index, const Reason &why, const Trace &trace);
 
   private:
     Mode mode_;
     std::vector<Action*> children_;
+    size_t max_concurrency_ = 0;
+    size_t required_succ_num_ = 0;
 
+    size_t next_index_ = 0;     //!< 下一个要启动的子动作
+    size_t running_num_ = 0;    //!< 正在运行的子动作个数
+    size_t succ_num_ = 0;       //!< 已成功的子动作个数
     FinishedChildren finished_children_;
 };
 
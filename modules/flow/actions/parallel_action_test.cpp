@@ -232,5 +232,125 @@ TEST(ParallelAction, Block) {
     EXPECT_EQ(ta3->state(), Action::State::kPause);
 }
 
+
+namespace {
+
+//! 由测试用例手动结束的动作，并统计同时运行的个数
+class ManualAction : public Action {
+  public:
+    ManualAction(event::Loop &loop, int &running_num, int &max_running_num) :
+        Action(loop, "Manual"), running_num_(running_num), max_running_num_(max_running_num) { }
+
+    virtual bool isReady() const override { return true; }
+
+    void done(bool is_succ) { finish(is_succ); }
+
+  protected:
+    virtual void onStart() override {
+        Action::onStart();
+        if (++running_num_ > max_running_num_)
+            max_running_num_ = running_num_;
+    }
+    virtual void onFinal() override { --running_num_; }
+
+  private:
+    int &running_num_;
+    int &max_running_num_;
+};
+
+}
+
+TEST(ParallelAction, MaxConcurrency) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([loop] { delete loop; });
+
+    int running_num = 0, max_running_num = 0;
+    ParallelAction para_action(*loop);
+    para_action.setMaxConcurrency(3);
+
+    std::vector<ManualAction*> children;
+    for (int i = 0; i < 10; ++i) {
+        auto child = new ManualAction(*loop, running_num, max_running_num);
+        para_action.addChild(child);
+        children.push_back(child);
+    }
+
+    bool is_finished = false;
+    para_action.setFinishCallback(
+        [&] (bool is_succ, const Action::Reason&, const Action::Trace&) {
+            EXPECT_TRUE(is_succ);
+            is_finished = true;
+        }
+    );
+
+    para_action.start();
+    EXPECT_EQ(running_num, 3);
+    EXPECT_EQ(children[3]->state(), Action::State::kIdle);
+
+    //! 逐个结束，排队的子动作依次启动
+    for (auto child : children) {
+        child->done(child != children.front());
+        loop->exitLoop(std::chrono::milliseconds(10));
+        loop->runLoop();
+    }
+
+    EXPECT_TRUE(is_finished);
+    EXPECT_EQ(max_running_num, 3);
+    EXPECT_EQ(para_action.getFinishedChildren().size(), 10u);
+    EXPECT_FALSE(para_action.getFinishedChildren().at(0));
+}
+
+TEST(ParallelAction, NOfM) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([loop] { delete loop; });
+
+    //! 子动作的结果依次为：失败 成功 失败 成功 成功
+    const bool results[] = { false, true, false, true, true };
+
+    //! {N, 结束时是否成功, 结束时已结束的子动作个数}
+    struct { size_t n; bool is_succ; size_t finished_num; } cases[] = {
+        { 1, true,  2 },
+        { 2, true,  4 },
+        { 3, true,  5 },
+        { 4, false, 3 },
+        { 0, false, 1 },
+    };
+
+    for (auto &c : cases) {
+        int running_num = 0, max_running_num = 0;
+        ParallelAction para_action(*loop, ParallelAction::Mode::kNOfM);
+        para_action.setRequiredSuccNum(c.n);
+        para_action.setMaxConcurrency(1);   //! 保证按顺序结束
+
+        std::vector<ManualAction*> children;
+        for (size_t i = 0; i < NUMBER_OF_ARRAY(results); ++i) {
+            auto child = new ManualAction(*loop, running_num, max_running_num);
+            para_action.addChild(child);
+            children.push_back(child);
+        }
+
+        bool is_finished = false;
+        bool is_succ = false;
+        para_action.setFinishCallback(
+            [&] (bool succ, const Action::Reason&, const Action::Trace&) {
+                is_finished = true;
+                is_succ = succ;
+            }
+        );
+
+        para_action.start();
+        for (size_t i = 0; i < children.size() && !is_finished; ++i) {
+            children[i]->done(results[i]);
+            loop->exitLoop(std::chrono::milliseconds(10));
+            loop->runLoop();
+        }
+
+        EXPECT_TRUE(is_finished) << "n:" << c.n;
+        EXPECT_EQ(is_succ, c.is_succ) << "n:" << c.n;
+        EXPECT_EQ(para_action.getFinishedChildren().size(), c.finished_num) << "n:" << c.n;
+        EXPECT_EQ(running_num, 0);
+    }
+}
+
 }
 }
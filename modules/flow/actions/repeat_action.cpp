@@ -24,8 +24,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 RepeatAction::RepeatAction(event::Loop &loop)
   : SerialAssembleAction(loop, "Repeat")
 { }
@@ -47,8 +45,8 @@ RepeatAction::RepeatAction(event::Loop &loop, Action *child, size_t times, Mode
     TBOX_ASSERT(is_set_parent_ok);
     UNUSED_VAR(is_set_parent_ok);
 
-    child_->setFinishCallback(std::bind(&RepeatAction::onChildFinished, this, _1, _2, _3));
-    child_->setBlockCallback(std::bind(&RepeatAction::block, this, _1, _2));
+    child_->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child_->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 }
 
 RepeatAction::~RepeatAction() {
@@ -73,8 +71,8 @@ bool RepeatAction::setChild(Action *child) {
     if (!child->setParent(this))
         return false;
 
-    child->setFinishCallback(std::bind(&RepeatAction::onChildFinished, this, _1, _2, _3));
-    child->setBlockCallback(std::bind(&RepeatAction::block, this, _1, _2));
+    child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
@@ -27,8 +27,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 SequenceAction::SequenceAction(event::Loop &loop, Mode mode)
   : SerialAssembleAction(loop, "Sequence")
   , mode_(mode)
@@ -64,8 +62,8 @@ int SequenceAction::addChild(Action *child) {
         return false;
 
     int index = children_.size();
-    child->setFinishCallback(std::bind(&SequenceAction::onChildFinished, this, _1, _2, _3));
-    child->setBlockCallback(std::bind(&SequenceAction::block, this, _1, _2));
+    child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
     children_.push_back(child);
 
     return index;
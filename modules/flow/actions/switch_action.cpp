@@ -27,8 +27,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 SwitchAction::SwitchAction(event::Loop &loop)
     : SerialAssembleAction(loop, "Switch")
 { }
@@ -69,15 +67,15 @@ bool SwitchAction::setChildAs(Action *child, const std::string &role) {
         return false;
 
     if (role == "switch") {
-        child->setFinishCallback(std::bind(&SwitchAction::onSwitchActionFinished, this, _1, _2));
-        child->setBlockCallback(std::bind(&SwitchAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &) { onSwitchActionFinished(is_succ, why); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(switch_action_);
         switch_action_ = child;
         return true;
 
     } else if (role == "default") {
-        child->setFinishCallback(std::bind(&SwitchAction::onLastChildFinished, this, _1, _2, _3));
-        child->setBlockCallback(std::bind(&SwitchAction::block, this, _1, _2));
+        child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+        child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
         CHECK_DELETE_RESET_OBJ(default_action_);
         default_action_ = child;
         return true;
@@ -85,8 +83,8 @@ bool SwitchAction::setChildAs(Action *child, const std::string &role) {
     } else if (util::string::IsStartWith(role, "case:")) {
         auto result = case_actions_.emplace(role, child);
         if (result.second) {
-            child->setFinishCallback(std::bind(&SwitchAction::onLastChildFinished, this, _1, _2, _3));
-            child->setBlockCallback(std::bind(&SwitchAction::block, this, _1, _2));
+            child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onLastChildFinished(is_succ, why, trace); });
+            child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
             return true;
         }
     }
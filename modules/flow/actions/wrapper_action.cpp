@@ -25,8 +25,6 @@
 namespace tbox {
 namespace flow {
 
-using namespace std::placeholders;
-
 WrapperAction::WrapperAction(event::Loop &loop, Mode mode)
   : SerialAssembleAction(loop, "Wrapper")
   , mode_(mode)
@@ -42,8 +40,8 @@ WrapperAction::WrapperAction(event::Loop &loop, Action *child, Mode mode)
     TBOX_ASSERT(is_set_parent_ok);
     UNUSED_VAR(is_set_parent_ok);
 
-    child_->setFinishCallback(std::bind(&WrapperAction::onChildFinished, this, _1, _2, _3));
-    child_->setBlockCallback(std::bind(&WrapperAction::block, this, _1, _2));
+    child_->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child_->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 }
 
 WrapperAction::~WrapperAction() {
@@ -67,8 +65,8 @@ bool WrapperAction::setChild(Action *child) {
     if (!child->setParent(this))
         return false;
 
-    child->setFinishCallback(std::bind(&WrapperAction::onChildFinished, this, _1, _2, _3));
-    child->setBlockCallback(std::bind(&WrapperAction::block, this, _1, _2));
+    child->setFinishCallback([this] (bool is_succ, const Reason &why, const Trace &trace) { onChildFinished(is_succ, why, trace); });
+    child->setBlockCallback([this] (const Reason &why, const Trace &trace) { block(why, trace); });
 
     CHECK_DELETE_RESET_OBJ(child_);
     child_ = child;
@@ -20,6 +20,7 @@
 #ifndef TBOX_FLOW_EVENT_PUBLISHER_H_20221001
 #define TBOX_FLOW_EVENT_PUBLISHER_H_20221001
 
+#include <cstddef>
 #include "event.h"
 
 namespace tbox {
@@ -29,10 +30,29 @@ class EventSubscriber;
 
 class EventPublisher {
   public:
+    //! 订阅所有事件
     virtual void subscribe(EventSubscriber *subscriber) = 0;
+    //! 取消该订阅者的所有订阅
     virtual void unsubscribe(EventSubscriber *subscriber) = 0;
     virtual void publish(Event event) = 0;
 
+    /**
+     * 只订阅指定的事件
+     *
+     * 发布者可据此只通知关心该事件的订阅者，同一订阅者可多次调用以订阅多个事件。
+     * 默认实现退化为订阅所有事件，由订阅者自行过滤
+     */
+    virtual void subscribe(EventSubscriber *subscriber, Event::ID event_id) {
+        subscribe(subscriber);
+        (void)event_id;
+    }
+
+    //! 批量发布，依次发布 events 中的 num 个事件
+    virtual void publish(const Event *events, size_t num) {
+        for (size_t i = 0; i < num; ++i)
+            publish(events[i]);
+    }
+
   protected:
     virtual ~EventPublisher() { }
 };
@@ -19,43 +19,235 @@
  */
 #include "event_publisher_impl.h"
 
-#include <algorithm>
-#include "event_subscriber.h"
 #include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+
+#include "event_subscriber.h"
 
 namespace tbox {
 namespace flow {
 
+struct EventPublisherImpl::Node {
+  EventSubscriber *subscriber = nullptr;  //!< 为nullptr表示已取消订阅，待释放
+  bool is_any = false;
+  Event::ID event_id = 0;
+  uint64_t seq = 0;     //!< 订阅序号，越大越晚订阅
+
+  Node *prev = nullptr;
+  Node *next = nullptr;
+  Node *sibling = nullptr;  //!< 同一订阅者的下一个节点；取消订阅后，用于串起待释放或空闲的节点
+};
+
+EventPublisherImpl::EventPublisherImpl(event::Loop *wp_loop)
+  : wp_loop_(wp_loop)
+{ }
+
+EventPublisherImpl::~EventPublisherImpl() {
+  TBOX_ASSERT(publish_depth_ == 0);
+
+  if (flush_run_id_ != 0)
+    wp_loop_->cancel(flush_run_id_);
+
+  auto delete_list = [] (List &list) {
+    auto node = list.head;
+    while (node != nullptr) {
+      auto next = node->next;
+      delete node;
+      node = next;
+    }
+  };
+
+  delete_list(any_list_);
+  for (auto &item : id_lists_)
+    delete_list(item.second);
+
+  while (free_nodes_ != nullptr) {
+    auto next = free_nodes_->sibling;
+    delete free_nodes_;
+    free_nodes_ = next;
+  }
+}
+
 void EventPublisherImpl::subscribe(EventSubscriber *subscriber) {
-  auto iter_end = subscriber_vec_.end();
-  auto iter = std::remove(subscriber_vec_.begin(), iter_end, subscriber);
-  if (iter == iter_end) {
-    subscriber_vec_.push_back(subscriber);
+  TBOX_ASSERT(subscriber != nullptr);
+
+  auto iter = subscriber_map_.find(subscriber);
+  if (iter != subscriber_map_.end()) {
+    if (iter->second->is_any)
+      return;
+    //! 之前只订阅了部分事件，现在改为订阅所有事件
+    unsubscribe(subscriber);
   }
+
+  addNode(subscriber, true, 0);
 }
 
-void EventPublisherImpl::unsubscribe(EventSubscriber *subscriber) {
-  {
-    auto iter_end = subscriber_vec_.end();
-    auto iter = std::remove(subscriber_vec_.begin(), iter_end, subscriber);
-    subscriber_vec_.erase(iter, iter_end);
+void EventPublisherImpl::subscribe(EventSubscriber *subscriber, Event::ID event_id) {
+  TBOX_ASSERT(subscriber != nullptr);
+
+  auto iter = subscriber_map_.find(subscriber);
+  if (iter != subscriber_map_.end()) {
+    for (auto node = iter->second; node != nullptr; node = node->sibling) {
+      //! 已订阅了所有事件，或已订阅了该事件
+      if (node->is_any || node->event_id == event_id)
+        return;
+    }
   }
-  {
-    auto iter_end = tmp_vec_.end();
-    auto iter = std::remove(tmp_vec_.begin(), iter_end, subscriber);
-    tmp_vec_.erase(iter, iter_end);
+
+  addNode(subscriber, false, event_id);
+}
+
+void EventPublisherImpl::unsubscribe(EventSubscriber *subscriber) {
+  auto iter = subscriber_map_.find(subscriber);
+  if (iter == subscriber_map_.end())
+    return;
+
+  auto node = iter->second;
+  subscriber_map_.erase(iter);
+
+  while (node != nullptr) {
+    auto sibling = node->sibling;
+    removeNode(node);
+    node = sibling;
   }
 }
 
 void EventPublisherImpl::publish(Event event) {
-  auto tmp_vec_ = subscriber_vec_;
-  while (!tmp_vec_.empty()) {
-    auto top_subscriber = tmp_vec_.back();
-    if (top_subscriber->onEvent(event))
+  ++publish_depth_;
+  publishOne(event);
+  if (--publish_depth_ == 0)
+    collectGarbage();
+}
+
+void EventPublisherImpl::publish(const Event *events, size_t num) {
+  ++publish_depth_;
+  for (size_t i = 0; i < num; ++i)
+    publishOne(events[i]);
+  if (--publish_depth_ == 0)
+    collectGarbage();
+}
+
+void EventPublisherImpl::post(Event event) {
+  TBOX_ASSERT(wp_loop_ != nullptr);
+
+  posted_events_.push_back(event);
+  if (flush_run_id_ == 0)
+    flush_run_id_ = wp_loop_->runNext([this] { flushPosted(); }, "EventPublisherImpl::post");
+}
+
+void EventPublisherImpl::addNode(EventSubscriber *subscriber, bool is_any, Event::ID event_id) {
+  auto node = allocNode();
+  node->subscriber = subscriber;
+  node->is_any = is_any;
+  node->event_id = event_id;
+  node->seq = next_seq_++;
+
+  auto &list = is_any ? any_list_ : id_lists_[event_id];
+  node->prev = list.tail;
+  if (list.tail != nullptr)
+    list.tail->next = node;
+  else
+    list.head = node;
+  list.tail = node;
+
+  auto &first = subscriber_map_[subscriber];
+  node->sibling = first;
+  first = node;
+}
+
+void EventPublisherImpl::removeNode(Node *node) {
+  //! 正在发布的过程中，不能将节点从链表中移除，以免打断遍历，先标记，待发布完成后再释放
+  if (publish_depth_ > 0) {
+    node->subscriber = nullptr;
+    node->sibling = garbage_nodes_;
+    garbage_nodes_ = node;
+    return;
+  }
+
+  auto iter = id_lists_.end();
+  List *list = &any_list_;
+  if (!node->is_any) {
+    iter = id_lists_.find(node->event_id);
+    TBOX_ASSERT(iter != id_lists_.end());
+    list = &iter->second;
+  }
+
+  if (node->prev != nullptr)
+    node->prev->next = node->next;
+  else
+    list->head = node->next;
+
+  if (node->next != nullptr)
+    node->next->prev = node->prev;
+  else
+    list->tail = node->prev;
+
+  if (list->head == nullptr && iter != id_lists_.end())
+    id_lists_.erase(iter);
+
+  freeNode(node);
+}
+
+void EventPublisherImpl::publishOne(const Event &event) {
+  //! 在此之后订阅的，不接收本事件
+  auto seq_limit = next_seq_;
+
+  //! id_lists_ 中的元素在发布过程中不会被删除，指针一直有效
+  auto iter = id_lists_.find(event.id);
+  Node *any_node = any_list_.tail;
+  Node *id_node = (iter != id_lists_.end()) ? iter->second.tail : nullptr;
+
+  //! 从后往前，按订阅的先后合并两条链表，后订阅的先通知
+  while (any_node != nullptr || id_node != nullptr) {
+    Node *node = nullptr;
+    if (id_node == nullptr || (any_node != nullptr && any_node->seq > id_node->seq)) {
+      node = any_node;
+      any_node = any_node->prev;
+    } else {
+      node = id_node;
+      id_node = id_node->prev;
+    }
+
+    if (node->subscriber == nullptr || node->seq >= seq_limit)
+      continue;
+
+    if (node->subscriber->onEvent(event))
       break;
-    tmp_vec_.pop_back();
   }
-  tmp_vec_.clear();
+}
+
+void EventPublisherImpl::flushPosted() {
+  flush_run_id_ = 0;
+  //! 交换出来再发布，以便在发布过程中 post() 的事件留到下一次
+  publishing_events_.swap(posted_events_);
+  publish(publishing_events_.data(), publishing_events_.size());
+  publishing_events_.clear();
+}
+
+void EventPublisherImpl::collectGarbage() {
+  auto node = garbage_nodes_;
+  garbage_nodes_ = nullptr;
+
+  while (node != nullptr) {
+    auto next = node->sibling;
+    removeNode(node);
+    node = next;
+  }
+}
+
+EventPublisherImpl::Node* EventPublisherImpl::allocNode() {
+  if (free_nodes_ == nullptr)
+    return new Node;
+
+  auto node = free_nodes_;
+  free_nodes_ = node->sibling;
+  return node;
+}
+
+void EventPublisherImpl::freeNode(Node *node) {
+  *node = Node();
+  node->sibling = free_nodes_;
+  free_nodes_ = node;
 }
 
 }
@@ -21,23 +21,81 @@
 #define TBOX_FLOW_EVENT_PUBLISHER_H_20221002
 
 #include <vector>
+#include <unordered_map>
+#include <tbox/base/defines.h>
+#include <tbox/event/loop.h>
+
 #include "event_publisher.h"
 
 namespace tbox {
 namespace flow {
 
+/**
+ * 事件发布者的默认实现
+ *
+ * 按事件ID建立订阅索引，发布事件时只通知订阅了该事件的订阅者与订阅了所有事件的订阅者，
+ * 而不必遍历所有订阅者。通知顺序为后订阅的先通知，一旦某订阅者的 onEvent() 返回 true，
+ * 表示该事件已被处理，不再通知其它订阅者。
+ *
+ * 允许在 onEvent() 中订阅、取消订阅及发布事件：
+ * - 发布过程中取消订阅的订阅者，不会再被通知；
+ * - 发布过程中新订阅的订阅者，从下一个事件开始才会被通知。
+ *
+ * 如果构造时指定了 Loop，还可以用 post() 将事件暂存起来，在下一次 Loop 循环中一并发布。
+ */
 class EventPublisherImpl : public EventPublisher {
+  public:
+    explicit EventPublisherImpl(event::Loop *wp_loop = nullptr);
+    virtual ~EventPublisherImpl();
+
+    NONCOPYABLE(EventPublisherImpl);
+    IMMOVABLE(EventPublisherImpl);
+
   public:
     virtual void subscribe(EventSubscriber *subscriber) override;
+    virtual void subscribe(EventSubscriber *subscriber, Event::ID event_id) override;
     virtual void unsubscribe(EventSubscriber *subscriber) override;
     virtual void publish(Event event) override;
+    virtual void publish(const Event *events, size_t num) override;
+
+    //! 暂存事件，在下一次 Loop 循环中与其它暂存的事件一并发布。须在构造时指定了 Loop
+    void post(Event event);
+
+    size_t subscriberNumber() const { return subscriber_map_.size(); }
 
   private:
-    std::vector<EventSubscriber*> subscriber_vec_;
-    std::vector<EventSubscriber*> tmp_vec_;
-};
+    struct Node;
+
+    struct List {
+        Node *head = nullptr;
+        Node *tail = nullptr;
+    };
 
+    void addNode(EventSubscriber *subscriber, bool is_any, Event::ID event_id);
+    void removeNode(Node *node);
+    void publishOne(const Event &event);
+    void flushPosted();
+    void collectGarbage();
 
+    Node* allocNode();
+    void freeNode(Node *node);
+
+  private:
+    event::Loop *wp_loop_;
+
+    List any_list_;                                 //!< 订阅了所有事件的
+    std::unordered_map<Event::ID, List> id_lists_;  //!< 事件ID -> 订阅了该事件的
+    std::unordered_map<EventSubscriber*, Node*> subscriber_map_;    //!< 订阅者 -> 其订阅链表
+
+    uint64_t next_seq_ = 0;
+    int publish_depth_ = 0;         //!< 发布嵌套深度，不为0时不能释放节点
+    Node *garbage_nodes_ = nullptr; //!< 发布过程中取消订阅的，待发布完成后释放
+    Node *free_nodes_ = nullptr;    //!< 空闲节点，循环使用
+
+    std::vector<Event> posted_events_;
+    std::vector<Event> publishing_events_;
+    event::Loop::RunId flush_run_id_ = 0;
+};
 
 }
 }
@@ -18,3 +18,219 @@
  * of the source tree.
  */
 
+#include <chrono>
+#include <iostream>
+#include <functional>
+#include <gtest/gtest.h>
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+
+#include "event_publisher_impl.h"
+#include "event_subscriber.h"
+
+namespace tbox {
+namespace flow {
+
+namespace {
+
+class TestSubscriber : public EventSubscriber {
+  public:
+    using Func = std::function<bool(Event)>;
+
+    TestSubscriber() { }
+    explicit TestSubscriber(const Func &func) : func_(func) { }
+
+    void setFunc(const Func &func) { func_ = func; }
+
+    virtual bool onEvent(Event event) override {
+      received.push_back(event.id);
+      return func_ ? func_(event) : false;
+    }
+
+    std::vector<Event::ID> received;
+
+  private:
+    Func func_;
+};
+
+}
+
+//! 后订阅的先通知，被处理后不再往下传
+TEST(EventPublisherImpl, OrderAndConsume) {
+  EventPublisherImpl pub;
+  std::vector<int> order;
+  TestSubscriber s1([&] (Event) { order.push_back(1); return false; });
+  TestSubscriber s2([&] (Event) { order.push_back(2); return false; });
+  TestSubscriber s3([&] (Event e) { order.push_back(3); return e.id == 100; });
+
+  pub.subscribe(&s1);
+  pub.subscribe(&s2, 100);
+  pub.subscribe(&s2, 101);
+  pub.subscribe(&s3);
+  pub.subscribe(&s3);   //! 重复订阅无效
+  EXPECT_EQ(pub.subscriberNumber(), 3u);
+
+  pub.publish(100);
+  EXPECT_EQ(order, std::vector<int>({3}));
+
+  order.clear();
+  pub.publish(101);
+  EXPECT_EQ(order, std::vector<int>({3, 2, 1}));
+
+  order.clear();
+  pub.publish(102);
+  EXPECT_EQ(order, std::vector<int>({3, 1}));
+
+  pub.unsubscribe(&s3);
+  order.clear();
+  pub.publish(100);
+  EXPECT_EQ(order, std::vector<int>({2, 1}));
+}
+
+//! 只订阅了部分事件的订阅者，不应收到其它事件
+TEST(EventPublisherImpl, IdIndex) {
+  EventPublisherImpl pub;
+  TestSubscriber s1, s2, s_any;
+  pub.subscribe(&s1, 1);
+  pub.subscribe(&s2, 2);
+  pub.subscribe(&s2, 3);
+  pub.subscribe(&s_any);
+
+  for (int id = 0; id < 5; ++id)
+    pub.publish(id);
+
+  EXPECT_EQ(s1.received, std::vector<Event::ID>({1}));
+  EXPECT_EQ(s2.received, std::vector<Event::ID>({2, 3}));
+  EXPECT_EQ(s_any.received, std::vector<Event::ID>({0, 1, 2, 3, 4}));
+
+  //! 改为订阅所有事件
+  pub.subscribe(&s1);
+  s1.received.clear();
+  pub.publish(1);
+  pub.publish(2);
+  EXPECT_EQ(s1.received, std::vector<Event::ID>({1, 2}));
+}
+
+//! 在 onEvent() 中取消订阅其它订阅者，被取消的不应再收到事件
+TEST(EventPublisherImpl, UnsubscribeDuringPublish) {
+  EventPublisherImpl pub;
+  TestSubscriber s1, s2, s3;
+  s3.setFunc([&] (Event) {
+    pub.unsubscribe(&s3);
+    pub.unsubscribe(&s2);
+    return false;
+  });
+
+  pub.subscribe(&s1, 1);
+  pub.subscribe(&s2, 1);
+  pub.subscribe(&s3);
+
+  pub.publish(1);
+  EXPECT_EQ(s3.received.size(), 1u);
+  EXPECT_TRUE(s2.received.empty());
+  EXPECT_EQ(s1.received.size(), 1u);
+  EXPECT_EQ(pub.subscriberNumber(), 1u);
+
+  pub.publish(1);
+  EXPECT_EQ(s3.received.size(), 1u);
+  EXPECT_EQ(s1.received.size(), 2u);
+}
+
+//! 在 onEvent() 中新订阅的，从下一个事件开始才收到
+TEST(EventPublisherImpl, SubscribeDuringPublish) {
+  EventPublisherImpl pub;
+  TestSubscriber s1, s2;
+  s1.setFunc([&] (Event) {
+    pub.subscribe(&s2, 1);
+    return false;
+  });
+  pub.subscribe(&s1);
+
+  Event events[] = {1, 1, 2};
+  pub.publish(events, 3);
+
+  EXPECT_EQ(s1.received, std::vector<Event::ID>({1, 1, 2}));
+  EXPECT_EQ(s2.received, std::vector<Event::ID>({1}));
+}
+
+//! 订阅者在 onEvent() 中取消自己的订阅后马上重新订阅
+TEST(EventPublisherImpl, ResubscribeDuringPublish) {
+  EventPublisherImpl pub;
+  TestSubscriber s1;
+  s1.setFunc([&] (Event) {
+    pub.unsubscribe(&s1);
+    pub.subscribe(&s1, 1);
+    return false;
+  });
+  pub.subscribe(&s1, 1);
+
+  pub.publish(1);
+  pub.publish(1);
+  EXPECT_EQ(s1.received.size(), 2u);
+  EXPECT_EQ(pub.subscriberNumber(), 1u);
+}
+
+//! post() 的事件在下一次循环中一并发布
+TEST(EventPublisherImpl, Post) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  EventPublisherImpl pub(loop);
+  TestSubscriber s1;
+  s1.setFunc([&] (Event e) {
+    if (e.id == 2)
+      pub.post(3);  //! 发布过程中 post() 的，留到下一次
+    return false;
+  });
+  pub.subscribe(&s1);
+
+  loop->runNext([&] {
+    pub.post(1);
+    pub.post(2);
+    EXPECT_TRUE(s1.received.empty());
+  });
+  loop->exitLoop(std::chrono::milliseconds(10));
+  loop->runLoop();
+
+  EXPECT_EQ(s1.received, std::vector<Event::ID>({1, 2, 3}));
+}
+
+//! 析构时还有未发布的事件，不应出错
+TEST(EventPublisherImpl, DestroyWithPosted) {
+  auto loop = event::Loop::New();
+  SetScopeExitAction([loop] { delete loop; });
+
+  {
+    EventPublisherImpl pub(loop);
+    pub.post(1);
+  }
+  loop->exitLoop(std::chrono::milliseconds(10));
+  loop->runLoop();
+}
+
+//! 大量订阅者各自等待不同的事件
+TEST(EventPublisherImpl, Benchmark) {
+  const int kSubscriberNum = 4096;
+  const int kPublishNum = 200000;
+
+  EventPublisherImpl pub;
+  std::vector<TestSubscriber> subscribers(kSubscriberNum);
+  for (int i = 0; i < kSubscriberNum; ++i)
+    pub.subscribe(&subscribers[i], i);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kPublishNum; ++i)
+    pub.publish(i % kSubscriberNum);
+  auto cost = std::chrono::steady_clock::now() - start;
+
+  size_t total_received = 0;
+  for (auto &s : subscribers)
+    total_received += s.received.size();
+  EXPECT_EQ(total_received, size_t(kPublishNum));
+
+  auto cost_us = std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+  std::cout << kPublishNum << " events to " << kSubscriberNum << " subscribers cost " << cost_us << " us" << std::endl;
+}
+
+}
+}
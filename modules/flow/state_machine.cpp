@@ -21,6 +21,8 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <stdexcept>
 #include <algorithm>
 
@@ -66,6 +68,9 @@ class StateMachine::Impl {
         state_changed_cb_ = std::move(cb);
     }
 
+    bool freeze();
+    bool isFrozen() const { return is_frozen_; }
+
     bool start();
     void stop();
 
@@ -103,9 +108,30 @@ class StateMachine::Impl {
         vector<Route> routes;   //! 转换路由
         map<EventID, EventFunc> events;  //! 内部事件
         EventFunc default_event;
+        int index;  //! 在跳转表中的行号，冻结后才有效，-1表示没有
+    };
+
+    //! 跳转表中的路由，下一个状态已解析好
+    struct CompiledRoute {
+        const Route *route;
+        State *next_state;
+    };
+
+    //! 跳转表的单元，对应 (状态, 事件)
+    struct Cell {
+        const EventFunc *event_func;    //! 要执行的事件处理函数，nullptr表示没有
+        uint32_t route_begin;           //! 可能匹配的路由在 compiled_routes_ 中的区间，已按原顺序排好
+        uint32_t route_end;
     };
 
     State* findState(StateID state_id) const;
+    //! 将跳转的目标状态ID解析成状态对象，终止状态可以不定义
+    State* toNextState(StateID state_id) const;
+
+    //! 找出下一个状态与路由动作，返回false表示不跳转
+    bool findNextByScan(Event event, State* &next_state, const ActionFunc* &route_action);
+    bool findNextByTable(Event event, State* &next_state, const ActionFunc* &route_action);
+    const Cell* findCell(const State *state, EventID event_id) const;
 
     StateID init_state_id_ = NULL_STATE_ID; //! 初始状态
 
@@ -116,6 +142,22 @@ class StateMachine::Impl {
     State *next_state_ = nullptr;   //! 下一个状态指针
     map<StateID, State*> states_;   //! 状态对象表
 
+    //! 以下为冻结后生成的跳转表
+    bool is_frozen_ = false;
+    bool is_state_dense_ = false;               //! 状态ID是否连续
+    StateID state_id_base_ = 0;
+    vector<State*> dense_states_;               //! 状态ID连续时，以 (state_id - state_id_base_) 为下标
+    unordered_map<StateID, State*> sparse_states_;  //! 状态ID稀疏时用哈希表
+
+    bool is_event_dense_ = false;               //! 事件ID是否连续
+    EventID event_id_base_ = 0;
+    vector<int> dense_event_cols_;              //! 事件ID连续时，以 (event_id - event_id_base_) 为下标，-1表示没有
+    unordered_map<EventID, int> sparse_event_cols_; //! 事件ID稀疏时用哈希表
+
+    size_t col_num_ = 0;        //! 列数，最后一列是所有路由与事件都没有提及的事件
+    vector<Cell> cells_;        //! 行为状态，列为事件
+    vector<CompiledRoute> compiled_routes_;
+
     StateChangedCallback state_changed_cb_;
 
     static State _term_state_;  //! 默认终止状态对象
@@ -164,6 +206,16 @@ void StateMachine::setStateChangedCallback(StateChangedCallback &&cb)
     impl_->setStateChangedCallback(std::move(cb));
 }
 
+bool StateMachine::freeze()
+{
+    return impl_->freeze();
+}
+
+bool StateMachine::isFrozen() const
+{
+    return impl_->isFrozen();
+}
+
 bool StateMachine::start()
 {
     return impl_->start();
@@ -222,7 +274,7 @@ void StateMachine::setName(const std::string &name)
 
 ///////////////////////
 
-StateMachine::Impl::State StateMachine::Impl::_term_state_ = { TERM_STATE_ID, nullptr, nullptr, "Term", nullptr, { } };
+StateMachine::Impl::State StateMachine::Impl::_term_state_ = { TERM_STATE_ID, nullptr, nullptr, "Term", nullptr, { }, { }, nullptr, -1 };
 
 StateMachine::Impl::~Impl()
 {
@@ -244,13 +296,18 @@ bool StateMachine::Impl::newState(StateID state_id,
         return false;
     }
 
+    if (is_frozen_) {
+        LogWarn("[%s]: it's frozen", name_.c_str());
+        return false;
+    }
+
     //! 已存在的状态不能再创建了
     if (states_.find(state_id) != states_.end()) {
         LogWarn("[%s]: state %d exist", name_.c_str(), state_id);
         return false;
     }
 
-    auto new_state = new State { state_id, enter_action, exit_action, label, nullptr, { } };
+    auto new_state = new State { state_id, enter_action, exit_action, label, nullptr, { }, { }, nullptr, -1 };
     states_[state_id] = new_state;
 
     if (init_state_id_ == NULL_STATE_ID)
@@ -271,6 +328,11 @@ bool StateMachine::Impl::addRoute(StateID from_state_id,
         return false;
     }
 
+    if (is_frozen_) {
+        LogWarn("[%s]: it's frozen", name_.c_str());
+        return false;
+    }
+
     //! 要求 from_state_id 必须是已存在的状态
     auto from_state = findState(from_state_id);
     if (from_state == nullptr) {
@@ -295,6 +357,11 @@ bool StateMachine::Impl::addEvent(StateID state_id, EventID event_id, const Even
         return false;
     }
 
+    if (is_frozen_) {
+        LogWarn("[%s]: it's frozen", name_.c_str());
+        return false;
+    }
+
     if (action == nullptr) {
         LogWarn("[%s]: state %d, event:%d, action is nullptr", name_.c_str(), state_id, event_id);
         return false;
@@ -322,6 +389,11 @@ bool StateMachine::Impl::setSubStateMachine(StateID state_id, StateMachine *wp_s
         return false;
     }
 
+    if (is_frozen_) {
+        LogWarn("[%s]: it's frozen", name_.c_str());
+        return false;
+    }
+
     auto state = findState(state_id);
     if (state == nullptr) {
         LogWarn("[%s]: state:%d not exist", name_.c_str(), state_id);
@@ -404,8 +476,48 @@ bool StateMachine::Impl::run(Event event)
         curr_state_->sub_sm->stop();
     }
 
+    State *next_state = nullptr;
+    const ActionFunc *route_action = nullptr;
+
+    bool is_found = is_frozen_ ? findNextByTable(event, next_state, route_action)
+                               : findNextByScan(event, next_state, route_action);
+    if (!is_found)
+        return false;
+
+    next_state_ = next_state;
+
+    ++cb_level_;
+    if (curr_state_->exit_action)
+        curr_state_->exit_action(event);
+
+    last_state_ = curr_state_;
+    curr_state_ = nullptr;
+
+    if (route_action != nullptr && *route_action)
+        (*route_action)(event);
+
+    curr_state_ = next_state_;
+    next_state_ = nullptr;
+
+    if (curr_state_->enter_action)
+        curr_state_->enter_action(event);
+
+    if (state_changed_cb_)
+        state_changed_cb_(last_state_->id, curr_state_->id, event);
+
+    //! 如果新的状态有子状态机，则启动子状态机并将事件交给子状态机处理
+    if (curr_state_->sub_sm != nullptr) {
+        curr_state_->sub_sm->start();
+        curr_state_->sub_sm->run(event);
+    }
+    --cb_level_;
+
+    return true;
+}
+
+bool StateMachine::Impl::findNextByScan(Event event, State* &next_state, const ActionFunc* &route_action)
+{
     StateID next_state_id = NULL_STATE_ID;
-    ActionFunc route_action;
 
     //! 检查事件，并执行
     ++cb_level_;
@@ -436,45 +548,179 @@ bool StateMachine::Impl::run(Event event)
 
         //! 以下是有跳转的情况
         next_state_id = route_iter->next_state_id;
-        route_action = route_iter->action;
+        route_action = &route_iter->action;
     }
 
-    next_state_ = findState(next_state_id);
-    if (next_state_ == nullptr) {
-        if (next_state_id == TERM_STATE_ID) {
-            next_state_ = &_term_state_;
-        } else {
-            LogErr("[%s]: Should not happen", name_.c_str());
-            return false;
+    next_state = toNextState(next_state_id);
+    return next_state != nullptr;
+}
+
+bool StateMachine::Impl::findNextByTable(Event event, State* &next_state, const ActionFunc* &route_action)
+{
+    auto cell = findCell(curr_state_, event.id);
+    if (cell == nullptr)
+        return false;
+
+    //! 检查事件，并执行
+    if (cell->event_func != nullptr) {
+        ++cb_level_;
+        StateID next_state_id = (*cell->event_func)(event);
+        --cb_level_;
+
+        if (next_state_id != NULL_STATE_ID) {
+            next_state = toNextState(next_state_id);
+            return next_state != nullptr;
         }
     }
 
-    ++cb_level_;
-    if (curr_state_->exit_action)
-        curr_state_->exit_action(event);
+    //! 表中只有事件匹配的路由，只需判定条件
+    for (auto i = cell->route_begin; i < cell->route_end; ++i) {
+        auto &item = compiled_routes_[i];
+        bool is_pass = true;
+        if (item.route->guard != nullptr) {
+            ++cb_level_;
+            is_pass = item.route->guard(event);
+            --cb_level_;
+        }
 
-    last_state_ = curr_state_;
-    curr_state_ = nullptr;
+        if (is_pass) {
+            next_state = item.next_state;
+            route_action = &item.route->action;
+            return next_state != nullptr;
+        }
+    }
 
-    if (route_action)
-        route_action(event);
+    return false;
+}
 
-    curr_state_ = next_state_;
-    next_state_ = nullptr;
+const StateMachine::Impl::Cell* StateMachine::Impl::findCell(const State *state, EventID event_id) const
+{
+    if (state->index < 0)
+        return nullptr;
+
+    int col = -1;
+    if (is_event_dense_) {
+        auto offset = static_cast<int64_t>(event_id) - event_id_base_;
+        if (offset >= 0 && offset < static_cast<int64_t>(dense_event_cols_.size()))
+            col = dense_event_cols_[offset];
+    } else {
+        auto iter = sparse_event_cols_.find(event_id);
+        if (iter != sparse_event_cols_.end())
+            col = iter->second;
+    }
 
-    if (curr_state_->enter_action)
-        curr_state_->enter_action(event);
+    if (col < 0)
+        col = col_num_ - 1;
 
-    if (state_changed_cb_)
-        state_changed_cb_(last_state_->id, curr_state_->id, event);
+    return &cells_[state->index * col_num_ + col];
+}
 
-    //! 如果新的状态有子状态机，则启动子状态机并将事件交给子状态机处理
-    if (curr_state_->sub_sm != nullptr) {
-        curr_state_->sub_sm->start();
-        curr_state_->sub_sm->run(event);
+StateMachine::Impl::State* StateMachine::Impl::toNextState(StateID state_id) const
+{
+    auto state = findState(state_id);
+    if (state == nullptr) {
+        if (state_id == TERM_STATE_ID)
+            return &_term_state_;
+
+        LogErr("[%s]: Should not happen", name_.c_str());
     }
-    --cb_level_;
+    return state;
+}
+
+bool StateMachine::Impl::freeze()
+{
+    if (is_frozen_)
+        return true;
 
+    if (cb_level_ != 0) {
+        LogWarn("[%s]: recursion invoke", name_.c_str());
+        return false;
+    }
+
+    //! ID 的跨度不超过个数的两倍时，视为连续的，用数组，否则用哈希表
+    auto is_dense = [] (int64_t min_id, int64_t max_id, size_t num) {
+        return (max_id - min_id + 1) <= static_cast<int64_t>(num * 2 + 8);
+    };
+
+    //! 状态表
+    vector<State*> states;
+    for (auto &item : states_) {
+        item.second->index = states.size();
+        states.push_back(item.second);
+    }
+
+    if (!states.empty()) {
+        StateID min_id = states.front()->id;
+        StateID max_id = states.back()->id;
+        is_state_dense_ = is_dense(min_id, max_id, states.size());
+        if (is_state_dense_) {
+            state_id_base_ = min_id;
+            dense_states_.assign(max_id - min_id + 1, nullptr);
+            for (auto state : states)
+                dense_states_[state->id - min_id] = state;
+        } else {
+            for (auto state : states)
+                sparse_states_[state->id] = state;
+        }
+    }
+
+    //! 事件列，只有在路由与事件处理中提及的事件才有单独的列，其它的事件共用最后一列
+    set<EventID> event_ids;
+    for (auto state : states) {
+        for (auto &route : state->routes) {
+            if (route.event_id != ANY_EVENT_ID)
+                event_ids.insert(route.event_id);
+        }
+        for (auto &item : state->events)
+            event_ids.insert(item.first);
+    }
+
+    vector<EventID> cols(event_ids.begin(), event_ids.end());
+    col_num_ = cols.size() + 1;
+
+    if (!cols.empty()) {
+        is_event_dense_ = is_dense(cols.front(), cols.back(), cols.size());
+        if (is_event_dense_) {
+            event_id_base_ = cols.front();
+            dense_event_cols_.assign(cols.back() - cols.front() + 1, -1);
+            for (size_t i = 0; i < cols.size(); ++i)
+                dense_event_cols_[cols[i] - event_id_base_] = i;
+        } else {
+            for (size_t i = 0; i < cols.size(); ++i)
+                sparse_event_cols_[cols[i]] = i;
+        }
+    }
+
+    //! 生成跳转表，要先置 is_frozen_，以便 toNextState() 使用上面的状态表
+    is_frozen_ = true;
+    cells_.resize(states.size() * col_num_);
+    for (auto state : states) {
+        for (size_t col = 0; col < col_num_; ++col) {
+            bool is_other_col = (col == col_num_ - 1);
+            EventID event_id = is_other_col ? ANY_EVENT_ID : cols[col];
+
+            auto &cell = cells_[state->index * col_num_ + col];
+            cell.event_func = nullptr;
+            if (!is_other_col) {
+                auto iter = state->events.find(event_id);
+                if (iter != state->events.end())
+                    cell.event_func = &iter->second;
+            }
+            if (cell.event_func == nullptr && state->default_event)
+                cell.event_func = &state->default_event;
+
+            cell.route_begin = compiled_routes_.size();
+            for (auto &route : state->routes) {
+                if (route.event_id == ANY_EVENT_ID || (!is_other_col && route.event_id == event_id))
+                    compiled_routes_.push_back(CompiledRoute{ &route, toNextState(route.next_state_id) });
+            }
+            cell.route_end = compiled_routes_.size();
+        }
+    }
+
+    LogDbg("[%s]: frozen, states:%zu(%s), events:%zu(%s), routes:%zu",
+           name_.c_str(), states.size(), is_state_dense_ ? "dense" : "sparse",
+           cols.size(), is_event_dense_ ? "dense" : "sparse", compiled_routes_.size());
     return true;
 }
 
@@ -501,11 +747,25 @@ StateMachine::StateID StateMachine::Impl::nextState() const
 
 StateMachine::Impl::State* StateMachine::Impl::findState(StateID state_id) const
 {
-    if (state_id != NULL_STATE_ID) {
-        auto iter = states_.find(state_id);
-        if (iter != states_.end())
-            return iter->second;
+    if (state_id == NULL_STATE_ID)
+        return nullptr;
+
+    if (is_frozen_) {
+        if (is_state_dense_) {
+            auto offset = static_cast<int64_t>(state_id) - state_id_base_;
+            if (offset >= 0 && offset < static_cast<int64_t>(dense_states_.size()))
+                return dense_states_[offset];
+        } else {
+            auto iter = sparse_states_.find(state_id);
+            if (iter != sparse_states_.end())
+                return iter->second;
+        }
+        return nullptr;
     }
+
+    auto iter = states_.find(state_id);
+    if (iter != states_.end())
+        return iter->second;
     return nullptr;
 }
 
@@ -513,6 +773,7 @@ void StateMachine::Impl::toJson(Json &js) const
 {
     js["name"] = name_;
     js["is_running"] = is_running_;
+    js["is_frozen"] = is_frozen_;
     js["init_state"] = init_state_id_;
     js["term_state"] = TERM_STATE_ID;
     if (curr_state_ != nullptr)
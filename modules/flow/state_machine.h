@@ -154,6 +154,23 @@ class StateMachine {
     //! 设置状态变更回调
     void setStateChangedCallback(StateChangedCallback &&cb);
 
+    /**
+     * \brief   冻结状态机的配置，生成跳转表
+     *
+     * 冻结前，run() 每次都要在 map 中查找状态与事件，并逐条检查路由的事件是否匹配。
+     * 冻结后，按 (状态, 事件) 直接查表，只剩下事件匹配的路由需要判定条件。
+     * ID 连续时用数组查找，稀疏时用哈希表。适用于配置一次、之后频繁 run() 的场景。
+     *
+     * \return  bool    成功与否，在状态机的回调中调用会失败
+     *
+     * \note    冻结后不能再 newState(), addRoute(), addEvent(), setSubStateMachine()；
+     *          不会冻结子状态机，子状态机需自行冻结
+     */
+    bool freeze();
+
+    //! 是否已冻结
+    bool isFrozen() const;
+
     //! 启动状态机
     bool start();
 
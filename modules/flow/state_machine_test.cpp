@@ -19,6 +19,9 @@
  */
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <iostream>
+
 #include <tbox/base/json.hpp>
 #include "state_machine.h"
 
@@ -715,5 +718,129 @@ TEST(StateMachine, LastNextState)
     EXPECT_EQ(count, 7);
 }
 
+namespace {
+/**
+ * 构建一个包含 条件路由、任意事件路由、事件处理、终止状态 的状态机
+ * id_scale 用于将状态与事件的ID拉开，构造ID稀疏的情况
+ */
+void BuildForFreezeTest(SM &sm, int id_scale, bool &condition, vector<string> &trace)
+{
+    auto s = [id_scale] (int id) { return id * id_scale; };
+    auto e = [id_scale] (int id) { return id * id_scale; };
+
+    for (int id = STATE_A; id <= STATE_D; ++id) {
+        sm.newState(s(id),
+            [&trace, id] (Event) { trace.push_back("enter:" + to_string(id)); },
+            [&trace, id] (Event) { trace.push_back("exit:" + to_string(id)); }
+        );
+    }
+
+    sm.addRoute(s(STATE_A), e(EVENT_1), s(STATE_B), [&] (Event) { return !condition; }, nullptr);
+    sm.addRoute(s(STATE_A), e(EVENT_1), s(STATE_C), nullptr, [&] (Event) { trace.push_back("a->c"); });
+    sm.addRoute(s(STATE_A), EVENT_ANY, s(STATE_D), [&] (Event) { return condition; }, nullptr);
+    sm.addRoute(s(STATE_B), EVENT_ANY, s(STATE_A), nullptr, nullptr);
+    sm.addRoute(s(STATE_C), e(EVENT_2), STATE_TERM, nullptr, nullptr);
+    sm.addEvent(s(STATE_C), e(EVENT_3), [&] (Event) { trace.push_back("c:event3"); return -1; });
+    sm.addEvent(s(STATE_D), e(EVENT_4), [&] (Event) { return s(STATE_A); });
+    sm.addEvent(s(STATE_D), EVENT_ANY, [&] (Event) { trace.push_back("d:any"); return -1; });
+    sm.setInitState(s(STATE_A));
+}
+
+//! 依次运行一串事件，记录下状态的变化
+vector<string> RunForFreezeTest(bool is_frozen, int id_scale)
+{
+    SM sm;
+    bool condition = false;
+    vector<string> trace;
+    BuildForFreezeTest(sm, id_scale, condition, trace);
+    if (is_frozen) {
+        EXPECT_TRUE(sm.freeze());
+    }
+
+    auto e = [id_scale] (int id) { return id * id_scale; };
+    sm.start();
+
+    const int events[] = { EVENT_1, EVENT_2, EVENT_1, EVENT_3, EVENT_4, EVENT_1, EVENT_3, EVENT_2, EVENT_1 };
+    for (int i = 0; i < 9; ++i) {
+        condition = (i == 2 || i == 5);
+        bool is_changed = sm.run(Event(e(events[i])));
+        trace.push_back(to_string(is_changed) + "@" + to_string(sm.currentState()));
+    }
+    return trace;
+}
+}
+
+//! 冻结前后的行为要完全一致
+TEST(StateMachine, FreezeSameBehavior)
+{
+    auto dense_trace = RunForFreezeTest(false, 1);
+    EXPECT_EQ(RunForFreezeTest(true, 1), dense_trace);
+
+    auto sparse_trace = RunForFreezeTest(false, 1000);
+    EXPECT_EQ(RunForFreezeTest(true, 1000), sparse_trace);
+
+    //! 最后进入了终止状态
+    EXPECT_EQ(dense_trace.back(), "0@0");
+}
+
+TEST(StateMachine, FreezeRejectConfig)
+{
+    SM sm;
+    sm.newState(STATE_A, nullptr, nullptr);
+    sm.newState(STATE_B, nullptr, nullptr);
+    sm.addRoute(STATE_A, EVENT_1, STATE_B, nullptr, nullptr);
+
+    EXPECT_FALSE(sm.isFrozen());
+    EXPECT_TRUE(sm.freeze());
+    EXPECT_TRUE(sm.isFrozen());
+    EXPECT_TRUE(sm.freeze());
+
+    EXPECT_FALSE(sm.newState(STATE_C, nullptr, nullptr));
+    EXPECT_FALSE(sm.addRoute(STATE_B, EVENT_2, STATE_A, nullptr, nullptr));
+    EXPECT_FALSE(sm.addEvent(STATE_B, EVENT_2, [] (Event) { return -1; }));
+
+    EXPECT_TRUE(sm.start());
+    EXPECT_TRUE(sm.run(EVENT_1));
+    EXPECT_EQ(sm.currentState(), STATE_B);
+    EXPECT_FALSE(sm.run(EVENT_2));
+
+    //! 冻结后仍可重启
+    EXPECT_TRUE(sm.restart());
+    EXPECT_EQ(sm.currentState(), STATE_A);
+}
+
+//! 比较冻结前后 run() 的速度
+TEST(StateMachine, FreezeBenchmark)
+{
+    const int kStateNum = 32;
+    const int kEventNum = 16;
+    const int kRunTimes = 1000000;
+
+    for (bool is_frozen : { false, true }) {
+        SM sm;
+        for (int s = 1; s <= kStateNum; ++s)
+            sm.newState(s, nullptr, nullptr);
+
+        //! 每个状态对每个事件都有一条带条件的路由，外加一条任意事件的路由
+        for (int s = 1; s <= kStateNum; ++s) {
+            for (int e = 1; e <= kEventNum; ++e)
+                sm.addRoute(s, e, (s + e - 1) % kStateNum + 1, [] (Event event) { return event.extra == nullptr; }, nullptr);
+            sm.addRoute(s, EVENT_ANY, s % kStateNum + 1, nullptr, nullptr);
+        }
+
+        if (is_frozen)
+            sm.freeze();
+        sm.start();
+
+        auto start_ts = chrono::steady_clock::now();
+        for (int i = 0; i < kRunTimes; ++i)
+            sm.run(Event(i % kEventNum + 1));
+        auto cost_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_ts).count();
+
+        cout << (is_frozen ? "frozen" : "not frozen") << ": " << kRunTimes << " events cost " << cost_us << " us, "
+             << kRunTimes * 1000000ull / (cost_us > 0 ? cost_us : 1) << " events/s" << endl;
+    }
+}
+
 }
 }
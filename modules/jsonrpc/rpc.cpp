@@ -29,7 +29,8 @@ namespace tbox {
 namespace jsonrpc {
 
 Rpc::Rpc(event::Loop *loop)
-    : request_timeout_(loop)
+    : loop_(loop)
+    , request_timeout_(loop)
     , respond_timeout_(loop)
 {
     using namespace std::placeholders;
@@ -62,6 +62,8 @@ class Rpc {
     bool initialize(Proto *proto, int timeout_sec = 30);
     void cleanup();
 
+    event::Loop* getLoop() const { return loop_; }
+
     //! 添加方法被调用时的回调函数
     void addService(const std::string &method, ServiceCallback &&cb);
 
@@ -85,6 +87,7 @@ class Rpc {
     void onRespondTimeout(int id);
 
   private:
+    event::Loop *loop_;
     Proto *proto_ = nullptr;
 
     std::unordered_map<std::string, ServiceCallback> method_services_;
@@ -0,0 +1,86 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_JSONRPC_RPC_AWAITER_HPP_20261019
+#define TBOX_JSONRPC_RPC_AWAITER_HPP_20261019
+
+/**
+ * 在 C++20 协程（tbox/coroutine/task.hpp）中发送请求并等待回复
+ *
+ *   auto result = co_await AsyncRequest(rpc, "add", js_params);
+ *   if (result.errcode == 0)
+ *       ... result.js_result ...
+ *
+ * 超时等错误由 Rpc 本身处理，体现在 errcode 中。
+ *
+ * \warning 协程挂起期间，不可销毁 Rpc 对象
+ */
+
+#include <coroutine>
+#include <string>
+#include <utility>
+
+#include <tbox/base/json.hpp>
+#include <tbox/event/loop.h>
+
+#include "rpc.h"
+
+namespace tbox {
+namespace jsonrpc {
+
+class AsyncRequest {
+  public:
+    struct Result {
+        int  errcode = 0;   //!< 错误码，= 0 表示没有错误
+        Json js_result;     //!< 回复的结果
+    };
+
+    AsyncRequest(Rpc &rpc, std::string method, Json js_params = Json()) :
+        rpc_(rpc), method_(std::move(method)), js_params_(std::move(js_params))
+    { }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        //! Rpc 在回调返回之后还要操作回调表，所以不在回调中直接恢复
+        auto cb = [this, handle] (int errcode, const Json &js_result) {
+            result_.errcode = errcode;
+            result_.js_result = js_result;
+            rpc_.getLoop()->runNext([handle] { handle.resume(); }, "co_await");
+        };
+
+        if (js_params_.is_null())
+            rpc_.request(method_, std::move(cb));
+        else
+            rpc_.request(method_, js_params_, std::move(cb));
+    }
+
+    Result await_resume() { return std::move(result_); }
+
+  private:
+    Rpc &rpc_;
+    std::string method_;
+    Json js_params_;
+    Result result_;
+};
+
+}
+}
+
+#endif //TBOX_JSONRPC_RPC_AWAITER_HPP_20261019
@@ -0,0 +1,103 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include <tbox/event/loop.h>
+#include <tbox/base/scope_exit.hpp>
+#include <tbox/coroutine/task.hpp>
+
+#include "protos/raw_stream_proto.h"
+#include "rpc_awaiter.hpp"
+
+namespace tbox {
+namespace jsonrpc {
+
+using coroutine::Task;
+
+TEST(RpcAwaiter, Request) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([=] { delete loop; });
+
+    Rpc rpc_a(loop), rpc_b(loop);
+    RawStreamProto proto_a, proto_b;
+    rpc_a.initialize(&proto_a);
+    rpc_b.initialize(&proto_b);
+    proto_a.setSendCallback([&] (const void *data_ptr, size_t data_size) { proto_b.onRecvData(data_ptr, data_size); });
+    proto_b.setSendCallback([&] (const void *data_ptr, size_t data_size) { proto_a.onRecvData(data_ptr, data_size); });
+
+    rpc_b.addService("add",
+        [&] (int, const Json &js_params, int &errcode, Json &js_result) {
+            errcode = 0;
+            js_result = js_params["a"].get<int>() + js_params["b"].get<int>();
+            return true;
+        }
+    );
+
+    int sum = 0;
+    int not_found_errcode = 0;
+
+    auto func = [&] () -> Task<> {
+        //! 依次发送，后一个请求用前一个的结果
+        Json js_params = { {"a", 1}, {"b", 2} };
+        auto r1 = co_await AsyncRequest(rpc_a, "add", js_params);
+        js_params = { {"a", r1.js_result.get<int>()}, {"b", 10} };
+        auto r2 = co_await AsyncRequest(rpc_a, "add", js_params);
+        sum = r2.js_result.get<int>();
+
+        auto r3 = co_await AsyncRequest(rpc_a, "not_exist");
+        not_found_errcode = r3.errcode;
+        loop->exitLoop();
+    };
+
+    loop->run([&] { func().detach(); });
+    loop->runLoop();
+
+    EXPECT_EQ(sum, 13);
+    EXPECT_NE(not_found_errcode, 0);
+
+    rpc_a.cleanup();
+    rpc_b.cleanup();
+}
+
+TEST(RpcAwaiter, Timeout) {
+    auto loop = event::Loop::New();
+    SetScopeExitAction([=] { delete loop; });
+
+    Rpc rpc(loop);
+    RawStreamProto proto;
+    rpc.initialize(&proto, 1);
+
+    int errcode = 0;
+    auto func = [&] () -> Task<> {
+        auto result = co_await AsyncRequest(rpc, "A");
+        errcode = result.errcode;
+        loop->exitLoop();
+    };
+
+    loop->run([&] { func().detach(); });
+    loop->exitLoop(std::chrono::seconds(3));
+    loop->runLoop();
+
+    EXPECT_EQ(errcode, -32000);
+    rpc.cleanup();
+}
+
+}
+}
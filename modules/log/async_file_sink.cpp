@@ -20,7 +20,6 @@
 #include "async_file_sink.h"
 
 #include <unistd.h>
-#include <fcntl.h>
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -34,6 +33,10 @@ namespace log {
 
 using namespace std;
 
+namespace {
+const size_t kDefaultPreallocSize = 256 << 10;  //! 日志文件默认每次预分配256KB
+}
+
 AsyncFileSink::AsyncFileSink()
 {
     AsyncSink::Config cfg;
@@ -44,6 +47,8 @@ AsyncFileSink::AsyncFileSink()
 
     setConfig(cfg);
     pid_ = ::getpid();
+
+    writer_cfg_.prealloc_size = kDefaultPreallocSize;
 }
 
 AsyncFileSink::~AsyncFileSink()
@@ -71,24 +76,61 @@ void AsyncFileSink::setFilePrefix(const std::string &file_prefix)
     updateInnerValues();
 }
 
+void AsyncFileSink::setFileExtension(const std::string &file_ext)
+{
+    file_ext_ = file_ext;
+    updateInnerValues();
+}
+
 void AsyncFileSink::setFileSyncEnable(bool enable)
 {
-    file_sync_enable_ = enable;
-    CHECK_CLOSE_RESET_FD(fd_);
+    std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+    if (enable)
+        writer_cfg_.sync_mode = util::FileWriter::SyncMode::kDsync;
+    else if (writer_cfg_.sync_mode == util::FileWriter::SyncMode::kDsync)
+        writer_cfg_.sync_mode = util::FileWriter::SyncMode::kNone;
+    is_reopen_required_ = true;
+}
+
+void AsyncFileSink::setFileWriterConfig(const util::FileWriter::Config &cfg)
+{
+    std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+    writer_cfg_ = cfg;
+    is_reopen_required_ = true;
+}
+
+util::FileWriter::Config AsyncFileSink::getFileWriterConfig() const
+{
+    std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+    return writer_cfg_;
+}
+
+void AsyncFileSink::setFileCompressType(util::CompressType type)
+{
+    std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+    compress_type_ = type;
+    is_reopen_required_ = true;
+}
+
+util::CompressType AsyncFileSink::getFileCompressType() const
+{
+    std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+    return compress_type_;
 }
 
 void AsyncFileSink::cleanup()
 {
     AsyncSink::cleanup();
+    writer_.close();
     pid_ = 0;
 }
 
 void AsyncFileSink::updateInnerValues()
 {
     filename_prefix_ = file_path_ + '/' + file_prefix_ + '.';
-    sym_filename_ = filename_prefix_ + "latest.log";
+    sym_filename_ = filename_prefix_ + "latest" + file_ext_;
 
-    CHECK_CLOSE_RESET_FD(fd_);
+    is_reopen_required_ = true;
 }
 
 void AsyncFileSink::endline()
@@ -101,26 +143,47 @@ void AsyncFileSink::flush()
     if (pid_ == 0 || !checkAndCreateLogFile())
         return;
 
-    auto wsize = ::write(fd_, cache_.data(), cache_.size());
-    if (wsize != static_cast<ssize_t>(cache_.size())) {
+    bool is_ok = false;
+    if (compressor_) {
+        //! 每批日志压缩成一帧，崩溃时最多丢失最后没写完的一帧
+        compressed_.clear();
+        is_ok = compressor_->compress(cache_.data(), cache_.size(), compressed_) &&
+                writer_.write(compressed_.data(), compressed_.size());
+    } else {
+        is_ok = writer_.write(cache_.data(), cache_.size());
+    }
+
+    //! 日志要及时可见，不足一块的也立即写入
+    if (!is_ok || !writer_.flush()) {
         cerr << "Err: write file error." << endl;
         return;
     }
 
-    total_write_size_ += cache_.size();
-
-    if (total_write_size_ >= file_max_size_)
-        CHECK_CLOSE_RESET_FD(fd_);
+    //! 关闭文件的收尾工作由 FileWriter 的后台线程完成，不阻塞
+    if (writer_.size() >= file_max_size_)
+        writer_.close();
 
     cache_.clear();
 }
 
 bool AsyncFileSink::checkAndCreateLogFile()
 {
-    if (fd_ >= 0) {
-        if (util::fs::IsFileExist(log_filename_))
+    if (is_reopen_required_.exchange(false)) {
+        std::lock_guard<std::mutex> lg(writer_cfg_lock_);
+        writer_.setConfig(writer_cfg_);
+        writer_.close();
+
+        if (compress_type_ == util::CompressType::kNone)
+            compressor_.reset();
+        else if (!compressor_ || compressor_->type() != compress_type_)
+            compressor_.reset(new util::BlockCompressor(compress_type_));
+    }
+
+    //! 由 inotify 得知文件是否被删除，不需要每次都 stat()
+    if (writer_.isOpened()) {
+        if (!writer_.isDeleted())
             return true;
-        CHECK_CLOSE_RESET_FD(fd_);
+        writer_.close();
     }
 
     //!检查并创建路径
@@ -140,28 +203,33 @@ bool AsyncFileSink::checkAndCreateLogFile()
     std::string log_filename;
     int postfix = 0;
     do {
-        log_filename = filename_prefix_ + timestamp + '.' + std::to_string(pid_) + ".log";
+        log_filename = filename_prefix_ + timestamp + '.' + std::to_string(pid_) + file_ext_;
         if (postfix != 0) {
             log_filename += '.';
             log_filename += std::to_string(postfix);
         }
+        if (compressor_)
+            log_filename += util::BlockCompressor::kFileSuffix;
         ++postfix;
     } while (util::fs::IsFileExist(log_filename));    //! 避免在同一秒多次创建日志文件，都指向同一日志名
     log_filename_ = std::move(log_filename);
 
-    int flags = O_CREAT | O_WRONLY | O_APPEND;
-    if (file_sync_enable_)
-        flags |= O_DSYNC;
-
-    fd_ = ::open(log_filename_.c_str(), flags, S_IRUSR | S_IWUSR);
-    if (fd_ < 0) {
+    if (!writer_.open(log_filename_)) {
         cerr << "Err: open file " << log_filename_ << " fail. error:" << errno << ',' << strerror(errno) << endl;
         return false;
     }
 
-    total_write_size_ = 0;
+    //! 压缩的文件从新的帧开始，不引用上一个文件的数据
+    if (compressor_)
+        compressor_->reset();
+
+    onLogFileOpened();
+
+    //! 压缩与否的链接名不同，两个都删除，以免留下指向旧文件的链接
+    std::string sym_compressed_filename = sym_filename_ + util::BlockCompressor::kFileSuffix;
     util::fs::RemoveFile(sym_filename_, false);
-    util::fs::MakeSymbolLink(log_filename_, sym_filename_, false);
+    util::fs::RemoveFile(sym_compressed_filename, false);
+    util::fs::MakeSymbolLink(log_filename_, compressor_ ? sym_compressed_filename : sym_filename_, false);
 
     return true;
 }
@@ -23,6 +23,12 @@
 #include "async_sink.h"
 
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+
+#include <tbox/util/file_writer.h>
+#include <tbox/util/block_compressor.h>
 
 namespace tbox {
 namespace log {
@@ -41,9 +47,28 @@ class AsyncFileSink : public AsyncSink {
     void setFileSyncEnable(bool enable);
     std::string currentFilename() const { return log_filename_; }
 
+    /**
+     * 设置日志文件的写入配置，默认每次预分配256KB，下次打开日志文件时生效
+     * setFileSyncEnable() 会将 sync_mode 设为 kDsync 或 kNone
+     */
+    void setFileWriterConfig(const util::FileWriter::Config &cfg);
+    util::FileWriter::Config getFileWriterConfig() const;
+
+    /**
+     * 设置日志文件的压缩方式，默认不压缩，下次打开日志文件时生效
+     * 压缩的日志文件名以 .tbz 结尾，每次写入的日志压缩成一帧，可用 ztail 工具查看
+     */
+    void setFileCompressType(util::CompressType type);
+    util::CompressType getFileCompressType() const;
+
   protected:
     void updateInnerValues();
 
+    //! 设置日志文件的扩展名，默认为 ".log"
+    void setFileExtension(const std::string &file_ext);
+    //! 打开了新的日志文件，在写入 cache_ 之前调用，子类可在 cache_ 的开头插入文件头
+    virtual void onLogFileOpened() { }
+
     virtual void endline() override;
     virtual void flush() override;
 
@@ -52,18 +77,24 @@ class AsyncFileSink : public AsyncSink {
   private:
     std::string file_prefix_ = "none";
     std::string file_path_ = "/var/log/";
+    std::string file_ext_ = ".log";
     size_t file_max_size_ = (1 << 20);  //!< 默认文件大小为1MB
-    bool file_sync_enable_ = false;
     pid_t pid_ = 0;
 
+    mutable std::mutex writer_cfg_lock_;
+    util::FileWriter::Config writer_cfg_;
+    util::CompressType compress_type_ = util::CompressType::kNone;
+    std::atomic_bool is_reopen_required_{true};    //!< 路径或写入配置改变了，需要重新打开文件
+
     std::string filename_prefix_;
     std::string sym_filename_;
     std::string log_filename_;
 
     std::vector<char> buffer_;
 
-    int fd_ = -1;
-    size_t total_write_size_ = 0;
+    util::FileWriter writer_;
+    std::unique_ptr<util::BlockCompressor> compressor_; //!< 不压缩时为空
+    std::vector<uint8_t> compressed_;
 };
 
 }
@@ -110,6 +110,70 @@ TEST(AsyncFileSink, RemoveLogFileDuringWriting)
     ch.cleanup();
 }
 
+TEST(AsyncFileSink, RecreateAfterRemoved)
+{
+    AsyncFileSink ch;
+    ch.setFilePath("/tmp/tbox");
+    ch.setFilePrefix("recreate_after_removed");
+    util::FileWriter::Config cfg;
+    cfg.prealloc_size = 64 << 10;
+    cfg.block_size = 4096;
+    ch.setFileWriterConfig(cfg);
+    ch.enable();
+
+    LogInfo("first");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    auto first_filename = ch.currentFilename();
+    std::string content;
+    EXPECT_TRUE(util::fs::ReadStringFromTextFile(first_filename, content));
+    EXPECT_NE(content.find("first"), std::string::npos);
+
+    util::fs::RemoveFile(first_filename);
+    LogInfo("second");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ch.cleanup();
+
+    EXPECT_TRUE(util::fs::ReadStringFromTextFile(ch.currentFilename(), content));
+    EXPECT_EQ(content.find("first"), std::string::npos);
+    EXPECT_NE(content.find("second"), std::string::npos);
+    util::fs::RemoveFile(ch.currentFilename());
+}
+
+TEST(AsyncFileSink, Compress)
+{
+    AsyncFileSink ch;
+    ch.setFilePath("/tmp/tbox");
+    ch.setFilePrefix("compress");
+    ch.setFileCompressType(util::CompressType::kLz4);
+    ch.enable();
+
+    for (int i = 0; i < 100; ++i)
+        LogInfo("compressed line %d", i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    LogInfo("last line");
+    ch.cleanup();
+
+    auto filename = ch.currentFilename();
+    EXPECT_EQ(filename.substr(filename.size() - 8), ".log.tbz");
+    EXPECT_TRUE(util::fs::IsFileExist("/tmp/tbox/compress.latest.log.tbz"));
+
+    std::string content;
+    ASSERT_TRUE(util::fs::ReadBinaryFromFile(filename, content));
+    EXPECT_EQ(content.find("last line"), std::string::npos);
+
+    util::BlockDecompressor decompressor;
+    std::string text;
+    size_t pos = 0;
+    while (pos < content.size()) {
+        auto ret = decompressor.decompress(content.data() + pos, content.size() - pos, text);
+        ASSERT_GT(ret, 0);
+        pos += ret;
+    }
+    EXPECT_NE(text.find("compressed line 99"), std::string::npos);
+    EXPECT_NE(text.find("last line"), std::string::npos);
+    util::fs::RemoveFile(filename);
+}
+
 TEST(AsyncFileSink, Truncate)
 {
     auto origin_len = LogSetMaxLength(100);
@@ -19,6 +19,9 @@
  */
 #include "async_sink.h"
 
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <cstring>
 #include <algorithm>
 #include <iostream>
@@ -51,15 +54,38 @@ void AsyncSink::onDisable()
 
 void AsyncSink::onLogFrontEnd(const LogContent *content)
 {
-    async_pipe_.append(content, sizeof(LogContent));
-    if (content->text_len != 0)
-        async_pipe_.append(content->text_ptr, content->text_len);
+    size_t frame_size = sizeof(LogContent) + content->text_len + content->field_num * sizeof(LogField);
+    for (uint32_t i = 0; i < content->field_num; ++i) {
+        auto &field = content->fields[i];
+        if (field.type == LOG_FIELD_STR)
+            frame_size += field.value.s.len;
+    }
+
+    //! 整条日志作为一条记录写入，管道溢出时整条丢弃
+    async_pipe_.appendLock();
+    if (async_pipe_.reserveLockless(frame_size)) {
+        async_pipe_.appendLockless(content, sizeof(LogContent));
+        if (content->text_len != 0)
+            async_pipe_.appendLockless(content->text_ptr, content->text_len);
+
+        //! 结构化字段：先是字段数组，再依次是各字串值的内容
+        if (content->field_num != 0) {
+            async_pipe_.appendLockless(content->fields, content->field_num * sizeof(LogField));
+            for (uint32_t i = 0; i < content->field_num; ++i) {
+                auto &field = content->fields[i];
+                if (field.type == LOG_FIELD_STR && field.value.s.len != 0)
+                    async_pipe_.appendLockless(field.value.s.ptr, field.value.s.len);
+            }
+        }
+    }
+    async_pipe_.appendUnlock();
 }
 
 void AsyncSink::onLogBackEndReadPipe(const void *data_ptr, size_t data_size)
 {
     auto start_ts = std::chrono::steady_clock::now();
 
+    reportDropped();
     buffer_.append(data_ptr, data_size);
 
     bool is_need_flush = false;
@@ -67,17 +93,37 @@ void AsyncSink::onLogBackEndReadPipe(const void *data_ptr, size_t data_size)
         LogContent content;
         ::memcpy(&content, buffer_.readableBegin(), sizeof(content));
 
-        auto frame_size = sizeof(LogContent) + content.text_len;
+        auto frame_begin = reinterpret_cast<const char*>(buffer_.readableBegin());
+        auto fields_offset = sizeof(LogContent) + content.text_len;
+        auto frame_size = fields_offset + content.field_num * sizeof(LogField);
         if (frame_size > buffer_.readableSize())  //! 总结长度不够
             break;
 
-        buffer_.hasRead(sizeof(content));
+        if (content.field_num != 0) {
+            //! 字段数组在缓冲中不一定对齐，拷贝出来用
+            fields_.resize(content.field_num);
+            ::memcpy(fields_.data(), frame_begin + fields_offset, content.field_num * sizeof(LogField));
+
+            auto str_ptr = frame_begin + frame_size;
+            for (auto &field : fields_) {
+                if (field.type == LOG_FIELD_STR) {
+                    field.value.s.ptr = str_ptr;
+                    str_ptr += field.value.s.len;
+                }
+            }
 
-        content.text_ptr = reinterpret_cast<const char*>(buffer_.readableBegin());
+            frame_size = str_ptr - frame_begin;
+            if (frame_size > buffer_.readableSize())
+                break;
+
+            content.fields = fields_.data();
+        }
+
+        content.text_ptr = frame_begin + sizeof(LogContent);
         onLogBackEnd(content);
 
         is_need_flush = true;
-        buffer_.hasRead(content.text_len);
+        buffer_.hasRead(frame_size);
     }
 
     if (is_need_flush)
@@ -116,11 +162,18 @@ void AsyncSink::onLogBackEnd(const LogContent &content)
     if (content.text_len > 0) {
         append(content.text_ptr, content.text_len);
         append(' '); //! 追加空格
+    }
 
-        if (content.text_trunc) {
-            const char *tip = "(TRUNCATED) ";
-            append(tip, ::strlen(tip));
-        }
+    if (content.field_num > 0) {
+        fields_text_.clear();
+        LogAppendFieldsAsText(content.fields, content.field_num, fields_text_);
+        append(fields_text_.data() + 1, fields_text_.size() - 1);   //! 跳过开头的空格
+        append(' ');
+    }
+
+    if (content.text_trunc) {
+        const char *tip = "(TRUNCATED) ";
+        append(tip, ::strlen(tip));
     }
 
     if (content.file_name != nullptr) {
@@ -135,6 +188,32 @@ void AsyncSink::onLogBackEnd(const LogContent &content)
     endline();
 }
 
+void AsyncSink::reportDropped()
+{
+    auto dropped_num = async_pipe_.getStats().dropped_records;
+    if (dropped_num == reported_dropped_num_)
+        return;
+
+    char text[64];
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+
+    LogContent content;
+    ::memset(&content, 0, sizeof(content));
+    content.thread_id = ::syscall(SYS_gettid);
+    content.timestamp.sec = static_cast<uint32_t>(tv.tv_sec);
+    content.timestamp.usec = static_cast<uint32_t>(tv.tv_usec);
+    content.module_id = "tbox.log";
+    content.func_name = __func__;
+    content.level = LOG_LEVEL_WARN;
+    content.text_len = ::snprintf(text, sizeof(text), "%llu logs dropped by pipe overflow",
+                                  static_cast<unsigned long long>(dropped_num - reported_dropped_num_));
+    content.text_ptr = text;
+
+    onLogBackEnd(content);
+    reported_dropped_num_ = dropped_num;
+}
+
 void AsyncSink::append(const char *str, size_t len)
 {
     cache_.reserve(cache_.size() + len);
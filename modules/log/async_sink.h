@@ -23,6 +23,7 @@
 #include "sink.h"
 
 #include <vector>
+#include <string>
 
 #include <tbox/util/async_pipe.h>
 #include <tbox/util/buffer.h>
@@ -37,17 +38,27 @@ class AsyncSink : public Sink {
     void setConfig(const Config &cfg) { cfg_ = cfg; }
     void cleanup();
 
+    //! 设置管道缓冲用尽时的处理策略，下次 enable() 时生效
+    void setOverflowPolicy(util::AsyncPipe::OverflowPolicy policy) { cfg_.overflow_policy = policy; }
+    util::AsyncPipe::OverflowPolicy getOverflowPolicy() const { return cfg_.overflow_policy; }
+    //! 获取管道的溢出统计
+    util::AsyncPipe::Stats getPipeStats() const { return async_pipe_.getStats(); }
+
   protected:
     virtual void onEnable() override;
     virtual void onDisable() override;
 
     virtual void onLogFrontEnd(const LogContent *content) override;
     void onLogBackEndReadPipe(const void *data_ptr, size_t data_size);
-    void onLogBackEnd(const LogContent &content);
+    //! 在后台将一条日志追加到 cache_，默认输出为文本
+    virtual void onLogBackEnd(const LogContent &content);
 
     void append(const char *str, size_t len);
     void append(char ch);
 
+    //! 如果有日志因管道溢出被丢弃，输出一条提示
+    void reportDropped();
+
     virtual void endline() = 0;
     virtual void flush() = 0;
 
@@ -60,6 +71,9 @@ class AsyncSink : public Sink {
     bool is_pipe_inited_ = false;
 
     util::Buffer buffer_;
+    std::vector<LogField> fields_;  //!< 后台从管道中取出的结构化字段
+    std::string fields_text_;
+    uint64_t reported_dropped_num_ = 0;
 };
 
 }
@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <chrono>
+#include <thread>
 #include <algorithm>
 
 #include "async_sink.h"
@@ -43,6 +44,18 @@ class TestAsyncSink : public AsyncSink {
     }
 };
 
+class StringTestAsyncSink : public AsyncSink {
+  public:
+    std::string text;
+
+  protected:
+    virtual void endline() { cache_.push_back('\n'); }
+    virtual void flush() override {
+        text.append(cache_.begin(), cache_.end());
+        cache_.clear();
+    }
+};
+
 class EmptyTestAsyncSink : public AsyncSink {
   protected:
     virtual void endline() { }
@@ -98,6 +111,64 @@ TEST(AsyncSink, Truncate)
     ch.cleanup();
 }
 
+TEST(AsyncSink, KeyValue)
+{
+    StringTestAsyncSink ch;
+    ch.enable();
+
+    std::string name = "tom cat";
+    LogKvInfo("order placed", LogKv("id", 1001), LogKv("price", 12.5), LogKv("ok", true), LogKv("name", name));
+    LogKvInfo("no fields");
+    ch.cleanup();
+
+    EXPECT_NE(ch.text.find("order placed id=1001 price=12.5 ok=true name=\"tom cat\" -- "), std::string::npos);
+    EXPECT_NE(ch.text.find("no fields -- "), std::string::npos);
+}
+
+//! 后台第一次输出时很慢，使管道溢出
+class SlowTestAsyncSink : public StringTestAsyncSink {
+  protected:
+    virtual void flush() override {
+        if (is_first_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            is_first_ = false;
+        }
+        StringTestAsyncSink::flush();
+    }
+    bool is_first_ = true;
+};
+
+TEST(AsyncSink, OverflowDropNewest)
+{
+    SlowTestAsyncSink ch;
+    AsyncSink::Config cfg;
+    cfg.buff_size = 1024;
+    cfg.buff_min_num = 1;
+    cfg.buff_max_num = 2;
+    cfg.interval = 10;
+    cfg.overflow_policy = tbox::util::AsyncPipe::OverflowPolicy::kDropNewest;
+    ch.setConfig(cfg);
+    ch.enable();
+
+    for (int i = 0; i < 200; ++i)
+        LogInfo("line %d", i);
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    LogInfo("end");
+    ch.cleanup();
+
+    auto stats = ch.getPipeStats();
+    EXPECT_GT(stats.dropped_records, 0u);
+    EXPECT_EQ(stats.blocked_times, 0u);
+    EXPECT_NE(ch.text.find("logs dropped by pipe overflow"), std::string::npos);
+
+    //! 没有被丢弃的日志都是完整的
+    size_t line_num = 0;
+    for (size_t pos = 0; (pos = ch.text.find("() line ", pos)) != std::string::npos; ++pos)
+        ++line_num;
+    EXPECT_EQ(line_num + stats.dropped_records, 200u);
+    EXPECT_NE(ch.text.find("() end -- "), std::string::npos);
+}
+
 #include <tbox/event/loop.h>
 using namespace tbox::event;
 
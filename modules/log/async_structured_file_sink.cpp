@@ -0,0 +1,58 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "async_structured_file_sink.h"
+
+namespace tbox {
+namespace log {
+
+namespace {
+const char* GetFileExtension(StructuredLogEncoder::Format format)
+{
+    return format == StructuredLogEncoder::Format::kBinary ? ".slog" : ".jsonl";
+}
+}
+
+AsyncStructuredFileSink::AsyncStructuredFileSink(Format format) :
+    encoder_(format)
+{
+    setFileExtension(GetFileExtension(format));
+}
+
+void AsyncStructuredFileSink::setFormat(Format format)
+{
+    encoder_ = StructuredLogEncoder(format);
+    setFileExtension(GetFileExtension(format));
+}
+
+void AsyncStructuredFileSink::onLogBackEnd(const LogContent &content)
+{
+    encoder_.encode(content, cache_);
+}
+
+void AsyncStructuredFileSink::onLogFileOpened()
+{
+    //! 二进制格式的每个文件都以文件头与完整的字典开始，可以单独解码
+    header_.clear();
+    encoder_.encodeHeader(header_);
+    cache_.insert(cache_.begin(), header_.begin(), header_.end());
+}
+
+}
+}
@@ -0,0 +1,58 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_ASYNC_STRUCTURED_FILE_SINK_H_20261019
+#define TBOX_LOG_ASYNC_STRUCTURED_FILE_SINK_H_20261019
+
+#include "async_file_sink.h"
+#include "structured_log.h"
+
+namespace tbox {
+namespace log {
+
+/**
+ * 结构化日志文件通道
+ *
+ * 与 AsyncFileSink 相同地管理日志文件，只是日志以 JSON-lines 或二进制格式写入，
+ * 由 LogKv*() 输出的结构化字段保留其类型，便于日志收集程序直接解析。
+ * 文件的扩展名分别为 .jsonl 与 .slog，二进制格式可用 ztail 工具还原为 JSON-lines
+ */
+class AsyncStructuredFileSink : public AsyncFileSink {
+  public:
+    using Format = StructuredLogEncoder::Format;
+
+    explicit AsyncStructuredFileSink(Format format = Format::kJsonLines);
+
+    //! 设置格式，须在 enable() 之前设置
+    void setFormat(Format format);
+    Format getFormat() const { return encoder_.format(); }
+
+  protected:
+    virtual void onLogBackEnd(const LogContent &content) override;
+    virtual void onLogFileOpened() override;
+
+  private:
+    StructuredLogEncoder encoder_;
+    std::vector<char> header_;
+};
+
+}
+}
+
+#endif //TBOX_LOG_ASYNC_STRUCTURED_FILE_SINK_H_20261019
@@ -0,0 +1,98 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <thread>
+#include <chrono>
+
+#include <tbox/util/fs.h>
+#include <tbox/util/string.h>
+
+#include "async_structured_file_sink.h"
+
+namespace tbox {
+namespace log {
+namespace {
+
+TEST(AsyncStructuredFileSink, JsonLines)
+{
+    AsyncStructuredFileSink ch;
+    ch.setFilePath("/tmp/tbox");
+    ch.setFilePrefix("structured_jsonl");
+    ch.enable();
+
+    LogKvInfo("order placed", LogKv("id", 1001), LogKv("user", std::string("tom")));
+    LogInfo("plain %d", 1);
+    ch.cleanup();
+
+    auto filename = ch.currentFilename();
+    EXPECT_TRUE(util::string::IsEndWith(filename, ".jsonl"));
+
+    std::string content;
+    ASSERT_TRUE(util::fs::ReadStringFromTextFile(filename, content));
+    EXPECT_NE(content.find("\"msg\":\"order placed\",\"fields\":{\"id\":1001,\"user\":\"tom\"}}\n"), std::string::npos);
+    EXPECT_NE(content.find("\"msg\":\"plain 1\"}\n"), std::string::npos);
+    util::fs::RemoveFile(filename);
+}
+
+TEST(AsyncStructuredFileSink, Binary)
+{
+    AsyncStructuredFileSink ch(AsyncStructuredFileSink::Format::kBinary);
+    ch.setFilePath("/tmp/tbox");
+    ch.setFilePrefix("structured_binary");
+    ch.setFileMaxSize(200);
+    ch.enable();
+
+    for (int i = 0; i < 10; ++i) {
+        LogKvInfo("tick", LogKv("count", i));
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    }
+    ch.cleanup();
+
+    //! 切换文件后，每个文件都可以单独解码
+    std::vector<std::string> filenames;
+    ASSERT_TRUE(util::fs::ListDirectory("/tmp/tbox", filenames));
+
+    int total_num = 0;
+    for (auto &filename : filenames) {
+        if (!util::string::IsStartWith(filename, "structured_binary.") ||
+            filename.find(".slog") == std::string::npos || filename.find("latest") != std::string::npos)
+            continue;
+
+        std::string content;
+        auto full_filename = "/tmp/tbox/" + filename;
+        ASSERT_TRUE(util::fs::ReadBinaryFromFile(full_filename, content));
+        EXPECT_TRUE(StructuredLogDecoder::IsBinary(content.data(), content.size()));
+
+        StructuredLogDecoder decoder;
+        std::string json_lines;
+        EXPECT_EQ(decoder.decode(content.data(), content.size(), json_lines), static_cast<ssize_t>(content.size()));
+        size_t pos = 0;
+        while ((pos = json_lines.find("\"msg\":\"tick\"", pos)) != std::string::npos) {
+            ++total_num;
+            ++pos;
+        }
+        util::fs::RemoveFile(full_filename);
+    }
+    EXPECT_EQ(total_num, 10);
+}
+
+}
+}
+}
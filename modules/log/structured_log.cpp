@@ -0,0 +1,529 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "structured_log.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <tbox/util/scalable_integer.h>
+
+namespace tbox {
+namespace log {
+
+namespace {
+
+const char kBinaryMagic[4] = {'T', 'B', 'S', 'L'};
+constexpr uint8_t kBinaryVersion = 1;
+constexpr uint8_t kTagDict = 'D';
+constexpr uint8_t kTagRecord = 'R';
+constexpr uint8_t kTagHeader = 'T';    //!< 即 kBinaryMagic 的第一个字节，文件头也当作一个条目
+constexpr uint8_t kFlagTruncated = 0x01;
+constexpr uint64_t kMaxLength = 16 << 20;   //!< 字串长度的上限，超过则认为数据有误
+constexpr size_t kMaxPtrCacheSize = 4096;
+
+const char* kLevelNames[LOG_LEVEL_MAX] = {
+    "fatal", "error", "warn", "notice", "important", "info", "debug", "trace"
+};
+
+template <typename Out>
+void AppendRaw(Out &out, const char *str, size_t len)
+{
+    out.insert(out.end(), str, str + len);
+}
+
+template <typename Out>
+void AppendRaw(Out &out, const char *str)
+{
+    AppendRaw(out, str, ::strlen(str));
+}
+
+template <typename Out>
+void AppendJsonString(Out &out, const char *ptr, size_t len)
+{
+    out.push_back('"');
+    for (size_t i = 0; i < len; ++i) {
+        char c = ptr[i];
+        switch (c) {
+            case '"':  AppendRaw(out, "\\\"", 2); break;
+            case '\\': AppendRaw(out, "\\\\", 2); break;
+            case '\n': AppendRaw(out, "\\n", 2); break;
+            case '\r': AppendRaw(out, "\\r", 2); break;
+            case '\t': AppendRaw(out, "\\t", 2); break;
+            default:
+                if (static_cast<uint8_t>(c) < 0x20) {
+                    char buff[8];
+                    int len = ::snprintf(buff, sizeof(buff), "\\u%04x", c);
+                    AppendRaw(out, buff, len);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+template <typename Out>
+void AppendJsonString(Out &out, const char *str)
+{
+    AppendJsonString(out, str, ::strlen(str));
+}
+
+template <typename Out>
+void AppendJsonValue(Out &out, const LogField &field)
+{
+    char buff[32];
+    int len = 0;
+
+    switch (field.type) {
+        case LOG_FIELD_INT:
+            len = ::snprintf(buff, sizeof(buff), "%lld", static_cast<long long>(field.value.i));
+            break;
+        case LOG_FIELD_UINT:
+            len = ::snprintf(buff, sizeof(buff), "%llu", static_cast<unsigned long long>(field.value.u));
+            break;
+        case LOG_FIELD_DOUBLE:
+            if (!std::isfinite(field.value.d)) {
+                AppendRaw(out, "null", 4);
+                return;
+            }
+            //! 优先用较短的形式，不能精确还原时才用17位
+            len = ::snprintf(buff, sizeof(buff), "%.15g", field.value.d);
+            if (std::strtod(buff, nullptr) != field.value.d)
+                len = ::snprintf(buff, sizeof(buff), "%.17g", field.value.d);
+            break;
+        case LOG_FIELD_BOOL:
+            AppendRaw(out, field.value.b ? "true" : "false");
+            return;
+        case LOG_FIELD_STR:
+            AppendJsonString(out, field.value.s.ptr, field.value.s.len);
+            return;
+        default:
+            AppendRaw(out, "null", 4);
+            return;
+    }
+    AppendRaw(out, buff, len);
+}
+
+//! 将一条日志输出为一行JSON
+template <typename Out>
+void AppendJsonLine(Out &out, const LogContent &content)
+{
+    char buff[128];
+    int len = ::snprintf(buff, sizeof(buff), "{\"ts\":%u.%06u,\"level\":\"%s\",\"thread\":%ld,\"module\":",
+                         content.timestamp.sec, content.timestamp.usec,
+                         kLevelNames[content.level], content.thread_id);
+    AppendRaw(out, buff, len);
+    AppendJsonString(out, content.module_id);
+
+    if (content.func_name != nullptr) {
+        AppendRaw(out, ",\"func\":");
+        AppendJsonString(out, content.func_name);
+    }
+
+    if (content.file_name != nullptr) {
+        AppendRaw(out, ",\"file\":");
+        AppendJsonString(out, content.file_name);
+        len = ::snprintf(buff, sizeof(buff), ",\"line\":%d", content.line);
+        AppendRaw(out, buff, len);
+    }
+
+    AppendRaw(out, ",\"msg\":");
+    AppendJsonString(out, content.text_ptr, content.text_len);
+
+    if (content.text_trunc)
+        AppendRaw(out, ",\"trunc\":true");
+
+    if (content.field_num > 0) {
+        AppendRaw(out, ",\"fields\":{");
+        for (uint32_t i = 0; i < content.field_num; ++i) {
+            auto &field = content.fields[i];
+            if (i != 0)
+                out.push_back(',');
+            AppendJsonString(out, field.key);
+            out.push_back(':');
+            AppendJsonValue(out, field);
+        }
+        out.push_back('}');
+    }
+
+    AppendRaw(out, "}\n", 2);
+}
+
+void PutVarint(std::vector<char> &out, uint64_t value)
+{
+    char buff[10];
+    auto len = util::DumpScalableInteger(value, buff, sizeof(buff));
+    out.insert(out.end(), buff, buff + len);
+}
+
+void PutString(std::vector<char> &out, const char *ptr, size_t len)
+{
+    PutVarint(out, len);
+    out.insert(out.end(), ptr, ptr + len);
+}
+
+inline uint64_t ZigZagEncode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+//! 从二进制数据中顺序读取，数据不足时返回false
+class Reader {
+  public:
+    Reader(const uint8_t *data, size_t size) : ptr_(data), end_(data + size) { }
+
+    size_t offset(const uint8_t *begin) const { return ptr_ - begin; }
+
+    bool getByte(uint8_t &value)
+    {
+        if (ptr_ >= end_)
+            return false;
+        value = *ptr_++;
+        return true;
+    }
+
+    bool getVarint(uint64_t &value)
+    {
+        auto len = util::ParseScalableInteger(ptr_, end_ - ptr_, value);
+        ptr_ += len;
+        return len != 0;
+    }
+
+    bool getBytes(size_t len, const char *&ptr)
+    {
+        if (static_cast<size_t>(end_ - ptr_) < len)
+            return false;
+        ptr = reinterpret_cast<const char*>(ptr_);
+        ptr_ += len;
+        return true;
+    }
+
+  private:
+    const uint8_t *ptr_;
+    const uint8_t *end_;
+};
+
+}
+
+void StructuredLogEncoder::encode(const LogContent &content, std::vector<char> &out)
+{
+    if (format_ == Format::kJsonLines) {
+        AppendJsonLine(out, content);
+        return;
+    }
+
+    //! 先确定所有字串的序号，新的字典项要写在日志条目之前
+    auto module_index = getStringIndex(content.module_id, out);
+    auto func_index = getStringIndex(content.func_name, out);
+    auto file_index = getStringIndex(content.file_name, out);
+
+    key_indexes_.clear();
+    for (uint32_t i = 0; i < content.field_num; ++i)
+        key_indexes_.push_back(getStringIndex(content.fields[i].key, out));
+
+    out.push_back(kTagRecord);
+    PutVarint(out, content.timestamp.sec);
+    PutVarint(out, content.timestamp.usec);
+    PutVarint(out, content.thread_id);
+    out.push_back(content.level);
+    out.push_back(content.text_trunc ? kFlagTruncated : 0);
+    PutVarint(out, module_index);
+    PutVarint(out, func_index);
+    PutVarint(out, file_index);
+    PutVarint(out, content.line);
+    PutString(out, content.text_ptr, content.text_len);
+
+    PutVarint(out, content.field_num);
+    for (uint32_t i = 0; i < content.field_num; ++i) {
+        auto &field = content.fields[i];
+        PutVarint(out, key_indexes_[i]);
+        out.push_back(field.type);
+
+        switch (field.type) {
+            case LOG_FIELD_INT:
+                PutVarint(out, ZigZagEncode(field.value.i));
+                break;
+            case LOG_FIELD_UINT:
+                PutVarint(out, field.value.u);
+                break;
+            case LOG_FIELD_DOUBLE: {
+                uint64_t bits;
+                ::memcpy(&bits, &field.value.d, sizeof(bits));
+                for (int j = 0; j < 8; ++j)
+                    out.push_back(static_cast<char>(bits >> (j * 8)));
+                break;
+            }
+            case LOG_FIELD_BOOL:
+                out.push_back(field.value.b ? 1 : 0);
+                break;
+            case LOG_FIELD_STR:
+                PutString(out, field.value.s.ptr, field.value.s.len);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void StructuredLogEncoder::encodeHeader(std::vector<char> &out) const
+{
+    if (format_ != Format::kBinary)
+        return;
+
+    out.insert(out.end(), kBinaryMagic, kBinaryMagic + sizeof(kBinaryMagic));
+    out.push_back(kBinaryVersion);
+
+    for (size_t i = 0; i < dict_.size(); ++i) {
+        out.push_back(kTagDict);
+        PutVarint(out, i + 1);
+        PutString(out, dict_[i].data(), dict_[i].size());
+    }
+}
+
+uint32_t StructuredLogEncoder::getStringIndex(const char *str, std::vector<char> &out)
+{
+    if (str == nullptr)
+        return 0;
+
+    //! 同一个地址的内容通常不会变，但还是要比较一下，以防地址被重用
+    auto ptr_iter = ptr_to_index_.find(str);
+    if (ptr_iter != ptr_to_index_.end() && dict_[ptr_iter->second - 1] == str)
+        return ptr_iter->second;
+
+    uint32_t index = 0;
+    auto str_iter = str_to_index_.find(str);
+    if (str_iter != str_to_index_.end()) {
+        index = str_iter->second;
+    } else {
+        dict_.push_back(str);
+        index = dict_.size();
+        str_to_index_[dict_.back()] = index;
+
+        out.push_back(kTagDict);
+        PutVarint(out, index);
+        PutString(out, dict_.back().data(), dict_.back().size());
+    }
+
+    if (ptr_to_index_.size() >= kMaxPtrCacheSize)
+        ptr_to_index_.clear();
+    ptr_to_index_[str] = index;
+    return index;
+}
+
+bool StructuredLogEncoder::ParseFormat(const std::string &name, Format &format)
+{
+    if (name == "jsonl")
+        format = Format::kJsonLines;
+    else if (name == "binary")
+        format = Format::kBinary;
+    else
+        return false;
+    return true;
+}
+
+const char* StructuredLogEncoder::FormatName(Format format)
+{
+    switch (format) {
+        case Format::kJsonLines: return "jsonl";
+        case Format::kBinary:    return "binary";
+    }
+    return "unknown";
+}
+
+///////////////////////////////////////////////////////////////////////
+
+bool StructuredLogDecoder::IsBinary(const void *data, size_t size)
+{
+    return size >= sizeof(kBinaryMagic) && ::memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+
+void StructuredLogDecoder::reset()
+{
+    dict_.clear();
+}
+
+ssize_t StructuredLogDecoder::decode(const void *data, size_t size, std::string &out)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    size_t pos = 0;
+    while (pos < size) {
+        auto ret = decodeEntry(bytes + pos, size - pos, out);
+        if (ret < 0)
+            return -1;
+        if (ret == 0)
+            break;
+        pos += ret;
+    }
+    return pos;
+}
+
+ssize_t StructuredLogDecoder::decodeEntry(const uint8_t *data, size_t size, std::string &out)
+{
+    Reader reader(data, size);
+    uint8_t tag = 0;
+    reader.getByte(tag);
+
+    if (tag == kTagHeader) {
+        const char *magic = nullptr;
+        uint8_t version = 0;
+        if (!reader.getBytes(sizeof(kBinaryMagic) - 1, magic) || !reader.getByte(version))
+            return 0;
+        if (::memcmp(magic, kBinaryMagic + 1, sizeof(kBinaryMagic) - 1) != 0 || version != kBinaryVersion)
+            return -1;
+        return reader.offset(data);
+    }
+
+    if (tag == kTagDict) {
+        uint64_t index = 0, len = 0;
+        const char *ptr = nullptr;
+        if (!reader.getVarint(index) || !reader.getVarint(len))
+            return 0;
+        //! 字典项按序号依次定义，也可以重复定义
+        if (index == 0 || index > dict_.size() + 1 || len > kMaxLength)
+            return -1;
+        if (!reader.getBytes(len, ptr))
+            return 0;
+        if (index > dict_.size())
+            dict_.resize(index);
+        dict_[index - 1].assign(ptr, len);
+        return reader.offset(data);
+    }
+
+    if (tag != kTagRecord)
+        return -1;
+
+    //! 将字典序号转换成字串，0为空
+    bool is_valid = true;
+    auto get_dict_str = [this, &is_valid] (uint64_t index) -> const char* {
+        if (index == 0)
+            return nullptr;
+        if (index > dict_.size()) {
+            is_valid = false;
+            return "";
+        }
+        return dict_[index - 1].c_str();
+    };
+
+    uint64_t sec = 0, usec = 0, thread_id = 0, module_index = 0, func_index = 0, file_index = 0, line = 0;
+    uint64_t text_len = 0, field_num = 0;
+    uint8_t level = 0, flags = 0;
+    const char *text_ptr = nullptr;
+
+    if (!reader.getVarint(sec) || !reader.getVarint(usec) || !reader.getVarint(thread_id) ||
+        !reader.getByte(level) || !reader.getByte(flags) ||
+        !reader.getVarint(module_index) || !reader.getVarint(func_index) || !reader.getVarint(file_index) ||
+        !reader.getVarint(line) || !reader.getVarint(text_len))
+        return 0;
+
+    if (level >= LOG_LEVEL_MAX || text_len > kMaxLength)
+        return -1;
+
+    if (!reader.getBytes(text_len, text_ptr) || !reader.getVarint(field_num))
+        return 0;
+
+    if (field_num > kMaxLength)
+        return -1;
+
+    fields_.resize(field_num);
+    for (auto &field : fields_) {
+        uint64_t key_index = 0;
+        uint8_t type = 0;
+        if (!reader.getVarint(key_index) || !reader.getByte(type))
+            return 0;
+
+        field.key = get_dict_str(key_index);
+        field.type = type;
+
+        uint64_t value = 0;
+        switch (type) {
+            case LOG_FIELD_INT:
+                if (!reader.getVarint(value))
+                    return 0;
+                field.value.i = ZigZagDecode(value);
+                break;
+            case LOG_FIELD_UINT:
+                if (!reader.getVarint(field.value.u))
+                    return 0;
+                break;
+            case LOG_FIELD_DOUBLE: {
+                const char *ptr = nullptr;
+                if (!reader.getBytes(8, ptr))
+                    return 0;
+                for (int j = 0; j < 8; ++j)
+                    value |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[j])) << (j * 8);
+                ::memcpy(&field.value.d, &value, sizeof(value));
+                break;
+            }
+            case LOG_FIELD_BOOL: {
+                uint8_t b = 0;
+                if (!reader.getByte(b))
+                    return 0;
+                field.value.b = b;
+                break;
+            }
+            case LOG_FIELD_STR:
+                if (!reader.getVarint(value))
+                    return 0;
+                if (value > kMaxLength)
+                    return -1;
+                if (!reader.getBytes(value, field.value.s.ptr))
+                    return 0;
+                field.value.s.len = value;
+                break;
+            default:
+                return -1;
+        }
+
+        if (field.key == nullptr)
+            is_valid = false;
+    }
+
+    LogContent content;
+    ::memset(&content, 0, sizeof(content));
+    content.thread_id = thread_id;
+    content.timestamp.sec = sec;
+    content.timestamp.usec = usec;
+    content.module_id = get_dict_str(module_index);
+    content.func_name = get_dict_str(func_index);
+    content.file_name = get_dict_str(file_index);
+    content.line = line;
+    content.level = level;
+    content.text_len = text_len;
+    content.text_ptr = text_ptr;
+    content.text_trunc = (flags & kFlagTruncated) != 0;
+    content.field_num = field_num;
+    content.fields = fields_.data();
+
+    if (!is_valid || content.module_id == nullptr)
+        return -1;
+
+    AppendJsonLine(out, content);
+    return reader.offset(data);
+}
+
+}
+}
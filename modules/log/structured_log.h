@@ -0,0 +1,119 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_LOG_STRUCTURED_LOG_H_20261019
+#define TBOX_LOG_STRUCTURED_LOG_H_20261019
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sys/types.h>
+
+#include <tbox/base/log_impl.h>
+
+namespace tbox {
+namespace log {
+
+/**
+ * 结构化日志的编码器
+ *
+ * 将 LogContent 编码为 JSON-lines 或紧凑的二进制格式，便于日志收集程序直接解析，不必用正则匹配文本。
+ *
+ * JSON-lines 格式，每行一条：
+ *   {"ts":1760860800.123456,"level":"info","thread":123,"module":"app","func":"onOrder",
+ *    "file":"order.cpp","line":42,"msg":"order placed","fields":{"id":1001,"price":12.5}}
+ *
+ * 二进制格式：
+ *   文件头 "TBSL" + 版本(1B)，之后是一个个条目，条目的第一个字节为类型：
+ *   'D' 字典项：序号，长度，内容
+ *   'R' 日志：秒，微秒，线程号，等级(1B)，标记(1B)，模块序号，函数序号，文件序号，行号，
+ *             消息长度，消息，字段数，每个字段：键序号，类型(1B)，值
+ *   整数均为 util::DumpScalableInteger() 的可变长格式，有符号整数先做 zigzag 编码，
+ *   浮点数为小端的8字节，字串为长度+内容。字典序号从1开始，0表示空。
+ *
+ * 模块名、函数名、文件名与字段名都编入字典，每个字串只在第一次出现时写出内容，之后只写序号。
+ * 这些字串都是常量，字典先按地址查找，命中时不需要计算字串的哈希。
+ */
+class StructuredLogEncoder {
+  public:
+    enum class Format {
+        kJsonLines, //!< 每行一条JSON（默认）
+        kBinary,    //!< 带字典的二进制格式
+    };
+
+    explicit StructuredLogEncoder(Format format = Format::kJsonLines) : format_(format) { }
+
+    Format format() const { return format_; }
+
+    //! 编码一条日志，追加到 out
+    void encode(const LogContent &content, std::vector<char> &out);
+
+    /**
+     * 二进制格式下，输出文件头及当前完整的字典，JSON-lines 格式下什么也不做
+     *
+     * 在每个文件的开头调用，使每个文件都可以单独解码
+     */
+    void encodeHeader(std::vector<char> &out) const;
+
+    //! 解析与获取 Format 的名称，名称分别为：jsonl, binary
+    static bool ParseFormat(const std::string &name, Format &format);
+    static const char* FormatName(Format format);
+
+  protected:
+    uint32_t getStringIndex(const char *str, std::vector<char> &out);
+
+  private:
+    Format format_;
+    std::vector<std::string> dict_;
+    std::unordered_map<std::string, uint32_t> str_to_index_;
+    std::unordered_map<const char*, uint32_t> ptr_to_index_;
+    std::vector<uint32_t> key_indexes_;
+};
+
+/**
+ * 二进制格式的结构化日志解码器，将其还原为与 JSON-lines 格式相同的文本
+ */
+class StructuredLogDecoder {
+  public:
+    /**
+     * 解码，解出来的 JSON 行追加到 out
+     *
+     * \return  >=0 消耗的字节数，末尾不完整的条目留待下次
+     *          -1  数据有误
+     */
+    ssize_t decode(const void *data, size_t size, std::string &out);
+
+    void reset();
+
+    //! 数据是否以二进制格式的文件头开始
+    static bool IsBinary(const void *data, size_t size);
+
+  protected:
+    //! 解码一个条目，返回其大小，0表示不完整，-1表示有误
+    ssize_t decodeEntry(const uint8_t *data, size_t size, std::string &out);
+
+  private:
+    std::vector<std::string> dict_;
+    std::vector<LogField> fields_;
+};
+
+}
+}
+
+#endif //TBOX_LOG_STRUCTURED_LOG_H_20261019
@@ -0,0 +1,180 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include "structured_log.h"
+
+namespace tbox {
+namespace log {
+namespace {
+
+LogContent MakeContent(const char *msg, const LogField *fields, uint32_t field_num)
+{
+    LogContent content;
+    ::memset(&content, 0, sizeof(content));
+    content.thread_id = 123;
+    content.timestamp.sec = 1760860800;
+    content.timestamp.usec = 1234;
+    content.module_id = "test";
+    content.func_name = "func";
+    content.file_name = "a.cpp";
+    content.line = 42;
+    content.level = LOG_LEVEL_INFO;
+    content.text_len = ::strlen(msg);
+    content.text_ptr = msg;
+    content.field_num = field_num;
+    content.fields = fields;
+    return content;
+}
+
+TEST(StructuredLog, JsonLines)
+{
+    std::string name = "tom \"cat\"\n";
+    LogField fields[] = {
+        LogKv("id", 1001),
+        LogKv("delta", -5L),
+        LogKv("count", 7u),
+        LogKv("price", 12.5),
+        LogKv("ok", true),
+        LogKv("name", name),
+    };
+    auto content = MakeContent("order placed", fields, 6);
+
+    StructuredLogEncoder encoder;
+    std::vector<char> out;
+    encoder.encode(content, out);
+
+    EXPECT_EQ(std::string(out.begin(), out.end()),
+              "{\"ts\":1760860800.001234,\"level\":\"info\",\"thread\":123,\"module\":\"test\","
+              "\"func\":\"func\",\"file\":\"a.cpp\",\"line\":42,\"msg\":\"order placed\","
+              "\"fields\":{\"id\":1001,\"delta\":-5,\"count\":7,\"price\":12.5,\"ok\":true,"
+              "\"name\":\"tom \\\"cat\\\"\\n\"}}\n");
+
+    //! 没有字段的普通日志
+    out.clear();
+    content = MakeContent("hello", nullptr, 0);
+    content.func_name = nullptr;
+    encoder.encode(content, out);
+    EXPECT_EQ(std::string(out.begin(), out.end()),
+              "{\"ts\":1760860800.001234,\"level\":\"info\",\"thread\":123,\"module\":\"test\","
+              "\"file\":\"a.cpp\",\"line\":42,\"msg\":\"hello\"}\n");
+}
+
+TEST(StructuredLog, Binary)
+{
+    StructuredLogEncoder json_encoder;
+    StructuredLogEncoder binary_encoder(StructuredLogEncoder::Format::kBinary);
+    std::vector<char> json_out, binary_out;
+    binary_encoder.encodeHeader(binary_out);
+
+    for (int i = 0; i < 100; ++i) {
+        std::string value = "value " + std::to_string(i);
+        LogField fields[] = {
+            LogKv("i", i - 50),
+            LogKv("u", static_cast<uint64_t>(i) << 40),
+            LogKv("d", i / 3.0),
+            LogKv("b", i % 2 == 0),
+            LogKv("s", value),
+        };
+        auto content = MakeContent("binary", fields, 5);
+        json_encoder.encode(content, json_out);
+        binary_encoder.encode(content, binary_out);
+    }
+
+    //! 字典使重复的字串只写一次
+    EXPECT_LT(binary_out.size(), json_out.size() / 3);
+
+    StructuredLogDecoder decoder;
+    std::string decoded;
+    EXPECT_TRUE(StructuredLogDecoder::IsBinary(binary_out.data(), binary_out.size()));
+    EXPECT_EQ(decoder.decode(binary_out.data(), binary_out.size(), decoded), static_cast<ssize_t>(binary_out.size()));
+    EXPECT_EQ(decoded, std::string(json_out.begin(), json_out.end()));
+}
+
+TEST(StructuredLog, BinaryPartial)
+{
+    StructuredLogEncoder encoder(StructuredLogEncoder::Format::kBinary);
+    std::vector<char> out;
+    encoder.encodeHeader(out);
+    LogField fields[] = { LogKv("key", "value") };
+    auto content = MakeContent("partial", fields, 1);
+    encoder.encode(content, out);
+    encoder.encode(content, out);
+
+    StructuredLogEncoder json_encoder;
+    std::vector<char> json_out;
+    json_encoder.encode(content, json_out);
+    json_encoder.encode(content, json_out);
+
+    //! 逐字节喂入，不完整的条目留待下次
+    StructuredLogDecoder decoder;
+    std::string decoded;
+    std::string pending;
+    for (char c : out) {
+        pending.push_back(c);
+        auto ret = decoder.decode(pending.data(), pending.size(), decoded);
+        ASSERT_GE(ret, 0);
+        pending.erase(0, ret);
+    }
+    EXPECT_TRUE(pending.empty());
+    EXPECT_EQ(decoded, std::string(json_out.begin(), json_out.end()));
+
+    //! 数据有误
+    std::string bad = "Xabc";
+    EXPECT_EQ(decoder.decode(bad.data(), bad.size(), decoded), -1);
+}
+
+TEST(StructuredLog, BinaryNewFile)
+{
+    StructuredLogEncoder encoder(StructuredLogEncoder::Format::kBinary);
+    LogField fields[] = { LogKv("key", 1) };
+    auto content = MakeContent("first", fields, 1);
+
+    std::vector<char> first_file;
+    encoder.encodeHeader(first_file);
+    encoder.encode(content, first_file);
+
+    //! 新文件的开头带有完整的字典，其中的日志可以引用之前定义的字典项
+    std::vector<char> second_file;
+    encoder.encodeHeader(second_file);
+    content.text_ptr = "second";
+    content.text_len = 6;
+    encoder.encode(content, second_file);
+
+    StructuredLogDecoder decoder;
+    std::string decoded;
+    EXPECT_EQ(decoder.decode(second_file.data(), second_file.size(), decoded), static_cast<ssize_t>(second_file.size()));
+    EXPECT_NE(decoded.find("\"msg\":\"second\",\"fields\":{\"key\":1}"), std::string::npos);
+}
+
+TEST(StructuredLog, Format)
+{
+    StructuredLogEncoder::Format format;
+    for (auto name : {"jsonl", "binary"}) {
+        EXPECT_TRUE(StructuredLogEncoder::ParseFormat(name, format));
+        EXPECT_STREQ(StructuredLogEncoder::FormatName(format), name);
+    }
+    EXPECT_FALSE(StructuredLogEncoder::ParseFormat("xml", format));
+}
+
+}
+}
+}
@@ -21,6 +21,7 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <string>
 
 namespace tbox {
 namespace log {
@@ -44,6 +45,12 @@ void SyncStdoutSink::onLogFrontEnd(const LogContent *content)
     if (content->text_len > 0)
         printf("%.*s ", content->text_len, content->text_ptr);
 
+    if (content->field_num > 0) {
+        std::string fields_text;
+        LogAppendFieldsAsText(content->fields, content->field_num, fields_text);
+        printf("%s ", fields_text.c_str() + 1);  //! 跳过开头的空格
+    }
+
     if (content->text_trunc)
         printf("(TRUNCATED) ");
 
@@ -215,6 +215,36 @@ bool ContextImp::initThreadPool(const Json &js)
         return false;
     }
 
+    if (util::json::HasObjectField(js, "adaptive")) {
+        auto &js_adaptive = js["adaptive"];
+        eventx::ThreadPool::AdaptiveConfig adaptive_cfg;
+        int value = 0;
+        double ratio = 0;
+
+        if (util::json::GetField(js_adaptive, "target_p99_us", value))
+            adaptive_cfg.target_wait_p99 = std::chrono::microseconds(value);
+
+        if (util::json::GetField(js_adaptive, "interval_ms", value))
+            adaptive_cfg.interval = std::chrono::milliseconds(value);
+
+        if (util::json::GetField(js_adaptive, "hysteresis", ratio))
+            adaptive_cfg.hysteresis = ratio;
+
+        if (util::json::GetField(js_adaptive, "shrink_periods", value))
+            adaptive_cfg.shrink_periods = value;
+
+        if (util::json::GetField(js_adaptive, "max_cpu_usage", ratio))
+            adaptive_cfg.max_cpu_usage = ratio;
+
+        if (util::json::GetField(js_adaptive, "step", value))
+            adaptive_cfg.step = value;
+
+        if (!sp_thread_pool_->setAdaptive(adaptive_cfg)) {
+            LogWarn("in cfg.thread_pool.adaptive, invalid config");
+            return false;
+        }
+    }
+
     if (!sp_thread_pool_->initialize(thread_pool_min, thread_pool_max))
         return false;
 
@@ -412,12 +442,58 @@ void ContextImp::initShell()
                     oss << "\r\n";
                     oss << "doing_task_num: " << snapshot.doing_task_num << "\r\n";
                     oss << "undo_task_peak_num: " << snapshot.undo_task_peak_num << "\r\n";
+                    oss << "keep_thread_num: " << snapshot.keep_thread_num << "\r\n";
+                    oss << "deadline_task_num: " << snapshot.deadline_task_num << "\r\n";
+                    oss << "deadline_miss_num: " << snapshot.deadline_miss_num << "\r\n";
+                    if (snapshot.adaptive.enabled) {
+                        oss << "adaptive.wait_p99: " << snapshot.adaptive.wait_p99_us << " us\r\n";
+                        oss << "adaptive.cpu_usage: " << snapshot.adaptive.cpu_usage * 100 << " %\r\n";
+                        oss << "adaptive.decision: " << eventx::ToString(snapshot.adaptive.decision) << "\r\n";
+                        oss << "adaptive.grow_times: " << snapshot.adaptive.grow_times << "\r\n";
+                        oss << "adaptive.shrink_times: " << snapshot.adaptive.shrink_times << "\r\n";
+                    }
                     s.send(oss.str());
                     (void)args;
                 }
             , "Print thread pool's snapshot");
             wp_nodes->mountNode(threadpool_node, func_node, "snapshot");
         }
+
+        {
+            auto stat_node = wp_nodes->createDirNode("ThreadPool's latency and utilization statistics");
+            wp_nodes->mountNode(threadpool_node, stat_node, "stat");
+
+            auto print_node = wp_nodes->createFuncNode(
+                [this] (const Session &s, const Args &) {
+                    std::stringstream ss;
+                    ss << sp_thread_pool_->getStat();
+                    std::string txt = ss.str();
+                    util::string::Replace(txt, "\n", "\r\n");
+                    s.send(txt);
+                }
+            , "print ThreadPool's stat data");
+            wp_nodes->mountNode(stat_node, print_node, "print");
+
+            auto dump_node = wp_nodes->createFuncNode(
+                [this] (const Session &s, const Args &) {
+                    Json js;
+                    sp_thread_pool_->getStat().toJson(js);
+                    auto json_str = js.dump(2);
+                    util::string::Replace(json_str, "\n", "\r\n");
+                    s.send(json_str);
+                    s.send("\r\n");
+                }
+            , "dump ThreadPool's stat data as JSON");
+            wp_nodes->mountNode(stat_node, dump_node, "dump");
+
+            auto reset_node = wp_nodes->createFuncNode(
+                [this] (const Session &s, const Args &) {
+                    sp_thread_pool_->resetStat();
+                    s.send("done\r\n");
+                }
+            , "reset ThreadPool's stat data");
+            wp_nodes->mountNode(stat_node, reset_node, "reset");
+        }
     }
 
     {
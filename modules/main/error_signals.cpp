@@ -28,6 +28,7 @@
 #include <tbox/base/log.h>
 #include <tbox/base/scope_exit.hpp>
 #include <tbox/base/backtrace.h>
+#include <tbox/trace/sink.h>
 
 #define TBOX_USE_SIGACTION
 
@@ -101,6 +102,11 @@ void OnErrorSignal(int signo)
         const std::string &stack_str = DumpBacktrace();
         LogFatal("main: <%p>\n-----call stack-----\n%s", ::main, stack_str.c_str());
 
+        //! 若处于飞行记录仪模式，转储崩溃前各线程的记录
+        //! 不能等待后端线程，只能用异步信号安全的 dumpFlightRecordsOnCrash()
+        if (trace::Sink::GetInstance().dumpFlightRecordsOnCrash())
+            LogFatal("trace flight records dumped");
+
         _is_recursion_call = false;
 
     } else {
@@ -59,6 +59,10 @@ bool Log::initialize(const char *proc_name, Context &ctx, const Json &cfg)
             LogSetMaxLength(static_cast<size_t>(max_len));
         }
 
+        //! 限流
+        if (util::json::HasObjectField(js_log, "limits"))
+            initLimitByJson(ctx.loop(), js_log.at("limits"));
+
         //! STDOUT
         if (util::json::HasObjectField(js_log, "stdout")) {
             installStdoutSink();
@@ -74,7 +78,10 @@ bool Log::initialize(const char *proc_name, Context &ctx, const Json &cfg)
         if (util::json::HasObjectField(js_log, "files")) {
             auto &js_files = js_log.at("files");
             for (auto &js_file : js_files.items()) {
-                installFileSink(js_file.key());
+                std::string format;
+                util::json::GetField(js_file.value(), "format", format);
+                if (!installFileSink(js_file.key(), format))
+                    continue;
                 initFileSinkByJson(js_file.key(), js_file.value(), proc_name);
             }
         }
@@ -90,6 +97,11 @@ void Log::cleanup()
 
     uninstallSyslogSink();
     uninstallStdoutSink();
+
+    CHECK_DELETE_RESET_OBJ(limit_flush_timer_);
+    for (auto &module_id : limit_modules_)
+        LogUnsetLimit(module_id.c_str());
+    limit_modules_.clear();
 }
 
 bool Log::installStdoutSink()
@@ -135,6 +147,7 @@ bool Log::installSyslogSink()
 
 bool Log::initSyslogSinkByJson(const Json &js)
 {
+    initAsyncSinkByJson(syslog_sink_->sink, js, "syslog");
     initSinkByJson(syslog_sink_->sink, js);
     return true;
 }
@@ -153,14 +166,27 @@ bool Log::uninstallSyslogSink()
     return true;
 }
 
-bool Log::installFileSink(const std::string &name)
+bool Log::installFileSink(const std::string &name, const std::string &format)
 {
     //! 不能创建已有的通道名
     if (file_sinks_.find(name) != file_sinks_.end())
         return false;
 
+    std::unique_ptr<log::AsyncFileSink> sink;
+    if (format.empty()) {
+        sink.reset(new log::AsyncFileSink);
+    } else {
+        log::StructuredLogEncoder::Format structured_format;
+        if (!log::StructuredLogEncoder::ParseFormat(format, structured_format)) {
+            LogWarn("log file sink '%s' format '%s' is invalid", name.c_str(), format.c_str());
+            return false;
+        }
+        sink.reset(new log::AsyncStructuredFileSink(structured_format));
+    }
+
     auto file_sink = new FileSink;
-    installShellForFileSink(file_sink->sink, file_sink->nodes, name);
+    file_sink->sink = std::move(sink);
+    installShellForFileSink(*file_sink->sink, file_sink->nodes, name);
     file_sinks_.emplace(name, file_sink);
     return true;
 }
@@ -171,8 +197,9 @@ bool Log::initFileSinkByJson(const std::string &name, const Json &js, const char
     if (iter == file_sinks_.end())
         return false;
 
-    auto &sink = iter->second->sink;
+    auto &sink = *iter->second->sink;
 
+    initAsyncSinkByJson(sink, js, "files." + name);
     initSinkByJson(sink, js);
 
     std::string path;
@@ -191,6 +218,30 @@ bool Log::initFileSinkByJson(const std::string &name, const Json &js, const char
     if (util::json::GetField(js, "max_size", max_size))
         sink.setFileMaxSize(max_size * 1024);
 
+    auto writer_cfg = sink.getFileWriterConfig();
+    unsigned int prealloc_size = 0;
+    if (util::json::GetField(js, "prealloc_size", prealloc_size))
+        writer_cfg.prealloc_size = prealloc_size * 1024;
+
+    unsigned int write_block_size = 0;
+    if (util::json::GetField(js, "write_block_size", write_block_size))
+        writer_cfg.block_size = write_block_size * 1024;
+
+    std::string sync_mode;
+    if (util::json::GetField(js, "sync_mode", sync_mode) &&
+        !util::FileWriter::ParseSyncMode(sync_mode, writer_cfg.sync_mode))
+        LogWarn("config 'log.files.%s.sync_mode' field is invalid", name.c_str());
+    sink.setFileWriterConfig(writer_cfg);
+
+    std::string compress;
+    if (util::json::GetField(js, "compress", compress)) {
+        util::CompressType compress_type;
+        if (util::ParseCompressType(compress, compress_type) && util::IsCompressTypeSupported(compress_type))
+            sink.setFileCompressType(compress_type);
+        else
+            LogWarn("config 'log.files.%s.compress' field is invalid or not supported", name.c_str());
+    }
+
     return true;
 }
 
@@ -209,8 +260,8 @@ bool Log::uninstallFileSink(const std::string &name)
 
 bool Log::uninstallFileSink(FileSink *file_sink, const std::string &name)
 {
-    file_sink->sink.disable();
-    file_sink->sink.cleanup();
+    file_sink->sink->disable();
+    file_sink->sink->cleanup();
 
     uninstallShellForFileSink(file_sink->nodes, name);
 
@@ -218,6 +269,40 @@ bool Log::uninstallFileSink(FileSink *file_sink, const std::string &name)
     return true;
 }
 
+void Log::initLimitByJson(event::Loop *loop, const Json &js)
+{
+    for (auto &item : js.items()) {
+        auto &js_limit = item.value();
+        LogLimitConfig config = { 0, 0, false };
+        util::json::GetField(js_limit, "rate", config.rate);
+        util::json::GetField(js_limit, "burst", config.burst);
+        util::json::GetField(js_limit, "merge_repeat", config.merge_repeat);
+
+        LogSetLimit(item.key().c_str(), &config);
+        limit_modules_.push_back(item.key());
+    }
+
+    //! 定时输出被丢弃与被合并日志的汇总
+    if (!limit_modules_.empty() && limit_flush_timer_ == nullptr) {
+        limit_flush_timer_ = loop->newTimerEvent("main::Log::limit_flush_timer_");
+        limit_flush_timer_->initialize(std::chrono::seconds(10), event::Event::Mode::kPersist);
+        limit_flush_timer_->setCallback([] { LogFlushLimit(); });
+        limit_flush_timer_->enable();
+    }
+}
+
+void Log::initAsyncSinkByJson(log::AsyncSink &sink, const Json &js, const std::string &name)
+{
+    std::string overflow_policy;
+    if (util::json::GetField(js, "overflow_policy", overflow_policy)) {
+        util::AsyncPipe::OverflowPolicy policy;
+        if (util::AsyncPipe::ParseOverflowPolicy(overflow_policy, policy))
+            sink.setOverflowPolicy(policy);
+        else
+            LogWarn("config 'log.%s.overflow_policy' field is invalid", name.c_str());
+    }
+}
+
 void Log::initSinkByJson(log::Sink &sink, const Json &js)
 {
     bool enable = false;
@@ -282,19 +367,20 @@ void Log::initShell()
                             oss << "fail, already exist.\r\n";
                     }
 
-                } else if (a.size() == 3 && a[1] == "file") {
+                } else if ((a.size() == 3 || a.size() == 4) && a[1] == "file") {
                     print_usage = false;
-                    if (installFileSink(a[2]))
+                    if (installFileSink(a[2], a.size() == 4 ? a[3] : ""))
                         oss << "done\r\n";
                     else
-                        oss << "fail, already exist.\r\n";
+                        oss << "fail, already exist or invalid format.\r\n";
                 }
 
                 if (print_usage) {
                     oss << "Install log sink.\r\n"
                         << "Usage: " << a[0] << " stdout       # install stdout sink.\r\n"
                         << "       " << a[0] << " syslog       # install syslog sink.\r\n"
-                        << "       " << a[0] << " file <name>  # install file sink by name.\r\n";
+                        << "       " << a[0] << " file <name>  # install file sink by name.\r\n"
+                        << "       " << a[0] << " file <name> <jsonl|binary>  # install structured file sink.\r\n";
                 }
 
                 s.send(oss.str());
@@ -346,6 +432,29 @@ void Log::initShell()
         );
         shell_->mountNode(log_node, func_node, "del_sink");
     }
+
+    {
+        auto func_node = shell_->createFuncNode(
+            [this] (const Session &s, const Args &) {
+                std::ostringstream oss;
+                LogLimitStats stats;
+                if (LogGetLimitStats(nullptr, &stats))
+                    oss << "total: dropped=" << stats.dropped << ", merged=" << stats.merged << "\r\n";
+
+                //! 使用默认配置的模块也各自列出
+                LogForeachLimitStats(
+                    [] (const char *module_id, const LogLimitStats *stats, void *ptr) {
+                        auto p_oss = static_cast<std::ostringstream*>(ptr);
+                        *p_oss << "'" << module_id << "': dropped=" << stats->dropped
+                               << ", merged=" << stats->merged << "\r\n";
+                    }, &oss
+                );
+                s.send(oss.str());
+            },
+            "print log rate limit statistics"
+        );
+        shell_->mountNode(log_node, func_node, "limit_stats");
+    }
 }
 
 void Log::installShellForSink(log::Sink &sink, terminal::NodeToken parent_node, SinkShellNodes &nodes, const std::string &name)
@@ -508,6 +617,24 @@ void Log::installShellForFileSink(log::AsyncFileSink &sink, FileSinkShellNodes &
         profile.help = "Set log file max size";
         nodes.set_max_size = terminal::AddFuncNode(*shell_, nodes.dir, "set_max_size", profile);
     }
+
+    {
+        auto func_node = shell_->createFuncNode(
+            [&sink] (const Session &s, const Args &) {
+                std::ostringstream oss;
+                auto stats = sink.getPipeStats();
+                oss << "policy: " << util::AsyncPipe::OverflowPolicyName(sink.getOverflowPolicy()) << "\r\n"
+                    << "dropped_records: " << stats.dropped_records << "\r\n"
+                    << "dropped_bytes: " << stats.dropped_bytes << "\r\n"
+                    << "spilled_records: " << stats.spilled_records << "\r\n"
+                    << "blocked_times: " << stats.blocked_times << "\r\n";
+                s.send(oss.str());
+            },
+            "print overflow statistics of log pipe"
+        );
+        shell_->mountNode(nodes.dir, func_node, "overflow_stats");
+        nodes.overflow_stats = func_node;
+    }
 }
 
 void Log::uninstallShellForFileSink(FileSinkShellNodes &nodes, const std::string &name)
@@ -516,6 +643,7 @@ void Log::uninstallShellForFileSink(FileSinkShellNodes &nodes, const std::string
     shell_->deleteNode(nodes.set_prefix);
     shell_->deleteNode(nodes.set_sync_enable);
     shell_->deleteNode(nodes.set_max_size);
+    shell_->deleteNode(nodes.overflow_stats);
 
     uninstallShellForSink(file_sink_node_, nodes, name);
 
@@ -21,12 +21,16 @@
 #define TBOX_MAIN_LOG_H_20220414
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <tbox/base/json_fwd.h>
+#include <tbox/event/timer_event.h>
 
 #include <tbox/log/sync_stdout_sink.h>
 #include <tbox/log/async_syslog_sink.h>
 #include <tbox/log/async_file_sink.h>
+#include <tbox/log/async_structured_file_sink.h>
 
 #include <tbox/terminal/terminal_nodes.h>
 
@@ -55,6 +59,7 @@ class Log {
         terminal::NodeToken set_prefix;
         terminal::NodeToken set_sync_enable;
         terminal::NodeToken set_max_size;
+        terminal::NodeToken overflow_stats;
     };
 
     struct StdoutSink {
@@ -68,7 +73,7 @@ class Log {
     };
 
     struct FileSink {
-        log::AsyncFileSink sink;
+        std::unique_ptr<log::AsyncFileSink> sink;   //!< 文本格式为 AsyncFileSink，结构化格式为 AsyncStructuredFileSink
         FileSinkShellNodes nodes;
     };
 
@@ -84,11 +89,17 @@ class Log {
     bool uninstallSyslogSink();
 
     //file相关
-    bool installFileSink(const std::string &name);
+    //! format 为空表示文本格式，否则为结构化格式：jsonl, binary
+    bool installFileSink(const std::string &name, const std::string &format = "");
     bool initFileSinkByJson(const std::string &name, const Json &js, const char *proc_name);
     bool uninstallFileSink(const std::string &name);
     bool uninstallFileSink(FileSink *file_sink, const std::string &name);
 
+    //! 限流相关
+    void initLimitByJson(event::Loop *loop, const Json &js);
+
+    //! 通过JSON初始化AsyncSink的配置项，须在 initSinkByJson() 之前调用
+    void initAsyncSinkByJson(log::AsyncSink &sink, const Json &js, const std::string &name);
     //! 通过JSON初始化Sink共有的配置项
     void initSinkByJson(log::Sink &sink, const Json &js);
 
@@ -107,6 +118,9 @@ class Log {
     SyslogSink *syslog_sink_ = nullptr;
     std::map<std::string, FileSink*> file_sinks_;
 
+    std::vector<std::string> limit_modules_;    //!< 配置了限流的模块
+    event::TimerEvent *limit_flush_timer_ = nullptr;
+
     terminal::NodeToken sink_node_;
     terminal::NodeToken file_sink_node_;
 };
@@ -56,6 +56,7 @@ struct Runtime {
     Log log;
     ContextImp ctx;
     Module apps;
+    Trace trace;
 
     util::PidFile pid_file;
     int exit_wait_sec = 1;
@@ -124,10 +125,10 @@ bool Start(int argc, char **argv)
     auto &log = _runtime->log;
     auto &ctx = _runtime->ctx;
     auto &apps = _runtime->apps;
+    auto &trace = _runtime->trace;
 
     Json js_conf;
     Args args(js_conf);
-    Trace trace;
 
     log.fillDefaultConfig(js_conf);
     ctx.fillDefaultConfig(js_conf);
@@ -184,6 +185,7 @@ bool Start(int argc, char **argv)
         } else {
             LogErr("Apps init fail");
         }
+        trace.cleanup();
         ctx.cleanup();
     } else {
         LogErr("Context init fail");
@@ -214,6 +216,7 @@ void Stop()
     _runtime->thread.join();
 
     _runtime->apps.cleanup();  //! cleanup所有应用
+    _runtime->trace.cleanup();
     _runtime->ctx.cleanup();
 
     End();
@@ -166,6 +166,7 @@ int Main(int argc, char **argv)
         } else {
             LogErr("Apps init fail");
         }
+        trace.cleanup();
         ctx.cleanup();
     } else {
         LogErr("Context init fail");
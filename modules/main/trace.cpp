@@ -18,6 +18,7 @@
  * of the source tree.
  */
 #include "trace.h"
+#include "trace_streamer.h"
 #include <iostream>
 #include <sstream>
 #include <tbox/base/log.h>
@@ -26,7 +27,9 @@
 #include <tbox/terminal/session.h>
 #include <tbox/terminal/helper.h>
 #include <tbox/util/json.h>
+#include <tbox/base/recorder.h>
 #include <tbox/trace/sink.h>
+#include <tbox/eventx/loop_wdog.h>
 
 namespace tbox {
 namespace main {
@@ -34,6 +37,62 @@ namespace main {
 using namespace terminal;
 using namespace std;
 
+namespace {
+
+bool SetClockSourceByName(const std::string &name)
+{
+    if (name == "realtime")
+        return trace::SetClockSource(trace::ClockSource::kRealtime);
+    else if (name == "coarse")
+        return trace::SetClockSource(trace::ClockSource::kMonotonicCoarse);
+    else if (name == "tsc")
+        return trace::SetClockSource(trace::ClockSource::kTsc);
+    else
+        return false;
+}
+
+bool SetModeByName(const std::string &name)
+{
+    if (name == "stream")
+        trace::Sink::GetInstance().setMode(trace::Sink::Mode::kStream);
+    else if (name == "flight_recorder")
+        trace::Sink::GetInstance().setMode(trace::Sink::Mode::kFlightRecorder);
+    else
+        return false;
+    return true;
+}
+
+std::string GetModeName()
+{
+    if (trace::Sink::GetInstance().getMode() == trace::Sink::Mode::kFlightRecorder)
+        return "flight_recorder";
+    return "stream";
+}
+
+//! Loop阻塞时，转储飞行记录，以便查看阻塞前各线程在做什么
+void OnLoopBlock(const std::string &name)
+{
+    LogWarn("loop \"%s\" block!", name.c_str());
+    if (trace::Sink::GetInstance().dumpFlightRecords())
+        LogNotice("dump trace flight records");
+}
+
+std::string GetClockSourceName()
+{
+    switch (trace::GetClockSource()) {
+        case trace::ClockSource::kMonotonicCoarse: return "coarse";
+        case trace::ClockSource::kTsc: return "tsc";
+        default: return "realtime";
+    }
+}
+
+}
+
+Trace::~Trace()
+{
+    cleanup();
+}
+
 void Trace::fillDefaultConfig(Json &cfg) const
 {
     cfg["trace"] = R"(
@@ -48,6 +107,7 @@ void Trace::fillDefaultConfig(Json &cfg) const
 bool Trace::initialize(Context &ctx, const Json &cfg)
 {
     initShell(*ctx.terminal());
+    eventx::LoopWDog::SetLoopBlockCallback(OnLoopBlock);
 
     if (util::json::HasObjectField(cfg, "trace")) {
         auto &js_trace = cfg.at("trace");
@@ -56,17 +116,81 @@ bool Trace::initialize(Context &ctx, const Json &cfg)
         bool is_sync_enable = false;
         std::string path_prefix;
         int max_size = 0;
+        std::string clock_source;
+        int thread_buffer_size = 0;
+        int sample_rate = 0;
+        int record_budget = 0;
+        int duration_threshold = 0;
+        std::string mode;
+        int flight_recorder_size = 0;
+        std::string live_bind;
+        int prealloc_size = -1;
+        int write_block_size = -1;
+        std::string sync_mode;
+        std::string compress;
 
         util::json::GetField(js_trace, "path_prefix", path_prefix);
         util::json::GetField(js_trace, "enable", is_enable);
         util::json::GetField(js_trace, "max_size", max_size);
         util::json::GetField(js_trace, "sync_enable", is_sync_enable);
+        util::json::GetField(js_trace, "clock_source", clock_source);
+        util::json::GetField(js_trace, "thread_buffer_size", thread_buffer_size);
+        util::json::GetField(js_trace, "sample_rate", sample_rate);
+        util::json::GetField(js_trace, "record_budget", record_budget);
+        util::json::GetField(js_trace, "duration_threshold_us", duration_threshold);
+        util::json::GetField(js_trace, "mode", mode);
+        util::json::GetField(js_trace, "flight_recorder_size", flight_recorder_size);
+        util::json::GetField(js_trace, "live_bind", live_bind);
+        util::json::GetField(js_trace, "prealloc_size", prealloc_size);
+        util::json::GetField(js_trace, "write_block_size", write_block_size);
+        util::json::GetField(js_trace, "sync_mode", sync_mode);
+        util::json::GetField(js_trace, "compress", compress);
 
         auto &sink = trace::Sink::GetInstance();
 
+        if (!clock_source.empty() && !SetClockSourceByName(clock_source))
+            LogWarn("config 'trace.clock_source' field is invalid or not supported");
+
+        if (thread_buffer_size > 0)
+            sink.setThreadBufferSize(thread_buffer_size);
+
+        if (sample_rate > 0)
+            sink.setSampleRate(sample_rate);
+
+        if (record_budget > 0)
+            sink.setRecordBudget(record_budget);
+
+        if (duration_threshold > 0)
+            sink.setDurationThreshold(duration_threshold);
+
+        if (!mode.empty() && !SetModeByName(mode))
+            LogWarn("config 'trace.mode' field is invalid");
+
+        if (flight_recorder_size > 0)
+            sink.setFlightRecorderSize(1024 * flight_recorder_size);
+
         if (max_size > 0)
             sink.setRecordFileMaxSize(1024 * max_size);
 
+        if (prealloc_size >= 0 || write_block_size >= 0 || !sync_mode.empty()) {
+            auto writer_cfg = sink.getFileWriterConfig();
+            if (prealloc_size >= 0)
+                writer_cfg.prealloc_size = 1024 * prealloc_size;
+            if (write_block_size >= 0)
+                writer_cfg.block_size = 1024 * write_block_size;
+            if (!sync_mode.empty() && !util::FileWriter::ParseSyncMode(sync_mode, writer_cfg.sync_mode))
+                LogWarn("config 'trace.sync_mode' field is invalid");
+            sink.setFileWriterConfig(writer_cfg);
+        }
+
+        if (!compress.empty()) {
+            util::CompressType compress_type;
+            if (util::ParseCompressType(compress, compress_type) && util::IsCompressTypeSupported(compress_type))
+                sink.setCompressType(compress_type);
+            else
+                LogWarn("config 'trace.compress' field is invalid or not supported");
+        }
+
         if (is_sync_enable)
             sink.setFileSyncEnable(true);
 
@@ -76,6 +200,12 @@ bool Trace::initialize(Context &ctx, const Json &cfg)
         if (is_enable)
             sink.enable();
 
+        if (!live_bind.empty()) {
+            sp_streamer_ = new TraceStreamer(ctx.loop());
+            if (!sp_streamer_->initialize(live_bind))
+                CHECK_DELETE_RESET_OBJ(sp_streamer_);
+        }
+
         if (util::json::HasObjectField(js_trace, "filter")) {
             auto &js_filter = js_trace.at("filter");
 
@@ -107,6 +237,14 @@ bool Trace::initialize(Context &ctx, const Json &cfg)
     return true;
 }
 
+void Trace::cleanup()
+{
+    if (sp_streamer_ != nullptr) {
+        sp_streamer_->cleanup();
+        CHECK_DELETE_RESET_OBJ(sp_streamer_);
+    }
+}
+
 void Trace::initShell(TerminalNodes &term)
 {
     auto trace_node = term.createDirNode("This is trace directory");
@@ -185,6 +323,108 @@ void Trace::initShell(TerminalNodes &term)
         terminal::AddFuncNode(term, trace_node, "get_dir_path", profile);
     }
 
+    {
+        terminal::StringFuncNodeProfile profile;
+        profile.get_func = [] () { return GetClockSourceName(); };
+        profile.set_func = [] (const std::string &text) { return SetClockSourceByName(text); };
+        profile.usage = \
+            "Usage: clock_source                      # print current clock source\r\n"
+            "       clock_source realtime|coarse|tsc  # set clock source\r\n";
+        profile.help = "print or set clock source";
+        terminal::AddFuncNode(term, trace_node, "clock_source", profile);
+    }
+
+    {
+        terminal::StringFuncNodeProfile profile;
+        profile.get_func = GetModeName;
+        profile.set_func = SetModeByName;
+        profile.usage = \
+            "Usage: mode                         # print current mode\r\n"
+            "       mode stream|flight_recorder  # set mode\r\n";
+        profile.help = "print or set trace mode";
+        terminal::AddFuncNode(term, trace_node, "mode", profile);
+    }
+
+    {
+        auto func_node = term.createFuncNode(
+            [] (const terminal::Session &s, const terminal::Args &) {
+                auto &sink = trace::Sink::GetInstance();
+                if (sink.dumpFlightRecords())
+                    s.send("dump requested, records will be written in " + sink.getDirPath() + "/records\r\n");
+                else
+                    s.send("fail, trace is not enabled or not in flight_recorder mode\r\n");
+            }
+        , "dump flight records");
+        term.mountNode(trace_node, func_node, "dump");
+    }
+
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [] { return trace::Sink::GetInstance().getSampleRate(); };
+        profile.set_func = \
+            [] (int one_in_n) {
+                trace::Sink::GetInstance().setSampleRate(one_in_n);
+                return true;
+            };
+        profile.min_value = 1;
+        profile.usage = \
+            "Usage: sample_rate      # print sample rate\r\n"
+            "       sample_rate <N>  # record 1 in N for each call site, 1 means record all\r\n";
+        profile.help = "print or set sample rate";
+        terminal::AddFuncNode(term, trace_node, "sample_rate", profile);
+    }
+
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [] { return trace::Sink::GetInstance().getRecordBudget(); };
+        profile.set_func = \
+            [] (int records_per_sec) {
+                trace::Sink::GetInstance().setRecordBudget(records_per_sec);
+                return true;
+            };
+        profile.min_value = 0;
+        profile.usage = \
+            "Usage: record_budget      # print record budget\r\n"
+            "       record_budget <N>  # limit to about N records per second, 0 means no limit\r\n";
+        profile.help = "print or set records per second budget";
+        terminal::AddFuncNode(term, trace_node, "record_budget", profile);
+    }
+
+    {
+        terminal::IntegerFuncNodeProfile profile;
+        profile.get_func = [] { return trace::Sink::GetInstance().getDurationThreshold(); };
+        profile.set_func = \
+            [] (int threshold_us) {
+                trace::Sink::GetInstance().setDurationThreshold(threshold_us);
+                return true;
+            };
+        profile.min_value = 0;
+        profile.usage = \
+            "Usage: duration_threshold       # print duration threshold\r\n"
+            "       duration_threshold <us>  # only record scopes that last >= us, 0 means no limit\r\n";
+        profile.help = "print or set duration threshold";
+        terminal::AddFuncNode(term, trace_node, "duration_threshold", profile);
+    }
+
+    {
+        terminal::StringFuncNodeProfile profile;
+        profile.get_func = [] () {
+            auto &sink = trace::Sink::GetInstance();
+            std::ostringstream oss;
+            oss << "effective_sample_rate: " << sink.getEffectiveSampleRate();
+            return oss.str();
+        };
+        profile.help = "get effective sample rate, adjusted by record budget";
+        terminal::AddFuncNode(term, trace_node, "get_effective_sample_rate", profile);
+    }
+
+    {
+        terminal::StringFuncNodeProfile profile;
+        profile.get_func = [] () { return std::to_string(trace::Sink::GetInstance().getDroppedRecordNum()); };
+        profile.help = "get number of records dropped because thread buffer is full";
+        terminal::AddFuncNode(term, trace_node, "get_dropped_num", profile);
+    }
+
     {
         auto filter_node = term.createDirNode();
         term.mountNode(trace_node, filter_node, "filter");
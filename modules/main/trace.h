@@ -26,13 +26,22 @@
 namespace tbox {
 namespace main {
 
+class TraceStreamer;
+
 class Trace {
+  public:
+    ~Trace();
+
   public:
     void fillDefaultConfig(Json &cfg) const;
     bool initialize(Context &ctx, const Json &cfg);
+    void cleanup();
 
   protected:
     void initShell(terminal::TerminalNodes &term);
+
+  private:
+    TraceStreamer *sp_streamer_ = nullptr;  //! 实时记录推送服务，配置了 live_bind 时才创建
 };
 
 }
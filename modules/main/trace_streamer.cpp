@@ -0,0 +1,232 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "trace_streamer.h"
+
+#include <tbox/base/log.h>
+#include <tbox/base/assert.h>
+
+namespace tbox {
+namespace main {
+
+namespace {
+constexpr size_t kMaxPendingSize = 4 << 20;   //! 每个客户端最多缓存待发送的数据量
+constexpr size_t kMaxSubscribeLineSize = 1024;
+}
+
+using namespace std::placeholders;
+
+TraceStreamer::TraceStreamer(event::Loop *wp_loop) :
+    wp_loop_(wp_loop),
+    sp_tcp_(new network::TcpServer(wp_loop))
+{
+    TBOX_ASSERT(wp_loop_ != nullptr);
+}
+
+TraceStreamer::~TraceStreamer()
+{
+    cleanup();
+    delete sp_tcp_;
+}
+
+bool TraceStreamer::initialize(const std::string &bind_addr)
+{
+    if (!sp_tcp_->initialize(network::SockAddr::FromString(bind_addr), 2)) {
+        LogWarn("trace streamer bind '%s' fail", bind_addr.c_str());
+        return false;
+    }
+
+    sp_tcp_->setConnectedCallback(std::bind(&TraceStreamer::onTcpConnected, this, _1));
+    sp_tcp_->setDisconnectedCallback(std::bind(&TraceStreamer::onTcpDisconnected, this, _1));
+    sp_tcp_->setReceiveCallback(std::bind(&TraceStreamer::onTcpReceived, this, _1, _2), 1);
+    sp_tcp_->setSendCompleteCallback(std::bind(&TraceStreamer::onTcpSendCompleted, this, _1));
+
+    if (!sp_tcp_->start()) {
+        sp_tcp_->cleanup();
+        return false;
+    }
+
+    sp_alive_token_ = std::make_shared<TraceStreamer*>(this);
+    is_inited_ = true;
+    LogInfo("trace streamer listen on %s", bind_addr.c_str());
+    return true;
+}
+
+void TraceStreamer::cleanup()
+{
+    if (!is_inited_)
+        return;
+
+    //! 移除后，收集线程不会再回调 onLiveRecords()
+    if (listener_id_ != 0) {
+        trace::Sink::GetInstance().removeLiveListener(listener_id_);
+        listener_id_ = 0;
+    }
+    //! 已投递到Loop中还未执行的发送任务随之失效
+    sp_alive_token_.reset();
+
+    sp_tcp_->stop();
+    sp_tcp_->cleanup();
+    {
+        std::lock_guard<std::mutex> lg(lock_);
+        clients_.clear();
+    }
+    is_inited_ = false;
+}
+
+size_t TraceStreamer::clientNum() const
+{
+    std::lock_guard<std::mutex> lg(lock_);
+    return clients_.size();
+}
+
+void TraceStreamer::onTcpConnected(const ConnToken &client)
+{
+    std::lock_guard<std::mutex> lg(lock_);
+    clients_[client] = std::make_shared<Client>();
+    LogInfo("trace streamer client %s connected", sp_tcp_->getClientAddress(client).toString().c_str());
+}
+
+void TraceStreamer::onTcpDisconnected(const ConnToken &client)
+{
+    {
+        std::lock_guard<std::mutex> lg(lock_);
+        clients_.erase(client);
+    }
+    removeListenerIfNeed();
+}
+
+void TraceStreamer::onTcpReceived(const ConnToken &client, network::Buffer &buff)
+{
+    auto begin = reinterpret_cast<const char*>(buff.readableBegin());
+    std::string str(begin, buff.readableSize());
+
+    auto pos = str.find('\n');
+    if (pos == std::string::npos) {
+        if (str.size() > kMaxSubscribeLineSize) {
+            LogNotice("subscribe line too long, disconnect");
+            sp_tcp_->disconnect(client);
+        }
+        return;
+    }
+    buff.hasRead(pos + 1);
+
+    std::set<std::string> modules;
+    std::string name_keyword;
+    if (!trace::ParseSubscribeLine(str.substr(0, pos), modules, name_keyword)) {
+        static const std::string kUsage = "usage: subscribe [module=<m1>,<m2>...] [name=<keyword>]\n";
+        sp_tcp_->send(client, kUsage.data(), kUsage.size());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(lock_);
+        auto iter = clients_.find(client);
+        if (iter == clients_.end())
+            return;
+
+        //! 可以重复订阅，以修改过滤条件
+        auto &sp_client = iter->second;
+        sp_client->encoder.setFilter(modules, name_keyword);
+        sp_client->is_subscribed = true;
+    }
+    addListenerIfNeed();
+}
+
+void TraceStreamer::onTcpSendCompleted(const ConnToken &client)
+{
+    std::lock_guard<std::mutex> lg(lock_);
+    auto iter = clients_.find(client);
+    if (iter != clients_.end()) {
+        //! 只扣除已交给 TcpServer 的数据，还在Loop队列中的仍计入待发送量
+        auto &sp_client = iter->second;
+        sp_client->pending_size -= sp_client->sending_size;
+        sp_client->sending_size = 0;
+    }
+}
+
+void TraceStreamer::onLiveRecords(const std::vector<trace::LiveRecord> &records)
+{
+    std::lock_guard<std::mutex> lg(lock_);
+    for (auto &item : clients_) {
+        auto &sp_client = item.second;
+        if (!sp_client->is_subscribed)
+            continue;
+
+        if (sp_client->pending_size >= kMaxPendingSize) {
+            sp_client->dropped_num += records.size();
+            continue;
+        }
+
+        auto sp_data = std::make_shared<std::string>();
+        if (sp_client->dropped_num > 0) {
+            sp_client->encoder.encodeDropped(sp_client->dropped_num, *sp_data);
+            sp_client->dropped_num = 0;
+        }
+
+        for (auto &record : records)
+            sp_client->encoder.encode(record, *sp_data);
+
+        if (sp_data->empty())
+            continue;
+
+        sp_client->pending_size += sp_data->size();
+
+        //! 本函数在收集线程中执行，投递的任务执行时，本对象或客户端可能已不存在
+        auto client = item.first;
+        std::weak_ptr<TraceStreamer*> wp_alive_token = sp_alive_token_;
+        std::weak_ptr<Client> wp_client = sp_client;
+        wp_loop_->runInLoop(
+            [wp_alive_token, wp_client, client, sp_data] {
+                auto sp_alive_token = wp_alive_token.lock();
+                auto sp_client = wp_client.lock();
+                if (!sp_alive_token || !sp_client)
+                    return;
+
+                auto self = *sp_alive_token;
+                if (self->sp_tcp_->isClientValid(client) &&
+                    self->sp_tcp_->send(client, sp_data->data(), sp_data->size()))
+                    sp_client->sending_size += sp_data->size();
+                else
+                    sp_client->pending_size -= sp_data->size();
+            },
+            "TraceStreamer::onLiveRecords"
+        );
+    }
+}
+
+void TraceStreamer::addListenerIfNeed()
+{
+    if (listener_id_ == 0)
+        listener_id_ = trace::Sink::GetInstance().addLiveListener(
+            std::bind(&TraceStreamer::onLiveRecords, this, _1));
+}
+
+void TraceStreamer::removeListenerIfNeed()
+{
+    if (listener_id_ == 0 || clientNum() != 0)
+        return;
+
+    //! 不可持有 lock_ 调用，回调中也要获取 lock_
+    trace::Sink::GetInstance().removeLiveListener(listener_id_);
+    listener_id_ = 0;
+}
+
+}
+}
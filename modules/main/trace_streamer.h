@@ -0,0 +1,94 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_MAIN_TRACE_STREAMER_H_20261019
+#define TBOX_MAIN_TRACE_STREAMER_H_20261019
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <tbox/event/loop.h>
+#include <tbox/network/tcp_server.h>
+#include <tbox/trace/sink.h>
+
+namespace tbox {
+namespace main {
+
+/**
+ * 实时记录推送服务
+ *
+ * 在指定的TCP端口上监听，客户端发送订阅命令后，持续推送 trace::Sink 中通过其过滤条件的记录。
+ * 编码格式见 trace/live_stream.h，可用 tools/trace/top 查看
+ *
+ * 记录由 Sink 的后端线程编码，再委托给 Loop 发送。
+ * 客户端接收太慢，待发送的数据超过上限时，丢弃新的记录，并告知客户端丢弃的条数
+ */
+class TraceStreamer {
+  public:
+    explicit TraceStreamer(event::Loop *wp_loop);
+    ~TraceStreamer();
+
+  public:
+    bool initialize(const std::string &bind_addr);
+    void cleanup();
+
+    size_t clientNum() const;
+
+  protected:
+    using ConnToken = network::TcpServer::ConnToken;
+
+    struct Client {
+        bool is_subscribed = false;
+        trace::LiveStreamEncoder encoder;
+        std::atomic<size_t> pending_size{0};    //! 已编码还未发送完的数据量
+        size_t sending_size = 0;                //! 已交给 TcpServer 还未发送完的数据量，只在Loop线程中访问
+        uint64_t dropped_num = 0;               //! 还未告知客户端的丢弃记录数
+    };
+    using ClientSptr = std::shared_ptr<Client>;
+
+    void onTcpConnected(const ConnToken &client);
+    void onTcpDisconnected(const ConnToken &client);
+    void onTcpReceived(const ConnToken &client, network::Buffer &buff);
+    void onTcpSendCompleted(const ConnToken &client);
+
+    void onLiveRecords(const std::vector<trace::LiveRecord> &records);
+
+    void addListenerIfNeed();
+    void removeListenerIfNeed();
+
+  private:
+    event::Loop *wp_loop_;
+    network::TcpServer *sp_tcp_;
+
+    mutable std::mutex lock_;   //! 保护 clients_，及其中的编码器
+    std::map<ConnToken, ClientSptr> clients_;
+    int listener_id_ = 0;       //! 只在Loop线程中访问
+    bool is_inited_ = false;
+
+    //! 投递到Loop中的发送任务持有其弱引用，cleanup() 或析构后这些任务不再执行
+    std::shared_ptr<TraceStreamer*> sp_alive_token_;
+};
+
+}
+}
+
+#endif //TBOX_MAIN_TRACE_STREAMER_H_20261019
@@ -0,0 +1,297 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "live_stream.h"
+
+#include <tbox/util/string.h>
+#include <tbox/util/scalable_integer.h>
+
+namespace tbox {
+namespace trace {
+
+namespace {
+
+//! 编码端按顺序分配序号，新序号最多比已知的多出这么多，超出视为格式错误，防止恶意数据耗尽内存
+constexpr uint64_t kMaxIndexGap = 1024;
+
+void AppendInteger(std::string &out, uint64_t value)
+{
+    uint8_t buffer[10];
+    auto size = util::DumpScalableInteger(value, buffer, sizeof(buffer));
+    out.append(reinterpret_cast<const char*>(buffer), size);
+}
+
+void AppendString(std::string &out, const std::string &str)
+{
+    AppendInteger(out, str.size());
+    out += str;
+}
+
+}
+
+std::string MakeSubscribeLine(const std::set<std::string> &modules, const std::string &name_keyword)
+{
+    std::string line = "subscribe";
+    if (!modules.empty()) {
+        line += " module=";
+        bool is_first = true;
+        for (auto &module : modules) {
+            if (!is_first)
+                line += ',';
+            line += module;
+            is_first = false;
+        }
+    }
+
+    if (!name_keyword.empty())
+        line += " name=" + name_keyword;
+
+    return line + '\n';
+}
+
+bool ParseSubscribeLine(const std::string &line, std::set<std::string> &modules, std::string &name_keyword)
+{
+    auto end_pos = line.find_last_not_of("\r\n");
+    std::vector<std::string> str_vec;
+    util::string::SplitBySpace(line.substr(0, end_pos == std::string::npos ? 0 : end_pos + 1), str_vec);
+    if (str_vec.empty() || str_vec[0] != "subscribe")
+        return false;
+
+    modules.clear();
+    name_keyword.clear();
+
+    for (size_t i = 1; i < str_vec.size(); ++i) {
+        auto &item = str_vec[i];
+        if (item.compare(0, 7, "module=") == 0) {
+            std::vector<std::string> module_vec;
+            util::string::Split(item.substr(7), ",", module_vec);
+            for (auto &module : module_vec) {
+                if (!module.empty())
+                    modules.insert(module);
+            }
+        } else if (item.compare(0, 5, "name=") == 0) {
+            name_keyword = item.substr(5);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LiveStreamEncoder::setFilter(const std::set<std::string> &modules, const std::string &name_keyword)
+{
+    modules_ = modules;
+    name_keyword_ = name_keyword;
+
+    //! 已定义的索引仍然有效，只需重新判定过滤结果
+    for (auto &item : name_key_to_entry_map_)
+        item.second.is_passed = -1;
+    for (auto &item : module_id_to_entry_map_)
+        item.second.is_passed = -1;
+}
+
+bool LiveStreamEncoder::encode(const LiveRecord &record, std::string &out)
+{
+    auto module_index = getModuleIndex(record, out);
+    if (module_index < 0)
+        return false;
+
+    auto name_index = getNameIndex(record, out);
+    if (name_index < 0)
+        return false;
+
+    auto thread_index = getThreadIndex(record.thread_id, out);
+
+    out.push_back(static_cast<char>(LiveFrameType::kRecord));
+    AppendInteger(out, record.end_ts_us - last_end_ts_us_);
+    AppendInteger(out, record.duration_us);
+    AppendInteger(out, thread_index);
+    AppendInteger(out, name_index);
+    AppendInteger(out, module_index);
+    last_end_ts_us_ = record.end_ts_us;
+
+    return true;
+}
+
+void LiveStreamEncoder::encodeDropped(uint64_t dropped_num, std::string &out)
+{
+    out.push_back(static_cast<char>(LiveFrameType::kDropped));
+    AppendInteger(out, dropped_num);
+}
+
+//! 获取模块的索引，首次通过过滤时先编码其定义，被过滤时返回 -1
+int64_t LiveStreamEncoder::getModuleIndex(const LiveRecord &record, std::string &out)
+{
+    auto &entry = module_id_to_entry_map_[record.module_id];
+    if (entry.is_passed < 0)
+        entry.is_passed = (modules_.empty() || modules_.count(*record.module) != 0) ? 1 : 0;
+
+    if (entry.is_passed == 0)
+        return -1;
+
+    if (entry.index < 0) {
+        entry.index = next_module_index_++;
+        out.push_back(static_cast<char>(LiveFrameType::kModule));
+        AppendInteger(out, entry.index);
+        AppendString(out, *record.module);
+    }
+    return entry.index;
+}
+
+//! 获取名称的索引，同一名称不同行号视为不同的名称
+int64_t LiveStreamEncoder::getNameIndex(const LiveRecord &record, std::string &out)
+{
+    uint64_t name_key = (static_cast<uint64_t>(record.name_id) << 32) | record.line;
+    auto &entry = name_key_to_entry_map_[name_key];
+    if (entry.is_passed < 0)
+        entry.is_passed = (name_keyword_.empty() || record.name->find(name_keyword_) != std::string::npos) ? 1 : 0;
+
+    if (entry.is_passed == 0)
+        return -1;
+
+    if (entry.index < 0) {
+        entry.index = next_name_index_++;
+        out.push_back(static_cast<char>(LiveFrameType::kName));
+        AppendInteger(out, entry.index);
+        AppendString(out, *record.name + " at L" + std::to_string(record.line));
+    }
+    return entry.index;
+}
+
+uint64_t LiveStreamEncoder::getThreadIndex(long thread_id, std::string &out)
+{
+    auto iter = thread_to_index_map_.find(thread_id);
+    if (iter != thread_to_index_map_.end())
+        return iter->second;
+
+    uint64_t index = thread_to_index_map_.size();
+    thread_to_index_map_[thread_id] = index;
+
+    out.push_back(static_cast<char>(LiveFrameType::kThread));
+    AppendInteger(out, index);
+    AppendInteger(out, thread_id);
+    return index;
+}
+
+int LiveStreamDecoder::decode(const void *data_ptr, size_t data_size)
+{
+    auto ptr = static_cast<const uint8_t*>(data_ptr);
+    size_t decoded_size = 0;
+
+    while (decoded_size < data_size) {
+        auto frame_size = decodeFrame(ptr + decoded_size, data_size - decoded_size);
+        if (frame_size < 0)
+            return -1;
+        if (frame_size == 0)
+            break;
+        decoded_size += frame_size;
+    }
+
+    return decoded_size;
+}
+
+int LiveStreamDecoder::decodeFrame(const uint8_t *data_ptr, size_t data_size)
+{
+    size_t pos = 1;
+    auto parse = [&] (uint64_t &value) {
+        auto size = util::ParseScalableInteger(data_ptr + pos, data_size - pos, value);
+        pos += size;
+        return size != 0;
+    };
+
+    auto type = static_cast<LiveFrameType>(data_ptr[0]);
+    switch (type) {
+        case LiveFrameType::kName:
+        case LiveFrameType::kModule: {
+            uint64_t index = 0, length = 0;
+            if (!parse(index) || !parse(length) || data_size - pos < length)
+                return 0;
+
+            auto &strs = type == LiveFrameType::kName ? names_ : modules_;
+            if (index > strs.size() + kMaxIndexGap)
+                return -1;
+            if (index >= strs.size())
+                strs.resize(index + 1);
+            strs[index].assign(reinterpret_cast<const char*>(data_ptr + pos), length);
+            pos += length;
+            break;
+        }
+
+        case LiveFrameType::kThread: {
+            uint64_t index = 0, thread_id = 0;
+            if (!parse(index) || !parse(thread_id))
+                return 0;
+
+            if (index > threads_.size() + kMaxIndexGap)
+                return -1;
+            if (index >= threads_.size())
+                threads_.resize(index + 1);
+            threads_[index] = thread_id;
+            break;
+        }
+
+        case LiveFrameType::kRecord: {
+            uint64_t end_ts_diff_us = 0;
+            Record record;
+            if (!parse(end_ts_diff_us) || !parse(record.duration_us) || !parse(record.thread_index) ||
+                !parse(record.name_index) || !parse(record.module_index))
+                return 0;
+
+            last_end_ts_us_ += end_ts_diff_us;
+            record.end_ts_us = last_end_ts_us_;
+            if (record_cb_)
+                record_cb_(record);
+            break;
+        }
+
+        case LiveFrameType::kDropped: {
+            uint64_t dropped_num = 0;
+            if (!parse(dropped_num))
+                return 0;
+
+            if (dropped_cb_)
+                dropped_cb_(dropped_num);
+            break;
+        }
+
+        default:
+            return -1;
+    }
+
+    return pos;
+}
+
+std::string LiveStreamDecoder::getName(uint64_t index) const
+{
+    return index < names_.size() ? names_[index] : std::to_string(index);
+}
+
+std::string LiveStreamDecoder::getModule(uint64_t index) const
+{
+    return index < modules_.size() ? modules_[index] : std::to_string(index);
+}
+
+long LiveStreamDecoder::getThreadId(uint64_t index) const
+{
+    return index < threads_.size() ? threads_[index] : -1;
+}
+
+}
+}
@@ -0,0 +1,154 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_LIVE_STREAM_H_20261019
+#define TBOX_TRACE_LIVE_STREAM_H_20261019
+
+#include <cstdint>
+#include <string>
+#include <set>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+namespace tbox {
+namespace trace {
+
+/**
+ * 实时记录，由 Sink 的后端线程交给实时监听者
+ *
+ * name 与 module 指向后端线程中的驻留字串，仅在回调期间有效
+ */
+struct LiveRecord {
+    uint64_t end_ts_us;
+    uint64_t duration_us;
+    long     thread_id;
+    uint32_t name_id;     //! 驻留字串ID，在进程内不变
+    uint32_t module_id;   //! 驻留字串ID，在进程内不变
+    uint32_t line;
+    const std::string *name;
+    const std::string *module;
+};
+
+/**
+ * 实时记录流的编码格式
+ *
+ * 客户端连接后，先发送一行订阅命令：
+ *   subscribe [module=<m1>,<m2>...] [name=<keyword>]\n
+ * 之后服务端持续发送二进制帧，每帧由1字节的类型与若干可变长整数组成：
+ *   kName    : index, length, <name at Lxx>
+ *   kModule  : index, length, <module>
+ *   kThread  : index, thread_id
+ *   kRecord  : end_ts_diff_us, duration_us, thread_index, name_index, module_index
+ *   kDropped : 因客户端接收太慢而丢弃的记录数
+ * 名称、模块、线程在首次被记录引用之前定义，记录的编码与记录文件相同
+ */
+enum class LiveFrameType : uint8_t {
+    kName = 1,
+    kModule,
+    kThread,
+    kRecord,
+    kDropped,
+};
+
+//! 生成与解析订阅命令行，modules 为空表示不按模块过滤，name_keyword 为空表示不按名称过滤
+std::string MakeSubscribeLine(const std::set<std::string> &modules, const std::string &name_keyword);
+bool ParseSubscribeLine(const std::string &line, std::set<std::string> &modules, std::string &name_keyword);
+
+//! 实时记录流编码器，每个订阅者一个
+class LiveStreamEncoder {
+  public:
+    void setFilter(const std::set<std::string> &modules, const std::string &name_keyword);
+
+    /**
+     * 编码一条记录，追加到 out 中
+     *
+     * \return  bool    是否通过过滤，未通过的不编码
+     */
+    bool encode(const LiveRecord &record, std::string &out);
+    void encodeDropped(uint64_t dropped_num, std::string &out);
+
+  protected:
+    int64_t getNameIndex(const LiveRecord &record, std::string &out);
+    int64_t getModuleIndex(const LiveRecord &record, std::string &out);
+    uint64_t getThreadIndex(long thread_id, std::string &out);
+
+  private:
+    std::set<std::string> modules_;
+    std::string name_keyword_;
+
+    struct Entry {
+        int64_t index = -1;     //! -1 表示还未定义
+        int8_t is_passed = -1;  //! 过滤结果，-1 表示未判定
+    };
+    std::unordered_map<uint64_t, Entry> name_key_to_entry_map_;
+    std::unordered_map<uint32_t, Entry> module_id_to_entry_map_;
+    std::unordered_map<long, uint64_t> thread_to_index_map_;
+    uint64_t next_name_index_ = 0;
+    uint64_t next_module_index_ = 0;
+    uint64_t last_end_ts_us_ = 0;
+};
+
+//! 实时记录流解码器
+class LiveStreamDecoder {
+  public:
+    struct Record {
+        uint64_t end_ts_us;
+        uint64_t duration_us;
+        uint64_t thread_index;
+        uint64_t name_index;
+        uint64_t module_index;
+    };
+
+    using RecordCallback = std::function<void (const Record &)>;
+    using DroppedCallback = std::function<void (uint64_t dropped_num)>;
+
+    void setRecordCallback(const RecordCallback &cb) { record_cb_ = cb; }
+    void setDroppedCallback(const DroppedCallback &cb) { dropped_cb_ = cb; }
+
+    /**
+     * 解码数据
+     *
+     * \return  已解码的字节数，剩余的为不完整的帧，需与后续收到的数据拼接后再解码；
+     *          -1 表示数据格式错误
+     */
+    int decode(const void *data_ptr, size_t data_size);
+
+    std::string getName(uint64_t index) const;
+    std::string getModule(uint64_t index) const;
+    long getThreadId(uint64_t index) const;
+
+  protected:
+    //! 解码一帧，返回其大小，0表示不完整，-1表示格式错误
+    int decodeFrame(const uint8_t *data_ptr, size_t data_size);
+
+  private:
+    std::vector<std::string> names_;
+    std::vector<std::string> modules_;
+    std::vector<long> threads_;
+    uint64_t last_end_ts_us_ = 0;
+
+    RecordCallback record_cb_;
+    DroppedCallback dropped_cb_;
+};
+
+}
+}
+
+#endif //TBOX_TRACE_LIVE_STREAM_H_20261019
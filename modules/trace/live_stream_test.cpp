@@ -0,0 +1,157 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <tbox/util/scalable_integer.h>
+#include "live_stream.h"
+
+namespace tbox {
+namespace trace {
+
+namespace {
+LiveRecord MakeRecord(uint64_t end_ts_us, uint64_t duration_us, long thread_id,
+                      const std::string &name, uint32_t name_id, uint32_t line,
+                      const std::string &module, uint32_t module_id)
+{
+    LiveRecord record;
+    record.end_ts_us = end_ts_us;
+    record.duration_us = duration_us;
+    record.thread_id = thread_id;
+    record.name_id = name_id;
+    record.module_id = module_id;
+    record.line = line;
+    record.name = &name;
+    record.module = &module;
+    return record;
+}
+}
+
+TEST(LiveStream, SubscribeLine) {
+    std::set<std::string> modules;
+    std::string keyword;
+
+    auto line = MakeSubscribeLine({"a", "b"}, "hello");
+    EXPECT_EQ(line, "subscribe module=a,b name=hello\n");
+    ASSERT_TRUE(ParseSubscribeLine(line, modules, keyword));
+    EXPECT_EQ(modules, std::set<std::string>({"a", "b"}));
+    EXPECT_EQ(keyword, "hello");
+
+    ASSERT_TRUE(ParseSubscribeLine("subscribe\r\n", modules, keyword));
+    EXPECT_TRUE(modules.empty());
+    EXPECT_TRUE(keyword.empty());
+
+    EXPECT_FALSE(ParseSubscribeLine("hello", modules, keyword));
+    EXPECT_FALSE(ParseSubscribeLine("subscribe xyz", modules, keyword));
+}
+
+TEST(LiveStream, EncodeAndDecode) {
+    std::string name_a = "void a()", name_b = "void b()";
+    std::string module_x = "x", module_y = "y";
+
+    LiveStreamEncoder encoder;
+    std::string data;
+    EXPECT_TRUE(encoder.encode(MakeRecord(100, 10, 1001, name_a, 0, 1, module_x, 1), data));
+    EXPECT_TRUE(encoder.encode(MakeRecord(120, 5, 1002, name_b, 2, 3, module_y, 3), data));
+    EXPECT_TRUE(encoder.encode(MakeRecord(130, 0, 1001, name_a, 0, 1, module_x, 1), data));
+    encoder.encodeDropped(7, data);
+
+    LiveStreamDecoder decoder;
+    std::vector<LiveStreamDecoder::Record> records;
+    uint64_t dropped_num = 0;
+    decoder.setRecordCallback([&] (const LiveStreamDecoder::Record &r) { records.push_back(r); });
+    decoder.setDroppedCallback([&] (uint64_t num) { dropped_num += num; });
+
+    //! 逐字节喂入，检验不完整帧的处理
+    std::string pending;
+    for (char c : data) {
+        pending.push_back(c);
+        auto size = decoder.decode(pending.data(), pending.size());
+        ASSERT_GE(size, 0);
+        pending.erase(0, size);
+    }
+    EXPECT_TRUE(pending.empty());
+
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[0].end_ts_us, 100u);
+    EXPECT_EQ(records[1].end_ts_us, 120u);
+    EXPECT_EQ(records[2].end_ts_us, 130u);
+    EXPECT_EQ(records[1].duration_us, 5u);
+    EXPECT_EQ(decoder.getName(records[0].name_index), "void a() at L1");
+    EXPECT_EQ(decoder.getName(records[1].name_index), "void b() at L3");
+    EXPECT_EQ(decoder.getModule(records[1].module_index), "y");
+    EXPECT_EQ(decoder.getThreadId(records[1].thread_index), 1002);
+    EXPECT_EQ(records[0].name_index, records[2].name_index);
+    EXPECT_EQ(dropped_num, 7u);
+}
+
+TEST(LiveStream, Filter) {
+    std::string name_a = "void a()", name_b = "void b()";
+    std::string module_x = "x", module_y = "y";
+
+    LiveStreamEncoder encoder;
+    encoder.setFilter({"x"}, "");
+
+    std::string data;
+    EXPECT_TRUE(encoder.encode(MakeRecord(100, 10, 1, name_a, 0, 1, module_x, 1), data));
+    EXPECT_FALSE(encoder.encode(MakeRecord(110, 10, 1, name_b, 2, 1, module_y, 3), data));
+
+    encoder.setFilter({}, "b");
+    EXPECT_FALSE(encoder.encode(MakeRecord(120, 10, 1, name_a, 0, 1, module_x, 1), data));
+    EXPECT_TRUE(encoder.encode(MakeRecord(130, 10, 1, name_b, 2, 1, module_y, 3), data));
+
+    LiveStreamDecoder decoder;
+    std::vector<std::string> names;
+    decoder.setRecordCallback(
+        [&] (const LiveStreamDecoder::Record &r) {
+            names.push_back(decoder.getModule(r.module_index) + ':' + decoder.getName(r.name_index));
+        }
+    );
+    EXPECT_EQ(decoder.decode(data.data(), data.size()), int(data.size()));
+    EXPECT_EQ(names, std::vector<std::string>({"x:void a() at L1", "y:void b() at L1"}));
+
+    EXPECT_EQ(decoder.decode("\xff", 1), -1);
+}
+
+//! 序号远超已知范围的帧视为格式错误，不能据此分配内存
+TEST(LiveStream, HugeIndex) {
+    auto make_frame = [] (LiveFrameType type, uint64_t index, uint64_t value) {
+        std::string frame(1, static_cast<char>(type));
+        uint8_t buffer[10];
+        for (auto v : { index, value }) {
+            auto size = util::DumpScalableInteger(v, buffer, sizeof(buffer));
+            frame.append(reinterpret_cast<const char*>(buffer), size);
+        }
+        return frame;
+    };
+
+    LiveStreamDecoder decoder;
+    auto frame = make_frame(LiveFrameType::kThread, 0xffffffffffffull, 1001);
+    EXPECT_EQ(decoder.decode(frame.data(), frame.size()), -1);
+
+    frame = make_frame(LiveFrameType::kName, 1ull << 40, 0);
+    EXPECT_EQ(decoder.decode(frame.data(), frame.size()), -1);
+
+    //! 正常的序号仍可解码
+    frame = make_frame(LiveFrameType::kThread, 0, 1001);
+    EXPECT_EQ(decoder.decode(frame.data(), frame.size()), static_cast<int>(frame.size()));
+    EXPECT_EQ(decoder.getThreadId(0), 1001);
+}
+
+}
+}
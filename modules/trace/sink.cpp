@@ -26,6 +26,7 @@
 #include <vector>
 #include <sstream>
 #include <chrono>
+#include <algorithm>
 
 #include <sys/syscall.h>
 #include <tbox/base/defines.h>
@@ -44,9 +45,24 @@ void CommitRecordFunc(const char *name, const char *module, uint32_t line,
     Sink::GetInstance().commitRecord(name, module, line, end_timepoint_us, duration_us);
 }
 
+void CommitEventFunc(const char *name, const char *module, uint32_t line, uint64_t timepoint_us)
+{
+    Sink::GetInstance().commitEvent(name, module, line, timepoint_us);
+}
+
 #define ENDLINE "\n"
 
 namespace {
+constexpr auto kCollectInterval = std::chrono::milliseconds(100); //! 后端定期收集的周期
+constexpr size_t kPtrCacheSize = 256;  //! 每个线程的字串指针缓存的大小
+constexpr size_t kPtrCacheProbeNum = 8;
+constexpr size_t kSiteCounterSize = 256;  //! 每个线程的调用点采样计数器个数
+constexpr size_t kMaxExitedFlightBufferNum = 32;  //! 飞行记录仪模式下最多保留的已退出线程的缓冲数
+constexpr auto kDumpWaitTimeout = std::chrono::seconds(3);
+constexpr size_t kDefaultPreallocSize = 1 << 20;    //! 记录文件默认每次预分配1MB
+constexpr size_t kDefaultWriteBlockSize = 64 << 10; //! 记录文件默认按64KB整块写入
+constexpr uint32_t kNoCrashStr = 0xffffffff;        //! 字串副本空间不足，未复制
+
 std::string GetLocalDateTimeStr()
 {
     char timestamp[16]; //! 固定长度16B，"20220414_071023"
@@ -56,14 +72,127 @@ std::string GetLocalDateTimeStr()
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &tm);
     return timestamp;
 }
+
+/**
+ * 崩溃转储的文本写入器，只用栈上的缓冲与 write(2)，异步信号安全
+ */
+class CrashWriter {
+  public:
+    explicit CrashWriter(int fd) : fd_(fd) { }
+    ~CrashWriter() { flush(); }
+
+    CrashWriter& append(const char *str) {
+        while (*str != '\0') {
+            if (len_ == sizeof(buff_))
+                flush();
+            buff_[len_++] = *str++;
+        }
+        return *this;
+    }
+
+    CrashWriter& append(uint64_t value) {
+        char digits[24];
+        size_t num = 0;
+        do {
+            digits[num++] = '0' + value % 10;
+            value /= 10;
+        } while (value != 0);
+
+        char str[24];
+        for (size_t i = 0; i < num; ++i)
+            str[i] = digits[num - 1 - i];
+        str[num] = '\0';
+        return append(str);
+    }
+
+    void flush() {
+        size_t pos = 0;
+        while (pos < len_) {
+            auto wsize = ::write(fd_, buff_ + pos, len_ - pos);
+            if (wsize <= 0 && errno != EINTR)
+                break;
+            if (wsize > 0)
+                pos += wsize;
+        }
+        len_ = 0;
+    }
+
+  private:
+    int fd_;
+    char buff_[1024];
+    size_t len_ = 0;
+};
 }
 
+/**
+ * 线程记录缓冲
+ *
+ * 单生产者单消费者的环形缓冲，由记录线程写入，由后端线程取出。
+ * 飞行记录仪模式下，由记录线程循环覆盖，后端线程只在转储时读取快照，不修改 head
+ */
+struct Sink::ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        records.resize(size);
+        mask = size - 1;
+        ::memset(ptr_cache_keys, 0, sizeof(ptr_cache_keys));
+        ::memset(site_counters, 0, sizeof(site_counters));
+    }
+
+    long thread_id = 0;
+    bool is_flight_recorder = false;
+    uint32_t generation = 0;
+    std::vector<Record> records;
+    size_t mask = 0;
+
+    std::atomic<size_t> tail{0};    //! 由记录线程写
+    char padding[64];               //! 隔开 tail 与 head，避免伪共享
+    std::atomic<size_t> head{0};    //! 由后端线程写
+
+    std::atomic<size_t> dropped_num{0};
+    std::atomic<size_t> offered_num{0};     //! 通过过滤待采样的记录数，仅本线程写
+    std::atomic_bool is_exited{false};
+
+    //! 各模块的过滤结果缓存，-1 表示未知，仅本线程访问
+    std::vector<int8_t> module_filter_results;
+    uint32_t filter_generation = 0;
+
+    //! 各调用点的采样计数，按 name 与 line 散列，仅本线程访问
+    uint32_t site_counters[kSiteCounterSize];
+
+    //! 字串指针到驻留ID的缓存，仅本线程访问
+    const char *ptr_cache_keys[kPtrCacheSize];
+    uint32_t ptr_cache_values[kPtrCacheSize];
+};
+
+//! 线程退出时标记其缓冲，由后端线程在取完记录后回收
+struct Sink::ThreadBufferHolder {
+    ~ThreadBufferHolder() {
+        if (buffer)
+            buffer->is_exited = true;
+    }
+    std::shared_ptr<ThreadBuffer> buffer;
+};
+
 Sink& Sink::GetInstance()
 {
     static Sink instance;
     return instance;
 }
 
+Sink::Sink()
+{
+    file_writer_cfg_.prealloc_size = kDefaultPreallocSize;
+    file_writer_cfg_.block_size = kDefaultWriteBlockSize;
+
+    for (auto &buffer : crash_buffers_)
+        buffer = nullptr;
+    crash_str_arena_.reset(new char[kCrashStrArenaSize]);
+    crash_str_offsets_.reset(new uint32_t[kMaxCrashStrNum]);
+}
+
 Sink::~Sink()
 {
     disable();
@@ -82,15 +211,95 @@ bool Sink::setPathPrefix(const std::string &path_prefix)
     name_list_filename_ = dir_path_ + "/names.txt";
     module_list_filename_ = dir_path_ + "/modules.txt";
     thread_list_filename_ = dir_path_ + "/threads.txt";
-    CHECK_CLOSE_RESET_FD(curr_record_fd_);
+    is_file_reopen_required_ = true;
 
     return true;
 }
 
 void Sink::setFileSyncEnable(bool is_enable)
 {
+    std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
     is_file_sync_enabled_ = is_enable;
-    CHECK_CLOSE_RESET_FD(curr_record_fd_);
+    if (is_enable)
+        file_writer_cfg_.sync_mode = util::FileWriter::SyncMode::kDsync;
+    else if (file_writer_cfg_.sync_mode == util::FileWriter::SyncMode::kDsync)
+        file_writer_cfg_.sync_mode = util::FileWriter::SyncMode::kNone;
+    is_file_reopen_required_ = true;
+}
+
+void Sink::setFileWriterConfig(const util::FileWriter::Config &cfg)
+{
+    std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
+    file_writer_cfg_ = cfg;
+    is_file_sync_enabled_ = cfg.sync_mode == util::FileWriter::SyncMode::kDsync;
+    is_file_reopen_required_ = true;
+}
+
+util::FileWriter::Config Sink::getFileWriterConfig() const
+{
+    std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
+    return file_writer_cfg_;
+}
+
+void Sink::setCompressType(util::CompressType type)
+{
+    std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
+    compress_type_ = type;
+    is_file_reopen_required_ = true;
+}
+
+util::CompressType Sink::getCompressType() const
+{
+    std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
+    return compress_type_;
+}
+
+void Sink::setThreadBufferSize(size_t record_num)
+{
+    if (record_num > 0) {
+        thread_buffer_size_ = record_num;
+        ++buffer_generation_;
+    }
+}
+
+void Sink::setMode(Mode mode)
+{
+    if (mode_.exchange(mode) != mode)
+        ++buffer_generation_;
+}
+
+void Sink::setFlightRecorderSize(size_t size)
+{
+    if (size >= sizeof(Record)) {
+        flight_recorder_size_ = size;
+        ++buffer_generation_;
+    }
+}
+
+void Sink::setSampleRate(uint32_t one_in_n)
+{
+    sample_rate_ = one_in_n > 0 ? one_in_n : 1;
+}
+
+void Sink::setRecordBudget(uint32_t records_per_sec)
+{
+    record_budget_ = records_per_sec;
+    if (records_per_sec == 0)
+        adaptive_sample_rate_ = 1;
+}
+
+uint32_t Sink::getEffectiveSampleRate() const
+{
+    return std::max(sample_rate_.load(), adaptive_sample_rate_.load());
+}
+
+size_t Sink::getDroppedRecordNum() const
+{
+    std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+    size_t dropped_num = retired_dropped_num_;
+    for (auto &buffer : thread_buffers_)
+        dropped_num += buffer->dropped_num.load(std::memory_order_relaxed);
+    return dropped_num;
 }
 
 bool Sink::enable()
@@ -103,16 +312,8 @@ bool Sink::enable()
         return false;
     }
 
-    using namespace std::placeholders;
-
-    util::AsyncPipe::Config config;
-    config.buff_size = 10240;
-    config.buff_min_num = 2;
-    config.buff_max_num = 20;
-    config.interval = 1000;
-
-    async_pipe_.initialize(config);
-    async_pipe_.setCallback(std::bind(&Sink::onBackendRecvData, this, _1, _2));
+    is_collector_running_ = true;
+    collector_thread_ = std::thread(&Sink::collectorProc, this);
     is_enabled_ = true;
 
     return true;
@@ -122,16 +323,105 @@ void Sink::disable()
 {
     if (is_enabled_) {
         is_enabled_ = false;
-        async_pipe_.cleanup();
-        CHECK_CLOSE_RESET_FD(curr_record_fd_);
-        buffer_.hasReadAll();
+        {
+            std::lock_guard<std::mutex> lg(collector_lock_);
+            is_collector_running_ = false;
+        }
+        collector_cond_.notify_one();
+        collector_thread_.join();   //! 后端线程退出前会取完所有的记录
+        dump_cond_.notify_all();
+        record_writer_.close();
+
+        if (crash_dump_readers_ == 0) {
+            for (auto &buffer : crash_buffers_)
+                buffer = nullptr;
+            crash_buffer_holders_.clear();
+            auto fd = crash_fd_.exchange(-1);
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+}
+
+bool Sink::dumpFlightRecords(bool wait)
+{
+    if (!is_enabled_ || mode_ != Mode::kFlightRecorder)
+        return false;
+
+    //! 在后端线程中调用，如后端线程崩溃触发的信号处理，无法转储
+    if (std::this_thread::get_id() == collector_thread_.get_id())
+        return false;
+
+    std::unique_lock<std::mutex> lk(collector_lock_);
+    if (!is_collector_running_)
+        return false;
+
+    auto seq = ++dump_request_seq_;
+    collector_cond_.notify_one();
+
+    if (!wait)
+        return true;
+
+    return dump_cond_.wait_for(lk, kDumpWaitTimeout,
+        [=] { return dump_done_seq_ >= seq || !is_collector_running_; }) && dump_done_seq_ >= seq;
+}
+
+bool Sink::dumpFlightRecordsOnCrash()
+{
+    if (!is_enabled_ || mode_ != Mode::kFlightRecorder)
+        return false;
+
+    int fd = crash_fd_;
+    if (fd < 0)
+        return false;
+
+    //! 先登记，后端线程看到后不再释放已发布的缓冲
+    ++crash_dump_readers_;
+
+    auto str_num = crash_str_num_.load(std::memory_order_acquire);
+    CrashWriter writer(fd);
+    writer.append("==== flight records of pid ").append(static_cast<uint64_t>(::getpid())).append(" ====\n");
+
+    for (auto &slot : crash_buffers_) {
+        auto buffer = slot.load();
+        if (buffer == nullptr)
+            continue;
+
+        writer.append("---- thread ").append(static_cast<uint64_t>(buffer->thread_id)).append(" ----\n");
+
+        //! 与 SnapshotRecords() 一样，最旧的两条可能正被覆盖，不转储
+        auto size = buffer->records.size();
+        auto tail = buffer->tail.load(std::memory_order_acquire);
+        auto keep = size > 2 ? size - 2 : size;
+        auto begin = tail > keep ? tail - keep : 0;
+
+        for (auto i = begin; i != tail; ++i) {
+            auto &record = buffer->records[i & buffer->mask];
+            writer.append(record.end_ts_us).append(" ")
+                  .append(record.duration_us).append(" ")
+                  .append(getCrashString(record.module_id, str_num)).append(" ")
+                  .append(static_cast<uint64_t>(record.line)).append(" ")
+                  .append(getCrashString(record.name_id, str_num)).append("\n");
+        }
     }
+
+    writer.flush();
+    ::fsync(fd);
+    return true;
+}
+
+void Sink::setFilterStrategy(FilterStrategy strategy)
+{
+    std::unique_lock<std::mutex> lk(lock_);
+    filter_strategy_ = strategy;
+    ++filter_generation_;
 }
 
 void Sink::setFilterExemptSet(const ExemptSet &exempt_set)
 {
     std::unique_lock<std::mutex> lk(lock_);
     filter_exempt_set_ = exempt_set;
+    ++filter_generation_;
 }
 
 Sink::ExemptSet Sink::getFilterExemptSet() const
@@ -151,28 +441,471 @@ bool Sink::isFilterPassed(const std::string &module) const
         return is_in_exempt_set;
 }
 
+bool Sink::isFilterPassed(ThreadBuffer *buffer, uint32_t module_id, const char *module)
+{
+    auto generation = filter_generation_.load(std::memory_order_relaxed);
+    if (buffer->filter_generation != generation) {
+        buffer->module_filter_results.assign(buffer->module_filter_results.size(), -1);
+        buffer->filter_generation = generation;
+    }
+
+    if (module_id >= buffer->module_filter_results.size())
+        buffer->module_filter_results.resize(module_id + 1, -1);
+
+    auto &result = buffer->module_filter_results[module_id];
+    if (result < 0)
+        result = isFilterPassed(module) ? 1 : 0;
+    return result == 1;
+}
+
+bool Sink::isSampled(ThreadBuffer *buffer, const char *name, uint32_t line)
+{
+    buffer->offered_num.store(buffer->offered_num.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    uint32_t sample_rate = std::max(sample_rate_.load(std::memory_order_relaxed),
+                                    adaptive_sample_rate_.load(std::memory_order_relaxed));
+    if (sample_rate <= 1)
+        return true;
+
+    auto hash = reinterpret_cast<uintptr_t>(name) ^ (line * 0x9e3779b1u);
+    hash ^= hash >> 11;
+    auto &counter = buffer->site_counters[hash & (kSiteCounterSize - 1)];
+    return (counter++ % sample_rate) == 0;
+}
+
+Sink::ThreadBuffer* Sink::getThreadBuffer()
+{
+    static thread_local ThreadBufferHolder _holder;
+
+    auto generation = buffer_generation_.load(std::memory_order_acquire);
+    if (!_holder.buffer || _holder.buffer->generation != generation) {
+        //! 模式或大小已修改，旧的缓冲按线程已退出处理，由后端线程回收
+        if (_holder.buffer)
+            _holder.buffer->is_exited = true;
+
+        bool is_flight_recorder = mode_ == Mode::kFlightRecorder;
+        auto capacity = is_flight_recorder ? flight_recorder_size_ / sizeof(Record) : thread_buffer_size_;
+        auto buffer = std::make_shared<ThreadBuffer>(capacity);
+        buffer->thread_id = ::syscall(SYS_gettid);
+        buffer->is_flight_recorder = is_flight_recorder;
+        buffer->generation = generation;
+
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        thread_buffers_.push_back(buffer);
+        _holder.buffer = std::move(buffer);
+    }
+
+    return _holder.buffer.get();
+}
+
+uint32_t Sink::internPointer(ThreadBuffer *buffer, const char *str)
+{
+    auto hash = reinterpret_cast<uintptr_t>(str);
+    hash ^= hash >> 9;
+    hash ^= hash >> 17;
+
+    for (size_t i = 0; i < kPtrCacheProbeNum; ++i) {
+        size_t pos = (hash + i) & (kPtrCacheSize - 1);
+        auto key = buffer->ptr_cache_keys[pos];
+        if (key == str)
+            return buffer->ptr_cache_values[pos];
+
+        if (key == nullptr) {   //! 首次出现
+            auto id = internString(str);
+            buffer->ptr_cache_keys[pos] = str;
+            buffer->ptr_cache_values[pos] = id;
+            return id;
+        }
+    }
+
+    //! 缓存已满，每次都查驻留表
+    return internString(str);
+}
+
+uint32_t Sink::internString(const char *str)
+{
+    std::lock_guard<std::mutex> lg(intern_lock_);
+    auto iter = intern_str_to_id_map_.find(str);
+    if (iter != intern_str_to_id_map_.end())
+        return iter->second;
+
+    uint32_t id = intern_strs_.size();
+    intern_strs_.push_back(str);
+    intern_str_to_id_map_[str] = id;
+    appendCrashString(id, str);
+    return id;
+}
+
+void Sink::appendCrashString(uint32_t id, const char *str)
+{
+    if (id >= kMaxCrashStrNum)
+        return;
+
+    auto size = ::strlen(str) + 1;
+    if (crash_str_arena_used_ + size <= kCrashStrArenaSize) {
+        ::memcpy(crash_str_arena_.get() + crash_str_arena_used_, str, size);
+        crash_str_offsets_[id] = crash_str_arena_used_;
+        crash_str_arena_used_ += size;
+    } else {
+        crash_str_offsets_[id] = kNoCrashStr;
+    }
+    crash_str_num_.store(id + 1, std::memory_order_release);
+}
+
+const char* Sink::getCrashString(uint32_t id, uint32_t str_num) const
+{
+    if (id >= str_num || crash_str_offsets_[id] == kNoCrashStr)
+        return "?";
+    return crash_str_arena_.get() + crash_str_offsets_[id];
+}
+
+const std::string& Sink::getInternedString(uint32_t id)
+{
+    if (id >= backend_intern_strs_.size()) {
+        std::lock_guard<std::mutex> lg(intern_lock_);
+        for (size_t i = backend_intern_strs_.size(); i < intern_strs_.size(); ++i)
+            backend_intern_strs_.push_back(intern_strs_[i]);
+    }
+    return backend_intern_strs_.at(id);
+}
+
 void Sink::commitRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us)
 {
     if (!is_enabled_)
         return;
 
-    RecordHeader header = {
-        .thread_id = ::syscall(SYS_gettid),
-        .end_ts_us = end_timepoint_us,
-        .duration_us = duration_us,
-        .line = line,
-        .name_size = ::strlen(name) + 1,
-        .module_size = ::strlen(module) + 1
-    };
+    //! 不足1us的区域记录时长为0，同样要被阈值过滤
+    if (duration_us < duration_threshold_us_.load(std::memory_order_relaxed))
+        return;
+
+    pushRecord(name, module, line, end_timepoint_us, duration_us);
+}
+
+void Sink::commitEvent(const char *name, const char *module, uint32_t line, uint64_t timepoint_us)
+{
+    if (!is_enabled_)
+        return;
+
+    pushRecord(name, module, line, timepoint_us, 0);
+}
+
+void Sink::pushRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us)
+{
+    auto buffer = getThreadBuffer();
+    auto module_id = internPointer(buffer, module);
+    if (!isFilterPassed(buffer, module_id, module) || !isSampled(buffer, name, line))
+        return;
+
+    auto tail = buffer->tail.load(std::memory_order_relaxed);
+    size_t used = 0;
+
+    //! 飞行记录仪模式下直接覆盖最旧的记录，不需要后端线程来取
+    if (!buffer->is_flight_recorder) {
+        used = tail - buffer->head.load(std::memory_order_acquire);
+        if (used >= buffer->records.size()) {
+            buffer->dropped_num.fetch_add(1, std::memory_order_relaxed);
+            requestCollect();
+            return;
+        }
+    }
+
+    auto &record = buffer->records[tail & buffer->mask];
+    record.end_ts_us = end_timepoint_us;
+    record.duration_us = duration_us;
+    record.thread_id = buffer->thread_id;
+    record.name_id = internPointer(buffer, name);
+    record.module_id = module_id;
+    record.line = line;
+    buffer->tail.store(tail + 1, std::memory_order_release);
+
+    //! 用到一半时，提前通知后端来取，以免缓冲满
+    if (!buffer->is_flight_recorder && used + 1 == buffer->records.size() / 2)
+        requestCollect();
+}
+
+void Sink::requestCollect()
+{
+    if (!is_collect_requested_.exchange(true))
+        collector_cond_.notify_one();
+}
+
+void Sink::collectorProc()
+{
+    std::unique_lock<std::mutex> lk(collector_lock_);
+    while (is_collector_running_) {
+        collector_cond_.wait_for(lk, kCollectInterval,
+            [this] {
+                return !is_collector_running_ || is_collect_requested_ ||
+                       dump_request_seq_ != dump_done_seq_;
+            }
+        );
+        is_collect_requested_ = false;
+        auto dump_seq = dump_request_seq_;
+
+        lk.unlock();
+        collectRecords();
+        if (dump_seq != dump_done_seq_)
+            dumpFlightRecordsInBackend();
+        lk.lock();
+
+        if (dump_seq != dump_done_seq_) {
+            dump_done_seq_ = dump_seq;
+            dump_cond_.notify_all();
+        }
+    }
+    lk.unlock();
+
+    collectRecords();
+}
+
+void Sink::collectRecords()
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        buffers = thread_buffers_;
+    }
+
+    collected_records_.clear();
+    for (auto &buffer : buffers) {
+        if (buffer->is_flight_recorder)
+            continue;
+
+        auto head = buffer->head.load(std::memory_order_relaxed);
+        auto tail = buffer->tail.load(std::memory_order_acquire);
+        for (auto i = head; i != tail; ++i)
+            collected_records_.push_back(buffer->records[i & buffer->mask]);
+        buffer->head.store(tail, std::memory_order_release);
+    }
+
+    //! 回收已退出且已取完的线程缓冲
+    //! 已退出线程的飞行记录仍要保留以备转储，只回收最早的、超出数量限制的，或是模式已改变的
+    {
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        size_t exited_flight_buffer_num = std::count_if(thread_buffers_.begin(), thread_buffers_.end(),
+            [] (const std::shared_ptr<ThreadBuffer> &buffer) {
+                return buffer->is_exited && buffer->is_flight_recorder;
+            }
+        );
+        bool is_flight_recorder_mode = mode_ == Mode::kFlightRecorder;
+
+        auto iter = std::remove_if(thread_buffers_.begin(), thread_buffers_.end(),
+            [&] (const std::shared_ptr<ThreadBuffer> &buffer) {
+                if (!buffer->is_exited)
+                    return false;
+
+                bool is_retired = false;
+                if (buffer->is_flight_recorder) {
+                    if (!is_flight_recorder_mode || exited_flight_buffer_num > kMaxExitedFlightBufferNum) {
+                        --exited_flight_buffer_num;
+                        is_retired = true;
+                    }
+                } else {
+                    is_retired = buffer->head.load() == buffer->tail.load();
+                }
+
+                if (is_retired) {
+                    retired_dropped_num_ += buffer->dropped_num.load();
+                    retired_offered_num_ += buffer->offered_num.load();
+                }
+                return is_retired;
+            }
+        );
+        thread_buffers_.erase(iter, thread_buffers_.end());
+    }
+
+    updateCrashDumpContext();
+    updateAdaptiveSampleRate();
+
+    if (collected_records_.empty()) {
+        //! 空闲时，将缓存中不足一块的记录写入文件
+        if (record_writer_.isOpened())
+            record_writer_.flush();
+        return;
+    }
+
+    //! 各线程的记录是分别取出的，需按时间重新排序
+    std::stable_sort(collected_records_.begin(), collected_records_.end(),
+        [] (const Record &a, const Record &b) { return a.end_ts_us < b.end_ts_us; });
+
+    if (has_live_listener_)
+        notifyLiveListeners(collected_records_);
+
+    onBackendRecvRecords(collected_records_);
+}
+
+void Sink::SnapshotRecords(ThreadBuffer *buffer, std::vector<Record> &records)
+{
+    auto size = buffer->records.size();
+    auto tail = buffer->tail.load(std::memory_order_acquire);
+    auto begin = tail > size ? tail - size : 0;
+    auto start_pos = records.size();
+
+    for (auto i = begin; i != tail; ++i)
+        records.push_back(buffer->records[i & buffer->mask]);
+
+    //! 拷贝期间，记录线程可能已覆盖了最旧的一部分，要丢弃
+    //! 正在写的 new_tail 会覆盖 new_tail - size，另外多丢一条，以防弱内存序下记录的写入先于 tail 可见
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto new_tail = buffer->tail.load(std::memory_order_relaxed);
+    if (new_tail + 2 > begin + size) {
+        auto overwritten_num = std::min(new_tail + 2 - begin - size, tail - begin);
+        records.erase(records.begin() + start_pos, records.begin() + start_pos + overwritten_num);
+    }
+}
+
+/**
+ * 为 dumpFlightRecordsOnCrash() 准备好转储文件，并发布当前的飞行记录缓冲
+ * 信号处理函数中不能加锁，也不能打开文件，这些都要由后端线程事先做好
+ */
+void Sink::updateCrashDumpContext()
+{
+    //! 已经在转储了，保持现状
+    if (crash_dump_readers_ != 0)
+        return;
+
+    bool is_flight_recorder_mode = mode_ == Mode::kFlightRecorder;
+    if (is_flight_recorder_mode && crash_fd_ < 0) {
+        std::string crash_filename = dir_path_ + "/crash_records.txt";
+        if (!util::fs::MakeDirectory(dir_path_, false)) {
+            LogErrno(errno, "create directory '%s' fail", dir_path_.c_str());
+        } else {
+            int fd = ::open(crash_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd < 0)
+                LogErrno(errno, "open '%s' fail", crash_filename.c_str());
+            crash_fd_ = fd;
+        }
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> holders;
+    if (is_flight_recorder_mode) {
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        for (auto &buffer : thread_buffers_) {
+            if (buffer->is_flight_recorder && holders.size() < kMaxCrashBufferNum)
+                holders.push_back(buffer);
+        }
+    }
+
+    if (holders == crash_buffer_holders_)
+        return;
+
+    for (size_t i = 0; i < kMaxCrashBufferNum; ++i)
+        crash_buffers_[i] = i < holders.size() ? holders[i].get() : nullptr;
 
-    async_pipe_.appendLock();
-    async_pipe_.appendLockless(&header, sizeof(header));
-    async_pipe_.appendLockless(name, header.name_size);
-    async_pipe_.appendLockless(module, header.module_size);
-    async_pipe_.appendUnlock();
+    //! 发布之后再检查一次，若信号处理函数已开始转储，它可能读到的是旧的缓冲，都要保留
+    if (crash_dump_readers_ == 0)
+        crash_buffer_holders_.swap(holders);
+    else
+        crash_buffer_holders_.insert(crash_buffer_holders_.end(), holders.begin(), holders.end());
+}
+
+void Sink::dumpFlightRecordsInBackend()
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        buffers = thread_buffers_;
+    }
+
+    collected_records_.clear();
+    for (auto &buffer : buffers) {
+        if (buffer->is_flight_recorder)
+            SnapshotRecords(buffer.get(), collected_records_);
+    }
+
+    if (collected_records_.empty()) {
+        LogNotice("no flight record to dump");
+        return;
+    }
+
+    std::stable_sort(collected_records_.begin(), collected_records_.end(),
+        [] (const Record &a, const Record &b) { return a.end_ts_us < b.end_ts_us; });
+
+    //! 每次转储都写入一个新的记录文件
+    record_writer_.close();
+    onBackendRecvRecords(collected_records_);
+    record_writer_.close();
+
+    LogInfo("dump %lu flight records to '%s'", collected_records_.size(), curr_record_filename_.c_str());
+}
+
+void Sink::updateAdaptiveSampleRate()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - last_adapt_time_;
+    if (elapsed < std::chrono::seconds(1))
+        return;
+
+    size_t offered_num = 0;
+    {
+        std::lock_guard<std::mutex> lg(thread_buffers_lock_);
+        offered_num = retired_offered_num_;
+        for (auto &buffer : thread_buffers_)
+            offered_num += buffer->offered_num.load(std::memory_order_relaxed);
+    }
+
+    auto offered_rate = (offered_num - last_offered_num_) * 1000000 /
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    last_offered_num_ = offered_num;
+    last_adapt_time_ = now;
+
+    uint32_t budget = record_budget_;
+    uint32_t adaptive_rate = 1;
+    if (budget > 0 && offered_rate > budget)
+        adaptive_rate = (offered_rate + budget - 1) / budget;
+
+    //! 加大立即生效，减小则每次减半，避免在预算附近来回振荡
+    auto curr_rate = adaptive_sample_rate_.load();
+    if (adaptive_rate < curr_rate)
+        adaptive_rate = std::max(adaptive_rate, curr_rate / 2);
+    adaptive_sample_rate_ = adaptive_rate;
+}
+
+int Sink::addLiveListener(const LiveListener &listener)
+{
+    std::lock_guard<std::mutex> lg(live_listeners_lock_);
+    auto listener_id = next_live_listener_id_++;
+    live_listeners_[listener_id] = listener;
+    has_live_listener_ = true;
+    return listener_id;
+}
+
+void Sink::removeLiveListener(int listener_id)
+{
+    std::lock_guard<std::mutex> lg(live_listeners_lock_);
+    live_listeners_.erase(listener_id);
+    has_live_listener_ = !live_listeners_.empty();
+}
+
+void Sink::notifyLiveListeners(const std::vector<Record> &records)
+{
+    //! 先取一次最大的ID，使后端的驻留字串副本扩充完整，之后取到的字串地址不再变化
+    uint32_t max_id = 0;
+    for (auto &record : records)
+        max_id = std::max(max_id, std::max(record.name_id, record.module_id));
+    getInternedString(max_id);
+
+    live_records_.clear();
+    live_records_.reserve(records.size());
+    for (auto &record : records) {
+        LiveRecord live_record;
+        live_record.end_ts_us = record.end_ts_us;
+        live_record.duration_us = record.duration_us;
+        live_record.thread_id = record.thread_id;
+        live_record.name_id = record.name_id;
+        live_record.module_id = record.module_id;
+        live_record.line = record.line;
+        live_record.name = &backend_intern_strs_[record.name_id];
+        live_record.module = &backend_intern_strs_[record.module_id];
+        live_records_.push_back(live_record);
+    }
+
+    std::lock_guard<std::mutex> lg(live_listeners_lock_);
+    for (auto &item : live_listeners_)
+        item.second(live_records_);
 }
 
-void Sink::onBackendRecvData(const void *data, size_t size)
+void Sink::onBackendRecvRecords(const std::vector<Record> &records)
 {
     auto start_ts = std::chrono::steady_clock::now();
 
@@ -182,43 +915,31 @@ void Sink::onBackendRecvData(const void *data, size_t size)
         !checkAndWriteThreads())
         return;
 
-    buffer_.append(data, size);
     std::vector<uint8_t> write_cache;
+    write_cache.reserve(records.size() * 8);
 
-    while (buffer_.readableSize() > sizeof(RecordHeader)) {
-        RecordHeader header;
-        ::memcpy(&header, buffer_.readableBegin(), sizeof(header));
-        //! Q: 为什么不直接引用，像这样 auto *phead = static_cast<const RecordHeader*>(buffer_.readableBegin())
-        //     而是要先copy到header再使用？
-        //! A: 因为直接指针引用会有对齐的问题。
-
-        auto packet_size = header.name_size + header.module_size + sizeof(header);
-        //! 如果长度不够，就跳过，等下一次
-        if (packet_size > buffer_.readableSize()) {
-            TBOX_ASSERT(packet_size < 1024); //! 正常不应该超过1K的，如果真超过了就是Bug
-            break;
-        }
-
-        buffer_.hasRead(sizeof(header));
-
-        const char *name = reinterpret_cast<const char*>(buffer_.readableBegin());
-        const char *module = name + header.name_size;
-        onBackendRecvRecord(header, name, module, write_cache);
-
-        buffer_.hasRead(header.name_size + header.module_size);
-    }
+    for (auto &record : records)
+        onBackendRecvRecord(record, write_cache);
 
     if (!write_cache.empty()) {
+        bool is_ok = false;
+        if (record_compressor_) {
+            //! 每批记录压缩成一帧
+            compressed_cache_.clear();
+            is_ok = record_compressor_->compress(write_cache.data(), write_cache.size(), compressed_cache_) &&
+                    record_writer_.write(compressed_cache_.data(), compressed_cache_.size());
+        } else {
+            is_ok = record_writer_.write(write_cache.data(), write_cache.size());
+        }
 
-        auto wsize = ::write(curr_record_fd_, write_cache.data(), write_cache.size());
-        if (wsize != static_cast<ssize_t>(write_cache.size())) {
+        if (!is_ok) {
             LogErrno(errno, "write record file '%s' fail", curr_record_filename_.c_str());
             return;
         }
 
-        total_write_size_ += wsize;
-        if (total_write_size_ >= record_file_max_size_)
-            CHECK_CLOSE_RESET_FD(curr_record_fd_);
+        //! 关闭文件的收尾工作由 FileWriter 的后台线程完成，不阻塞后端线程
+        if (record_writer_.size() >= record_file_max_size_)
+            record_writer_.close();
     }
 
     auto time_cost = std::chrono::steady_clock::now() - start_ts;
@@ -226,14 +947,26 @@ void Sink::onBackendRecvData(const void *data, size_t size)
         LogNotice("trace sink cost > 100 ms, %lu us", time_cost.count() / 1000);
 }
 
-void Sink::onBackendRecvRecord(const RecordHeader &record, const char *name, const char *module, std::vector<uint8_t> &write_cache)
+void Sink::onBackendRecvRecord(const Record &record, std::vector<uint8_t> &write_cache)
 {
-    if (!isFilterPassed(module))
-        return;
-
     auto thread_index = allocThreadIndex(record.thread_id);
-    auto name_index = allocNameIndex(name, record.line);
-    auto module_index = allocModuleIndex(module);
+
+    Index name_index = 0;
+    uint64_t name_key = (static_cast<uint64_t>(record.name_id) << 32) | record.line;
+    auto name_iter = name_id_line_to_index_map_.find(name_key);
+    if (name_iter != name_id_line_to_index_map_.end()) {
+        name_index = name_iter->second;
+    } else {
+        name_index = allocNameIndex(getInternedString(record.name_id), record.line);
+        name_id_line_to_index_map_[name_key] = name_index;
+    }
+
+    if (record.module_id >= module_id_to_index_vec_.size())
+        module_id_to_index_vec_.resize(record.module_id + 1, std::numeric_limits<Index>::max());
+    auto &module_index = module_id_to_index_vec_[record.module_id];
+    if (module_index == std::numeric_limits<Index>::max())
+        module_index = allocModuleIndex(getInternedString(record.module_id));
+
     auto time_diff = record.end_ts_us - last_timepoint_us_;
 
     constexpr size_t kBufferSize = 40;
@@ -252,12 +985,42 @@ void Sink::onBackendRecvRecord(const RecordHeader &record, const char *name, con
     std::copy(buffer, buffer + data_size, back_insert_iter);
 }
 
+void Sink::applyFileWriterConfig()
+{
+    util::FileWriter::Config list_cfg;
+    {
+        std::lock_guard<std::mutex> lg(file_writer_cfg_lock_);
+        record_writer_.setConfig(file_writer_cfg_);
+        if (is_file_sync_enabled_)
+            list_cfg.sync_mode = util::FileWriter::SyncMode::kDsync;
+
+        if (compress_type_ == util::CompressType::kNone)
+            record_compressor_.reset();
+        else if (!record_compressor_ || record_compressor_->type() != compress_type_)
+            record_compressor_.reset(new util::BlockCompressor(compress_type_));
+    }
+
+    //! 列表文件很小，且每次追加的内容都要立即写入，只沿用落盘的配置
+    name_list_writer_.setConfig(list_cfg);
+    module_list_writer_.setConfig(list_cfg);
+    thread_list_writer_.setConfig(list_cfg);
+
+    record_writer_.close();
+    name_list_writer_.close();
+    module_list_writer_.close();
+    thread_list_writer_.close();
+}
+
 bool Sink::checkAndCreateRecordFile()
 {
-    if (curr_record_fd_ >= 0) {
-        if (util::fs::IsFileExist(curr_record_filename_))
+    if (is_file_reopen_required_.exchange(false))
+        applyFileWriterConfig();
+
+    //! 由 inotify 得知文件是否被删除，不需要每次都 stat()
+    if (record_writer_.isOpened()) {
+        if (!record_writer_.isDeleted())
             return true;
-        CHECK_CLOSE_RESET_FD(curr_record_fd_);
+        record_writer_.close();
     }
 
     std::string records_path = dir_path_ + "/records";
@@ -277,21 +1040,21 @@ bool Sink::checkAndCreateRecordFile()
             new_record_filename += '.';
             new_record_filename += std::to_string(postfix);
         }
+        if (record_compressor_)
+            new_record_filename += util::BlockCompressor::kFileSuffix;
         ++postfix;
     } while (util::fs::IsFileExist(new_record_filename));    //! 避免在同一秒多次创建日志文件，都指向同一日志名
     curr_record_filename_ = std::move(new_record_filename);
 
-    int flags = O_CREAT | O_WRONLY | O_APPEND;
-    if (is_file_sync_enabled_)
-        flags |= O_DSYNC;
-
-    curr_record_fd_ = ::open(curr_record_filename_.c_str(), flags, S_IRUSR | S_IWUSR);
-    if (curr_record_fd_ < 0) {
+    if (!record_writer_.open(curr_record_filename_)) {
         LogErrno(errno, "open record file '%s' fail", curr_record_filename_.c_str());
         return false;
     }
 
-    total_write_size_ = 0;
+    //! 新的记录文件从新的帧开始，可单独解压
+    if (record_compressor_)
+        record_compressor_->reset();
+
     last_timepoint_us_ = 0;
     return true;
 }
@@ -299,54 +1062,63 @@ bool Sink::checkAndCreateRecordFile()
 bool Sink::checkAndWriteNames()
 {
     //! 如果文件不存在了，则重写所有的名称列表
-    if (!util::fs::IsFileExist(name_list_filename_)) {
-        std::vector<std::string> name_vec(name_to_index_map_.size());
-        for (auto &item : name_to_index_map_)
-            name_vec[item.second] = item.first;
+    if (name_list_writer_.isOpened() && !name_list_writer_.isDeleted())
+        return true;
 
-        std::ostringstream oss;
-        for (auto &content: name_vec)
-            oss << content << ENDLINE;
+    std::vector<std::string> name_vec(name_to_index_map_.size());
+    for (auto &item : name_to_index_map_)
+        name_vec[item.second] = item.first;
 
-        return util::fs::WriteStringToTextFile(name_list_filename_, oss.str(), is_file_sync_enabled_);
-    }
+    std::ostringstream oss;
+    for (auto &content: name_vec)
+        oss << content << ENDLINE;
 
+    if (!name_list_writer_.open(name_list_filename_, true) || !name_list_writer_.write(oss.str())) {
+        LogErrno(errno, "write '%s' fail", name_list_filename_.c_str());
+        return false;
+    }
     return true;
 }
 
 bool Sink::checkAndWriteModules()
 {
     //! 如果文件不存在了，则重写所有的模块列表
-    if (!util::fs::IsFileExist(module_list_filename_)) {
-        std::vector<std::string> module_vec(module_to_index_map_.size());
-        for (auto &item : module_to_index_map_)
-            module_vec[item.second] = item.first;
+    if (module_list_writer_.isOpened() && !module_list_writer_.isDeleted())
+        return true;
 
-        std::ostringstream oss;
-        for (auto &module : module_vec)
-            oss << module << ENDLINE;
+    std::vector<std::string> module_vec(module_to_index_map_.size());
+    for (auto &item : module_to_index_map_)
+        module_vec[item.second] = item.first;
 
-        return util::fs::WriteStringToTextFile(module_list_filename_, oss.str(), is_file_sync_enabled_);
-    }
+    std::ostringstream oss;
+    for (auto &module : module_vec)
+        oss << module << ENDLINE;
 
+    if (!module_list_writer_.open(module_list_filename_, true) || !module_list_writer_.write(oss.str())) {
+        LogErrno(errno, "write '%s' fail", module_list_filename_.c_str());
+        return false;
+    }
     return true;
 }
 
 bool Sink::checkAndWriteThreads()
 {
     //! 如果文件不存在了，则重写所有的线程列表
-    if (!util::fs::IsFileExist(thread_list_filename_)) {
-        std::vector<int> thread_vec(thread_to_index_map_.size());
-        for (auto &item : thread_to_index_map_)
-            thread_vec[item.second] = item.first;
+    if (thread_list_writer_.isOpened() && !thread_list_writer_.isDeleted())
+        return true;
 
-        std::ostringstream oss;
-        for (auto thread_id : thread_vec)
-            oss << thread_id << ENDLINE;
+    std::vector<int> thread_vec(thread_to_index_map_.size());
+    for (auto &item : thread_to_index_map_)
+        thread_vec[item.second] = item.first;
 
-        return util::fs::WriteStringToTextFile(thread_list_filename_, oss.str(), is_file_sync_enabled_);
-    }
+    std::ostringstream oss;
+    for (auto thread_id : thread_vec)
+        oss << thread_id << ENDLINE;
 
+    if (!thread_list_writer_.open(thread_list_filename_, true) || !thread_list_writer_.write(oss.str())) {
+        LogErrno(errno, "write '%s' fail", thread_list_filename_.c_str());
+        return false;
+    }
     return true;
 }
 
@@ -360,7 +1132,7 @@ Sink::Index Sink::allocNameIndex(const std::string &name, uint32_t line)
     auto new_index = next_name_index_++;
     name_to_index_map_[content] = new_index;
 
-    util::fs::AppendStringToTextFile(name_list_filename_, content + ENDLINE, is_file_sync_enabled_);
+    name_list_writer_.write(content + ENDLINE);
     return new_index;
 }
 
@@ -373,7 +1145,7 @@ Sink::Index Sink::allocModuleIndex(const std::string &module)
     auto new_index = next_module_index_++;
     module_to_index_map_[module] = new_index;
 
-    util::fs::AppendStringToTextFile(module_list_filename_, module + ENDLINE, is_file_sync_enabled_);
+    module_list_writer_.write(module + ENDLINE);
     return new_index;
 }
 
@@ -386,7 +1158,7 @@ Sink::Index Sink::allocThreadIndex(long thread_id)
     auto new_index = next_thread_index_++;
     thread_to_index_map_[thread_id] = new_index;
 
-    util::fs::AppendStringToTextFile(thread_list_filename_, std::to_string(thread_id) + ENDLINE, is_file_sync_enabled_);
+    thread_list_writer_.write(std::to_string(thread_id) + ENDLINE);
     return new_index;
 }
 
@@ -27,9 +27,17 @@
 #include <mutex>
 #include <set>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <condition_variable>
+#include <functional>
 
-#include <tbox/util/async_pipe.h>
-#include <tbox/util/buffer.h>
+#include <tbox/util/file_writer.h>
+#include <tbox/util/block_compressor.h>
+
+#include "live_stream.h"
 
 namespace tbox {
 namespace trace {
@@ -67,6 +75,76 @@ class Sink {
     void setRecordFileMaxSize(size_t max_size) { record_file_max_size_ = max_size; }
     size_t getRecordFileMaxSize() const { return record_file_max_size_; }
 
+    /**
+     * 设置记录文件的写入配置，默认预分配1MB、按64KB整块写入，下次打开记录文件时生效
+     *
+     * 不足一块的记录最多缓存 max_hold_ms，后端空闲时也会写入
+     * setFileSyncEnable() 会将 sync_mode 设为 kDsync 或 kNone
+     */
+    void setFileWriterConfig(const util::FileWriter::Config &cfg);
+    util::FileWriter::Config getFileWriterConfig() const;
+
+    /**
+     * 设置记录文件的压缩方式，默认不压缩，下次打开记录文件时生效
+     *
+     * 压缩的记录文件名以 .bin.tbz 结尾，后端每批写入的记录压缩成一帧，analyzer 可直接读取
+     */
+    void setCompressType(util::CompressType type);
+    util::CompressType getCompressType() const;
+
+    /**
+     * 设置每个线程的记录缓冲能存放的记录条数，默认4096，各线程在下一次记录时按新的大小重建缓冲
+     *
+     * 每个线程先将记录写入自己的缓冲，不加锁，不做系统调用，由后端线程定期成批取走。
+     * 缓冲满时，新的记录会被丢弃，并计入 getDroppedRecordNum()
+     */
+    void setThreadBufferSize(size_t record_num);
+    size_t getThreadBufferSize() const { return thread_buffer_size_; }
+
+    //! 获取因线程缓冲满而丢弃的记录数
+    size_t getDroppedRecordNum() const;
+
+    //! 记录模式
+    enum class Mode {
+        kStream,          //! 流式，记录持续写入记录文件（默认）
+        kFlightRecorder,  //! 飞行记录仪，各线程只在内存中循环保留最近的记录，需要时才转储到文件
+    };
+    //! 设置与获取记录模式，各线程在下一次记录时按新的模式重建缓冲
+    void setMode(Mode mode);
+    Mode getMode() const { return mode_; }
+
+    //! 设置飞行记录仪模式下每个线程缓冲的大小，单位：字节，默认1MB
+    void setFlightRecorderSize(size_t size);
+    size_t getFlightRecorderSize() const { return flight_recorder_size_; }
+
+    /**
+     * 转储飞行记录
+     *
+     * 将各线程缓冲中现存的记录，按时间排序后写入一个新的记录文件。
+     * 转储由后端线程执行，记录线程不受影响
+     *
+     * \param wait  是否等待转储完成，最多等待3秒
+     *
+     * \return  bool    请求或转储是否成功，未使能或不是飞行记录仪模式时返回false
+     *
+     * \note    可在终端命令、Loop阻塞回调中调用，会加锁等待，不可在信号处理函数中调用
+     */
+    bool dumpFlightRecords(bool wait = false);
+
+    /**
+     * 在致命信号处理函数中转储飞行记录
+     *
+     * 将各线程缓冲中现存的记录，按线程逐条以文本形式写入 <dir>/crash_records.txt。
+     * 该文件与各线程缓冲的列表由后端线程事先准备好，本函数只用 write(2) 写文件，
+     * 不加锁，不分配内存，是异步信号安全的
+     *
+     * \return  bool    是否已转储，未使能、不是飞行记录仪模式或文件未就绪时返回false
+     *
+     * \note    每行格式：<结束时间戳us> <时长us> <模块> <行号> <名称>；
+     *          记录线程仍在运行，各缓冲中最旧的两条可能正被覆盖，不转储
+     */
+    bool dumpFlightRecordsOnCrash();
+
     bool enable();  //! 使能
     void disable(); //! 停止
 
@@ -79,12 +157,53 @@ class Sink {
     };
     using ExemptSet = std::set<std::string>;
     //! 设置与获取过滤策略，默认允许或是拒绝
-    void setFilterStrategy(FilterStrategy strategy) { filter_strategy_ = strategy; }
+    void setFilterStrategy(FilterStrategy strategy);
     FilterStrategy getFilterStrategy() const { return filter_strategy_; }
     //! 设置与获取豁免集合
     void setFilterExemptSet(const ExemptSet &exempt_set);
     ExemptSet getFilterExemptSet() const;
 
+    /**
+     * 设置采样间隔，每个调用点每 one_in_n 条记录只保留1条
+     * 1 表示不采样，全部记录（默认）
+     */
+    void setSampleRate(uint32_t one_in_n);
+    uint32_t getSampleRate() const { return sample_rate_; }
+
+    /**
+     * 设置每秒记录条数的预算，0 表示不限制（默认）
+     *
+     * 超出预算时，后端每秒根据实际的记录速率加大采样间隔，使记录数接近预算；
+     * 低于预算时，逐步恢复到 setSampleRate() 所设的间隔
+     */
+    void setRecordBudget(uint32_t records_per_sec);
+    uint32_t getRecordBudget() const { return record_budget_; }
+
+    //! 获取当前实际生效的采样间隔
+    uint32_t getEffectiveSampleRate() const;
+
+    /**
+     * 设置时长阈值，只记录持续时长 >= threshold_us 的区域记录，0 表示不限制（默认）
+     * 时长为0的区域记录同样被过滤；RECORD_EVENT() 的事件记录经 commitEvent() 提交，不受影响
+     */
+    void setDurationThreshold(uint64_t threshold_us) { duration_threshold_us_ = threshold_us; }
+    uint64_t getDurationThreshold() const { return duration_threshold_us_; }
+
+    /**
+     * 实时监听者，在后端线程中成批回调，records 已按时间排序
+     * 仅流式模式下有效，飞行记录仪模式下记录不经过后端线程
+     */
+    using LiveListener = std::function<void (const std::vector<LiveRecord> &records)>;
+
+    /**
+     * 添加与删除实时监听者
+     *
+     * \note   removeLiveListener() 返回之后，不会再有回调；
+     *         不可在回调中调用 addLiveListener() 与 removeLiveListener()
+     */
+    int addLiveListener(const LiveListener &listener);
+    void removeLiveListener(int listener_id);
+
     /**
      * \brief 提交记录
      *
@@ -92,33 +211,66 @@ class Sink {
      * \param line          行号
      * \param end_ts        记录结束的时间点，单位: us
      * \param duration_us   记录持续时长，单位:us
+     *
+     * \note   name 与 module 按指针驻留，同一线程中同一地址的字串只在首次出现时读取其内容，
+     *         所以应当是字串常量，RECORD_XXX() 宏都满足这个要求
+     *
+     * 时长阈值、模块过滤、采样都在记录线程中判定，未通过的记录不会进入缓冲
      */
     void commitRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us);
 
+    //! 提交事件记录，时长为0，不受时长阈值限制
+    void commitEvent(const char *name, const char *module, uint32_t line, uint64_t timepoint_us);
+
   protected:
+    Sink();
     ~Sink();
 
-    struct RecordHeader {
-        long thread_id;
+    //! 线程缓冲中的记录项
+    struct Record {
         uint64_t end_ts_us;
         uint64_t duration_us;
+        long     thread_id;
+        uint32_t name_id;   //! 驻留字串ID
+        uint32_t module_id; //! 驻留字串ID
         uint32_t line;
-        size_t name_size;
-        size_t module_size;
     };
 
+    struct ThreadBuffer;
+    struct ThreadBufferHolder;
+
     using Index = uint64_t;
 
-    void onBackendRecvData(const void *data, size_t size);
-    void onBackendRecvRecord(const RecordHeader &record, const char *name, const char *module,
-                             std::vector<uint8_t> &write_cache);
+    ThreadBuffer* getThreadBuffer();
+    uint32_t internPointer(ThreadBuffer *buffer, const char *str);
+    uint32_t internString(const char *str);
+    const std::string& getInternedString(uint32_t id);
+
+    //! 经过模块过滤与采样后，写入本线程的缓冲
+    void pushRecord(const char *name, const char *module, uint32_t line, uint64_t end_timepoint_us, uint64_t duration_us);
+    void requestCollect();
+    void collectorProc();
+    void collectRecords();
+    void dumpFlightRecordsInBackend();
+    static void SnapshotRecords(ThreadBuffer *buffer, std::vector<Record> &records);
+    void updateCrashDumpContext();
+    void appendCrashString(uint32_t id, const char *str);
+    const char* getCrashString(uint32_t id, uint32_t str_num) const;
+
+    void notifyLiveListeners(const std::vector<Record> &records);
+    void onBackendRecvRecords(const std::vector<Record> &records);
+    void onBackendRecvRecord(const Record &record, std::vector<uint8_t> &write_cache);
 
     bool checkAndWriteNames();
     bool checkAndWriteModules();
     bool checkAndWriteThreads();
     bool checkAndCreateRecordFile();
+    void applyFileWriterConfig();
 
     bool isFilterPassed(const std::string &module) const;
+    bool isFilterPassed(ThreadBuffer *buffer, uint32_t module_id, const char *module);
+    bool isSampled(ThreadBuffer *buffer, const char *name, uint32_t line);
+    void updateAdaptiveSampleRate();
 
     Index allocNameIndex(const std::string &name, uint32_t line);
     Index allocModuleIndex(const std::string &module);
@@ -132,15 +284,80 @@ class Sink {
     std::string thread_list_filename_;
     bool is_file_sync_enabled_ = false;
 
+    //! 记录文件的写入配置
+    mutable std::mutex file_writer_cfg_lock_;
+    util::FileWriter::Config file_writer_cfg_;
+    util::CompressType compress_type_ = util::CompressType::kNone;
+    std::atomic_bool is_file_reopen_required_{true};    //! 路径或写入配置改变了，后端需要重新打开文件
+
     std::atomic_bool is_enabled_{false};
 
-    util::AsyncPipe async_pipe_;
+    size_t thread_buffer_size_ = 4096;
+    size_t flight_recorder_size_ = 1 << 20;
+    std::atomic<Mode> mode_{Mode::kStream};
+    std::atomic<uint32_t> buffer_generation_{0};    //! 线程缓冲的版本，模式或大小修改时加1，使各线程重建缓冲
+
+    //! 各线程的记录缓冲
+    mutable std::mutex thread_buffers_lock_;
+    std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers_;
+    size_t retired_dropped_num_ = 0;    //! 已退出线程丢弃的记录数
+    size_t retired_offered_num_ = 0;    //! 已退出线程待采样的记录数
+
+    //! 采样相关变量
+    std::atomic<uint32_t> sample_rate_{1};
+    std::atomic<uint32_t> record_budget_{0};
+    std::atomic<uint32_t> adaptive_sample_rate_{1};
+    std::atomic<uint64_t> duration_threshold_us_{0};
+
+    //! 驻留字串
+    std::mutex intern_lock_;
+    std::unordered_map<std::string, uint32_t> intern_str_to_id_map_;
+    std::vector<std::string> intern_strs_;
+
+    //! 后端线程
+    std::thread collector_thread_;
+    std::mutex collector_lock_;
+    std::condition_variable collector_cond_;
+    bool is_collector_running_ = false;
+    std::atomic_bool is_collect_requested_{false};
+    std::condition_variable dump_cond_;
+    uint64_t dump_request_seq_ = 0;     //! 由 collector_lock_ 保护
+    uint64_t dump_done_seq_ = 0;        //! 由 collector_lock_ 保护
+
+    //! 崩溃转储相关变量，供 dumpFlightRecordsOnCrash() 无锁访问
+    static constexpr size_t kMaxCrashBufferNum = 64;
+    static constexpr size_t kMaxCrashStrNum = 16 << 10;
+    static constexpr size_t kCrashStrArenaSize = 256 << 10;
+    std::atomic<int> crash_fd_{-1};                                 //! 由后端线程事先打开
+    std::atomic<ThreadBuffer*> crash_buffers_[kMaxCrashBufferNum];  //! 由后端线程发布
+    std::vector<std::shared_ptr<ThreadBuffer>> crash_buffer_holders_;   //! 由后端线程读写，保持已发布的缓冲有效
+    std::atomic<int> crash_dump_readers_{0};    //! 正在转储的信号处理函数数，不为0时不释放已发布的缓冲
+    std::unique_ptr<char[]> crash_str_arena_;   //! 驻留字串的副本，只追加，由 intern_lock_ 保护写
+    std::unique_ptr<uint32_t[]> crash_str_offsets_;
+    size_t crash_str_arena_used_ = 0;           //! 由 intern_lock_ 保护
+    std::atomic<uint32_t> crash_str_num_{0};    //! 已发布的字串数
+
+    //! 实时监听者
+    std::mutex live_listeners_lock_;
+    std::map<int, LiveListener> live_listeners_;
+    int next_live_listener_id_ = 1;
+    std::atomic_bool has_live_listener_{false};
 
     //! 下面的成员变量，由后端线程读写
-    util::Buffer buffer_;
+    std::vector<Record> collected_records_;
+    std::vector<LiveRecord> live_records_;
+    std::vector<std::string> backend_intern_strs_;  //! 驻留字串在后端的副本
+    std::unordered_map<uint64_t, Index> name_id_line_to_index_map_;
+    std::vector<Index> module_id_to_index_vec_;
+    std::chrono::steady_clock::time_point last_adapt_time_;
+    size_t last_offered_num_ = 0;
     std::string curr_record_filename_;  //! 当前记录文件的全名
-    int curr_record_fd_ = -1;       //! 当前记录文件描述符
-    size_t total_write_size_ = 0;   //! 当前记录文件已写入数据量
+    util::FileWriter record_writer_;        //! 当前记录文件
+    std::unique_ptr<util::BlockCompressor> record_compressor_;  //! 不压缩时为空
+    std::vector<uint8_t> compressed_cache_;
+    util::FileWriter name_list_writer_;
+    util::FileWriter module_list_writer_;
+    util::FileWriter thread_list_writer_;
     uint64_t last_timepoint_us_ = 0; //! 当前记录文件的上一条记录的时间戳(us)
 
     //! 名称编码
@@ -157,6 +374,7 @@ class Sink {
     mutable std::mutex lock_;
     FilterStrategy filter_strategy_ = FilterStrategy::kPermit;  //! 默认允许
     ExemptSet filter_exempt_set_;
+    std::atomic<uint32_t> filter_generation_{0};  //! 过滤条件的版本，每次修改加1，使线程中缓存的结果失效
 };
 
 }
@@ -27,12 +27,53 @@
 #include <tbox/util/fs.h>
 #include <tbox/util/string.h>
 #include <tbox/util/timestamp.h>
+#include <tbox/util/scalable_integer.h>
+#include <tbox/util/block_compressor.h>
 
 #include "sink.h"
 
 namespace tbox {
 namespace trace {
 
+namespace {
+//! 统计记录文件中的记录条数，每条记录由5个可变长整数组成
+size_t CountRecords(const std::string &record_filename)
+{
+  std::string record_content;
+  if (!util::fs::ReadBinaryFromFile(record_filename, record_content))
+    return 0;
+
+  if (util::BlockDecompressor::IsFrame(record_content.data(), record_content.size())) {
+    util::BlockDecompressor decompressor;
+    std::string decompressed;
+    size_t pos = 0;
+    while (pos < record_content.size()) {
+      auto ret = decompressor.decompress(record_content.data() + pos, record_content.size() - pos, decompressed);
+      if (ret <= 0)
+        break;
+      pos += ret;
+    }
+    record_content.swap(decompressed);
+  }
+
+  auto data = reinterpret_cast<const uint8_t*>(record_content.data());
+  size_t size = record_content.size();
+  size_t record_num = 0;
+  uint64_t value = 0;
+  while (size > 0) {
+    for (int i = 0; i < 5; ++i) {
+      auto parse_size = util::ParseScalableInteger(data, size, value);
+      if (parse_size == 0)
+        return record_num;
+      data += parse_size;
+      size -= parse_size;
+    }
+    ++record_num;
+  }
+  return record_num;
+}
+}
+
 TEST(Sink, Base) {
   std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
 
@@ -89,6 +130,82 @@ TEST(Sink, Base) {
   util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
 }
 
+TEST(Sink, RecordFileRotateAndRecreate) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setRecordFileMaxSize(1000);
+  ts.enable();
+
+  const int kRecordNum = 2000;
+  for (int i = 0; i < kRecordNum / 2; ++i)
+    ts.commitRecord("void a()", "a", 1, 100 + i, 10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  //! 列表文件被删除后，要能重建
+  std::string name_list_filename = ts.getDirPath() + "/names.txt";
+  ASSERT_TRUE(util::fs::RemoveFile(name_list_filename));
+
+  for (int i = kRecordNum / 2; i < kRecordNum; ++i)
+    ts.commitRecord("void b()", "a", 2, 100 + i, 10);
+  ts.disable();
+  ts.setRecordFileMaxSize(std::numeric_limits<size_t>::max());
+
+  std::string name_list_content;
+  ASSERT_TRUE(util::fs::ReadStringFromTextFile(name_list_filename, name_list_content));
+  EXPECT_NE(name_list_content.find("void a() at L1\n"), std::string::npos);
+  EXPECT_NE(name_list_content.find("void b() at L2\n"), std::string::npos);
+
+  //! 超过上限就切换文件，所有的记录都在
+  std::string records_path = ts.getDirPath() + "/records";
+  std::vector<std::string> record_filenames;
+  ASSERT_TRUE(util::fs::ListDirectory(records_path, record_filenames));
+  EXPECT_GT(record_filenames.size(), 1u);
+
+  size_t total_record_num = 0;
+  for (auto &filename : record_filenames)
+    total_record_num += CountRecords(records_path + '/' + filename);
+  EXPECT_EQ(total_record_num, size_t(kRecordNum));
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, Compress) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setCompressType(util::CompressType::kLz4);
+  ts.setRecordFileMaxSize(100);  //! 记录很相似，压缩后很小
+  ts.enable();
+
+  const int kRecordNum = 5000;
+  for (int i = 0; i < kRecordNum; ++i) {
+    ts.commitRecord("void a()", "a", 1, 100 + i, 10);
+    if (i % 1000 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  }
+  ts.disable();
+  ts.setRecordFileMaxSize(std::numeric_limits<size_t>::max());
+  ts.setCompressType(util::CompressType::kNone);
+
+  std::string records_path = ts.getDirPath() + "/records";
+  std::vector<std::string> record_filenames;
+  ASSERT_TRUE(util::fs::ListDirectory(records_path, record_filenames));
+  EXPECT_GT(record_filenames.size(), 1u);
+
+  //! 每个压缩的记录文件都可以单独解压
+  size_t total_record_num = 0;
+  for (auto &filename : record_filenames) {
+    EXPECT_TRUE(util::string::IsEndWith(filename, ".tbz"));
+    total_record_num += CountRecords(records_path + '/' + filename);
+  }
+  EXPECT_EQ(total_record_num, size_t(kRecordNum));
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
 TEST(Sink, MultiThread) {
   std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
 
@@ -108,7 +225,222 @@ TEST(Sink, MultiThread) {
   t.join();
   ts.disable();
 
-  //!TODO: 检查记录和条数是否有2000条
+  EXPECT_EQ(ts.getDroppedRecordNum(), 0u);
+
+  //! 检查记录条数是否有2000条
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 2000u);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, CommitCost) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.enable();
+
+  const int kTimes = 100000;
+  auto start_ts = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTimes; ++i)
+    ts.commitRecord(__PRETTY_FUNCTION__, "A", __LINE__, i, 1);
+  auto cost_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_ts).count();
+  std::cout << "commitRecord() cost: " << cost_ns / kTimes << " ns" << std::endl;
+
+  ts.disable();
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, DurationThreshold) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setDurationThreshold(100);
+  ts.enable();
+
+  ts.commitRecord("void fast()", "a", 1, 100, 10);
+  ts.commitRecord("void slow()", "a", 2, 200, 100);
+  ts.commitRecord("void slower()", "a", 3, 300, 1000);
+  ts.commitRecord("void tiny()", "a", 4, 400, 0);   //! 不足1us的区域记录同样被过滤
+  ts.commitEvent("void event()", "a", 5, 500);      //! 事件不受时长阈值限制
+
+  ts.disable();
+  ts.setDurationThreshold(0);
+
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 3u);
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, SampleRate) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setSampleRate(10);
+  ts.enable();
+
+  //! 两个调用点，各自每10条保留1条
+  for (int i = 0; i < 100; ++i) {
+    ts.commitRecord("void a()", "a", 1, 100 + i, 10);
+    ts.commitRecord("void b()", "a", 2, 100 + i, 10);
+  }
+
+  ts.disable();
+  ts.setSampleRate(1);
+
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 20u);
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, RecordBudget) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setRecordBudget(1000);
+  ts.enable();
+
+  EXPECT_EQ(ts.getEffectiveSampleRate(), 1u);
+
+  //! 约 50000 条/秒，远超预算
+  auto end_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+  while (std::chrono::steady_clock::now() < end_time) {
+    for (int i = 0; i < 50; ++i)
+      ts.commitRecord(__PRETTY_FUNCTION__, "a", __LINE__, util::GetUtcMicroseconds(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  EXPECT_GT(ts.getEffectiveSampleRate(), 1u);
+
+  ts.disable();
+  ts.setRecordBudget(0);
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, FilterInFrontend) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.enable();
+
+  ts.setFilterExemptSet({"b"});
+  ts.commitRecord("void a()", "a", 1, 100, 10);
+  ts.commitRecord("void b()", "b", 1, 101, 10);
+
+  ts.setFilterExemptSet({});
+  ts.commitRecord("void b()", "b", 1, 102, 10);
+
+  ts.disable();
+
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 2u);
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, FlightRecorder) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setMode(Sink::Mode::kFlightRecorder);
+  ts.setFlightRecorderSize(100 * 40); //! 约100条，取整到128条
+  EXPECT_FALSE(ts.dumpFlightRecords());
+  ts.enable();
+  auto dropped_num = ts.getDroppedRecordNum();
+
+  for (int i = 0; i < 1000; ++i)
+    ts.commitRecord("void a()", "a", 1, 100 + i, 10);
+
+  std::thread t([&ts] {
+    for (int i = 0; i < 10; ++i)
+      ts.commitRecord("void b()", "b", 1, 2000 + i, 10);
+  });
+  t.join();
+
+  //! 转储前不写文件
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_FALSE(util::fs::IsFileExist(ts.getDirPath() + "/records"));
+  EXPECT_EQ(ts.getDroppedRecordNum(), dropped_num);
+
+  //! 已退出线程的记录也在其中，已写满的缓冲中最旧的两条可能正被覆盖，不转储
+  ASSERT_TRUE(ts.dumpFlightRecords(true));
+  auto first_filename = ts.getCurrRecordFilename();
+  EXPECT_EQ(CountRecords(first_filename), 126u + 10u);
+
+  ts.commitRecord("void a()", "a", 1, 3000, 10);
+  ASSERT_TRUE(ts.dumpFlightRecords(true));
+  EXPECT_NE(ts.getCurrRecordFilename(), first_filename);
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 126u + 10u);
+
+  ts.disable();
+  ts.setMode(Sink::Mode::kStream);
+  EXPECT_FALSE(ts.dumpFlightRecords());
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, FlightRecorderOnCrash) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+  ts.setMode(Sink::Mode::kFlightRecorder);
+  ts.setFlightRecorderSize(100 * 40); //! 约100条，取整到128条
+  EXPECT_FALSE(ts.dumpFlightRecordsOnCrash());
+  ts.enable();
+
+  for (int i = 0; i < 1000; ++i)
+    ts.commitRecord("void a()", "a", 1, 100 + i, 10);
+
+  std::thread t([&ts] {
+    for (int i = 0; i < 10; ++i)
+      ts.commitRecord("void b()", "b", 2, 2000 + i, 10);
+  });
+  t.join();
+
+  //! 等后端线程打开转储文件，并发布各线程的缓冲
+  auto crash_filename = ts.getDirPath() + "/crash_records.txt";
+  for (int i = 0; i < 20 && !util::fs::IsFileExist(crash_filename); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  ASSERT_TRUE(ts.dumpFlightRecordsOnCrash());
+  ts.disable();
+  ts.setMode(Sink::Mode::kStream);
+
+  std::string content;
+  ASSERT_TRUE(util::fs::ReadStringFromTextFile(crash_filename, content));
+  EXPECT_NE(content.find("1099 10 a 1 void a()\n"), std::string::npos);
+  EXPECT_NE(content.find("2009 10 b 2 void b()\n"), std::string::npos);
+  EXPECT_EQ(content.find("973 10 a 1 void a()\n"), std::string::npos);  //! 最旧的两条不转储
+  EXPECT_NE(content.find("974 10 a 1 void a()\n"), std::string::npos);
+
+  util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
+}
+
+TEST(Sink, LiveListener) {
+  std::string path_prefix = "/tmp/cpp-tbox-test/trace-sink";
+
+  auto &ts = Sink::GetInstance();
+  ts.setPathPrefix(path_prefix);
+
+  std::vector<std::string> names;
+  auto listener_id = ts.addLiveListener(
+    [&] (const std::vector<LiveRecord> &records) {
+      for (auto &record : records)
+        names.push_back(*record.module + ':' + *record.name);
+    }
+  );
+
+  ts.enable();
+  ts.commitRecord("void a()", "a", 1, 100, 10);
+  ts.commitRecord("void b()", "b", 2, 101, 10);
+  ts.disable();
+
+  ts.removeLiveListener(listener_id);
+  EXPECT_EQ(names, std::vector<std::string>({"a:void a()", "b:void b()"}));
+  EXPECT_EQ(CountRecords(ts.getCurrRecordFilename()), 2u);
+
   util::fs::RemoveDirectory("/tmp/cpp-tbox-test");
 }
 
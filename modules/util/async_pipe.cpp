@@ -28,6 +28,8 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 #include <condition_variable>
 #include <iostream>
 
@@ -40,7 +42,7 @@ class AsyncPipe::Impl {
   public:
     class Buffer {
       public:
-        Buffer(size_t cap);
+        Buffer(size_t cap, bool is_spill = false);
         ~Buffer();
 
         NONCOPYABLE(Buffer);
@@ -53,12 +55,19 @@ class AsyncPipe::Impl {
         inline bool   empty() const { return size_ == 0; }
         inline void  *data()  const { return data_; }
         inline size_t size()  const { return size_; }
-        inline void   reset() { size_ = 0; }
+        inline size_t capacity() const { return capacity_; }
+        inline size_t remain() const { return capacity_ - size_; }
+        inline bool   isSpill() const { return is_spill_; }
+        inline size_t recordNum() const { return record_num_; }
+        inline void   addRecord() { ++record_num_; }
+        inline void   reset() { size_ = 0; record_num_ = 0; }
 
       private:
         size_t  capacity_;
         size_t  size_ = 0;
         uint8_t *data_ = nullptr;
+        bool    is_spill_;          //!< 是否为应急缓冲
+        size_t  record_num_ = 0;    //!< 所存的记录数，仅在非 kBlock 策略下有效
     };
 
   public:
@@ -68,14 +77,25 @@ class AsyncPipe::Impl {
     bool initialize(const Config &cfg);
     void setCallback(const Callback &cb) { cb_ = cb; }
     void cleanup();
-    void append(const void *data_ptr, size_t data_size);
+    bool append(const void *data_ptr, size_t data_size);
     void appendLock();
     void appendUnlock();
     void appendLockless(const void *data_ptr, size_t data_size);
+    bool reserveLockless(size_t record_size);
+    Stats getStats() const;
 
   protected:
     void threadFunc();
 
+    //! 将 curr_buffer_ 交给后台
+    void commitCurrBuffer();
+    //! 不阻塞地取一个能容纳 size 字节的缓冲，取不到返回nullptr
+    Buffer* tryTakeBuffer(size_t size);
+    //! 丢弃最早的一个还未被后台处理的缓冲
+    bool dropOldestBuffer();
+    //! 回收处理完或被丢弃的缓冲
+    void recycleBuffer(Buffer *buff);
+
   private:
     Config      cfg_;
     Callback    cb_;
@@ -84,6 +104,7 @@ class AsyncPipe::Impl {
     vector<Buffer*> free_buffers_;  //!< 可用缓冲数组
     deque<Buffer*>  full_buffers_;  //!< 已满缓冲队列
     size_t          buff_num_;      //!< 缓冲个数
+    Buffer*         spill_buffer_ = nullptr;    //!< 空闲的应急缓冲，由 free_buffers_mutex_ 保护
 
     bool    inited_ = false;        //!< 是否已经启动子线程
     bool    stop_signal_ = false;   //!< 停止信号
@@ -95,10 +116,16 @@ class AsyncPipe::Impl {
     mutex   buff_num_mutex_;        //!< 锁 buff_num_ 的
     condition_variable full_buffers_cv_;    //!< full_buffers_ 不为空条件变量
     condition_variable free_buffers_cv_;    //!< free_buffers_ 不为空条件变量
+
+    atomic<uint64_t> dropped_records_{0};
+    atomic<uint64_t> dropped_bytes_{0};
+    atomic<uint64_t> spilled_records_{0};
+    atomic<uint64_t> blocked_times_{0};
 };
 
-AsyncPipe::Impl::Buffer::Buffer(size_t cap) :
-    capacity_(cap)
+AsyncPipe::Impl::Buffer::Buffer(size_t cap, bool is_spill) :
+    capacity_(cap),
+    is_spill_(is_spill)
 {
     data_ = new uint8_t [cap];
 }
@@ -129,6 +156,32 @@ AsyncPipe::~AsyncPipe()
     delete impl_;
 }
 
+bool AsyncPipe::ParseOverflowPolicy(const std::string &name, OverflowPolicy &policy)
+{
+    if (name == "block")
+        policy = OverflowPolicy::kBlock;
+    else if (name == "drop_newest")
+        policy = OverflowPolicy::kDropNewest;
+    else if (name == "drop_oldest")
+        policy = OverflowPolicy::kDropOldest;
+    else if (name == "spill")
+        policy = OverflowPolicy::kSpill;
+    else
+        return false;
+    return true;
+}
+
+const char* AsyncPipe::OverflowPolicyName(OverflowPolicy policy)
+{
+    switch (policy) {
+        case OverflowPolicy::kBlock:        return "block";
+        case OverflowPolicy::kDropNewest:   return "drop_newest";
+        case OverflowPolicy::kDropOldest:   return "drop_oldest";
+        case OverflowPolicy::kSpill:        return "spill";
+    }
+    return "unknown";
+}
+
 bool AsyncPipe::initialize(const Config &cfg)
 {
     return impl_->initialize(cfg);
@@ -144,9 +197,9 @@ void AsyncPipe::cleanup()
     impl_->cleanup();
 }
 
-void AsyncPipe::append(const void *data_ptr, size_t data_size)
+bool AsyncPipe::append(const void *data_ptr, size_t data_size)
 {
-    impl_->append(data_ptr, data_size);
+    return impl_->append(data_ptr, data_size);
 }
 
 void AsyncPipe::appendLock()
@@ -164,6 +217,16 @@ void AsyncPipe::appendLockless(const void *data_ptr, size_t data_size)
     impl_->appendLockless(data_ptr, data_size);
 }
 
+bool AsyncPipe::reserveLockless(size_t record_size)
+{
+    return impl_->reserveLockless(record_size);
+}
+
+AsyncPipe::Stats AsyncPipe::getStats() const
+{
+    return impl_->getStats();
+}
+
 AsyncPipe::Impl::Impl()
 { }
 
@@ -201,6 +264,11 @@ bool AsyncPipe::Impl::initialize(const Config &cfg)
         free_buffers_.push_back(new Buffer(cfg.buff_size));
     buff_num_ = cfg.buff_min_num;
 
+    if (cfg.overflow_policy == OverflowPolicy::kSpill) {
+        size_t spill_size = cfg.spill_buff_size != 0 ? cfg.spill_buff_size : cfg.buff_size * cfg.buff_max_num;
+        spill_buffer_ = new Buffer(spill_size, true);
+    }
+
     auto bt = thread(std::bind(&AsyncPipe::Impl::threadFunc, this));
     backend_thread_.swap(bt);
     inited_ = true;
@@ -222,15 +290,19 @@ void AsyncPipe::Impl::cleanup()
     for (auto item : free_buffers_)
         CHECK_DELETE_RESET_OBJ(item);
     free_buffers_.clear();
+    CHECK_DELETE_RESET_OBJ(spill_buffer_);
 
     cb_ = nullptr;
     inited_ = false;
 }
 
-void AsyncPipe::Impl::append(const void *data_ptr, size_t data_size)
+bool AsyncPipe::Impl::append(const void *data_ptr, size_t data_size)
 {
     std::lock_guard<std::mutex> lg(curr_buffer_mutex_);
+    if (!reserveLockless(data_size))
+        return false;
     appendLockless(data_ptr, data_size);
+    return true;
 }
 
 void AsyncPipe::Impl::appendLock()
@@ -245,6 +317,19 @@ void AsyncPipe::Impl::appendUnlock()
 
 void AsyncPipe::Impl::appendLockless(const void *data_ptr, size_t data_size)
 {
+    //! 非 kBlock 策略下，记录不跨缓冲存放，且不能阻塞
+    if (cfg_.overflow_policy != OverflowPolicy::kBlock) {
+        //! 没有预留过空间的数据，视为一条单独的记录
+        if (curr_buffer_ == nullptr || curr_buffer_->remain() < data_size) {
+            if (!reserveLockless(data_size))
+                return;
+        }
+        curr_buffer_->append(data_ptr, data_size);
+        if (curr_buffer_->full())
+            commitCurrBuffer();
+        return;
+    }
+
     const uint8_t *ptr = static_cast<const uint8_t*>(data_ptr);
     size_t  remain_size = data_size;
 
@@ -261,6 +346,7 @@ void AsyncPipe::Impl::appendLockless(const void *data_ptr, size_t data_size)
                     free_buffers_.push_back(new Buffer(cfg_.buff_size));
                 } else {  //! 否则只能等待后端释放
                     buff_num_mutex_.unlock();
+                    ++blocked_times_;
                     free_buffers_cv_.wait(lk, [this] { return !free_buffers_.empty(); });
                 }
             }
@@ -285,6 +371,135 @@ void AsyncPipe::Impl::appendLockless(const void *data_ptr, size_t data_size)
     }
 }
 
+bool AsyncPipe::Impl::reserveLockless(size_t record_size)
+{
+    //! kBlock 策略下空间总是够的，大不了等
+    if (cfg_.overflow_policy == OverflowPolicy::kBlock)
+        return true;
+
+    if (curr_buffer_ != nullptr) {
+        if (curr_buffer_->remain() >= record_size) {
+            curr_buffer_->addRecord();
+            if (curr_buffer_->isSpill())
+                ++spilled_records_;
+            return true;
+        }
+        //! 当前缓冲放不下整条记录，先交给后台，再取一个新的
+        commitCurrBuffer();
+    }
+
+    for (;;) {
+        curr_buffer_ = tryTakeBuffer(record_size);
+        if (curr_buffer_ != nullptr)
+            break;
+
+        if (cfg_.overflow_policy == OverflowPolicy::kDropOldest && dropOldestBuffer())
+            continue;
+
+        if (cfg_.overflow_policy == OverflowPolicy::kSpill) {
+            std::lock_guard<std::mutex> lg(free_buffers_mutex_);
+            if (spill_buffer_ != nullptr && spill_buffer_->capacity() >= record_size) {
+                curr_buffer_ = spill_buffer_;
+                spill_buffer_ = nullptr;
+                break;
+            }
+        }
+
+        ++dropped_records_;
+        dropped_bytes_ += record_size;
+        return false;
+    }
+
+    curr_buffer_->addRecord();
+    if (curr_buffer_->isSpill())
+        ++spilled_records_;
+    return true;
+}
+
+AsyncPipe::Stats AsyncPipe::Impl::getStats() const
+{
+    Stats stats;
+    stats.dropped_records = dropped_records_.load();
+    stats.dropped_bytes = dropped_bytes_.load();
+    stats.spilled_records = spilled_records_.load();
+    stats.blocked_times = blocked_times_.load();
+    return stats;
+}
+
+void AsyncPipe::Impl::commitCurrBuffer()
+{
+    std::lock_guard<std::mutex> lg(full_buffers_mutex_);
+    full_buffers_.push_back(curr_buffer_);
+    full_buffers_cv_.notify_all();
+    curr_buffer_ = nullptr;
+}
+
+AsyncPipe::Impl::Buffer* AsyncPipe::Impl::tryTakeBuffer(size_t size)
+{
+    std::lock_guard<std::mutex> lg(free_buffers_mutex_);
+    if (size <= cfg_.buff_size && !free_buffers_.empty()) {
+        auto buff = free_buffers_.back();
+        free_buffers_.pop_back();
+        return buff;
+    }
+
+    std::lock_guard<std::mutex> lg2(buff_num_mutex_);
+    //! 超过 buff_size 的记录要单独申请缓冲，必要时释放一个空闲缓冲来腾出名额
+    if (buff_num_ >= cfg_.buff_max_num && !free_buffers_.empty()) {
+        delete free_buffers_.back();
+        free_buffers_.pop_back();
+        --buff_num_;
+    }
+
+    if (buff_num_ < cfg_.buff_max_num) {
+        ++buff_num_;
+        return new Buffer(std::max(size, cfg_.buff_size));
+    }
+    return nullptr;
+}
+
+bool AsyncPipe::Impl::dropOldestBuffer()
+{
+    Buffer *buff = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(full_buffers_mutex_);
+        if (full_buffers_.empty())
+            return false;
+        buff = full_buffers_.front();
+        full_buffers_.pop_front();
+    }
+
+    dropped_records_ += buff->recordNum();
+    dropped_bytes_ += buff->size();
+    recycleBuffer(buff);
+    return true;
+}
+
+void AsyncPipe::Impl::recycleBuffer(Buffer *buff)
+{
+    buff->reset();
+
+    if (buff->isSpill()) {
+        std::lock_guard<std::mutex> lg(free_buffers_mutex_);
+        spill_buffer_ = buff;
+        return;
+    }
+
+    buff_num_mutex_.lock();
+    //! 多出来的与单独申请的大缓冲直接释放
+    if (buff_num_ > cfg_.buff_min_num || buff->capacity() != cfg_.buff_size) {
+        --buff_num_;
+        buff_num_mutex_.unlock();
+        delete buff;
+    } else {
+        buff_num_mutex_.unlock();
+        //! 将处理后的缓冲放回 free_buffers_ 中
+        std::lock_guard<std::mutex> lg(free_buffers_mutex_);
+        free_buffers_.push_back(buff);
+        free_buffers_cv_.notify_all();
+    }
+}
+
 void AsyncPipe::Impl::threadFunc()
 {
     for (;;) {
@@ -345,20 +560,7 @@ void AsyncPipe::Impl::threadFunc()
                 //! 进行处理
                 if (cb_)
                     cb_(buff->data(), buff->size());
-                buff->reset();
-
-                buff_num_mutex_.lock();
-                if (buff_num_ > cfg_.buff_min_num) {
-                    --buff_num_;
-                    buff_num_mutex_.unlock();
-                    delete buff;
-                } else {
-                    buff_num_mutex_.unlock();
-                    //! 将处理后的缓冲放回 free_buffers_ 中
-                    std::lock_guard<std::mutex> lg(free_buffers_mutex_);
-                    free_buffers_.push_back(buff);
-                    free_buffers_cv_.notify_all();
-                }
+                recycleBuffer(buff);
             }
         }
 
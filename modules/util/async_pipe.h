@@ -40,11 +40,18 @@
  * 1）缓冲写满；2）距上次同步数据超过cfg.interval毫秒数
  *
  * 当对象被销毁或cleanup()时，会自动停止后台的线程，并将所有缓冲的数据同步调用预设置的回调
+ *
+ * 当缓冲个数达到 buff_max_num 后，默认的策略是让写入者等待后台释放缓冲。
+ * 如果写入者不能被阻塞，如事件循环线程，可以通过 Config::overflow_policy 选择其它策略。
+ * 除 kBlock 外的策略以一条完整的记录为单位处理，一条记录不会跨缓冲存放，
+ * 所以丢弃缓冲时不会破坏前后记录的完整性。由多段数据组成的记录，写入前要先调用 reserveLockless()。
  */
 #ifndef TBOX_ASYNC_PIPLE_H_20211219
 #define TBOX_ASYNC_PIPLE_H_20211219
 
 #include <cstddef>
+#include <cstdint>
+#include <string>
 #include <functional>
 
 namespace tbox {
@@ -57,20 +64,45 @@ class AsyncPipe {
 
   public:
     using Callback = std::function<void(const void *, size_t)>;
+
+    //! 缓冲用尽时的处理策略
+    enum class OverflowPolicy {
+        kBlock,         //!< 阻塞等待后台释放缓冲
+        kDropNewest,    //!< 丢弃新写入的记录
+        kDropOldest,    //!< 丢弃最早的、还未被后台处理的缓冲，腾出空间给新的记录
+        kSpill,         //!< 写入应急缓冲，应急缓冲也满了再丢弃新写入的记录
+    };
+
     struct Config {
         size_t buff_size = 1024;    //!< 缓冲大小，默认1KB
         size_t buff_min_num = 2;    //!< 缓冲保留个数，默认2
         size_t buff_max_num = 10;   //!< 缓冲最大个数，默认5
         size_t interval = 1000;     //!< 同步间隔，单位ms，默认1秒
+        OverflowPolicy overflow_policy = OverflowPolicy::kBlock;    //!< 缓冲用尽时的处理策略
+        size_t spill_buff_size = 0; //!< kSpill 策略的应急缓冲大小，0表示 buff_size * buff_max_num
+    };
+
+    //! 溢出统计
+    struct Stats {
+        uint64_t dropped_records = 0;   //!< 丢弃的记录数
+        uint64_t dropped_bytes = 0;     //!< 丢弃的字节数
+        uint64_t spilled_records = 0;   //!< 写入应急缓冲的记录数
+        uint64_t blocked_times = 0;     //!< 写入者被阻塞的次数
     };
 
+    //! 解析与获取 OverflowPolicy 的名称，名称分别为：block, drop_newest, drop_oldest, spill
+    static bool ParseOverflowPolicy(const std::string &name, OverflowPolicy &policy);
+    static const char* OverflowPolicyName(OverflowPolicy policy);
+
     bool initialize(const Config &cfg);     //! 初始化
     void setCallback(const Callback &cb);   //! 设置回调
 
     /**
-     * \brief 有锁异步写入
+     * \brief 有锁异步写入一条记录
+     *
+     * \return false 表示该记录因缓冲溢出被丢弃
      */
-    void append(const void *data_ptr, size_t data_size); //! 有锁异步写入
+    bool append(const void *data_ptr, size_t data_size);
 
     void appendLock();    //! 开始无锁追加
     void appendUnlock();  //! 结束无锁追加
@@ -81,6 +113,16 @@ class AsyncPipe {
      */
     void appendLockless(const void *data_ptr, size_t data_size);
 
+    /**
+     * \brief 为接下来一条大小为 record_size 的记录预留空间
+     *        须在 appendLock() 与 appendUnlock() 之间调用，然后用 appendLockless() 写入该记录
+     *
+     * \return false 表示该记录因缓冲溢出要被丢弃，不要再写入它
+     */
+    bool reserveLockless(size_t record_size);
+
+    Stats getStats() const; //! 获取溢出统计
+
     void cleanup(); //! 清理
 
   private:
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <thread>
+#include <atomic>
 #include "buffer.h"
 
 using namespace tbox::util;
@@ -261,5 +262,126 @@ TEST(AsyncPipe, MultiThreadAppend)
     }
 }
 
+/**
+ * 后台处理第一个缓冲时被卡住，检查各溢出策略下保留下来的记录
+ *
+ * 缓冲大小为10，每条记录4字节，每个缓冲只能放2条记录，最多2个缓冲
+ */
+vector<uint32_t> TestOverflowPolicy(AsyncPipe::OverflowPolicy policy, AsyncPipe::Stats &stats)
+{
+    AsyncPipe::Config cfg;
+    cfg.buff_size = 10;
+    cfg.buff_min_num = 1;
+    cfg.buff_max_num = 2;
+    cfg.interval = 10000;
+    cfg.overflow_policy = policy;
+    cfg.spill_buff_size = 20;
+
+    vector<uint32_t> out_data;
+    atomic_bool is_backend_blocked(false);
+    atomic_bool is_release(false);
+
+    AsyncPipe ap;
+    EXPECT_TRUE(ap.initialize(cfg));
+    ap.setCallback(
+        [&] (const void *ptr, size_t size) {
+            is_backend_blocked = true;
+            while (!is_release)
+                this_thread::sleep_for(chrono::milliseconds(1));
+
+            EXPECT_EQ(size % sizeof(uint32_t), 0u);
+            const uint32_t *p = static_cast<const uint32_t*>(ptr);
+            out_data.insert(out_data.end(), p, p + size / sizeof(uint32_t));
+        }
+    );
+
+    for (uint32_t i = 0; i < 20; ++i) {
+        ap.append(&i, sizeof(i));
+        //! 第3条记录使第1个缓冲交给后台，等后台卡住了再继续
+        if (i == 2) {
+            while (!is_backend_blocked)
+                this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+
+    stats = ap.getStats();
+    is_release = true;
+    ap.cleanup();
+    return out_data;
+}
+
+TEST(AsyncPipe, OverflowDropNewest)
+{
+    AsyncPipe::Stats stats;
+    auto out_data = TestOverflowPolicy(AsyncPipe::OverflowPolicy::kDropNewest, stats);
+    EXPECT_EQ(out_data, vector<uint32_t>({0, 1, 2, 3}));
+    EXPECT_EQ(stats.dropped_records, 16u);
+    EXPECT_EQ(stats.dropped_bytes, 16u * 4);
+    EXPECT_EQ(stats.blocked_times, 0u);
+}
+
+TEST(AsyncPipe, OverflowDropOldest)
+{
+    AsyncPipe::Stats stats;
+    auto out_data = TestOverflowPolicy(AsyncPipe::OverflowPolicy::kDropOldest, stats);
+    EXPECT_EQ(out_data, vector<uint32_t>({0, 1, 18, 19}));
+    EXPECT_EQ(stats.dropped_records, 16u);
+    EXPECT_EQ(stats.blocked_times, 0u);
+}
+
+TEST(AsyncPipe, OverflowSpill)
+{
+    AsyncPipe::Stats stats;
+    auto out_data = TestOverflowPolicy(AsyncPipe::OverflowPolicy::kSpill, stats);
+    EXPECT_EQ(out_data, vector<uint32_t>({0, 1, 2, 3, 4, 5, 6, 7, 8}));
+    EXPECT_EQ(stats.spilled_records, 5u);
+    EXPECT_EQ(stats.dropped_records, 11u);
+    EXPECT_EQ(stats.blocked_times, 0u);
+}
+
+TEST(AsyncPipe, OverflowLargeRecord)
+{
+    AsyncPipe::Config cfg;
+    cfg.buff_size = 10;
+    cfg.buff_min_num = 1;
+    cfg.buff_max_num = 4;
+    cfg.interval = 10;
+    cfg.overflow_policy = AsyncPipe::OverflowPolicy::kDropNewest;
+
+    std::string out_data;
+    AsyncPipe ap;
+    EXPECT_TRUE(ap.initialize(cfg));
+    ap.setCallback(
+        [&] (const void *ptr, size_t size) {
+            out_data.append(static_cast<const char*>(ptr), size);
+        }
+    );
+
+    //! 超过缓冲大小的记录不被拆开
+    const std::string large(25, 'x');
+    EXPECT_TRUE(ap.append("abc", 3));
+    EXPECT_TRUE(ap.append(large.data(), large.size()));
+
+    //! 由多段组成的记录
+    ap.appendLock();
+    EXPECT_TRUE(ap.reserveLockless(8));
+    ap.appendLockless("1234", 4);
+    ap.appendLockless("5678", 4);
+    ap.appendUnlock();
+
+    ap.cleanup();
+    EXPECT_EQ(out_data, "abc" + large + "12345678");
+    EXPECT_EQ(ap.getStats().dropped_records, 0u);
+}
+
+TEST(AsyncPipe, OverflowPolicyName)
+{
+    AsyncPipe::OverflowPolicy policy;
+    EXPECT_TRUE(AsyncPipe::ParseOverflowPolicy("drop_oldest", policy));
+    EXPECT_EQ(policy, AsyncPipe::OverflowPolicy::kDropOldest);
+    EXPECT_STREQ(AsyncPipe::OverflowPolicyName(AsyncPipe::OverflowPolicy::kSpill), "spill");
+    EXPECT_FALSE(AsyncPipe::ParseOverflowPolicy("xxx", policy));
+}
+
 }
 }
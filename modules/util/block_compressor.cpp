@@ -0,0 +1,551 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "block_compressor.h"
+
+#include <cstring>
+#include <algorithm>
+
+#if TBOX_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "crc.h"
+
+namespace tbox {
+namespace util {
+
+constexpr const char *BlockCompressor::kFileSuffix;
+
+namespace {
+
+const uint8_t kMagic[3] = {'T', 'B', 'Z'};
+constexpr size_t kHeaderSize = 20;
+constexpr uint8_t kFlagReset = 0x01;
+constexpr size_t kMaxRawSize = 16 << 20;    //!< 每帧原始数据的上限，也用于识别错误的帧头
+constexpr size_t kMaxPayloadSize = kMaxRawSize + kMaxRawSize / 255 + 16;
+
+//! LZ4 块格式的参数
+constexpr size_t kMaxDistance = 65535;
+constexpr size_t kWindowSize = 64 << 10;            //!< 可被引用的历史数据的大小
+constexpr size_t kWindowTrimSize = 4 * kWindowSize; //!< 窗口超过这个大小才裁剪，减少搬移
+constexpr int kHashLog = 14;
+constexpr uint64_t kEmptyPos = UINT64_MAX;
+constexpr size_t kMinMatch = 4;
+constexpr size_t kLastLiterals = 5; //!< 最后5个字节必须是字面量
+constexpr size_t kMfLimit = 12;     //!< 最后一个匹配须在距结尾12字节之前开始
+
+inline uint32_t Read32(const uint8_t *p)
+{
+    uint32_t v;
+    ::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t Hash(uint32_t seq) { return (seq * 2654435761u) >> (32 - kHashLog); }
+
+inline void PutLE32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+inline uint32_t GetLE32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint8_t* WriteLength(uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+bool ReadLength(const uint8_t *&ip, const uint8_t *iend, size_t &len)
+{
+    uint8_t b = 0;
+    do {
+        if (ip >= iend)
+            return false;
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+uint8_t* WriteSequence(uint8_t *op, const uint8_t *literals, size_t lit_len, size_t offset, size_t match_len)
+{
+    uint8_t *token = op++;
+    size_t ml = match_len - kMinMatch;
+    *token = (std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(ml, 15);
+    if (lit_len >= 15)
+        op = WriteLength(op, lit_len - 15);
+    ::memcpy(op, literals, lit_len);
+    op += lit_len;
+    *op++ = offset;
+    *op++ = offset >> 8;
+    if (ml >= 15)
+        op = WriteLength(op, ml - 15);
+    return op;
+}
+
+void TrimWindow(std::vector<uint8_t> &window, uint64_t *p_base = nullptr)
+{
+    if (window.size() <= kWindowTrimSize)
+        return;
+
+    auto drop_size = window.size() - kWindowSize;
+    window.erase(window.begin(), window.begin() + drop_size);
+    if (p_base != nullptr)
+        *p_base += drop_size;
+}
+
+}
+
+bool ParseCompressType(const std::string &name, CompressType &type)
+{
+    if (name == "none")
+        type = CompressType::kNone;
+    else if (name == "lz4")
+        type = CompressType::kLz4;
+    else if (name == "zstd")
+        type = CompressType::kZstd;
+    else
+        return false;
+    return true;
+}
+
+const char* CompressTypeName(CompressType type)
+{
+    switch (type) {
+        case CompressType::kNone: return "none";
+        case CompressType::kLz4:  return "lz4";
+        case CompressType::kZstd: return "zstd";
+    }
+    return "unknown";
+}
+
+bool IsCompressTypeSupported(CompressType type)
+{
+#if TBOX_ENABLE_ZSTD
+    return type == CompressType::kNone || type == CompressType::kLz4 || type == CompressType::kZstd;
+#else
+    return type == CompressType::kNone || type == CompressType::kLz4;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////
+
+BlockCompressor::BlockCompressor(CompressType type, int level) :
+    type_(IsCompressTypeSupported(type) ? type : CompressType::kNone)
+{
+#if TBOX_ENABLE_ZSTD
+    if (type_ == CompressType::kZstd) {
+        auto cctx = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+        zstd_ctx_ = cctx;
+    }
+#else
+    (void)level;
+#endif
+}
+
+BlockCompressor::~BlockCompressor()
+{
+#if TBOX_ENABLE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(zstd_ctx_));
+#endif
+}
+
+void BlockCompressor::reset()
+{
+    is_reset_pending_ = true;
+}
+
+bool BlockCompressor::compress(const void *data, size_t size, std::vector<uint8_t> &out)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+
+    //! 超出单帧上限的，分成多帧
+    while (size > kMaxRawSize) {
+        if (!compress(bytes, kMaxRawSize, out))
+            return false;
+        bytes += kMaxRawSize;
+        size -= kMaxRawSize;
+    }
+
+    if (size == 0)
+        return true;
+
+    auto header_pos = out.size();
+    auto payload_pos = header_pos + kHeaderSize;
+    auto frame_type = type_;
+    size_t payload_size = 0;
+
+    if (type_ == CompressType::kLz4) {
+        if (is_reset_pending_) {
+            window_.clear();
+            window_base_ = 0;
+            hash_table_.assign(1 << kHashLog, kEmptyPos);
+        }
+
+        auto start = window_.size();
+        window_.insert(window_.end(), bytes, bytes + size);
+        out.resize(payload_pos + size + size / 255 + 16);
+        payload_size = compressLz4(start, out.data() + payload_pos);
+
+        //! 压缩不了的直接存放原始数据，解压时同样会放入窗口，不影响后面的帧
+        if (payload_size >= size) {
+            frame_type = CompressType::kNone;
+            ::memcpy(out.data() + payload_pos, bytes, size);
+            payload_size = size;
+        }
+
+        TrimWindow(window_, &window_base_);
+
+    } else if (type_ == CompressType::kZstd) {
+        out.resize(payload_pos);
+        if (!compressZstd(bytes, size, out)) {
+            out.resize(header_pos);
+            return false;
+        }
+        payload_size = out.size() - payload_pos;
+
+    } else {
+        out.resize(payload_pos + size);
+        ::memcpy(out.data() + payload_pos, bytes, size);
+        payload_size = size;
+    }
+
+    out.resize(payload_pos + payload_size);
+
+    auto header = out.data() + header_pos;
+    ::memcpy(header, kMagic, sizeof(kMagic));
+    header[3] = static_cast<uint8_t>(frame_type);
+    header[4] = is_reset_pending_ ? kFlagReset : 0;
+    header[5] = header[6] = header[7] = 0;
+    PutLE32(header + 8, size);
+    PutLE32(header + 12, payload_size);
+    PutLE32(header + 16, CalcCrc32(out.data() + payload_pos, payload_size));
+
+    is_reset_pending_ = false;
+    return true;
+}
+
+size_t BlockCompressor::compressLz4(size_t start, uint8_t *out)
+{
+    const uint8_t *base = window_.data();
+    size_t end = window_.size();
+    size_t ip = start;
+    size_t anchor = start;
+    uint8_t *op = out;
+
+    if (end - start > kMfLimit) {
+        size_t mf_limit = end - kMfLimit;
+        size_t match_limit = end - kLastLiterals;
+        size_t miss_num = 0;
+
+        while (ip < mf_limit) {
+            uint32_t seq = Read32(base + ip);
+            auto &slot = hash_table_[Hash(seq)];
+            uint64_t cand_pos = slot;
+            uint64_t curr_pos = window_base_ + ip;
+            slot = curr_pos;
+
+            if (cand_pos == kEmptyPos || cand_pos < window_base_ ||
+                (curr_pos - cand_pos) > kMaxDistance ||
+                Read32(base + (cand_pos - window_base_)) != seq) {
+                //! 连续未命中时加大步长，对不可压缩的数据更快
+                ip += 1 + (miss_num++ >> 6);
+                continue;
+            }
+            miss_num = 0;
+
+            size_t ref = cand_pos - window_base_;
+            while (ip > anchor && ref > 0 && base[ip - 1] == base[ref - 1]) {
+                --ip;
+                --ref;
+            }
+
+            size_t match_len = kMinMatch;
+            while (ip + match_len < match_limit && base[ip + match_len] == base[ref + match_len])
+                ++match_len;
+
+            op = WriteSequence(op, base + anchor, ip - anchor, ip - ref, match_len);
+            ip += match_len;
+            anchor = ip;
+
+            //! 匹配末尾附近的位置也放入哈希表，提高后面的命中率
+            if (ip < mf_limit)
+                hash_table_[Hash(Read32(base + ip - 2))] = window_base_ + ip - 2;
+        }
+    }
+
+    //! 最后的字面量
+    size_t lit_len = end - anchor;
+    *op++ = std::min<size_t>(lit_len, 15) << 4;
+    if (lit_len >= 15)
+        op = WriteLength(op, lit_len - 15);
+    ::memcpy(op, base + anchor, lit_len);
+    op += lit_len;
+
+    return op - out;
+}
+
+bool BlockCompressor::compressZstd(const void *data, size_t size, std::vector<uint8_t> &out)
+{
+#if TBOX_ENABLE_ZSTD
+    auto cctx = static_cast<ZSTD_CCtx*>(zstd_ctx_);
+    if (is_reset_pending_)
+        ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+
+    //! ZSTD_e_flush 使本块的数据都能立即解压出来，又保留了之前的数据作为字典
+    ZSTD_inBuffer in = { data, size, 0 };
+    size_t pos = out.size();
+    for (;;) {
+        out.resize(pos + std::max(ZSTD_compressBound(size - in.pos), ZSTD_CStreamOutSize()));
+        ZSTD_outBuffer ob = { out.data() + pos, out.size() - pos, 0 };
+        size_t remain = ZSTD_compressStream2(cctx, &ob, &in, ZSTD_e_flush);
+        if (ZSTD_isError(remain))
+            return false;
+        pos += ob.pos;
+        if (remain == 0)
+            break;
+    }
+    out.resize(pos);
+    return true;
+#else
+    (void)data;
+    (void)size;
+    (void)out;
+    return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////
+
+BlockDecompressor::BlockDecompressor() { }
+
+BlockDecompressor::~BlockDecompressor()
+{
+#if TBOX_ENABLE_ZSTD
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(zstd_ctx_));
+#endif
+}
+
+void BlockDecompressor::reset()
+{
+    window_.clear();
+    is_synced_ = false;
+}
+
+bool BlockDecompressor::IsFrame(const void *data, size_t size)
+{
+    return size >= sizeof(kMagic) && ::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+size_t BlockDecompressor::FindFrame(const void *data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i + sizeof(kMagic) <= size; ++i) {
+        if (IsFrame(bytes + i, size - i))
+            return i;
+    }
+    return size;
+}
+
+ssize_t BlockDecompressor::decompress(const void *data, size_t size, std::string &out)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+
+    if (size < kHeaderSize) {
+        //! 不足一个帧头时，只要已有的部分是对的，就认为是还没写完
+        auto cmp_size = std::min(size, sizeof(kMagic));
+        return ::memcmp(bytes, kMagic, cmp_size) == 0 ? 0 : -1;
+    }
+
+    if (!IsFrame(bytes, size))
+        return -1;
+
+    auto frame_type = static_cast<CompressType>(bytes[3]);
+    bool is_reset = (bytes[4] & kFlagReset) != 0;
+    size_t raw_size = GetLE32(bytes + 8);
+    size_t payload_size = GetLE32(bytes + 12);
+    uint32_t crc = GetLE32(bytes + 16);
+
+    if (bytes[3] > static_cast<uint8_t>(CompressType::kZstd) ||
+        raw_size > kMaxRawSize || payload_size > kMaxPayloadSize)
+        return -1;
+
+    if (size < kHeaderSize + payload_size)
+        return 0;
+
+    auto payload = bytes + kHeaderSize;
+    ssize_t frame_size = kHeaderSize + payload_size;
+
+    //! 这一帧坏了，后面引用它的帧也解不对，直到下一个带 kFlagReset 的帧
+    if (CalcCrc32(payload, payload_size) != crc) {
+        is_synced_ = false;
+        return -1;
+    }
+
+    if (is_reset) {
+        window_.clear();
+        is_synced_ = true;
+#if TBOX_ENABLE_ZSTD
+        if (zstd_ctx_ != nullptr)
+            ZSTD_DCtx_reset(static_cast<ZSTD_DCtx*>(zstd_ctx_), ZSTD_reset_session_only);
+#endif
+    }
+
+    if (frame_type == CompressType::kNone) {
+        if (payload_size != raw_size)
+            return -1;
+        out.append(reinterpret_cast<const char*>(payload), payload_size);
+        window_.insert(window_.end(), payload, payload + payload_size);
+        TrimWindow(window_);
+        return frame_size;
+    }
+
+    //! 缺少之前的数据，解不了，跳过
+    if (!is_synced_)
+        return frame_size;
+
+    bool is_ok = false;
+    if (frame_type == CompressType::kLz4) {
+        is_ok = decompressLz4(payload, payload_size, raw_size);
+        if (is_ok) {
+            out.append(reinterpret_cast<const char*>(window_.data() + window_.size() - raw_size), raw_size);
+            TrimWindow(window_);
+        }
+    } else {
+        is_ok = decompressZstd(payload, payload_size, raw_size, out);
+    }
+
+    if (!is_ok) {
+        is_synced_ = false;
+        return -1;
+    }
+
+    return frame_size;
+}
+
+bool BlockDecompressor::decompressLz4(const uint8_t *payload, size_t payload_size, size_t raw_size)
+{
+    size_t start = window_.size();
+    window_.resize(start + raw_size);
+
+    uint8_t *base = window_.data();
+    size_t op = start;
+    size_t oend = start + raw_size;
+    const uint8_t *ip = payload;
+    const uint8_t *iend = payload + payload_size;
+
+    for (;;) {
+        if (ip >= iend)
+            break;
+
+        uint8_t token = *ip++;
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !ReadLength(ip, iend, lit_len))
+            break;
+        if (lit_len > static_cast<size_t>(iend - ip) || lit_len > oend - op)
+            break;
+
+        ::memcpy(base + op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == iend) {   //! 最后的字面量之后没有匹配
+            if (op == oend)
+                return true;
+            break;
+        }
+
+        if (iend - ip < 2)
+            break;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            break;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !ReadLength(ip, iend, match_len))
+            break;
+        match_len += kMinMatch;
+        if (match_len > oend - op)
+            break;
+
+        size_t ref = op - offset;
+        if (offset >= match_len) {
+            ::memcpy(base + op, base + ref, match_len);
+        } else {
+            //! 重叠的匹配，须逐字节复制
+            for (size_t i = 0; i < match_len; ++i)
+                base[op + i] = base[ref + i];
+        }
+        op += match_len;
+    }
+
+    window_.resize(start);
+    return false;
+}
+
+bool BlockDecompressor::decompressZstd(const uint8_t *payload, size_t payload_size, size_t raw_size, std::string &out)
+{
+#if TBOX_ENABLE_ZSTD
+    if (zstd_ctx_ == nullptr)
+        zstd_ctx_ = ZSTD_createDCtx();
+    auto dctx = static_cast<ZSTD_DCtx*>(zstd_ctx_);
+
+    size_t start = out.size();
+    out.resize(start + raw_size);
+
+    ZSTD_inBuffer in = { payload, payload_size, 0 };
+    ZSTD_outBuffer ob = { &out[start], raw_size, 0 };
+    while (in.pos < in.size || ob.pos < ob.size) {
+        auto last_in_pos = in.pos;
+        auto last_out_pos = ob.pos;
+        auto ret = ZSTD_decompressStream(dctx, &ob, &in);
+        if (ZSTD_isError(ret) || (in.pos == last_in_pos && ob.pos == last_out_pos))
+            break;
+    }
+
+    if (in.pos == in.size && ob.pos == ob.size)
+        return true;
+
+    out.resize(start);
+    return false;
+#else
+    (void)payload;
+    (void)payload_size;
+    (void)raw_size;
+    (void)out;
+    return false;
+#endif
+}
+
+}
+}
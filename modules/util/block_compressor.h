@@ -0,0 +1,140 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_BLOCK_COMPRESSOR_H_20261019
+#define TBOX_UTIL_BLOCK_COMPRESSOR_H_20261019
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace util {
+
+enum class CompressType : uint8_t {
+    kNone = 0,  //!< 不压缩
+    kLz4  = 1,  //!< LZ4块格式，内置实现，速度快
+    kZstd = 2,  //!< zstd，压缩率高，需在编译时开启 TBOX_ENABLE_ZSTD 并链接 libzstd
+};
+
+//! 解析与获取 CompressType 的名称，名称分别为：none, lz4, zstd
+bool ParseCompressType(const std::string &name, CompressType &type);
+const char* CompressTypeName(CompressType type);
+//! 是否支持该压缩类型
+bool IsCompressTypeSupported(CompressType type);
+
+/**
+ * 流式分块压缩器
+ *
+ * 每次 compress() 将一块数据压缩成一个完整的帧，追加到输出中。帧的格式（小端）：
+ *   magic "TBZ"(3B) | type(1B) | flags(1B) | reserved(3B) | raw_size(4B) | payload_size(4B) | crc32(4B) | payload
+ *
+ * 同一个流中，后面的帧可以引用前面帧的数据，所以每块数据即使很小也有不错的压缩率。
+ * reset() 之后的第一帧带有 kFlagReset 标记，不引用之前的数据，通常在开始一个新文件时调用。
+ * 因为每一帧都是完整的，进程崩溃时最多丢失最后一个没有写完整的帧，之前的数据都能解压。
+ *
+ * \warnning    不可多线程同时使用
+ */
+class BlockCompressor {
+  public:
+    /**
+     * \param type   压缩类型，不支持时退化为 kNone，帧中存放原始数据
+     * \param level  压缩级别，仅对 kZstd 有效，<=0 表示使用默认级别
+     */
+    explicit BlockCompressor(CompressType type, int level = 0);
+    ~BlockCompressor();
+
+    NONCOPYABLE(BlockCompressor);
+    IMMOVABLE(BlockCompressor);
+
+  public:
+    CompressType type() const { return type_; }
+
+    //! 压缩一块数据，成帧后追加到 out
+    bool compress(const void *data, size_t size, std::vector<uint8_t> &out);
+
+    //! 之后的帧不再引用之前的数据
+    void reset();
+
+    //! 压缩文件的文件名后缀
+    static constexpr const char *kFileSuffix = ".tbz";
+
+  protected:
+    size_t compressLz4(size_t start, uint8_t *out);
+    bool compressZstd(const void *data, size_t size, std::vector<uint8_t> &out);
+
+  private:
+    CompressType type_;
+    bool is_reset_pending_ = true;
+
+    //! LZ4 的状态
+    std::vector<uint8_t> window_;   //!< 之前最多64KB的数据 + 当前块的数据
+    uint64_t window_base_ = 0;      //!< window_[0] 在整个流中的位置
+    std::vector<uint64_t> hash_table_;  //!< 4字节序列的哈希 -> 在整个流中的位置
+
+    void *zstd_ctx_ = nullptr;
+};
+
+/**
+ * 流式分块解压器，与 BlockCompressor 对应
+ *
+ * 须从流的开头或某个带 kFlagReset 标记的帧开始，按顺序解压每一帧
+ */
+class BlockDecompressor {
+  public:
+    BlockDecompressor();
+    ~BlockDecompressor();
+
+    NONCOPYABLE(BlockDecompressor);
+    IMMOVABLE(BlockDecompressor);
+
+  public:
+    /**
+     * 解压一帧，解压出来的数据追加到 out
+     *
+     * \return  >0  消耗的字节数
+     *          0   数据不足一帧，如正在写或崩溃时没写完的最后一帧
+     *          -1  数据有误，可跳过1个字节，用 FindFrame() 找下一个帧
+     */
+    ssize_t decompress(const void *data, size_t size, std::string &out);
+
+    void reset();
+
+    //! 数据是否以帧头开始，用于区分压缩文件与普通文件
+    static bool IsFrame(const void *data, size_t size);
+    //! 查找下一个帧头的位置，找不到返回 size
+    static size_t FindFrame(const void *data, size_t size);
+
+  protected:
+    bool decompressLz4(const uint8_t *payload, size_t payload_size, size_t raw_size);
+    bool decompressZstd(const uint8_t *payload, size_t payload_size, size_t raw_size, std::string &out);
+
+  private:
+    std::vector<uint8_t> window_;   //!< 之前最多64KB的数据 + 当前块的数据
+    bool is_synced_ = false;        //!< 是否已遇到过带 kFlagReset 标记的帧
+    void *zstd_ctx_ = nullptr;
+};
+
+}
+}
+
+#endif //TBOX_UTIL_BLOCK_COMPRESSOR_H_20261019
@@ -0,0 +1,203 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+
+#include "block_compressor.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+std::string MakeLogLine(int i)
+{
+    return "I 2026-10-19 10:00:00." + std::to_string(100000 + i) + " main.cpp:42 tick, count:" + std::to_string(i) + "\n";
+}
+
+//! 依次解压 data 中的所有帧
+std::string DecompressAll(BlockDecompressor &decompressor, const std::vector<uint8_t> &data)
+{
+    std::string out;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        auto ret = decompressor.decompress(data.data() + pos, data.size() - pos, out);
+        if (ret <= 0)
+            break;
+        pos += ret;
+    }
+    return out;
+}
+
+TEST(BlockCompressor, CompressType) {
+    CompressType type;
+    for (auto name : {"none", "lz4", "zstd"}) {
+        EXPECT_TRUE(ParseCompressType(name, type));
+        EXPECT_STREQ(CompressTypeName(type), name);
+    }
+    EXPECT_FALSE(ParseCompressType("gzip", type));
+    EXPECT_TRUE(IsCompressTypeSupported(CompressType::kNone));
+    EXPECT_TRUE(IsCompressTypeSupported(CompressType::kLz4));
+}
+
+TEST(BlockCompressor, Lz4SmallBlocks) {
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    std::string expect;
+
+    //! 每一块都很小，靠引用之前的块取得压缩率
+    for (int i = 0; i < 1000; ++i) {
+        auto line = MakeLogLine(i);
+        expect += line;
+        ASSERT_TRUE(compressor.compress(line.data(), line.size(), data));
+    }
+    //! 除去每帧20字节的帧头
+    EXPECT_LT(data.size() - 1000 * 20, expect.size() / 2);
+
+    BlockDecompressor decompressor;
+    EXPECT_EQ(DecompressAll(decompressor, data), expect);
+}
+
+TEST(BlockCompressor, Lz4LargeBlock) {
+    std::string expect;
+    for (int i = 0; i < 20000; ++i)
+        expect += MakeLogLine(i % 300);
+
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(compressor.compress(expect.data(), expect.size(), data));
+    ASSERT_TRUE(compressor.compress(expect.data(), expect.size(), data));
+    EXPECT_LT(data.size(), expect.size() / 4);
+
+    BlockDecompressor decompressor;
+    EXPECT_EQ(DecompressAll(decompressor, data), expect + expect);
+}
+
+TEST(BlockCompressor, Incompressible) {
+    std::string expect;
+    uint32_t seed = 1;
+    for (int i = 0; i < 4096; ++i) {
+        seed = seed * 1103515245 + 12345;
+        expect.push_back(seed >> 16);
+    }
+
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(compressor.compress(expect.data(), expect.size(), data));
+    //! 压缩不了的原样存放，只多出一个帧头
+    EXPECT_EQ(data[3], static_cast<uint8_t>(CompressType::kNone));
+    EXPECT_EQ(data.size(), expect.size() + 20);
+
+    //! 后面的帧引用了原样存放的数据
+    ASSERT_TRUE(compressor.compress(expect.data(), expect.size(), data));
+    EXPECT_LT(data.size(), expect.size() + 200);
+
+    BlockDecompressor decompressor;
+    EXPECT_EQ(DecompressAll(decompressor, data), expect + expect);
+}
+
+TEST(BlockCompressor, Reset) {
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    std::string line = MakeLogLine(1);
+
+    compressor.compress(line.data(), line.size(), data);
+    compressor.compress(line.data(), line.size(), data);
+    compressor.reset();
+    size_t second_pos = data.size();
+    compressor.compress(line.data(), line.size(), data);
+    compressor.compress(line.data(), line.size(), data);
+
+    //! 从 reset() 之后的帧开始也可以解压，如同一个新文件
+    BlockDecompressor decompressor;
+    std::vector<uint8_t> second(data.begin() + second_pos, data.end());
+    EXPECT_EQ(DecompressAll(decompressor, second), line + line);
+
+    //! 没有从流的开头解压的，跳过，直到带 reset 标记的帧
+    BlockDecompressor decompressor2;
+    std::string out;
+    auto first_size = decompressor2.decompress(data.data(), data.size(), out);
+    ASSERT_GT(first_size, 0);
+    decompressor2.reset();
+    std::vector<uint8_t> tail(data.begin() + first_size, data.end());
+    EXPECT_EQ(DecompressAll(decompressor2, tail), line + line);
+}
+
+TEST(BlockCompressor, Truncated) {
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    std::string line = MakeLogLine(1);
+    compressor.compress(line.data(), line.size(), data);
+
+    BlockDecompressor decompressor;
+    std::string out;
+    for (size_t size = 0; size < data.size(); ++size)
+        EXPECT_EQ(decompressor.decompress(data.data(), size, out), 0);
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(decompressor.decompress(data.data(), data.size(), out), static_cast<ssize_t>(data.size()));
+    EXPECT_EQ(out, line);
+}
+
+TEST(BlockCompressor, Corrupted) {
+    BlockCompressor compressor(CompressType::kLz4);
+    std::vector<uint8_t> data;
+    std::string line = MakeLogLine(1);
+    compressor.compress(line.data(), line.size(), data);
+    size_t first_size = data.size();
+    compressor.compress(line.data(), line.size(), data);
+    compressor.reset();
+    size_t third_pos = data.size();
+    compressor.compress(line.data(), line.size(), data);
+
+    data[first_size + 20] ^= 0xff;    //! 破坏第二帧的数据
+
+    BlockDecompressor decompressor;
+    std::string out;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        auto ret = decompressor.decompress(data.data() + pos, data.size() - pos, out);
+        if (ret < 0) {
+            EXPECT_EQ(pos, first_size);
+            pos += 1;
+            pos += BlockDecompressor::FindFrame(data.data() + pos, data.size() - pos);
+        } else {
+            ASSERT_GT(ret, 0);
+            pos += ret;
+        }
+    }
+    EXPECT_EQ(pos, data.size());
+    EXPECT_EQ(out, line + line);
+    EXPECT_LE(third_pos, data.size());
+}
+
+TEST(BlockCompressor, None) {
+    BlockCompressor compressor(CompressType::kNone);
+    std::vector<uint8_t> data;
+    std::string line = MakeLogLine(1);
+    compressor.compress(line.data(), line.size(), data);
+    compressor.compress(line.data(), line.size(), data);
+    EXPECT_TRUE(BlockDecompressor::IsFrame(data.data(), data.size()));
+    EXPECT_FALSE(BlockDecompressor::IsFrame(line.data(), line.size()));
+
+    BlockDecompressor decompressor;
+    EXPECT_EQ(DecompressAll(decompressor, data), line + line);
+}
+
+}
+}
+}
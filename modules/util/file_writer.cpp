@@ -0,0 +1,420 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "file_writer.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+namespace tbox {
+namespace util {
+
+namespace {
+constexpr size_t kDirectAlign = 4096;   //! O_DIRECT 要求的内存、偏移与长度的对齐值
+}
+
+FileWriter::FileWriter() { }
+
+FileWriter::~FileWriter()
+{
+    close();
+
+    {
+        std::lock_guard<std::mutex> lg(worker_lock_);
+        is_worker_running_ = false;
+    }
+    worker_cond_.notify_one();
+    if (worker_.joinable())
+        worker_.join(); //! 后台线程退出前会做完所有的收尾工作
+
+    if (inotify_fd_ >= 0)
+        ::close(inotify_fd_);
+    ::free(buffer_);
+}
+
+bool FileWriter::open(const std::string &filename, bool truncate)
+{
+    close();
+
+    curr_cfg_ = cfg_;
+
+    int flags = O_CREAT | O_RDWR | O_CLOEXEC;
+    if (truncate)
+        flags |= O_TRUNC;
+    if (curr_cfg_.sync_mode == SyncMode::kDsync)
+        flags |= O_DSYNC;
+
+    int fd = ::open(filename.c_str(), flags, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        return false;
+    }
+
+    block_size_ = curr_cfg_.block_size;
+    if (curr_cfg_.sync_mode == SyncMode::kDirect) {
+        block_size_ = std::max(block_size_, kDirectAlign);
+        block_size_ = (block_size_ + kDirectAlign - 1) / kDirectAlign * kDirectAlign;
+        //! tmpfs 等不支持 O_DIRECT 的文件系统会失败，退回常规写
+        direct_fd_ = ::open(filename.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+    }
+
+    fd_ = fd;
+    filename_ = filename;
+
+    size_t file_size = st.st_size;
+    block_offset_ = file_size;
+    if (block_size_ > 0) {
+        //! 文件原有的末尾不足一块的部分读入缓存，使之后的整块写入能对齐
+        block_offset_ = file_size / block_size_ * block_size_;
+        buffer_len_ = file_size - block_offset_;
+        reserveBuffer(block_size_ * 2);
+        if (buffer_len_ > 0 &&
+            ::pread(fd_, buffer_, buffer_len_, block_offset_) != static_cast<ssize_t>(buffer_len_)) {
+            int err = errno;
+            buffer_len_ = 0;
+            close();
+            errno = err;
+            return false;
+        }
+        tail_written_len_ = buffer_len_;
+    }
+    prealloc_end_ = file_size;
+
+    is_deleted_ = false;
+    createWatch();
+    checkAndPrealloc();
+    return true;
+}
+
+void FileWriter::close()
+{
+    if (fd_ < 0)
+        return;
+
+    flush();
+
+    int fd = fd_;
+    int direct_fd = direct_fd_;
+    size_t file_size = size();
+    bool is_preallocated = curr_cfg_.prealloc_size > 0;
+    bool need_sync = curr_cfg_.sync_mode == SyncMode::kRange || curr_cfg_.sync_mode == SyncMode::kDirect;
+
+    if (is_preallocated || need_sync) {
+        //! 预分配的任务也在后台线程中，须在它们之后再关闭fd
+        runInWorker(
+            [fd, direct_fd, file_size, is_preallocated, need_sync] {
+                //! 截掉 FALLOC_FL_KEEP_SIZE 预分配的、没有用到的空间
+                if (is_preallocated) {
+                    auto ret = ::ftruncate(fd, file_size);
+                    (void)ret;
+                }
+                if (need_sync)
+                    ::fdatasync(fd);
+                if (direct_fd >= 0)
+                    ::close(direct_fd);
+                ::close(fd);
+            }
+        );
+    } else {
+        if (direct_fd >= 0)
+            ::close(direct_fd);
+        ::close(fd);
+    }
+
+    if (watch_fd_ >= 0) {
+        ::inotify_rm_watch(inotify_fd_, watch_fd_);
+        watch_fd_ = -1;
+    }
+
+    fd_ = -1;
+    direct_fd_ = -1;
+    buffer_len_ = 0;
+    tail_written_len_ = 0;
+    block_offset_ = 0;
+    prealloc_end_ = 0;
+}
+
+bool FileWriter::write(const void *data, size_t size)
+{
+    if (fd_ < 0) {
+        errno = EBADF;
+        return false;
+    }
+
+    if (size == 0)
+        return true;
+
+    if (block_size_ == 0) {
+        if (!pwriteAll(fd_, static_cast<const char*>(data), size, block_offset_))
+            return false;
+
+        if (curr_cfg_.sync_mode == SyncMode::kRange)
+            ::sync_file_range(fd_, block_offset_, size, SYNC_FILE_RANGE_WRITE);
+
+        block_offset_ += size;
+        checkAndPrealloc();
+        return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (buffer_len_ == tail_written_len_)
+        tail_since_ = now;
+
+    reserveBuffer(buffer_len_ + size);
+    ::memcpy(buffer_ + buffer_len_, data, size);
+    buffer_len_ += size;
+
+    checkAndPrealloc();
+
+    if (!writeBlocks())
+        return false;
+
+    if (buffer_len_ > tail_written_len_ &&
+        (now - tail_since_) >= std::chrono::milliseconds(curr_cfg_.max_hold_ms))
+        return writeTail();
+
+    return true;
+}
+
+bool FileWriter::flush()
+{
+    if (fd_ < 0) {
+        errno = EBADF;
+        return false;
+    }
+
+    if (block_size_ == 0)
+        return true;
+
+    return writeBlocks() && writeTail();
+}
+
+bool FileWriter::isDeleted()
+{
+    if (fd_ < 0 || is_deleted_)
+        return is_deleted_;
+
+    //! 没能监视的，退回用 fstat() 检查链接数，只能发现删除，发现不了移走
+    if (watch_fd_ < 0) {
+        struct stat st;
+        is_deleted_ = ::fstat(fd_, &st) != 0 || st.st_nlink == 0;
+        return is_deleted_;
+    }
+
+    alignas(struct inotify_event) char events[1024];
+    for (;;) {
+        auto rsize = ::read(inotify_fd_, events, sizeof(events));
+        if (rsize <= 0)
+            break;
+
+        for (char *p = events; p < events + rsize; ) {
+            auto event = reinterpret_cast<const struct inotify_event*>(p);
+            if (event->wd == watch_fd_) {
+                if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                    is_deleted_ = true;
+                } else if (event->mask & IN_ATTRIB) {
+                    //! 删除时链接数的变化只产生 IN_ATTRIB，IN_DELETE_SELF 要等到最后一个fd关闭后才有
+                    struct stat st;
+                    if (::fstat(fd_, &st) != 0 || st.st_nlink == 0)
+                        is_deleted_ = true;
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return is_deleted_;
+}
+
+bool FileWriter::ParseSyncMode(const std::string &name, SyncMode &mode)
+{
+    if (name == "none")
+        mode = SyncMode::kNone;
+    else if (name == "dsync")
+        mode = SyncMode::kDsync;
+    else if (name == "range")
+        mode = SyncMode::kRange;
+    else if (name == "direct")
+        mode = SyncMode::kDirect;
+    else
+        return false;
+    return true;
+}
+
+const char* FileWriter::SyncModeName(SyncMode mode)
+{
+    switch (mode) {
+        case SyncMode::kNone:   return "none";
+        case SyncMode::kDsync:  return "dsync";
+        case SyncMode::kRange:  return "range";
+        case SyncMode::kDirect: return "direct";
+    }
+    return "unknown";
+}
+
+bool FileWriter::writeBlocks()
+{
+    size_t len = buffer_len_ / block_size_ * block_size_;
+    if (len == 0)
+        return true;
+
+    //! 之前由 writeTail() 常规写入的部分，会被这次的整块写入再覆盖一遍，内容是相同的
+    int fd = direct_fd_ >= 0 ? direct_fd_ : fd_;
+    if (!pwriteAll(fd, buffer_, len, block_offset_))
+        return false;
+
+    if (curr_cfg_.sync_mode == SyncMode::kRange)
+        ::sync_file_range(fd_, block_offset_, len, SYNC_FILE_RANGE_WRITE);
+
+    block_offset_ += len;
+    buffer_len_ -= len;
+    ::memmove(buffer_, buffer_ + len, buffer_len_);
+    tail_written_len_ = tail_written_len_ > len ? tail_written_len_ - len : 0;
+    return true;
+}
+
+bool FileWriter::writeTail()
+{
+    if (buffer_len_ <= tail_written_len_)
+        return true;
+
+    //! 不足一块的，只能常规写
+    if (!pwriteAll(fd_, buffer_ + tail_written_len_, buffer_len_ - tail_written_len_,
+                   block_offset_ + tail_written_len_))
+        return false;
+
+    tail_written_len_ = buffer_len_;
+    return true;
+}
+
+bool FileWriter::pwriteAll(int fd, const char *data, size_t size, size_t offset)
+{
+    while (size > 0) {
+        auto wsize = ::pwrite(fd, data, size, offset);
+        if (wsize < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += wsize;
+        size -= wsize;
+        offset += wsize;
+    }
+    return true;
+}
+
+void FileWriter::reserveBuffer(size_t size)
+{
+    if (size <= buffer_capacity_)
+        return;
+
+    size_t new_capacity = std::max(size, buffer_capacity_ * 2);
+    new_capacity = (new_capacity + kDirectAlign - 1) / kDirectAlign * kDirectAlign;
+
+    //! O_DIRECT 要求内存地址对齐
+    void *new_buffer = nullptr;
+    if (::posix_memalign(&new_buffer, kDirectAlign, new_capacity) != 0)
+        throw std::bad_alloc();
+
+    if (buffer_len_ > 0)
+        ::memcpy(new_buffer, buffer_, buffer_len_);
+    ::free(buffer_);
+
+    buffer_ = static_cast<char*>(new_buffer);
+    buffer_capacity_ = new_capacity;
+}
+
+void FileWriter::checkAndPrealloc()
+{
+    auto prealloc_size = curr_cfg_.prealloc_size;
+    if (prealloc_size == 0)
+        return;
+
+    //! 用掉一半时就预分配下一段
+    auto file_size = size();
+    if (file_size + prealloc_size / 2 < prealloc_end_)
+        return;
+
+    auto offset = std::max(prealloc_end_, file_size);
+    prealloc_end_ = offset + prealloc_size;
+
+    int fd = fd_;
+    runInWorker(
+        [fd, offset, prealloc_size] {
+            //! 不改变文件大小，读者看到的仍是实际写入的数据；不支持的文件系统失败也无妨
+            ::fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, prealloc_size);
+        }
+    );
+}
+
+bool FileWriter::createWatch()
+{
+    if (inotify_fd_ < 0) {
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ < 0)
+            return false;
+    }
+
+    watch_fd_ = ::inotify_add_watch(inotify_fd_, filename_.c_str(), IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    return watch_fd_ >= 0;
+}
+
+void FileWriter::runInWorker(std::function<void()> &&task)
+{
+    std::lock_guard<std::mutex> lg(worker_lock_);
+    if (!is_worker_running_) {
+        is_worker_running_ = true;
+        worker_ = std::thread(&FileWriter::workerProc, this);
+    }
+    worker_tasks_.push_back(std::move(task));
+    worker_cond_.notify_one();
+}
+
+void FileWriter::workerProc()
+{
+    std::unique_lock<std::mutex> lk(worker_lock_);
+    for (;;) {
+        worker_cond_.wait(lk, [this] { return !worker_tasks_.empty() || !is_worker_running_; });
+        if (worker_tasks_.empty())
+            break;
+
+        auto task = std::move(worker_tasks_.front());
+        worker_tasks_.pop_front();
+
+        lk.unlock();
+        task();
+        lk.lock();
+    }
+}
+
+}
+}
@@ -0,0 +1,168 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_FILE_WRITER_H_20261019
+#define TBOX_UTIL_FILE_WRITER_H_20261019
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+#include <tbox/base/defines.h>
+
+namespace tbox {
+namespace util {
+
+/**
+ * 持续追加写文件的写入器，供日志、trace记录等需要持续写文件、按大小切换文件的模块共用
+ *
+ * 与直接 open() + write() 相比：
+ * - 用 inotify 监视文件是否被删除或移走，代替每次写之前的 stat()；
+ * - 用 fallocate() 分段预分配磁盘空间，减少文件碎片与写时的块分配开销；
+ * - 数据攒满整块才写，写入的偏移与长度都按块对齐，可选用 O_DIRECT 或 sync_file_range()；
+ * - 关闭文件时的收尾工作（截掉多余的预分配空间、落盘、close）交由后台线程做，
+ *   切换文件不阻塞调用线程。
+ *
+ * 使用示例：
+ *  FileWriter writer;
+ *  FileWriter::Config cfg;
+ *  cfg.prealloc_size = 1 << 20;
+ *  cfg.block_size = 64 << 10;
+ *  writer.setConfig(cfg);
+ *  if (!writer.isOpened() || writer.isDeleted())
+ *    writer.open("/var/log/my.log");
+ *  writer.write(data, size);
+ *  writer.flush();
+ *
+ * \warnning    除构造与析构外，所有函数须在同一个线程中调用；
+ *              为避免在日志模块中递归打印日志，本类不打印日志，出错时返回false并保留errno
+ */
+class FileWriter {
+  public:
+    enum class SyncMode {
+        kNone,      //!< 只写入 page cache，由内核择机回写（默认）
+        kDsync,     //!< O_DSYNC，每次写入都等待数据落盘
+        kRange,     //!< 每写入一批整块，都用 sync_file_range() 发起异步回写，不等待
+        kDirect,    //!< O_DIRECT，整块的数据绕过 page cache 直接写盘，不支持的文件系统自动退回 kNone
+    };
+
+    struct Config {
+        size_t prealloc_size = 0;   //!< 每次预分配的空间，0表示不预分配
+        size_t block_size = 0;      //!< 写入块的大小，0表示不缓存，kDirect模式下会向上对齐到4KB
+        SyncMode sync_mode = SyncMode::kNone;
+        uint32_t max_hold_ms = 1000;    //!< 不足一块的数据最多在内存中缓存多久，write()时检查
+    };
+
+  public:
+    FileWriter();
+    ~FileWriter();
+
+    NONCOPYABLE(FileWriter);
+    IMMOVABLE(FileWriter);
+
+  public:
+    //! 设置配置，在下一次 open() 时生效
+    void setConfig(const Config &cfg) { cfg_ = cfg; }
+    const Config& getConfig() const { return cfg_; }
+
+    /**
+     * 打开文件，之后写入的数据追加到文件的末尾
+     *
+     * 如果已打开了其它文件，则先关闭它
+     *
+     * \param filename  文件名
+     * \param truncate  是否清空文件原有的内容
+     */
+    bool open(const std::string &filename, bool truncate = false);
+
+    //! 关闭文件，缓存的数据会先写入，收尾工作由后台线程完成
+    void close();
+
+    bool isOpened() const { return fd_ >= 0; }
+    const std::string& filename() const { return filename_; }
+
+    /**
+     * 写入数据
+     *
+     * 只写入整块的数据，不足一块的部分缓存起来，缓存超过 max_hold_ms 时也会写入
+     */
+    bool write(const void *data, size_t size);
+    bool write(const std::string &str) { return write(str.data(), str.size()); }
+
+    //! 将缓存中不足一块的数据写入文件
+    bool flush();
+
+    //! 当前文件是否被删除或移走了，通常在发现后重新 open()
+    bool isDeleted();
+
+    //! 当前文件的大小，包含缓存中未写入的部分
+    size_t size() const { return block_offset_ + buffer_len_; }
+
+    //! 解析与获取 SyncMode 的名称，名称分别为：none, dsync, range, direct
+    static bool ParseSyncMode(const std::string &name, SyncMode &mode);
+    static const char* SyncModeName(SyncMode mode);
+
+  protected:
+    bool writeBlocks();
+    bool writeTail();
+    bool pwriteAll(int fd, const char *data, size_t size, size_t offset);
+    void reserveBuffer(size_t size);
+    void checkAndPrealloc();
+    bool createWatch();
+
+    //! 后台线程
+    void runInWorker(std::function<void()> &&task);
+    void workerProc();
+
+  private:
+    Config cfg_;
+    Config curr_cfg_;       //!< 当前打开的文件所用的配置
+
+    std::string filename_;
+    int fd_ = -1;           //!< 常规写的文件描述符
+    int direct_fd_ = -1;    //!< O_DIRECT 的文件描述符，仅在 kDirect 模式下有效
+    size_t block_size_ = 0;
+
+    char *buffer_ = nullptr;        //!< 从 block_offset_ 开始，还没有整块写入的数据
+    size_t buffer_len_ = 0;
+    size_t buffer_capacity_ = 0;
+    size_t tail_written_len_ = 0;   //!< buffer_ 中已经由 writeTail() 写入文件的长度
+    size_t block_offset_ = 0;       //!< 已整块写入的数据量，即 buffer_ 的数据在文件中的偏移
+    std::chrono::steady_clock::time_point tail_since_;  //!< buffer_ 中最早一个未写入文件的数据的时间
+    size_t prealloc_end_ = 0;       //!< 已预分配到的位置
+
+    int inotify_fd_ = -1;
+    int watch_fd_ = -1;
+    bool is_deleted_ = false;
+
+    std::thread worker_;
+    std::mutex worker_lock_;
+    std::condition_variable worker_cond_;
+    std::deque<std::function<void()>> worker_tasks_;
+    bool is_worker_running_ = false;
+};
+
+}
+}
+
+#endif //TBOX_UTIL_FILE_WRITER_H_20261019
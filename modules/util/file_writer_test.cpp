@@ -0,0 +1,210 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "file_writer.h"
+#include "fs.h"
+
+namespace tbox {
+namespace util {
+namespace {
+
+const char *test_filename = "./file_writer_test.txt";
+
+std::string ReadFile(const std::string &filename)
+{
+    std::string content;
+    fs::ReadStringFromTextFile(filename, content);
+    return content;
+}
+
+size_t GetFileSize(const std::string &filename)
+{
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0)
+        return 0;
+    return st.st_size;
+}
+
+TEST(FileWriter, Write) {
+    ::unlink(test_filename);
+    FileWriter writer;
+    EXPECT_FALSE(writer.isOpened());
+    EXPECT_FALSE(writer.write("abc", 3));
+
+    ASSERT_TRUE(writer.open(test_filename));
+    EXPECT_TRUE(writer.isOpened());
+    EXPECT_TRUE(writer.write("hello ", 6));
+    EXPECT_TRUE(writer.write(std::string("world")));
+    EXPECT_EQ(writer.size(), 11u);
+    EXPECT_EQ(ReadFile(test_filename), "hello world");
+    writer.close();
+
+    //! 再打开时追加写
+    ASSERT_TRUE(writer.open(test_filename));
+    EXPECT_EQ(writer.size(), 11u);
+    writer.write("!", 1);
+    writer.close();
+    EXPECT_EQ(ReadFile(test_filename), "hello world!");
+
+    ASSERT_TRUE(writer.open(test_filename, true));
+    EXPECT_EQ(writer.size(), 0u);
+    writer.close();
+    EXPECT_EQ(ReadFile(test_filename), "");
+
+    ::unlink(test_filename);
+}
+
+TEST(FileWriter, Block) {
+    ::unlink(test_filename);
+    FileWriter writer;
+    FileWriter::Config cfg;
+    cfg.block_size = 16;
+    writer.setConfig(cfg);
+    ASSERT_TRUE(writer.open(test_filename));
+
+    //! 不足一块的先缓存
+    writer.write("0123456789", 10);
+    EXPECT_EQ(GetFileSize(test_filename), 0u);
+    EXPECT_EQ(writer.size(), 10u);
+
+    writer.write("abcdefghij", 10);
+    EXPECT_EQ(GetFileSize(test_filename), 16u);
+
+    writer.flush();
+    EXPECT_EQ(ReadFile(test_filename), "0123456789abcdefghij");
+
+    //! flush() 之后再补满一块，内容不变
+    writer.write("ABCDEFGHIJKL", 12);
+    EXPECT_EQ(GetFileSize(test_filename), 32u);
+    writer.close();
+    EXPECT_EQ(ReadFile(test_filename), "0123456789abcdefghijABCDEFGHIJKL");
+
+    //! 打开原有的文件，末尾不足一块的部分要对齐
+    ASSERT_TRUE(writer.open(test_filename));
+    writer.write("xyz", 3);
+    writer.close();
+    EXPECT_EQ(ReadFile(test_filename), "0123456789abcdefghijABCDEFGHIJKLxyz");
+
+    ::unlink(test_filename);
+}
+
+TEST(FileWriter, MaxHold) {
+    ::unlink(test_filename);
+    FileWriter writer;
+    FileWriter::Config cfg;
+    cfg.block_size = 1024;
+    cfg.max_hold_ms = 0;
+    writer.setConfig(cfg);
+    ASSERT_TRUE(writer.open(test_filename));
+
+    writer.write("abc", 3);
+    EXPECT_EQ(ReadFile(test_filename), "abc");
+
+    writer.close();
+    ::unlink(test_filename);
+}
+
+TEST(FileWriter, Prealloc) {
+    ::unlink(test_filename);
+    {
+        FileWriter writer;
+        FileWriter::Config cfg;
+        cfg.prealloc_size = 4 << 20;
+        writer.setConfig(cfg);
+        ASSERT_TRUE(writer.open(test_filename));
+
+        std::string data(100, 'x');
+        writer.write(data);
+        //! 预分配不改变文件的大小
+        EXPECT_EQ(GetFileSize(test_filename), 100u);
+    }
+
+    //! 关闭后，没用到的预分配空间被截掉
+    struct stat st;
+    ASSERT_EQ(::stat(test_filename, &st), 0);
+    EXPECT_EQ(st.st_size, 100);
+    EXPECT_LT(st.st_blocks * 512, 1 << 20);
+
+    ::unlink(test_filename);
+}
+
+TEST(FileWriter, Direct) {
+    ::unlink(test_filename);
+
+    std::string data;
+    for (int i = 0; i < 10000; ++i)
+        data.push_back('a' + i % 26);
+
+    {
+        FileWriter writer;
+        FileWriter::Config cfg;
+        cfg.sync_mode = FileWriter::SyncMode::kDirect;
+        cfg.prealloc_size = 1 << 20;
+        writer.setConfig(cfg);
+        ASSERT_TRUE(writer.open(test_filename));
+
+        writer.write(data.data(), 3000);
+        writer.flush();
+        EXPECT_EQ(ReadFile(test_filename), data.substr(0, 3000));
+        writer.write(data.data() + 3000, data.size() - 3000);
+    }
+    EXPECT_EQ(ReadFile(test_filename), data);
+
+    ::unlink(test_filename);
+}
+
+TEST(FileWriter, Deleted) {
+    ::unlink(test_filename);
+    FileWriter writer;
+    ASSERT_TRUE(writer.open(test_filename));
+    writer.write("abc", 3);
+    EXPECT_FALSE(writer.isDeleted());
+    EXPECT_FALSE(writer.isDeleted());
+
+    ::unlink(test_filename);
+    EXPECT_TRUE(writer.isDeleted());
+
+    ASSERT_TRUE(writer.open(test_filename));
+    EXPECT_FALSE(writer.isDeleted());
+
+    //! 移走也算
+    std::string new_filename = std::string(test_filename) + ".1";
+    ASSERT_EQ(::rename(test_filename, new_filename.c_str()), 0);
+    EXPECT_TRUE(writer.isDeleted());
+    writer.close();
+
+    ::unlink(new_filename.c_str());
+}
+
+TEST(FileWriter, SyncMode) {
+    FileWriter::SyncMode mode;
+    for (auto name : {"none", "dsync", "range", "direct"}) {
+        EXPECT_TRUE(FileWriter::ParseSyncMode(name, mode));
+        EXPECT_STREQ(FileWriter::SyncModeName(mode), name);
+    }
+    EXPECT_FALSE(FileWriter::ParseSyncMode("xxx", mode));
+}
+
+}
+}
+}
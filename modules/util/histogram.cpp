@@ -0,0 +1,137 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "histogram.h"
+
+#include <cmath>
+#include <tbox/base/json.hpp>
+
+namespace tbox {
+namespace util {
+
+constexpr size_t Histogram::kSubBucketNum;
+constexpr uint64_t Histogram::kMaxValue;
+constexpr size_t Histogram::kBucketNum;
+
+size_t Histogram::IndexOf(uint64_t value)
+{
+    if (value > kMaxValue)
+        value = kMaxValue;
+
+    if (value < kSubBucketNum)
+        return value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBucketNum + ((value >> shift) - kSubBucketNum);
+}
+
+uint64_t Histogram::UpperBoundOf(size_t index)
+{
+    if (index < kSubBucketNum)
+        return index;
+
+    int shift = index / kSubBucketNum - 1;
+    uint64_t sub = index % kSubBucketNum;
+    uint64_t lower = (kSubBucketNum + sub) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    ++buckets_[IndexOf(value)];
+
+    if (count_ == 0 || value < min_)
+        min_ = value;
+    if (value > max_)
+        max_ = value;
+
+    ++count_;
+    sum_ += value;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    if (other.count_ == 0)
+        return;
+
+    for (size_t i = 0; i < kBucketNum; ++i)
+        buckets_[i] += other.buckets_[i];
+
+    if (count_ == 0 || other.min_ < min_)
+        min_ = other.min_;
+    if (other.max_ > max_)
+        max_ = other.max_;
+
+    count_ += other.count_;
+    sum_ += other.sum_;
+}
+
+void Histogram::reset()
+{
+    buckets_.fill(0);
+    count_ = sum_ = min_ = max_ = 0;
+}
+
+double Histogram::mean() const
+{
+    return count_ > 0 ? (sum_ * 1.0 / count_) : 0;
+}
+
+uint64_t Histogram::percentile(double percent) const
+{
+    if (count_ == 0)
+        return 0;
+
+    if (percent <= 0)
+        return min_;
+
+    if (percent >= 100)
+        return max_;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percent * count_ / 100));
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t acc = 0;
+    for (size_t i = 0; i < kBucketNum; ++i) {
+        acc += buckets_[i];
+        if (acc >= rank) {
+            auto value = UpperBoundOf(i);
+            return value < max_ ? value : max_;
+        }
+    }
+
+    return max_;
+}
+
+void Histogram::toJson(Json &js) const
+{
+    js["count"] = count_;
+    js["min"] = min();
+    js["max"] = max_;
+    js["mean"] = mean();
+    js["p50"] = percentile(50);
+    js["p90"] = percentile(90);
+    js["p99"] = percentile(99);
+    js["p999"] = percentile(99.9);
+}
+
+}
+}
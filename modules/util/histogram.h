@@ -0,0 +1,96 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_UTIL_HISTOGRAM_H_20261019
+#define TBOX_UTIL_HISTOGRAM_H_20261019
+
+#include <cstdint>
+#include <array>
+#include <tbox/base/json_fwd.h>
+
+namespace tbox {
+namespace util {
+
+/**
+ * 对数-线性分桶直方图（HDR风格）
+ *
+ * 将 [2^n, 2^(n+1)) 区间再等分成 kSubBucketNum 个子桶，
+ * 相对误差不超过 1/kSubBucketNum，记录与合并的代价均为 O(1) 与 O(kBucketNum)。
+ * 适合用于统计时延等跨度很大的数值，并计算 p50/p99/p999 等分位值。
+ *
+ * 使用示例：
+ *  Histogram h;
+ *  h.record(120);
+ *  h.record(3500);
+ *  auto p99 = h.percentile(99);
+ *
+ * \warnning    多线程使用需在外部加锁，通常的做法是每个线程各持有一个，读取时再 merge()
+ */
+class Histogram {
+  public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBucketNum = 1 << kSubBucketBits;
+    static constexpr int kMaxValueBits = 40;    //!< 可记录的最大值为 2^40-1，超出的按最大值记录
+    static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+    static constexpr size_t kBucketNum = (kMaxValueBits - kSubBucketBits + 1) * kSubBucketNum;
+
+    //! 记录一个值
+    void record(uint64_t value);
+    //! 将另一个直方图的数据合并进来
+    void merge(const Histogram &other);
+    //! 清除所有数据
+    void reset();
+
+    inline uint64_t count() const { return count_; }
+    inline uint64_t sum() const { return sum_; }
+    inline uint64_t min() const { return count_ > 0 ? min_ : 0; }
+    inline uint64_t max() const { return max_; }
+    double mean() const;
+
+    /**
+     * 获取分位值
+     *
+     * \param percent   百分比，范围 [0, 100]，如：99.9
+     *
+     * \return  该分位所在桶的上限值，且不超过 max()
+     */
+    uint64_t percentile(double percent) const;
+
+    /**
+     * 导出为JSON，格式如下：
+     * {"count":100,"min":1,"max":90,"mean":12.3,"p50":10,"p90":30,"p99":80,"p999":90}
+     */
+    void toJson(Json &js) const;
+
+  public:
+    static size_t IndexOf(uint64_t value);          //!< 值所对应的桶号
+    static uint64_t UpperBoundOf(size_t index);     //!< 桶所能容纳的最大值
+
+  private:
+    std::array<uint64_t, kBucketNum> buckets_ = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+};
+
+}
+}
+
+#endif //TBOX_UTIL_HISTOGRAM_H_20261019
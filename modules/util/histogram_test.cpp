@@ -0,0 +1,100 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2018 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <gtest/gtest.h>
+#include <tbox/base/json.hpp>
+#include "histogram.h"
+
+namespace tbox {
+namespace util {
+
+TEST(Histogram, IndexAndUpperBound) {
+    for (uint64_t v = 0; v < 100000; ++v) {
+        auto index = Histogram::IndexOf(v);
+        ASSERT_LT(index, Histogram::kBucketNum);
+        EXPECT_LE(v, Histogram::UpperBoundOf(index));
+        if (index > 0) {
+            EXPECT_GT(v, Histogram::UpperBoundOf(index - 1));
+        }
+    }
+
+    EXPECT_EQ(Histogram::IndexOf(Histogram::kMaxValue), Histogram::kBucketNum - 1);
+    EXPECT_EQ(Histogram::IndexOf(UINT64_MAX), Histogram::kBucketNum - 1);
+    EXPECT_EQ(Histogram::UpperBoundOf(Histogram::kBucketNum - 1), Histogram::kMaxValue);
+}
+
+TEST(Histogram, Empty) {
+    Histogram h;
+    EXPECT_EQ(h.count(), 0u);
+    EXPECT_EQ(h.min(), 0u);
+    EXPECT_EQ(h.max(), 0u);
+    EXPECT_EQ(h.percentile(99), 0u);
+    EXPECT_DOUBLE_EQ(h.mean(), 0);
+}
+
+TEST(Histogram, Percentile) {
+    Histogram h;
+    for (uint64_t v = 1; v <= 1000; ++v)
+        h.record(v);
+
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.min(), 1u);
+    EXPECT_EQ(h.max(), 1000u);
+    EXPECT_DOUBLE_EQ(h.mean(), 500.5);
+
+    //! 相对误差不超过 1/16
+    EXPECT_NEAR(h.percentile(50), 500, 500 / 16);
+    EXPECT_NEAR(h.percentile(90), 900, 900 / 16);
+    EXPECT_NEAR(h.percentile(99), 990, 990 / 16);
+    EXPECT_EQ(h.percentile(100), 1000u);
+    EXPECT_EQ(h.percentile(0), 1u);
+}
+
+TEST(Histogram, Merge) {
+    Histogram h1, h2;
+    h1.record(10);
+    h1.record(20);
+    h2.record(5);
+    h2.record(3000);
+
+    h1.merge(h2);
+    EXPECT_EQ(h1.count(), 4u);
+    EXPECT_EQ(h1.min(), 5u);
+    EXPECT_EQ(h1.max(), 3000u);
+    EXPECT_EQ(h1.sum(), 3035u);
+
+    h1.reset();
+    EXPECT_EQ(h1.count(), 0u);
+    EXPECT_EQ(h1.max(), 0u);
+}
+
+TEST(Histogram, ToJson) {
+    Histogram h;
+    h.record(7);
+
+    Json js;
+    h.toJson(js);
+    EXPECT_EQ(js["count"], 1);
+    EXPECT_EQ(js["min"], 7);
+    EXPECT_EQ(js["max"], 7);
+    EXPECT_EQ(js["p99"], 7);
+}
+
+}
+}
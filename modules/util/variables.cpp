@@ -19,15 +19,29 @@
  */
 #include "variables.h"
 
+#include <atomic>
 #include <tbox/base/json.hpp>
 
 namespace tbox {
 namespace util {
 
+namespace {
+//! 查找缓存的世代，任意对象的结构变化都使其增加，使所有缓存失效
+std::atomic<uint64_t> _lookup_generation(1);
+//! 缓存的上限，防止变量名不断变化时无限增长
+constexpr size_t kMaxLookupCacheSize = 256;
+}
+
+//! 变量名 -> 值
+struct Variables::VariableMap : public std::unordered_map<std::string, Json> { };
+
 Variables::Variables() { }
 
 Variables::~Variables() {
-    CHECK_DELETE_RESET_OBJ(var_map_);
+    //! 子对象可能缓存了本对象中的变量
+    if (var_map_ != nullptr)
+        Invalidate();
+    var_map_.reset();
     parent_ = nullptr;
 }
 
@@ -38,92 +52,142 @@ IMPL_MOVE_RESET_FUNC(Variables)
 void Variables::swap(Variables &other) {
     std::swap(var_map_, other.var_map_);
     std::swap(parent_, other.parent_);
+    Invalidate();
 }
 
 void Variables::copy(const Variables &other) {
     parent_ = other.parent_;
-    if (other.var_map_ != nullptr) {
-        if (var_map_ == nullptr)
-            var_map_ = new VariableMap;
-        *var_map_ = *other.var_map_;
+    var_map_ = other.var_map_;  //! 共享，修改时再复制
+    Invalidate();
+}
+
+void Variables::setParent(Variables *parent) {
+    if (parent_ != parent) {
+        parent_ = parent;
+        Invalidate();
     }
 }
 
 bool Variables::define(const std::string &name, const Json &js_init_value) {
-    if (var_map_ == nullptr)
-        var_map_ = new VariableMap;
+    if (var_map_ != nullptr && var_map_->count(name) != 0)
+        return false;
 
-    auto result = var_map_->emplace(name, js_init_value);
-    return result.second;
+    mutableMap().emplace(name, js_init_value);
+    Invalidate();
+    return true;
 }
 
 bool Variables::undefine(const std::string &name) {
-    if (var_map_ == nullptr)
+    if (var_map_ == nullptr || var_map_->count(name) == 0)
         return false;
 
-    auto iter = var_map_->find(name);
-    if (iter == var_map_->end())
+    auto &var_map = mutableMap();
+    var_map.erase(name);
+
+    if (var_map.empty())
+        var_map_.reset();
+
+    Invalidate();
+    return true;
+}
+
+bool Variables::has(const std::string &name, bool local_only) const {
+    return find(name, local_only) != nullptr;
+}
+
+const Json* Variables::find(const std::string &name, bool local_only) const {
+    auto found = findLocal(name);
+    if (found.owner == nullptr && !local_only)
+        found = findInAncestors(name);
+    return found.value;
+}
+
+bool Variables::get(const std::string &name, Json &js_out_value, bool local_only) const {
+    auto value = find(name, local_only);
+    if (value == nullptr)
         return false;
 
-    var_map_->erase(iter);
+    js_out_value = *value;
+    return true;
+}
 
-    if (var_map_->empty())
-        CHECK_DELETE_RESET_OBJ(var_map_);
+bool Variables::set(const std::string &name, const Json &js_new_value, bool local_only) {
+    auto found = findLocal(name);
+    if (found.owner == nullptr && !local_only)
+        found = findInAncestors(name);
 
+    if (found.owner == nullptr)
+        return false;
+
+    //! 变量表与其它对象共享，要先复制再修改
+    if (found.owner->var_map_.use_count() > 1)
+        found.value = &found.owner->mutableMap().at(name);
+
+    *found.value = js_new_value;
     return true;
 }
 
-bool Variables::has(const std::string &name, bool local_only) const {
+void Variables::toJson(Json &js) const {
+    js = Json::object();
     if (var_map_ != nullptr) {
-        auto iter = var_map_->find(name);
-        if (iter != var_map_->end())
-            return true;
+        for (auto &item : *var_map_)
+            js[item.first] = item.second;
     }
-
-    //! 本节点找不到，就找父节点
-    if (!local_only && parent_ != nullptr)
-        return parent_->has(name);
-
-    return false;
 }
 
-bool Variables::get(const std::string &name, Json &js_out_value, bool local_only) const {
+Variables::Found Variables::findLocal(const std::string &name) const {
+    Found found;
     if (var_map_ != nullptr) {
         auto iter = var_map_->find(name);
         if (iter != var_map_->end()) {
-            js_out_value = iter->second;
-            return true;
+            found.owner = const_cast<Variables*>(this);
+            found.value = &iter->second;
         }
     }
+    return found;
+}
 
-    //! 本节点找不到，就找父节点
-    if (!local_only && parent_ != nullptr)
-        return parent_->get(name, js_out_value);
+Variables::Found Variables::findInAncestors(const std::string &name) const {
+    if (parent_ == nullptr)
+        return Found();
 
-    return false;
-}
+    auto generation = _lookup_generation.load(std::memory_order_relaxed);
+    if (lookup_cache_generation_ != generation || lookup_cache_.size() >= kMaxLookupCacheSize) {
+        lookup_cache_.clear();
+        lookup_cache_generation_ = generation;
 
-bool Variables::set(const std::string &name, const Json &js_new_value, bool local_only) {
-    if (var_map_ != nullptr) {
-        auto iter = var_map_->find(name);
-        if (iter != var_map_->end()) {
-            iter->second = js_new_value;
-            return true;
-        }
+    } else {
+        auto iter = lookup_cache_.find(name);
+        if (iter != lookup_cache_.end())
+            return iter->second;
     }
 
-    //! 本节点找不到，就找父节点
-    if (!local_only && parent_ != nullptr)
-        return parent_->set(name, js_new_value);
+    //! 逐级向上找，不存在的结果也缓存
+    Found found;
+    for (auto vars = parent_; vars != nullptr; vars = vars->parent_) {
+        found = vars->findLocal(name);
+        if (found.owner != nullptr)
+            break;
+    }
 
-    return false;
+    lookup_cache_.emplace(name, found);
+    return found;
 }
 
-void Variables::toJson(Json &js) const {
-    if (var_map_ != nullptr)
-        js = *var_map_;
-    else
-        js = Json::object();
+Variables::VariableMap& Variables::mutableMap() {
+    if (var_map_ == nullptr) {
+        var_map_ = std::make_shared<VariableMap>();
+
+    } else if (var_map_.use_count() > 1) {
+        var_map_ = std::make_shared<VariableMap>(*var_map_);
+        //! 变量的地址变了，缓存中的指针失效
+        Invalidate();
+    }
+    return *var_map_;
+}
+
+void Variables::Invalidate() {
+    _lookup_generation.fetch_add(1, std::memory_order_relaxed);
 }
 
 }
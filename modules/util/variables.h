@@ -20,7 +20,9 @@
 #ifndef TBOX_VARIABLES_H_20250201
 #define TBOX_VARIABLES_H_20250201
 
-#include <map>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 #include <tbox/base/defines.h>
 #include <tbox/base/json_fwd.h>
@@ -30,7 +32,17 @@
 namespace tbox {
 namespace util {
 
-//! 变量对象
+/**
+ * 变量对象
+ *
+ * 变量以哈希表存储；本地找不到时，沿 parent 链向上找。
+ * 向上找到的结果会缓存在发起查找的对象中，下次直接命中，免去逐级查找。
+ * 任意对象 define()、undefine()、setParent() 等改变查找结果的操作都会使所有缓存失效。
+ *
+ * 复制时不复制变量表，而是共享，直到其中一方修改时才真正复制（copy-on-write）。
+ *
+ * \warning 不可多线程同时使用，get() 等 const 函数也会更新缓存
+ */
 class Variables {
   public:
     Variables();
@@ -40,7 +52,7 @@ class Variables {
     DECLARE_MOVE_RESET_FUNC(Variables);
 
   public:
-    void setParent(Variables *parent) { parent_ = parent; }
+    void setParent(Variables *parent);
 
     /**
      * 定义变量，并指定初始值
@@ -81,6 +93,14 @@ class Variables {
      */
     bool get(const std::string &name, Json &js_out_value, bool local_only = false) const;
 
+    /**
+     * 查找变量，免去复制
+     *
+     * \return 变量值的指针，不存在则返回 nullptr。
+     *         在下一次对该变量或其所在对象进行 set()、define()、undefine() 之前有效
+     */
+    const Json* find(const std::string &name, bool local_only = false) const;
+
     //! 获取变量的模板
     template <typename T>
     bool get(const std::string &name, T &out_value, bool local_only = false) const {
@@ -103,7 +123,7 @@ class Variables {
     bool set(const std::string &name, const Json &js_new_value, bool local_only = false);
 
     //! 检查是否没有变量
-    inline bool empty() const { return var_map_ == nullptr; }
+    inline bool empty() const { return !var_map_; }
 
   public:
     void toJson(Json &js) const;        //! 导出为Json对象
@@ -111,11 +131,32 @@ class Variables {
     void swap(Variables &other);        //! 交换
     void copy(const Variables &other);  //! 复制
 
-  private:
-    using VariableMap = std::map<std::string, Json>;
+  protected:
+    struct VariableMap;
+    using VariableMapSptr = std::shared_ptr<VariableMap>;
+
+    //! 在 parent 链上找到的变量
+    struct Found {
+        Variables *owner = nullptr; //!< 变量所在的对象，为nullptr表示不存在
+        Json *value = nullptr;
+    };
+
+    Found findLocal(const std::string &name) const;
+    Found findInAncestors(const std::string &name) const;
+
+    //! 获取可修改的变量表，如果与其它对象共享，则先复制一份
+    VariableMap& mutableMap();
 
+    //! 使所有对象的查找缓存失效
+    static void Invalidate();
+
+  private:
     Variables *parent_ = nullptr;
-    VariableMap *var_map_ = nullptr;
+    VariableMapSptr var_map_;
+
+    //! 向上查找的缓存，变量名 -> 结果
+    mutable std::unordered_map<std::string, Found> lookup_cache_;
+    mutable uint64_t lookup_cache_generation_ = 0;
 };
 
 }
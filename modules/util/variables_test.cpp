@@ -162,5 +162,110 @@ TEST(Variables, Parent) {
     }
 }
 
+//! 缓存的查找结果随 define()、undefine()、setParent() 更新
+TEST(Variables, LookupCache) {
+    Variables vars_pparent, vars_parent, vars_child;
+    vars_parent.setParent(&vars_pparent);
+    vars_child.setParent(&vars_parent);
+
+    vars_pparent.define("a", 1);
+
+    int a = 0;
+    EXPECT_TRUE(vars_child.get("a", a));
+    EXPECT_EQ(a, 1);
+    EXPECT_FALSE(vars_child.has("b"));
+
+    //! 中间层定义同名变量，遮蔽上层的
+    vars_parent.define("a", 2);
+    EXPECT_TRUE(vars_child.get("a", a));
+    EXPECT_EQ(a, 2);
+
+    //! 之前不存在的变量被定义
+    vars_pparent.define("b", 3);
+    EXPECT_TRUE(vars_child.has("b"));
+
+    //! 通过缓存修改，修改的是中间层的
+    EXPECT_TRUE(vars_child.set("a", 22));
+    EXPECT_TRUE(vars_parent.get("a", a, true));
+    EXPECT_EQ(a, 22);
+
+    vars_parent.undefine("a");
+    EXPECT_TRUE(vars_child.get("a", a));
+    EXPECT_EQ(a, 1);
+
+    //! 断开父对象
+    vars_parent.setParent(nullptr);
+    EXPECT_FALSE(vars_child.has("a"));
+    EXPECT_FALSE(vars_child.has("b"));
+
+    //! 父对象析构后，重新挂到其它对象上
+    {
+        Variables vars_tmp;
+        vars_tmp.define("a", 4);
+        vars_child.setParent(&vars_tmp);
+        EXPECT_TRUE(vars_child.get("a", a));
+        EXPECT_EQ(a, 4);
+        vars_child.setParent(&vars_parent);
+    }
+    EXPECT_FALSE(vars_child.has("a"));
+}
+
+TEST(Variables, Find) {
+    Variables vars_parent, vars_child;
+    vars_child.setParent(&vars_parent);
+
+    vars_parent.define("s", "hello");
+    auto value = vars_child.find("s");
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, "hello");
+
+    EXPECT_EQ(vars_child.find("s", true), nullptr);
+    EXPECT_EQ(vars_child.find("t"), nullptr);
+}
+
+//! 复制时共享变量表，修改时才复制
+TEST(Variables, CopyOnWrite) {
+    Variables vars_parent;
+    vars_parent.define("p", 0);
+
+    Variables vars1;
+    vars1.setParent(&vars_parent);
+    vars1.define("a", 1);
+    vars1.define("b", 2);
+
+    Variables vars2(vars1);
+    EXPECT_EQ(vars1.find("a"), vars2.find("a"));    //! 共享同一份
+    EXPECT_TRUE(vars2.has("p"));                    //! 父对象也被复制
+
+    EXPECT_TRUE(vars2.set("a", 11));
+    EXPECT_NE(vars1.find("a"), vars2.find("a"));
+
+    int a = 0;
+    EXPECT_TRUE(vars1.get("a", a));
+    EXPECT_EQ(a, 1);
+    EXPECT_TRUE(vars2.get("a", a));
+    EXPECT_EQ(a, 11);
+
+    Variables vars3 = vars1;
+    EXPECT_TRUE(vars3.undefine("b"));
+    EXPECT_FALSE(vars3.has("b"));
+    EXPECT_TRUE(vars1.has("b"));
+
+    //! 子对象通过缓存修改共享的父对象
+    Variables vars_child;
+    vars_child.setParent(&vars1);
+    EXPECT_TRUE(vars_child.has("a"));
+    Variables vars4(vars1);
+    EXPECT_TRUE(vars_child.set("a", 111));
+    EXPECT_TRUE(vars4.get("a", a));
+    EXPECT_EQ(a, 1);
+    EXPECT_TRUE(vars1.get("a", a));
+    EXPECT_EQ(a, 111);
+
+    Json js;
+    vars1.toJson(js);
+    EXPECT_EQ(js, Json({{"a", 111}, {"b", 2}}));
+}
+
 }
 }
@@ -0,0 +1,236 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include <tbox/util/block_compressor.h>
+
+using namespace std;
+using namespace tbox;
+
+namespace {
+
+struct Options {
+    std::string filename;
+    size_t line_num = 10;
+    bool is_follow = false;
+};
+
+void PrintUsage(const char *proc_name)
+{
+    std::cout
+      << "This is cpp-tbox log file viewer." << std::endl
+      << "It prints the tail of the log file, both the plain (.log) and the compressed (.log.tbz) are supported." << std::endl
+      << std::endl
+      << "Usage: " << proc_name << " [options] <log_file>" << std::endl
+      << "Options:" << std::endl
+      << "  -n <num>  print the last num lines, default is 10" << std::endl
+      << "  -f        output appended data as the file grows, and follow the link if it points to a new file" << std::endl
+      << "Exp  : " << proc_name << " -n 100 -f /var/log/my_proc.latest.log.tbz" << std::endl;
+}
+
+bool ParseArgs(int argc, char **argv, Options &opts)
+{
+    int opt;
+    while ((opt = ::getopt(argc, argv, "n:fh")) != -1) {
+        switch (opt) {
+            case 'n':
+                opts.line_num = std::atoi(optarg);
+                break;
+            case 'f':
+                opts.is_follow = true;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if (optind >= argc)
+        return false;
+
+    opts.filename = argv[optind];
+    return true;
+}
+
+/**
+ * 日志文件读取器
+ *
+ * 每次 read() 读出文件新追加的内容，压缩的文件逐帧解压，没写完的帧留到下次
+ */
+class LogFileReader {
+  public:
+    ~LogFileReader() { close(); }
+
+    bool open(const std::string &filename)
+    {
+        close();
+
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            return false;
+
+        struct stat st;
+        ::fstat(fd_, &st);
+        dev_ = st.st_dev;
+        ino_ = st.st_ino;
+        filename_ = filename;
+        return true;
+    }
+
+    void close()
+    {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        pending_.clear();
+        consumed_size_ = 0;
+        format_ = Format::kUnknown;
+        decompressor_.reset();
+    }
+
+    //! 读出新追加的内容，追加到 text
+    void read(std::string &text)
+    {
+        char buff[64 << 10];
+        for (;;) {
+            auto rsize = ::read(fd_, buff, sizeof(buff));
+            if (rsize <= 0)
+                break;
+            pending_.append(buff, rsize);
+        }
+
+        if (format_ == Format::kUnknown) {
+            //! 由文件开头是否为帧头来区分压缩的与普通的日志文件
+            if (pending_.size() < 3)
+                return;
+            format_ = util::BlockDecompressor::IsFrame(pending_.data(), pending_.size()) ?
+                      Format::kCompressed : Format::kPlain;
+        }
+
+        if (format_ == Format::kPlain) {
+            text += pending_;
+            pending_.clear();
+            return;
+        }
+
+        size_t pos = 0;
+        while (pos < pending_.size()) {
+            auto ret = decompressor_.decompress(pending_.data() + pos, pending_.size() - pos, text);
+            if (ret > 0) {
+                pos += ret;
+            } else if (ret == 0) {
+                break;  //! 没写完的帧，等下次
+            } else {
+                std::cerr << "Warn: corrupted frame at offset " << (consumed_size_ + pos) << ", skip" << std::endl;
+                ++pos;
+                pos += util::BlockDecompressor::FindFrame(pending_.data() + pos, pending_.size() - pos);
+            }
+        }
+        pending_.erase(0, pos);
+        consumed_size_ += pos;
+    }
+
+    //! 文件名是否指向了别的文件，如日志切换文件后 latest 链接指向了新的文件
+    bool isReplaced() const
+    {
+        struct stat st;
+        if (::stat(filename_.c_str(), &st) != 0)
+            return false;
+        return st.st_dev != dev_ || st.st_ino != ino_;
+    }
+
+  private:
+    enum class Format { kUnknown, kPlain, kCompressed };
+
+    std::string filename_;
+    int fd_ = -1;
+    dev_t dev_ = 0;
+    ino_t ino_ = 0;
+
+    Format format_ = Format::kUnknown;
+    std::string pending_;       //!< 读出还没有处理的数据
+    size_t consumed_size_ = 0;
+    util::BlockDecompressor decompressor_;
+};
+
+//! 输出 text 的最后 line_num 行
+void PrintTail(const std::string &text, size_t line_num)
+{
+    size_t end = text.size();
+    if (end > 0 && text.back() == '\n')
+        --end;  //! 最后的换行符不算
+
+    size_t start = line_num > 0 ? 0 : text.size();
+    size_t count = 0;
+    for (size_t i = end; i > 0 && line_num > 0; --i) {
+        if (text[i - 1] == '\n' && ++count == line_num) {
+            start = i;
+            break;
+        }
+    }
+
+    std::cout.write(text.data() + start, text.size() - start);
+    std::cout << std::flush;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    LogFileReader reader;
+    if (!reader.open(opts.filename)) {
+        std::cerr << "Err: open '" << opts.filename << "' fail, " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::string text;
+    reader.read(text);
+    PrintTail(text, opts.line_num);
+
+    while (opts.is_follow) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        text.clear();
+        reader.read(text);
+
+        //! 先读完原来的文件，再从头读新的文件
+        if (reader.isReplaced() && reader.open(opts.filename))
+            reader.read(text);
+
+        std::cout << text << std::flush;
+    }
+
+    return 0;
+}
@@ -17,41 +17,55 @@
  * project authors may be found in the CONTRIBUTORS.md file in the root
  * of the source tree.
  */
+#include <unistd.h>
+
 #include <iostream>
+#include <fstream>
+#include <iomanip>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <map>
 
 #include <tbox/util/fs.h>
 #include <tbox/util/string.h>
-#include <tbox/util/buffer.h>
-#include <tbox/util/scalable_integer.h>
 
+#include "record_file.h"
+#include "stat.h"
 #include "writer.h"
 
 using namespace std;
 using namespace tbox;
+using namespace tbox::trace;
 
-//! 统计数据
-struct Stat {
-    uint64_t  name_index = 0;
-    uint64_t  module_index = 0;
+using StringVec = std::vector<std::string>;
 
-    size_t    times = 0;            //! 次数
-    uint64_t  dur_acc_us = 0;       //! 累积时长
-    uint64_t  dur_min_us = std::numeric_limits<uint64_t>::max(); //! 最小时长
-    uint64_t  dur_max_us = 0;       //! 最大时长
-    uint64_t  dur_max_ts_us = 0;    //! 最大时长的时间点
+namespace {
 
-    uint64_t  dur_avg_us = 0;       //! 平均时长
-    uint64_t  dur_warn_line_us = 0; //! 警告水位线
+constexpr size_t kFlushSize = 1 << 20;  //! 格式化缓存超过该大小就写入文件
 
-    uint64_t  dur_warn_count = 0;   //! 超过警告水位线次数
+struct Options {
+    std::string dir_path;
+    uint64_t begin_ts_us = 0;   //! 时间窗口起点，只统计开始时间在窗口内的记录
+    uint64_t end_ts_us = std::numeric_limits<uint64_t>::max();
+    size_t   jobs = 0;          //! 并行解码的线程数，0表示与CPU核数相同
+    uint64_t split_us = 0;      //! 按时间拆分 view.json 的跨度，0表示不拆分
 };
 
-using StringVec = std::vector<std::string>;
-using StatVec = std::vector<Stat>;
+//! 记录的名称、模块、线程表
+struct Tables {
+    StringVec names;
+    StringVec modules;
+    StringVec threads;
 
-//! start_time_us, duration_us, name_index, module_index, thread_index
-using RecordHandleFunc = std::function<void(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t)>;
+    bool isValid(const Record &record) const {
+        return record.name_index < names.size() &&
+               record.module_index < modules.size() &&
+               record.thread_index < threads.size();
+    }
+};
 
 void PrintUsage(const char *proc_name)
 {
@@ -59,98 +73,264 @@ void PrintUsage(const char *proc_name)
       << "This is cpp-tbox trace analyze tool." << std::endl
       << "It reads record files from the specified directory, and generates view.json and stat.txt in this directory." << std::endl
       << std::endl
-      << "Usage: " << proc_name << " <dir_path>" << std::endl
-      << "Exp  : " << proc_name << " /some/where/my_proc.20240531_032237.114" << std::endl;
+      << "Usage: " << proc_name << " [options] <dir_path>" << std::endl
+      << "Options:" << std::endl
+      << "  -b <ts_us>  only analyze records start at or after ts_us" << std::endl
+      << "  -e <ts_us>  only analyze records start before ts_us" << std::endl
+      << "  -j <num>    number of decoding threads, default is number of CPU cores" << std::endl
+      << "  -s <sec>    split view.json into view.<N>.json, each covers sec seconds" << std::endl
+      << "Exp  : " << proc_name << " /some/where/my_proc.20240531_032237.114" << std::endl
+      << "       " << proc_name << " -s 10 -b 1717126957000000 /some/where/my_proc.20240531_032237.114" << std::endl;
 }
 
-//! 从Buffer中提取5个uint64_t的数值
-bool PickRecord(util::Buffer &buffer, uint64_t &end_diff_us, uint64_t &duration_us,
-                uint64_t &thread_index, uint64_t &name_index, uint64_t &module_index)
+bool ParseArgs(int argc, char **argv, Options &opts)
 {
-    uint8_t *buffer_begin = buffer.readableBegin();
-    size_t   buffer_size  = buffer.readableSize();
-
-    size_t  parse_size = 0;
-    size_t  data_size = 0;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "b:e:j:s:h")) != -1) {
+        try {
+            switch (opt) {
+                case 'b': opts.begin_ts_us = std::stoull(optarg); break;
+                case 'e': opts.end_ts_us = std::stoull(optarg); break;
+                case 'j': opts.jobs = std::stoul(optarg); break;
+                case 's': opts.split_us = std::stoull(optarg) * 1000000; break;
+                default: return false;
+            }
+        } catch (const std::exception &) {
+            std::cerr << "Err: invalid value '" << optarg << "' of -" << static_cast<char>(opt) << std::endl;
+            return false;
+        }
+    }
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), end_diff_us);
-    if (parse_size == 0)
+    if (optind >= argc)
         return false;
-    data_size += parse_size;
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), duration_us);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+    opts.dir_path = argv[optind];
+    if (opts.jobs == 0)
+        opts.jobs = std::max(1u, std::thread::hardware_concurrency());
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), thread_index);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+    return true;
+}
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), name_index);
-    if (parse_size == 0)
-        return false;
-    data_size += parse_size;
+//! 用 jobs 个线程处理 num 个任务，func(task_index, worker_index)
+void ParallelFor(size_t num, size_t jobs, const std::function<void(size_t, size_t)> &func)
+{
+    std::atomic<size_t> next_index(0);
+    auto worker = [&] (size_t worker_index) {
+        for (auto i = next_index++; i < num; i = next_index++)
+            func(i, worker_index);
+    };
+
+    std::vector<std::thread> threads;
+    jobs = std::min(jobs, num);
+    for (size_t i = 1; i < jobs; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+
+    for (auto &t : threads)
+        t.join();
+}
 
-    parse_size = util::ParseScalableInteger((buffer_begin + data_size), (buffer_size - data_size), module_index);
-    if (parse_size == 0)
+//! 列出目录下所有的记录文件，按名称即创建时间排序
+bool ListRecordFiles(const std::string &records_dir, StringVec &record_file_vec)
+{
+    StringVec filename_vec;
+    if (!util::fs::ListDirectory(records_dir, filename_vec)) {
+        std::cerr << "Err: List '" << records_dir << "' fail!" << std::endl;
         return false;
-    data_size += parse_size;
+    }
 
-    buffer.hasRead(data_size);
+    std::sort(filename_vec.begin(), filename_vec.end());
+    for (auto &filename : filename_vec)
+        record_file_vec.push_back(records_dir + '/' + filename);
     return true;
 }
 
-//! 读取指定的记录文件
-void ReadRecordFile(const std::string &filename, const RecordHandleFunc &func)
+//! 并行读取各记录文件，统计数据。每个文件独立编码，可单独解码
+void AnalyzeRecordFiles(const StringVec &record_file_vec, const Tables &tables,
+                        const Options &opts, Analysis &analysis, size_t &invalid_num)
 {
-    std::ifstream ifs(filename, std::ifstream::binary);
-    if (!ifs) {
-        std::cerr << "Err: Read '" << filename << "' fail!" << std::endl;
-        return;
+    std::vector<Analysis> worker_analyses(opts.jobs);
+    std::vector<size_t> worker_invalid_nums(opts.jobs, 0);
+
+    ParallelFor(record_file_vec.size(), opts.jobs,
+        [&] (size_t file_index, size_t worker_index) {
+            auto &filename = record_file_vec[file_index];
+            RecordFile record_file;
+            if (!record_file.open(filename)) {
+                std::cerr << "Err: Read '" << filename << "' fail!" << std::endl;
+                return;
+            }
+
+            //! 线程忙碌区间的合并要求记录有序，所以每个文件单独统计后再合并
+            Analysis file_analysis;
+            auto &invalid = worker_invalid_nums[worker_index];
+            record_file.decode(
+                [&] (const Record &record) {
+                    if (record.start_ts_us < opts.begin_ts_us || record.start_ts_us >= opts.end_ts_us)
+                        return;
+                    if (!tables.isValid(record)) {
+                        ++invalid;
+                        return;
+                    }
+                    file_analysis.add(record);
+                }
+            );
+            worker_analyses[worker_index].merge(file_analysis);
+        }
+    );
+
+    invalid_num = 0;
+    for (size_t i = 0; i < opts.jobs; ++i) {
+        analysis.merge(worker_analyses[i]);
+        invalid_num += worker_invalid_nums[i];
     }
 
-    uint64_t last_end_ts_us = 0;
-    util::Buffer buffer;
+    //! 处理统计数据
+    for (auto &stat : analysis.name_stats) {
+        if (stat.times > 0) {
+            stat.dur_avg_us = stat.dur_acc_us / stat.times;
+            stat.dur_warn_line_us = (stat.dur_avg_us + stat.dur_max_us) / 2;
+        }
+    }
+}
 
-    while (true) {
-        char tmp[1024];
-        auto rsize = ifs.readsome(tmp, sizeof(tmp));
-        if (rsize == 0)
-            break;
+/**
+ * 按时间拆分的 view.json 集合
+ *
+ * 多个线程分别格式化记录，按所属的时间分片缓存，再成批写入对应的文件
+ */
+class ViewWriterSet {
+  public:
+    ViewWriterSet(const Options &opts, uint64_t begin_ts_us) :
+        opts_(opts), begin_ts_us_(begin_ts_us)
+    { }
+
+    ~ViewWriterSet() {
+        for (auto &item : writers_) {
+            item.second->writeFooter();
+            delete item.second;
+        }
+    }
 
-        buffer.append(tmp, rsize);
+    size_t chunkIndex(uint64_t ts_us) const {
+        if (opts_.split_us == 0 || ts_us <= begin_ts_us_)
+            return 0;
+        return (ts_us - begin_ts_us_) / opts_.split_us;
+    }
 
-        while (buffer.readableSize() >= 4) {
-            uint64_t end_diff_us, duration_us, thread_index, name_index, module_index;
-            if (!PickRecord(buffer, end_diff_us, duration_us, thread_index, name_index, module_index))
-                break;
+    std::string chunkFilename(size_t chunk_index) const {
+        if (opts_.split_us == 0)
+            return opts_.dir_path + "/view.json";
+        return opts_.dir_path + "/view." + std::to_string(chunk_index) + ".json";
+    }
 
-            uint64_t end_ts_us = last_end_ts_us + end_diff_us;
-            uint64_t start_ts_us = end_ts_us - duration_us;
-            last_end_ts_us = end_ts_us;
+    //! 写入各分片已格式化的记录，并清空
+    void write(std::map<size_t, std::string> &chunks) {
+        std::lock_guard<std::mutex> lg(lock_);
+        for (auto &item : chunks) {
+            if (item.second.empty())
+                continue;
+
+            auto writer = getWriter(item.first);
+            if (writer != nullptr)
+                writer->writeFormatted(item.second);
+            item.second.clear();
+        }
+    }
 
-            func(start_ts_us, duration_us, name_index, module_index, thread_index);
+  protected:
+    Writer* getWriter(size_t chunk_index) {
+        auto iter = writers_.find(chunk_index);
+        if (iter != writers_.end())
+            return iter->second;
+
+        auto filename = chunkFilename(chunk_index);
+        std::cout << "Info: Generating " << filename << std::endl;
+
+        auto writer = new Writer;
+        if (!writer->open(filename)) {
+            std::cerr << "Err: Create '" << filename << "' fail!" << std::endl;
+            delete writer;
+            writer = nullptr;
+        } else {
+            writer->writeHeader();
         }
+        writers_[chunk_index] = writer;
+        return writer;
     }
-}
 
-//! 读取目录下所有的记录文件
-void ReadAllRecordFiles(const std::string &records_dir, const RecordHandleFunc &func)
+  private:
+    const Options &opts_;
+    uint64_t begin_ts_us_;
+    std::mutex lock_;
+    std::map<size_t, Writer*> writers_;
+};
+
+//! 并行读取各记录文件，生成 view.json，标出超出警告线的记录与最大时长的记录
+void GenerateViews(const StringVec &record_file_vec, const Tables &tables,
+                   const Options &opts, Analysis &analysis)
 {
-    StringVec record_file_vec;
-    if (!util::fs::ListDirectory(records_dir, record_file_vec)) {
-      std::cerr << "Err: List '" << records_dir << "' fail!" << std::endl;
-      return;
+    ViewWriterSet writer_set(opts, std::max(opts.begin_ts_us, analysis.begin_ts_us));
+    std::vector<std::vector<uint64_t>> worker_warn_counts(opts.jobs);
+
+    ParallelFor(record_file_vec.size(), opts.jobs,
+        [&] (size_t file_index, size_t worker_index) {
+            RecordFile record_file;
+            if (!record_file.open(record_file_vec[file_index]))
+                return;
+
+            auto &warn_counts = worker_warn_counts[worker_index];
+            warn_counts.resize(analysis.name_stats.size(), 0);
+
+            std::map<size_t, std::string> chunks;
+            record_file.decode(
+                [&] (const Record &record) {
+                    if (record.start_ts_us < opts.begin_ts_us || record.start_ts_us >= opts.end_ts_us ||
+                        !tables.isValid(record))
+                        return;
+
+                    auto &name = tables.names[record.name_index];
+                    auto &module = tables.modules[record.module_index];
+                    auto &chunk = chunks[writer_set.chunkIndex(record.start_ts_us)];
+
+                    Writer::FormatRecorder(chunk, name, module, tables.threads[record.thread_index],
+                                           record.start_ts_us, record.duration_us);
+
+                    auto &stat = analysis.name_stats[record.name_index];
+                    if (record.duration_us >= stat.dur_warn_line_us) {
+                        ++warn_counts[record.name_index];
+                        Writer::FormatRecorder(chunk, name, module, "WARN", record.start_ts_us, record.duration_us);
+                    }
+
+                    if (chunk.size() >= kFlushSize)
+                        writer_set.write(chunks);
+                }
+            );
+            writer_set.write(chunks);
+        }
+    );
+
+    for (auto &warn_counts : worker_warn_counts) {
+        for (size_t i = 0; i < warn_counts.size(); ++i)
+            analysis.name_stats[i].dur_warn_count += warn_counts[i];
     }
 
-    for (auto record_file : record_file_vec)
-        ReadRecordFile(records_dir + '/' + record_file, func);
+    //! 标记出最大时间点
+    std::map<size_t, std::string> chunks;
+    for (size_t i = 0; i < analysis.name_stats.size(); ++i) {
+        auto &stat = analysis.name_stats[i];
+        if (stat.times == 0)
+            continue;
+
+        auto &chunk = chunks[writer_set.chunkIndex(stat.dur_max_ts_us)];
+        Writer::FormatRecorder(chunk, tables.names[i], tables.modules[stat.module_index], "MAX",
+                               stat.dur_max_ts_us, stat.dur_max_us);
+    }
+    writer_set.write(chunks);
 }
 
 //! 导出统计数据到文件
-void DumpStatToFile(const StringVec &name_vec, const StatVec &stat_vec, const std::string &stat_filename)
+void DumpStatToFile(const Tables &tables, const Analysis &analysis, size_t invalid_num, const std::string &stat_filename)
 {
     std::ofstream ofs(stat_filename);
     if (!ofs) {
@@ -158,10 +338,21 @@ void DumpStatToFile(const StringVec &name_vec, const StatVec &stat_vec, const st
         return;
     }
 
-    auto size = name_vec.size();
+    uint64_t span_us = analysis.end_ts_us > analysis.begin_ts_us ? analysis.end_ts_us - analysis.begin_ts_us : 0;
+
+    ofs << "record_num       : " << analysis.record_num << std::endl
+        << "invalid_num      : " << invalid_num << std::endl
+        << "begin_ts_us      : " << (analysis.record_num > 0 ? analysis.begin_ts_us : 0) << " us" << std::endl
+        << "end_ts_us        : " << analysis.end_ts_us << " us" << std::endl
+        << "span_us          : " << span_us << " us" << std::endl
+        << std::endl;
+
+    auto size = std::min(tables.names.size(), analysis.name_stats.size());
     for (size_t i = 0; i < size; ++i) {
-        auto &name = name_vec.at(i);
-        auto &stat = stat_vec.at(i);
+        auto &name = tables.names.at(i);
+        auto &stat = analysis.name_stats.at(i);
+        if (stat.times == 0)
+            continue;
 
         ofs << std::string(name.size(), '=') << std::endl
             << name << std::endl
@@ -169,117 +360,83 @@ void DumpStatToFile(const StringVec &name_vec, const StatVec &stat_vec, const st
             << "times            : " << stat.times << std::endl
             << "dur_min_us       : " << stat.dur_min_us << " us" << std::endl
             << "dur_avg_us       : " << stat.dur_avg_us << " us" << std::endl
+            << "dur_p50_us       : " << stat.histogram.percentile(50) << " us" << std::endl
+            << "dur_p90_us       : " << stat.histogram.percentile(90) << " us" << std::endl
+            << "dur_p99_us       : " << stat.histogram.percentile(99) << " us" << std::endl
+            << "dur_p999_us      : " << stat.histogram.percentile(99.9) << " us" << std::endl
             << "dur_max_us       : " << stat.dur_max_us << " us" << std::endl
             << "dur_max_at_us    : " << stat.dur_max_ts_us << " us" << std::endl
             << "dur_warn_line_us : " << stat.dur_warn_line_us << " us" << std::endl
             << "dur_warn_count   : " << stat.dur_warn_count << std::endl
             << std::endl;
     }
+
+    //! 各线程的利用率，即合并重叠的记录后，忙碌时长占总时长的比例
+    ofs << "=======" << std::endl
+        << "threads" << std::endl
+        << "-------" << std::endl;
+    auto thread_num = std::min(tables.threads.size(), analysis.thread_stats.size());
+    for (size_t i = 0; i < thread_num; ++i) {
+        auto &stat = analysis.thread_stats.at(i);
+        if (stat.times == 0)
+            continue;
+
+        double utilization = span_us > 0 ? stat.busy_us * 100.0 / span_us : 0;
+        ofs << std::setw(8) << tables.threads.at(i)
+            << " : times " << stat.times
+            << ", busy " << stat.busy_us << " us"
+            << ", utilization " << std::fixed << std::setprecision(2) << utilization << '%' << std::endl;
+    }
+}
+
 }
 
 int main(int argc, char **argv)
 {
-    if (argc <= 1) {
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
         PrintUsage(argv[0]);
         return 0;
     }
 
-    std::string dir_path = argv[1];
-    if (!util::fs::IsDirectoryExist(dir_path)) {
-        std::cerr << "Err: dir_path '" << dir_path << "' not exist!" << std::endl;
+    if (!util::fs::IsDirectoryExist(opts.dir_path)) {
+        std::cerr << "Err: dir_path '" << opts.dir_path << "' not exist!" << std::endl;
         return 0;
     }
 
-    std::string view_filename = dir_path + "/view.json";
-    std::string stat_filename = dir_path + "/stat.txt";
-
-    std::cout << "Info: Generating " << view_filename << std::endl;
-    trace::Writer writer;
-    if (!writer.open(view_filename)) {
-        std::cerr << "Err: Create '" << view_filename << "' fail!" << std::endl;
-        return 0;
-    }
+    std::string stat_filename = opts.dir_path + "/stat.txt";
 
     //! 从 threads.txt, names.txt, modules.txt 文件中导入数据
-    std::string names_filename = dir_path + "/names.txt";
-    std::string modules_filename = dir_path + "/modules.txt";
-    std::string threads_filename = dir_path + "/threads.txt";
+    std::string names_filename = opts.dir_path + "/names.txt";
+    std::string modules_filename = opts.dir_path + "/modules.txt";
+    std::string threads_filename = opts.dir_path + "/threads.txt";
 
-    StringVec name_vec, module_vec, thread_vec;
-    if (!util::fs::ReadAllLinesFromTextFile(names_filename, name_vec))
+    Tables tables;
+    if (!util::fs::ReadAllLinesFromTextFile(names_filename, tables.names))
         std::cerr << "Warn: Load names.txt fail!" << std::endl;
-    if (!util::fs::ReadAllLinesFromTextFile(modules_filename, module_vec))
+    if (!util::fs::ReadAllLinesFromTextFile(modules_filename, tables.modules))
         std::cerr << "Warn: Load modules.txt fail!" << std::endl;
-    if (!util::fs::ReadAllLinesFromTextFile(threads_filename, thread_vec))
+    if (!util::fs::ReadAllLinesFromTextFile(threads_filename, tables.threads))
         std::cerr << "Warn: Load threads.txt fail!" << std::endl;
 
-    std::vector<Stat> stat_vec(name_vec.size());
-    std::string records_dir = dir_path + "/records";
-
-    writer.writeHeader();
-
-    //! 第一次遍历记录文件
-    ReadAllRecordFiles(records_dir,
-        [&] (uint64_t start_ts_us, uint64_t duration_us, uint64_t name_index, uint64_t module_index, uint64_t thread_index) {
-            auto &name = name_vec.at(name_index);
-            auto &module = module_vec.at(module_index);
-            auto &thread = thread_vec.at(thread_index);
-
-            writer.writeRecorder(name, module, thread, start_ts_us, duration_us);
-
-            auto &stat = stat_vec.at(name_index);
-            stat.name_index = name_index;
-            stat.module_index = module_index;
-            ++stat.times;
-            stat.dur_acc_us += duration_us;
-            if (stat.dur_max_us < duration_us) {
-                stat.dur_max_us = duration_us;
-                stat.dur_max_ts_us = start_ts_us;
-            }
-
-            if (stat.dur_min_us > duration_us) {
-                stat.dur_min_us = duration_us;
-            }
-        }
-    );
-
-    //! 处理统计数据
-    for (auto &stat : stat_vec) {
-        if (stat.times > 0) {
-            stat.dur_avg_us = stat.dur_acc_us / stat.times;
-            stat.dur_warn_line_us = (stat.dur_avg_us + stat.dur_max_us) / 2;
-        }
-    }
-
-    //! 第二次遍历记录文件，标出超出警告线的
-    ReadAllRecordFiles(records_dir,
-        [&] (uint64_t start_ts_us, uint64_t duration_us, uint64_t name_index, uint64_t module_index, uint64_t) {
-            auto &stat = stat_vec.at(name_index);
-            if (duration_us < stat.dur_warn_line_us)
-                return;
-
-            auto &name = name_vec.at(name_index);
-            auto &module = module_vec.at(module_index);
-
-            ++stat.dur_warn_count;
-            writer.writeRecorder(name, module, "WARN", start_ts_us, duration_us);
-        }
-    );
+    StringVec record_file_vec;
+    if (!ListRecordFiles(opts.dir_path + "/records", record_file_vec))
+        return 0;
 
-    //! 标记出最大时间点
-    for (auto &stat : stat_vec) {
-        auto &name = name_vec.at(stat.name_index);
-        auto &module = module_vec.at(stat.module_index);
-        writer.writeRecorder(name, module, "MAX", stat.dur_max_ts_us, stat.dur_max_us);
-    }
+    //! 第一次遍历记录文件，统计
+    Analysis analysis;
+    size_t invalid_num = 0;
+    AnalyzeRecordFiles(record_file_vec, tables, opts, analysis, invalid_num);
+    if (invalid_num > 0)
+        std::cerr << "Warn: " << invalid_num << " records have invalid index, ignored" << std::endl;
 
-    writer.writeFooter();
+    //! 第二次遍历记录文件，生成 view.json，需要用到第一次得到的警告线
+    GenerateViews(record_file_vec, tables, opts, analysis);
 
     //! 输出统计到 stat.txt
     std::cout << "Info: Generating " << stat_filename << std::endl;
-    DumpStatToFile(name_vec, stat_vec, stat_filename);
+    DumpStatToFile(tables, analysis, invalid_num, stat_filename);
 
     std::cout << "Info: Success." << std::endl;
     return 0;
 }
-
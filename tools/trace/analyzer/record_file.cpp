@@ -0,0 +1,146 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "record_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+
+#include <tbox/util/scalable_integer.h>
+#include <tbox/util/block_compressor.h>
+
+namespace tbox {
+namespace trace {
+
+bool RecordFile::open(const std::string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = st.st_size;
+    if (size_ > 0) {
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            size_ = 0;
+            ::close(fd);
+            return false;
+        }
+        ::madvise(data_, size_, MADV_SEQUENTIAL);
+        is_mapped_ = true;
+    }
+
+    ::close(fd);    //! 映射建立后就可以关闭了
+
+    if (util::BlockDecompressor::IsFrame(data_, size_))
+        return decompress();
+
+    return true;
+}
+
+void RecordFile::close()
+{
+    if (is_mapped_) {
+        ::munmap(data_, size_);
+        is_mapped_ = false;
+    }
+    data_ = nullptr;
+    size_ = 0;
+    decompressed_.clear();
+}
+
+bool RecordFile::decompress()
+{
+    util::BlockDecompressor decompressor;
+    auto ptr = static_cast<const uint8_t*>(data_);
+    size_t pos = 0;
+    while (pos < size_) {
+        auto ret = decompressor.decompress(ptr + pos, size_ - pos, decompressed_);
+        if (ret > 0) {
+            pos += ret;
+        } else if (ret == 0) {
+            break;  //! 末尾不完整的帧，如崩溃时没写完的，忽略
+        } else {
+            //! 坏掉的帧只丢弃它自己，从下一个帧头继续，解压器会跳过引用它的帧直到下一个重置帧
+            std::cerr << "Warn: corrupted frame at offset " << pos << ", skip" << std::endl;
+            ++pos;
+            pos += util::BlockDecompressor::FindFrame(ptr + pos, size_ - pos);
+        }
+    }
+
+    ::munmap(data_, size_);
+    is_mapped_ = false;
+
+    data_ = &decompressed_[0];
+    size_ = decompressed_.size();
+    return true;
+}
+
+size_t RecordFile::decode(const RecordHandleFunc &func) const
+{
+    auto ptr = static_cast<const uint8_t*>(data_);
+    size_t remain_size = size_;
+    size_t record_num = 0;
+    uint64_t last_end_ts_us = 0;
+
+    while (remain_size > 0) {
+        //! 每条记录由5个可变长整数组成: end_diff, duration, thread, name, module
+        uint64_t values[5];
+        size_t data_size = 0;
+        for (auto &value : values) {
+            auto parse_size = util::ParseScalableInteger(ptr + data_size, remain_size - data_size, value);
+            if (parse_size == 0)
+                return record_num;
+            data_size += parse_size;
+        }
+        ptr += data_size;
+        remain_size -= data_size;
+
+        uint64_t end_ts_us = last_end_ts_us + values[0];
+        last_end_ts_us = end_ts_us;
+
+        Record record;
+        record.duration_us = values[1];
+        record.start_ts_us = end_ts_us - record.duration_us;
+        record.thread_index = values[2];
+        record.name_index = values[3];
+        record.module_index = values[4];
+
+        func(record);
+        ++record_num;
+    }
+
+    return record_num;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_ANALYZER_RECORD_FILE_H_20261019
+#define TBOX_TRACE_ANALYZER_RECORD_FILE_H_20261019
+
+#include <cstdint>
+#include <string>
+#include <functional>
+
+namespace tbox {
+namespace trace {
+
+//! 解码后的记录
+struct Record {
+  uint64_t start_ts_us;
+  uint64_t duration_us;
+  uint64_t thread_index;
+  uint64_t name_index;
+  uint64_t module_index;
+};
+
+/**
+ * 记录文件
+ *
+ * 以 mmap 的方式映射整个文件，顺序解码，不做额外的拷贝
+ * 压缩的记录文件(.bin.tbz)则先整个解压到内存中
+ */
+class RecordFile {
+ public:
+  using RecordHandleFunc = std::function<void(const Record &)>;
+
+  ~RecordFile() { close(); }
+
+  bool open(const std::string &filename);
+  void close();
+
+  //! 记录数据的大小，压缩的记录文件为解压后的大小
+  size_t size() const { return size_; }
+
+  /**
+   * 逐条解码记录，并回调 func
+   *
+   * \return  解码出的记录条数，文件末尾不完整的记录会被忽略
+   */
+  size_t decode(const RecordHandleFunc &func) const;
+
+ private:
+  bool decompress();
+
+ private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+  std::string decompressed_;  //!< 压缩的记录文件解压后的数据，此时 data_ 指向它
+  bool is_mapped_ = false;
+};
+
+}
+}
+
+#endif //TBOX_TRACE_ANALYZER_RECORD_FILE_H_20261019
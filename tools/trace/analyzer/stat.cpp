@@ -0,0 +1,129 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include "stat.h"
+
+#include <algorithm>
+
+namespace tbox {
+namespace trace {
+
+namespace {
+constexpr size_t kMaxPendingSpanNum = 4096;   //! 线程待合并区间的上限，超出则将前一半计入忙碌时长
+}
+
+void NameStat::add(const Record &record)
+{
+    module_index = record.module_index;
+    ++times;
+    dur_acc_us += record.duration_us;
+    if (dur_max_us < record.duration_us) {
+        dur_max_us = record.duration_us;
+        dur_max_ts_us = record.start_ts_us;
+    }
+    if (dur_min_us > record.duration_us)
+        dur_min_us = record.duration_us;
+    histogram.record(record.duration_us);
+}
+
+void NameStat::merge(const NameStat &other)
+{
+    if (other.times == 0)
+        return;
+
+    module_index = other.module_index;
+    times += other.times;
+    dur_acc_us += other.dur_acc_us;
+    //! 各文件合并的顺序不定，时长相同时取较早的，与顺序统计的结果一致
+    if (dur_max_us < other.dur_max_us ||
+        (dur_max_us == other.dur_max_us && dur_max_ts_us > other.dur_max_ts_us)) {
+        dur_max_us = other.dur_max_us;
+        dur_max_ts_us = other.dur_max_ts_us;
+    }
+    dur_min_us = std::min(dur_min_us, other.dur_min_us);
+    histogram.merge(other.histogram);
+}
+
+void ThreadStat::add(const Record &record)
+{
+    ++times;
+    if (record.duration_us == 0)
+        return;
+
+    Span span = { record.start_ts_us, record.start_ts_us + record.duration_us };
+
+    //! 与之重叠的区间都在末尾，合并之
+    while (!spans.empty() && spans.back().end >= span.begin) {
+        span.begin = std::min(span.begin, spans.back().begin);
+        span.end = std::max(span.end, spans.back().end);
+        spans.pop_back();
+    }
+    spans.push_back(span);
+
+    if (spans.size() >= kMaxPendingSpanNum) {
+        auto half = spans.size() / 2;
+        for (size_t i = 0; i < half; ++i)
+            busy_us += spans[i].end - spans[i].begin;
+        spans.erase(spans.begin(), spans.begin() + half);
+    }
+}
+
+//! 各记录文件分别统计，文件之间的区间不再合并
+void ThreadStat::merge(const ThreadStat &other)
+{
+    times += other.times;
+    busy_us += other.busy_us;
+    for (auto &span : other.spans)
+        busy_us += span.end - span.begin;
+}
+
+void Analysis::add(const Record &record)
+{
+    ++record_num;
+    begin_ts_us = std::min(begin_ts_us, record.start_ts_us);
+    end_ts_us = std::max(end_ts_us, record.start_ts_us + record.duration_us);
+
+    if (record.name_index >= name_stats.size())
+        name_stats.resize(record.name_index + 1);
+    name_stats[record.name_index].add(record);
+
+    if (record.thread_index >= thread_stats.size())
+        thread_stats.resize(record.thread_index + 1);
+    thread_stats[record.thread_index].add(record);
+}
+
+void Analysis::merge(const Analysis &other)
+{
+    record_num += other.record_num;
+    begin_ts_us = std::min(begin_ts_us, other.begin_ts_us);
+    end_ts_us = std::max(end_ts_us, other.end_ts_us);
+
+    if (other.name_stats.size() > name_stats.size())
+        name_stats.resize(other.name_stats.size());
+    for (size_t i = 0; i < other.name_stats.size(); ++i)
+        name_stats[i].merge(other.name_stats[i]);
+
+    if (other.thread_stats.size() > thread_stats.size())
+        thread_stats.resize(other.thread_stats.size());
+    for (size_t i = 0; i < other.thread_stats.size(); ++i)
+        thread_stats[i].merge(other.thread_stats[i]);
+}
+
+}
+}
@@ -0,0 +1,86 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#ifndef TBOX_TRACE_ANALYZER_STAT_H_20261019
+#define TBOX_TRACE_ANALYZER_STAT_H_20261019
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <tbox/util/histogram.h>
+
+#include "record_file.h"
+
+namespace tbox {
+namespace trace {
+
+//! 名称的统计数据
+struct NameStat {
+  uint64_t  module_index = 0;
+
+  size_t    times = 0;            //! 次数
+  uint64_t  dur_acc_us = 0;       //! 累积时长
+  uint64_t  dur_min_us = std::numeric_limits<uint64_t>::max(); //! 最小时长
+  uint64_t  dur_max_us = 0;       //! 最大时长
+  uint64_t  dur_max_ts_us = 0;    //! 最大时长的时间点
+  util::Histogram histogram;      //! 时长分布，可合并，用于计算分位值
+
+  uint64_t  dur_avg_us = 0;       //! 平均时长
+  uint64_t  dur_warn_line_us = 0; //! 警告水位线
+  uint64_t  dur_warn_count = 0;   //! 超过警告水位线次数
+
+  void add(const Record &record);
+  void merge(const NameStat &other);
+};
+
+/**
+ * 线程的统计数据
+ *
+ * 同一线程的记录按结束时间先后排列，嵌套的记录先内后外。
+ * 将重叠的记录合并后累加，得到线程的忙碌时长
+ */
+struct ThreadStat {
+  size_t    times = 0;            //! 记录数
+  uint64_t  busy_us = 0;          //! 已合并完成的忙碌时长
+
+  void add(const Record &record);
+  void merge(const ThreadStat &other);
+
+  struct Span { uint64_t begin, end; };
+  std::vector<Span> spans;        //! 尚未合并完成的区间，按时间升序且互不重叠
+};
+
+//! 一组记录文件的统计结果
+struct Analysis {
+  size_t    record_num = 0;
+  uint64_t  begin_ts_us = std::numeric_limits<uint64_t>::max();
+  uint64_t  end_ts_us = 0;
+
+  std::vector<NameStat> name_stats;
+  std::vector<ThreadStat> thread_stats;
+
+  void add(const Record &record);
+  void merge(const Analysis &other);
+};
+
+}
+}
+
+#endif //TBOX_TRACE_ANALYZER_STAT_H_20261019
@@ -46,24 +46,51 @@ bool Writer::writeRecorder(const std::string &name, const std::string &module,
     if (!ofs_.is_open())
         return false;
 
+    std::string record;
+    FormatRecorder(record, name, module, tid, start_ts_us, duration_us);
+    return writeFormatted(record);
+}
+
+bool Writer::writeFormatted(const std::string &records)
+{
+    if (!ofs_.is_open())
+        return false;
+
+    if (records.empty())
+        return true;
+
     if (!is_first_record_)
         ofs_ << ',' << std::endl;
     is_first_record_ = false;
 
-    ofs_  << R"({"name":")" << name
-          << R"(","cat":")" << module
-          << R"(","pid":"","tid":")"
-          << tid << R"(","ts":)" << start_ts_us << ',';
+    ofs_ << records;
+    return ofs_.good();
+}
+
+void Writer::FormatRecorder(std::string &out, const std::string &name, const std::string &module,
+                            const std::string &tid, uint64_t start_ts_us, uint64_t duration_us)
+{
+    if (!out.empty())
+        out += ",\n";
 
-    if (duration_us != 0)
-        ofs_ << R"("ph":"X","dur":)" << duration_us;
-    else
-        ofs_ << R"("ph":"I")";
+    out += R"({"name":")";
+    out += name;
+    out += R"(","cat":")";
+    out += module;
+    out += R"(","pid":"","tid":")";
+    out += tid;
+    out += R"(","ts":)";
+    out += std::to_string(start_ts_us);
+    out += ',';
 
-    ofs_ << "}";
-    ofs_.flush();
+    if (duration_us != 0) {
+        out += R"("ph":"X","dur":)";
+        out += std::to_string(duration_us);
+    } else {
+        out += R"("ph":"I")";
+    }
 
-    return true;
+    out += '}';
 }
 
 bool Writer::writeFooter()
@@ -34,8 +34,17 @@ class Writer {
   bool writeHeader();
   bool writeRecorder(const std::string &name, const std::string &module,
                      const std::string &tid, uint64_t start_ts_us, uint64_t duration_us);
+  //! 写入由 FormatRecorder() 生成的多条记录
+  bool writeFormatted(const std::string &records);
   bool writeFooter();
 
+  /**
+   * 将一条记录格式化后追加到 out 中，用于多个线程分别格式化，再成批写入
+   * out 不为空时，先追加分隔符
+   */
+  static void FormatRecorder(std::string &out, const std::string &name, const std::string &module,
+                             const std::string &tid, uint64_t start_ts_us, uint64_t duration_us);
+
  private:
   std::ofstream ofs_;
   bool is_first_record_ = true;
@@ -0,0 +1,261 @@
+/*
+ *     .============.
+ *    //  M A K E  / \
+ *   //  C++ DEV  /   \
+ *  //  E A S Y  /  \/ \
+ * ++ ----------.  \/\  .
+ *  \\     \     \ /\  /
+ *   \\     \     \   /
+ *    \\     \     \ /
+ *     -============'
+ *
+ * Copyright (c) 2024 Hevake and contributors, all rights reserved.
+ *
+ * This file is part of cpp-tbox (https://github.com/cpp-main/cpp-tbox)
+ * Use of this source code is governed by MIT license that can be found
+ * in the LICENSE file in the root of the source tree. All contributing
+ * project authors may be found in the CONTRIBUTORS.md file in the root
+ * of the source tree.
+ */
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <algorithm>
+
+#include <tbox/util/string.h>
+#include <tbox/trace/live_stream.h>
+
+using namespace std;
+using namespace tbox;
+
+namespace {
+
+struct Options {
+    std::string host;
+    std::string port;
+    size_t top_n = 20;
+    std::set<std::string> modules;
+    std::string name_keyword;
+};
+
+//! 一秒内某个名称的统计
+struct Stat {
+    uint64_t name_index = 0;
+    uint64_t module_index = 0;
+    size_t   times = 0;
+    uint64_t dur_acc_us = 0;
+    uint64_t dur_max_us = 0;
+};
+
+void PrintUsage(const char *proc_name)
+{
+    std::cout
+      << "This is cpp-tbox trace live viewer." << std::endl
+      << "It subscribes the trace records from a running process, and shows the hottest scopes per second." << std::endl
+      << "The process should be configured with 'trace.live_bind'." << std::endl
+      << std::endl
+      << "Usage: " << proc_name << " [options] <host>:<port>" << std::endl
+      << "Options:" << std::endl
+      << "  -n <num>          show top num scopes, default is 20" << std::endl
+      << "  -m <m1>,<m2>...   only subscribe the specified modules" << std::endl
+      << "  -k <keyword>      only subscribe the names that contain keyword" << std::endl
+      << "Exp  : " << proc_name << " -n 10 -m tbox.event 192.168.0.10:6061" << std::endl;
+}
+
+bool ParseArgs(int argc, char **argv, Options &opts)
+{
+    int opt;
+    while ((opt = ::getopt(argc, argv, "n:m:k:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                opts.top_n = std::atoi(optarg);
+                break;
+            case 'm': {
+                std::vector<std::string> module_vec;
+                util::string::Split(optarg, ",", module_vec);
+                opts.modules.insert(module_vec.begin(), module_vec.end());
+                break;
+            }
+            case 'k':
+                opts.name_keyword = optarg;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if (optind >= argc)
+        return false;
+
+    std::string addr = argv[optind];
+    auto pos = addr.rfind(':');
+    if (pos == std::string::npos || opts.top_n == 0)
+        return false;
+
+    opts.host = addr.substr(0, pos);
+    opts.port = addr.substr(pos + 1);
+    return true;
+}
+
+int Connect(const Options &opts)
+{
+    struct addrinfo hints, *result = nullptr;
+    ::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int ret = ::getaddrinfo(opts.host.c_str(), opts.port.c_str(), &hints, &result);
+    if (ret != 0) {
+        std::cerr << "Err: resolve '" << opts.host << "' fail, " << gai_strerror(ret) << std::endl;
+        return -1;
+    }
+
+    int sock_fd = -1;
+    for (auto ai = result; ai != nullptr; ai = ai->ai_next) {
+        sock_fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock_fd < 0)
+            continue;
+        if (::connect(sock_fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        ::close(sock_fd);
+        sock_fd = -1;
+    }
+    ::freeaddrinfo(result);
+
+    if (sock_fd < 0)
+        std::cerr << "Err: connect " << opts.host << ':' << opts.port << " fail" << std::endl;
+    return sock_fd;
+}
+
+void PrintTop(const Options &opts, const trace::LiveStreamDecoder &decoder,
+              const std::map<std::pair<uint64_t, uint64_t>, Stat> &stat_map,
+              size_t record_num, uint64_t dropped_num)
+{
+    std::vector<const Stat*> stat_vec;
+    for (auto &item : stat_map)
+        stat_vec.push_back(&item.second);
+
+    //! 按总时长降序，事件按次数
+    std::sort(stat_vec.begin(), stat_vec.end(),
+        [] (const Stat *a, const Stat *b) {
+            if (a->dur_acc_us != b->dur_acc_us)
+                return a->dur_acc_us > b->dur_acc_us;
+            return a->times > b->times;
+        }
+    );
+
+    std::ostringstream oss;
+    if (::isatty(STDOUT_FILENO))
+        oss << "\033[2J\033[H";   //! 清屏
+
+    time_t now = ::time(nullptr);
+    char time_str[32];
+    ::strftime(time_str, sizeof(time_str), "%F %T", ::localtime(&now));
+
+    oss << time_str << "  records: " << record_num << "/s  dropped: " << dropped_num << std::endl
+        << std::setw(10) << "TOTAL_US" << std::setw(10) << "TIMES"
+        << std::setw(10) << "AVG_US" << std::setw(10) << "MAX_US"
+        << "  " << std::left << std::setw(16) << "MODULE" << "NAME" << std::right << std::endl;
+
+    for (size_t i = 0; i < stat_vec.size() && i < opts.top_n; ++i) {
+        auto stat = stat_vec[i];
+        oss << std::setw(10) << stat->dur_acc_us
+            << std::setw(10) << stat->times
+            << std::setw(10) << stat->dur_acc_us / stat->times
+            << std::setw(10) << stat->dur_max_us
+            << "  " << std::left << std::setw(16) << decoder.getModule(stat->module_index)
+            << decoder.getName(stat->name_index) << std::right << std::endl;
+    }
+
+    std::cout << oss.str() << std::flush;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage(argv[0]);
+        return 0;
+    }
+
+    int sock_fd = Connect(opts);
+    if (sock_fd < 0)
+        return 1;
+
+    auto subscribe_line = trace::MakeSubscribeLine(opts.modules, opts.name_keyword);
+    if (::send(sock_fd, subscribe_line.data(), subscribe_line.size(), 0) < 0) {
+        std::cerr << "Err: send subscribe fail, " << strerror(errno) << std::endl;
+        ::close(sock_fd);
+        return 1;
+    }
+
+    trace::LiveStreamDecoder decoder;
+    std::map<std::pair<uint64_t, uint64_t>, Stat> stat_map;
+    size_t record_num = 0;
+    uint64_t dropped_num = 0;
+
+    decoder.setRecordCallback(
+        [&] (const trace::LiveStreamDecoder::Record &record) {
+            auto &stat = stat_map[std::make_pair(record.name_index, record.module_index)];
+            stat.name_index = record.name_index;
+            stat.module_index = record.module_index;
+            ++stat.times;
+            stat.dur_acc_us += record.duration_us;
+            stat.dur_max_us = std::max(stat.dur_max_us, record.duration_us);
+            ++record_num;
+        }
+    );
+    decoder.setDroppedCallback([&] (uint64_t num) { dropped_num += num; });
+
+    std::string pending;
+    auto next_print_time = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_print_time) {
+            PrintTop(opts, decoder, stat_map, record_num, dropped_num);
+            stat_map.clear();
+            record_num = 0;
+            dropped_num = 0;
+            next_print_time += std::chrono::seconds(1);
+            continue;
+        }
+
+        struct pollfd pfd = { sock_fd, POLLIN, 0 };
+        auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(next_print_time - now).count();
+        if (::poll(&pfd, 1, timeout_ms + 1) <= 0)
+            continue;
+
+        char buff[64 << 10];
+        auto rsize = ::recv(sock_fd, buff, sizeof(buff), 0);
+        if (rsize <= 0) {
+            std::cerr << "Info: connection closed" << std::endl;
+            break;
+        }
+
+        pending.append(buff, rsize);
+        auto decoded_size = decoder.decode(pending.data(), pending.size());
+        if (decoded_size < 0) {
+            //! 订阅命令有误时，服务端会回复文本的使用说明
+            std::cerr << "Err: invalid data: " << pending << std::endl;
+            break;
+        }
+        pending.erase(0, decoded_size);
+    }
+
+    ::close(sock_fd);
+    return 0;
+}